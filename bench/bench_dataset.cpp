@@ -0,0 +1,447 @@
+/*
+Benchmarks of the DataSet API. Each case builds datasets of a number of rows in one mix of
+types and times createDataPoint, addDataPoint, getDataPoint, filterByType, the value
+filters, aggregates and sort, serial and parallel, and freeDataSet. Every operation is
+reported as one line of JSON, or CSV with --csv, giving:
+
+    ns_per_row          wall time per row
+    bytes_per_row       bytes requested from malloc, calloc and realloc per row
+    allocations_per_row calls to malloc, calloc and realloc per row
+    peak_rss_kb         peak resident set size of the process so far
+
+so the output of two builds can be compared line by line. A case with few rows is
+repeated until it covers at least 10^6 rows. The allocation counts need glibc and are
+reported as 0 elsewhere.
+
+Build and run from the repository root:
+
+    g++ -std=c++17 -O2 -pthread -Isrc bench/bench_dataset.cpp solution/[a-z]*.cpp -o bench_dataset
+    ./bench_dataset --rows 1e3,1e6,1e8 --mix int,mixed --threads 8
+
+A case of 10^9 rows needs tens of gigabytes for the data points createDataPoint makes.
+*/
+
+#include "bitmap.h"
+#include "filter.h"
+#include "aggregate.h"
+#include "parallel.h"
+#include "sort.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+// Count the calls to the allocator and the bytes they request
+static std::atomic<int64_t> allocationCount(0);
+static std::atomic<int64_t> allocationBytes(0);
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *block, size_t size);
+
+    void *malloc(size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add((int64_t)size, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add((int64_t)(count * size), std::memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *block, size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add((int64_t)size, std::memory_order_relaxed);
+        return __libc_realloc(block, size);
+    }
+}
+
+static int64_t allocationsSoFar()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+static int64_t bytesSoFar()
+{
+    return allocationBytes.load(std::memory_order_relaxed);
+}
+#else
+static int64_t allocationsSoFar()
+{
+    return 0;
+}
+
+static int64_t bytesSoFar()
+{
+    return 0;
+}
+#endif
+
+// Define enums for the mixes of types a benchmark dataset holds
+typedef enum
+{
+    MIX_INT,    // INT values only
+    MIX_FLOAT,  // FLOAT values only
+    MIX_STRING, // STRING values from 1000 distinct strings
+    MIX_MIXED,  // INT, FLOAT and STRING values and empty slots in turn
+} Mix;
+
+static const char *mixNames[] = {"int", "float", "string", "mixed"};
+
+// Define a struct for the running totals of one operation of a case
+typedef struct
+{
+    const char *name;
+    double seconds;
+    int64_t allocations;
+    int64_t bytes;
+} Measure;
+
+// Define a struct for the start of a timed section
+typedef struct
+{
+    std::chrono::steady_clock::time_point time;
+    int64_t allocations;
+    int64_t bytes;
+} Mark;
+
+static Mark startMark()
+{
+    Mark mark;
+    mark.allocations = allocationsSoFar();
+    mark.bytes = bytesSoFar();
+    mark.time = std::chrono::steady_clock::now();
+    return mark;
+}
+
+// Add the time and allocations since a mark to a measure
+static void stopMark(const Mark &mark, Measure *measure)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    measure->seconds += std::chrono::duration<double>(now - mark.time).count();
+    measure->allocations += allocationsSoFar() - mark.allocations;
+    measure->bytes += bytesSoFar() - mark.bytes;
+}
+
+static long peakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Type of the data point in row i of a mix, or -1 for an empty row
+static int rowType(Mix mix, int64_t i)
+{
+    switch (mix)
+    {
+    case MIX_INT:
+        return INT;
+    case MIX_FLOAT:
+        return FLOAT;
+    case MIX_STRING:
+        return STRING;
+    default:
+        return i % 4 < 3 ? (int)(i % 4) : -1;
+    }
+}
+
+// Type the filters, aggregates and sort of a mix work on
+static DataType mainType(Mix mix)
+{
+    return mix == MIX_FLOAT ? FLOAT : mix == MIX_STRING ? STRING : INT;
+}
+
+// Fill in the data point of row i, whose value lives in the given storage
+static void rowPoint(Mix mix, int64_t i, DataPoint *point, int *intValue, float *floatValue, char *text, size_t length)
+{
+    point->type = (DataType)rowType(mix, i);
+    switch (point->type)
+    {
+    case INT:
+        *intValue = (int)((i * 2654435761u) % 1000000);
+        point->value = intValue;
+        break;
+    case FLOAT:
+        *floatValue = (float)(i % 10007) * 0.25f;
+        point->value = floatValue;
+        break;
+    default:
+        snprintf(text, length, "value-%d", (int)(i % 1000));
+        point->value = text;
+        break;
+    }
+}
+
+static void printHeader(bool csv)
+{
+    if (csv)
+    {
+        printf("operation,mix,rows,repeats,ns_per_row,bytes_per_row,allocations_per_row,peak_rss_kb\n");
+    }
+}
+
+static void printMeasure(bool csv, const Measure &measure, Mix mix, int64_t rows, int64_t repeats)
+{
+    double total = (double)rows * (double)repeats;
+    double ns = measure.seconds * 1e9 / total;
+    double bytes = (double)measure.bytes / total;
+    double allocations = (double)measure.allocations / total;
+    if (csv)
+    {
+        printf("%s,%s,%lld,%lld,%.3f,%.3f,%.4f,%ld\n", measure.name, mixNames[mix], (long long)rows, (long long)repeats, ns, bytes,
+               allocations, peakRssKb());
+    }
+    else
+    {
+        printf("{\"operation\":\"%s\",\"mix\":\"%s\",\"rows\":%lld,\"repeats\":%lld,\"ns_per_row\":%.3f,\"bytes_per_row\":%.3f,"
+               "\"allocations_per_row\":%.4f,\"peak_rss_kb\":%ld}\n",
+               measure.name, mixNames[mix], (long long)rows, (long long)repeats, ns, bytes, allocations, peakRssKb());
+    }
+    fflush(stdout);
+}
+
+// Keeps the compiler from dropping a loop whose result is otherwise unused
+static volatile int64_t sink;
+
+/*
+This function runs one case: rows rows of a mix, repeated so that the case covers at
+least 10^6 rows, and prints a line for each operation.
+*/
+static void runCase(Mix mix, int64_t rows, bool csv)
+{
+    enum
+    {
+        CREATE,
+        ADD,
+        GET,
+        FILTER_TYPE,
+        FILTER_VALUES,
+        AGGREGATE,
+        PARALLEL_FILTER,
+        PARALLEL_AGGREGATE,
+        SORT,
+        PARALLEL_SORT,
+        FREE,
+        OPERATIONS
+    };
+    Measure measures[OPERATIONS] = {
+        {"createDataPoint", 0, 0, 0},       {"addDataPoint", 0, 0, 0},           {"getDataPoint", 0, 0, 0},
+        {"filterByType", 0, 0, 0},          {"filterValues", 0, 0, 0},           {"aggregateValues", 0, 0, 0},
+        {"parallelFilterValues", 0, 0, 0},  {"parallelAggregateValues", 0, 0, 0}, {"sortValues", 0, 0, 0},
+        {"parallelSortValues", 0, 0, 0},    {"freeDataSet", 0, 0, 0},
+    };
+    DataType type = mainType(mix);
+    int64_t repeats = rows < 1000000 ? (1000000 + rows - 1) / rows : 1;
+    int intValue;
+    float floatValue;
+    char text[32];
+    for (int64_t r = 0; r < repeats; r++)
+    {
+        // createDataPoint makes one allocation for the point and one for its value
+        std::vector<DataPoint *> points((size_t)rows);
+        DataPoint point;
+        Mark mark = startMark();
+        for (int64_t i = 0; i < rows; i++)
+        {
+            rowPoint(mix, i, &point, &intValue, &floatValue, text, sizeof(text));
+            points[i] = point.type == (DataType)-1 ? NULL : createDataPoint(point.type, point.value);
+        }
+        stopMark(mark, &measures[CREATE]);
+        for (int64_t i = 0; i < rows; i++)
+        {
+            if (points[i] != NULL)
+            {
+                free(points[i]->value);
+                free(points[i]);
+            }
+        }
+        std::vector<DataPoint *>().swap(points);
+
+        mark = startMark();
+        DataSet *dataset = createDataSet(rows);
+        for (int64_t i = 0; i < rows; i++)
+        {
+            rowPoint(mix, i, &point, &intValue, &floatValue, text, sizeof(text));
+            if (rowType(mix, i) >= 0)
+            {
+                addDataPoint(dataset, i, &point);
+            }
+        }
+        stopMark(mark, &measures[ADD]);
+
+        mark = startMark();
+        int64_t held = 0;
+        for (int64_t i = 0; i < rows; i++)
+        {
+            held += getDataPoint(dataset, i) != NULL;
+        }
+        sink = held;
+        stopMark(mark, &measures[GET]);
+
+        mark = startMark();
+        DataSet *filtered = filterByType(dataset, type);
+        stopMark(mark, &measures[FILTER_TYPE]);
+        freeDataSet(filtered);
+
+        if (type != STRING)
+        {
+            int32_t intRange[2] = {100000, 500000};
+            float floatRange[2] = {100.0f, 1000.0f};
+            AggregateResult result;
+            mark = startMark();
+            Bitmap *selection = type == INT ? filterIntValues(dataset, COMPARE_BETWEEN, intRange, 2)
+                                            : filterFloatValues(dataset, COMPARE_BETWEEN, floatRange, 2);
+            stopMark(mark, &measures[FILTER_VALUES]);
+            mark = startMark();
+            aggregateValues(dataset, type, NULL, &result);
+            stopMark(mark, &measures[AGGREGATE]);
+            freeBitmap(selection);
+
+            mark = startMark();
+            selection = type == INT ? parallelFilterIntValues(dataset, COMPARE_BETWEEN, intRange, 2)
+                                    : parallelFilterFloatValues(dataset, COMPARE_BETWEEN, floatRange, 2);
+            stopMark(mark, &measures[PARALLEL_FILTER]);
+            mark = startMark();
+            parallelAggregateValues(dataset, type, NULL, &result);
+            stopMark(mark, &measures[PARALLEL_AGGREGATE]);
+            freeBitmap(selection);
+        }
+
+        int64_t count;
+        mark = startMark();
+        int64_t *order = sortValues(dataset, type, NULL, SORT_ASCENDING, &count);
+        stopMark(mark, &measures[SORT]);
+        free(order);
+        mark = startMark();
+        order = parallelSortValues(dataset, type, NULL, SORT_ASCENDING, &count);
+        stopMark(mark, &measures[PARALLEL_SORT]);
+        free(order);
+
+        mark = startMark();
+        freeDataSet(dataset);
+        stopMark(mark, &measures[FREE]);
+    }
+    for (int op = 0; op < OPERATIONS; op++)
+    {
+        if (type == STRING && op >= FILTER_VALUES && op <= PARALLEL_AGGREGATE)
+        {
+            continue;
+        }
+        printMeasure(csv, measures[op], mix, rows, repeats);
+    }
+}
+
+// Split a comma-separated list into its items
+static std::vector<std::string> splitList(const char *list)
+{
+    std::vector<std::string> items;
+    std::string item;
+    for (const char *c = list;; c++)
+    {
+        if (*c == ',' || *c == '\0')
+        {
+            if (!item.empty())
+            {
+                items.push_back(item);
+            }
+            item.clear();
+            if (*c == '\0')
+            {
+                return items;
+            }
+        }
+        else
+        {
+            item += *c;
+        }
+    }
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "usage: %s [--rows N,N,...] [--mix int,float,string,mixed] [--threads N] [--csv]\n"
+            "  --rows     rows per case, such as 1e3,1e6 (default 1e3,1e4,1e5,1e6,1e7)\n"
+            "  --mix      mixes of types to run (default all)\n"
+            "  --threads  threads of the parallel functions, 0 for one per hardware thread (default 0)\n"
+            "  --csv      print CSV instead of JSON lines\n",
+            program);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<int64_t> rows = {1000, 10000, 100000, 1000000, 10000000};
+    std::vector<Mix> mixes = {MIX_INT, MIX_FLOAT, MIX_STRING, MIX_MIXED};
+    bool csv = false;
+    for (int a = 1; a < argc; a++)
+    {
+        std::string option = argv[a];
+        if (option == "--csv")
+        {
+            csv = true;
+        }
+        else if (option == "--rows" && a + 1 < argc)
+        {
+            rows.clear();
+            for (const std::string &item : splitList(argv[++a]))
+            {
+                double value = strtod(item.c_str(), NULL);
+                if (value < 1)
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                rows.push_back((int64_t)value);
+            }
+        }
+        else if (option == "--mix" && a + 1 < argc)
+        {
+            mixes.clear();
+            for (const std::string &item : splitList(argv[++a]))
+            {
+                int m = 0;
+                while (m < 4 && item != mixNames[m])
+                {
+                    m++;
+                }
+                if (m == 4)
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                mixes.push_back((Mix)m);
+            }
+        }
+        else if (option == "--threads" && a + 1 < argc)
+        {
+            setThreadCount(atoi(argv[++a]));
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    printHeader(csv);
+    for (Mix mix : mixes)
+    {
+        for (int64_t count : rows)
+        {
+            runCase(mix, count, csv);
+        }
+    }
+    return 0;
+}
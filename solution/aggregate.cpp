@@ -0,0 +1,419 @@
+#include "aggregate.h"
+#include "filter.h"
+#include "internal.h"
+
+#include <float.h>
+#include <immintrin.h>
+
+/*
+Aggregation works one 64-bit word of the type bitmap at a time. A word whose 64 slots
+all take part is reduced with AVX2 over the contiguous column; any other word is reduced
+one set bit at a time. FLOAT sums are taken in double per word and the word sums are
+added with Kahan compensation, so long columns do not lose low-order bits. The AVX2 path
+is skipped when the filter kernel is pinned to KERNEL_SCALAR.
+*/
+
+void initPartial(Partial *partial)
+{
+    partial->count = 0;
+    partial->intSum = 0;
+    partial->sum = 0.0;
+    partial->compensation = 0.0;
+    partial->min = DBL_MAX;
+    partial->max = -DBL_MAX;
+}
+
+// Add a value to a Kahan-compensated sum
+static inline void kahanAdd(Partial *partial, double value)
+{
+    double y = value - partial->compensation;
+    double t = partial->sum + y;
+    partial->compensation = (t - partial->sum) - y;
+    partial->sum = t;
+}
+
+// AVX2: sum, min and max of 64 INT values
+__attribute__((target("avx2"))) static void reduceIntsAvx2(const int32_t *values, int64_t *sum, int32_t *min, int32_t *max)
+{
+    __m256i total = _mm256_setzero_si256();
+    __m256i low = _mm256_loadu_si256((const __m256i *)values);
+    __m256i high = low;
+    for (int j = 0; j < 64; j += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(values + j));
+        total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        low = _mm256_min_epi32(low, v);
+        high = _mm256_max_epi32(high, v);
+    }
+    int64_t lanes[4];
+    int32_t lows[8], highs[8];
+    _mm256_storeu_si256((__m256i *)lanes, total);
+    _mm256_storeu_si256((__m256i *)lows, low);
+    _mm256_storeu_si256((__m256i *)highs, high);
+    *sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    *min = lows[0];
+    *max = highs[0];
+    for (int k = 1; k < 8; k++)
+    {
+        *min = lows[k] < *min ? lows[k] : *min;
+        *max = highs[k] > *max ? highs[k] : *max;
+    }
+}
+
+// AVX2: sum in double, min and max of 64 FLOAT values; NaN values are left out of min and max
+__attribute__((target("avx2"))) static void reduceFloatsAvx2(const float *values, double *sum, float *min, float *max)
+{
+    __m256d total0 = _mm256_setzero_pd();
+    __m256d total1 = _mm256_setzero_pd();
+    __m256 low = _mm256_set1_ps(FLT_MAX);
+    __m256 high = _mm256_set1_ps(-FLT_MAX);
+    for (int j = 0; j < 64; j += 8)
+    {
+        __m256 v = _mm256_loadu_ps(values + j);
+        total0 = _mm256_add_pd(total0, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        total1 = _mm256_add_pd(total1, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+        // min and max return their second operand when the first is NaN
+        low = _mm256_min_ps(v, low);
+        high = _mm256_max_ps(v, high);
+    }
+    double lanes[4];
+    float lows[8], highs[8];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(total0, total1));
+    _mm256_storeu_ps(lows, low);
+    _mm256_storeu_ps(highs, high);
+    *sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    *min = lows[0];
+    *max = highs[0];
+    for (int k = 1; k < 8; k++)
+    {
+        *min = lows[k] < *min ? lows[k] : *min;
+        *max = highs[k] > *max ? highs[k] : *max;
+    }
+}
+
+// Aggregate the INT values of the slots set in mask over one word
+static void aggregateIntWord(const int32_t *block, uint64_t mask, bool vector, Partial *partial)
+{
+    if (mask == ~(uint64_t)0 && vector)
+    {
+        int64_t sum;
+        int32_t min, max;
+        reduceIntsAvx2(block, &sum, &min, &max);
+        partial->count += 64;
+        partial->intSum += sum;
+        partial->min = min < partial->min ? min : partial->min;
+        partial->max = max > partial->max ? max : partial->max;
+        return;
+    }
+    while (mask != 0)
+    {
+        int32_t value = block[__builtin_ctzll(mask)];
+        partial->count++;
+        partial->intSum += value;
+        partial->min = value < partial->min ? value : partial->min;
+        partial->max = value > partial->max ? value : partial->max;
+        mask &= mask - 1;
+    }
+}
+
+// Aggregate the FLOAT values of the slots set in mask over one word
+static void aggregateFloatWord(const float *block, uint64_t mask, bool vector, Partial *partial)
+{
+    if (mask == ~(uint64_t)0 && vector)
+    {
+        double sum;
+        float min, max;
+        reduceFloatsAvx2(block, &sum, &min, &max);
+        partial->count += 64;
+        kahanAdd(partial, sum);
+        partial->min = min < partial->min ? min : partial->min;
+        partial->max = max > partial->max ? max : partial->max;
+        return;
+    }
+    double sum = 0.0;
+    int64_t count = 0;
+    while (mask != 0)
+    {
+        float value = block[__builtin_ctzll(mask)];
+        count++;
+        sum += value;
+        partial->min = value < partial->min ? value : partial->min;
+        partial->max = value > partial->max ? value : partial->max;
+        mask &= mask - 1;
+    }
+    if (count > 0)
+    {
+        partial->count += count;
+        kahanAdd(partial, sum);
+    }
+}
+
+/*
+This function aggregates the INT values of the words [wordBegin, wordEnd) of a sealed dataset
+block by block. A block whose INT slots are all selected is answered from the count, sum,
+minimum and maximum kept in its header, since the values filling its other slots repeat its
+INT values; an RLE block adds each run once per selected slot in it; any other block is
+decoded and aggregated a word at a time.
+*/
+static void aggregateEncodedRange(const DataSet *dataset, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd,
+                                  bool vector, Partial *partial)
+{
+    const EncodedInts *column = dataset->encodedInts;
+    const int64_t blockWords = INT_BLOCK_SIZE / 64;
+    int32_t values[INT_BLOCK_SIZE];
+    uint64_t masks[INT_BLOCK_SIZE / 64];
+    for (int64_t b = wordBegin / blockWords; b * blockWords < wordEnd; b++)
+    {
+        const IntBlock *block = &column->blocks[b];
+        int64_t first = b * blockWords > wordBegin ? b * blockWords : wordBegin;
+        int64_t last = (b + 1) * blockWords < wordEnd ? (b + 1) * blockWords : wordEnd;
+        int64_t blockEnd = bitmapWordCount(dataset->size) < (b + 1) * blockWords ? bitmapWordCount(dataset->size) : (b + 1) * blockWords;
+        bool whole = first == b * blockWords && last == blockEnd;
+        int64_t count = 0;
+        memset(masks, 0, sizeof(masks));
+        for (int64_t w = first; w < last; w++)
+        {
+            uint64_t ints = dataset->typeIndex[INT].words[w];
+            uint64_t mask = selection != NULL ? ints & selection->words[w] : ints;
+            whole = whole && mask == ints;
+            masks[w - b * blockWords] = mask;
+            count += __builtin_popcountll(mask);
+        }
+        if (count == 0)
+        {
+            continue;
+        }
+        if (whole)
+        {
+            partial->count += count;
+            partial->intSum += block->sum;
+            partial->min = block->min < partial->min ? block->min : partial->min;
+            partial->max = block->max > partial->max ? block->max : partial->max;
+        }
+        else if (block->encoding == ENCODING_RLE)
+        {
+            int64_t begin = 0;
+            for (int r = 0; r < block->runs; r++)
+            {
+                int32_t value;
+                uint32_t end;
+                runAt(column, block, r, &value, &end);
+                int64_t selected = 0;
+                for (int64_t w = begin / 64; w < bitmapWordCount(end); w++)
+                {
+                    selected += __builtin_popcountll(masks[w] & rangeMask(w, begin, end));
+                }
+                if (selected > 0)
+                {
+                    partial->count += selected;
+                    partial->intSum += (int64_t)value * selected;
+                    partial->min = value < partial->min ? value : partial->min;
+                    partial->max = value > partial->max ? value : partial->max;
+                }
+                begin = end;
+            }
+        }
+        else
+        {
+            decodeIntBlock(column, b, blockLength(dataset->size, b), values);
+            for (int64_t w = first; w < last; w++)
+            {
+                if (masks[w - b * blockWords] != 0)
+                {
+                    aggregateIntWord(values + (size_t)(w - b * blockWords) * 64, masks[w - b * blockWords], vector, partial);
+                }
+            }
+        }
+    }
+}
+
+// Check the arguments shared by the aggregate functions
+bool validAggregate(const DataSet *dataset, DataType type, const Bitmap *selection)
+{
+    return dataset != NULL && (type == INT || type == FLOAT) && (selection == NULL || selection->size == dataset->size);
+}
+
+// Aggregate the values of a type over the words [wordBegin, wordEnd) into a partial
+void aggregateRange(const DataSet *dataset, DataType type, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd, Partial *partial)
+{
+    bool vector = getFilterKernel() != KERNEL_SCALAR;
+    if (type == INT && dataset->encodedInts != NULL)
+    {
+        aggregateEncodedRange(dataset, selection, wordBegin, wordEnd, vector, partial);
+        countScan(dataset, wordSlots(dataset->size, wordBegin, wordEnd), 0);
+        return;
+    }
+    const int64_t zoneWords = ZONE_SIZE / 64;
+    int64_t skipped = 0;
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        // Skip a zone without a value of the type
+        if (dataset->zones != NULL && (w == wordBegin || w % zoneWords == 0) && dataset->zones[w / zoneWords].counts[type] == 0)
+        {
+            int64_t next = (w / zoneWords + 1) * zoneWords;
+            skipped += wordSlots(dataset->size, w, next < wordEnd ? next : wordEnd);
+            w = next - 1;
+            continue;
+        }
+        uint64_t mask = dataset->typeIndex[type].words[w];
+        if (selection != NULL)
+        {
+            mask &= selection->words[w];
+        }
+        if (mask == 0)
+        {
+            continue;
+        }
+        if (type == INT)
+        {
+            aggregateIntWord(dataset->ints + (size_t)w * 64, mask, vector, partial);
+        }
+        else
+        {
+            aggregateFloatWord(dataset->floats + (size_t)w * 64, mask, vector, partial);
+        }
+    }
+    countScan(dataset, wordSlots(dataset->size, wordBegin, wordEnd) - skipped, skipped);
+}
+
+// Add the aggregates of one partial into another
+void mergePartial(Partial *into, const Partial *from)
+{
+    into->count += from->count;
+    into->intSum += from->intSum;
+    kahanAdd(into, from->sum);
+    kahanAdd(into, -from->compensation);
+    into->min = from->min < into->min ? from->min : into->min;
+    into->max = from->max > into->max ? from->max : into->max;
+}
+
+// Turn the aggregates of a partial into a result
+void finishAggregate(const Partial *partial, DataType type, AggregateResult *result)
+{
+    result->count = partial->count;
+    result->intSum = partial->intSum;
+    result->sum = type == INT ? (double)partial->intSum : partial->sum;
+    bool any = partial->count > 0 && partial->min <= partial->max;
+    result->min = any ? partial->min : 0.0;
+    result->max = any ? partial->max : 0.0;
+    result->avg = partial->count > 0 ? result->sum / partial->count : 0.0;
+}
+
+/*
+This function computes COUNT, SUM, MIN, MAX and AVG over the values of a specified type
+in a dataset, restricted to the slots set in a selection bitmap unless the selection is NULL.
+INT sums are exact in intSum and also given as a double in sum. MIN, MAX and AVG are 0 when
+no value takes part, and NaN FLOAT values are left out of MIN and MAX.
+It returns false if the dataset or result is NULL, the type is not INT or FLOAT, or the
+selection size differs from the dataset size.
+*/
+bool aggregateValues(DataSet *dataset, DataType type, const Bitmap *selection, AggregateResult *result)
+{
+    ScopedStatTimer timer(STAT_TIMER_AGGREGATE);
+    if (!validAggregate(dataset, type, selection) || result == NULL)
+    {
+        return false;
+    }
+    Partial partial;
+    initPartial(&partial);
+    aggregateRange(dataset, type, selection, 0, bitmapWordCount(dataset->size), &partial);
+    finishAggregate(&partial, type, result);
+    return true;
+}
+
+// Map a value to the key used for distinct counting; -0.0 counts as 0.0 and every NaN as one value
+static inline uint32_t distinctKey(const DataSet *dataset, DataType type, int64_t index)
+{
+    if (type == INT)
+    {
+        return (uint32_t)dataset->ints[index];
+    }
+    float value = dataset->floats[index];
+    if (value == 0.0f)
+    {
+        value = 0.0f;
+    }
+    else if (value != value)
+    {
+        return 0x7fc00000u;
+    }
+    uint32_t key;
+    memcpy(&key, &value, sizeof(key));
+    return key;
+}
+
+/*
+This function counts the distinct values of a specified type in a dataset, restricted to
+the slots set in a selection bitmap unless the selection is NULL. Values are inserted into
+an open-addressing hash set sized for the number of values taking part.
+It returns -1 if the arguments are invalid as for aggregateValues or memory runs out.
+*/
+int64_t countDistinctValues(DataSet *dataset, DataType type, const Bitmap *selection)
+{
+    if (!validAggregate(dataset, type, selection))
+    {
+        return -1;
+    }
+    int64_t words = bitmapWordCount(dataset->size);
+    int64_t count = 0;
+    for (int64_t w = 0; w < words; w++)
+    {
+        uint64_t mask = dataset->typeIndex[type].words[w];
+        count += __builtin_popcountll(selection != NULL ? mask & selection->words[w] : mask);
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+    size_t tableSize = 16;
+    int shift = 60;
+    while (tableSize < (size_t)count * 2)
+    {
+        tableSize *= 2;
+        shift--;
+    }
+    // Each entry holds a key in its low half and 1 in its high half when taken
+    uint64_t *table = (uint64_t *)calloc(tableSize, sizeof(uint64_t));
+    if (table == NULL)
+    {
+        return -1;
+    }
+    // The values of a sealed INT column are decoded a block at a time
+    bool sealed = type == INT && dataset->encodedInts != NULL;
+    int32_t values[INT_BLOCK_SIZE];
+    int64_t decoded = -1;
+    int64_t distinct = 0;
+    for (int64_t w = 0; w < words; w++)
+    {
+        uint64_t mask = dataset->typeIndex[type].words[w];
+        if (selection != NULL)
+        {
+            mask &= selection->words[w];
+        }
+        if (sealed && mask != 0 && w * 64 / INT_BLOCK_SIZE != decoded)
+        {
+            decoded = w * 64 / INT_BLOCK_SIZE;
+            decodeIntBlock(dataset->encodedInts, decoded, blockLength(dataset->size, decoded), values);
+        }
+        while (mask != 0)
+        {
+            int64_t index = w * 64 + __builtin_ctzll(mask);
+            uint32_t key = sealed ? (uint32_t)values[index % INT_BLOCK_SIZE] : distinctKey(dataset, type, index);
+            uint64_t entry = ((uint64_t)1 << 32) | key;
+            size_t slot = (size_t)((entry * 0x9E3779B97F4A7C15ull) >> shift);
+            while (table[slot] != 0 && table[slot] != entry)
+            {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+            if (table[slot] == 0)
+            {
+                table[slot] = entry;
+                distinct++;
+            }
+            mask &= mask - 1;
+        }
+    }
+    free(table);
+    return distinct;
+}
@@ -0,0 +1,213 @@
+#include "allocator.h"
+#include "internal.h"
+
+/*
+Allocators. Every array a dataset owns is taken from the allocator of the dataset through
+allocateBlock, resizeBlock and releaseBlock, with malloc behind a NULL allocator. The arena
+allocator hands out memory by bumping a pointer through large zero-filled blocks and never
+frees a single block: freeing a dataset returns nothing to it, and freeArenaAllocator hands
+every block back to malloc at once. An arena takes no lock, so each thread gives its datasets
+an arena of its own and allocates without contending with the others.
+*/
+
+#define ARENA_ALIGNMENT 16
+
+// Define a struct for a block of an arena, followed by the memory it hands out
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;
+    size_t size; // bytes that follow the block header
+    size_t used; // bytes handed out
+} ArenaBlock;
+
+// Define a struct for an arena allocator
+typedef struct
+{
+    Allocator allocator;
+    ArenaBlock *blocks; // block memory is handed out from, followed by the older blocks
+    size_t blockSize;
+    void *last; // most recent allocation, which can still grow in place
+} Arena;
+
+// Round a size up to the arena alignment
+static inline size_t alignSize(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+// Get the memory of an arena block
+static inline char *blockBytes(ArenaBlock *block)
+{
+    return (char *)block + alignSize(sizeof(ArenaBlock));
+}
+
+// Hand out size bytes of zero-filled memory by bumping the pointer of the current block
+static void *arenaAllocate(void *context, size_t size)
+{
+    Arena *arena = (Arena *)context;
+    size = alignSize(size > 0 ? size : 1);
+    ArenaBlock *block = arena->blocks;
+    if (block == NULL || block->size - block->used < size)
+    {
+        size_t bytes = size > arena->blockSize ? size : arena->blockSize;
+        block = (ArenaBlock *)calloc(1, alignSize(sizeof(ArenaBlock)) + bytes);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        block->size = bytes;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+    void *memory = blockBytes(block) + block->used;
+    block->used += size;
+    arena->last = memory;
+    return memory;
+}
+
+// Grow the most recent allocation in place when its block has room, otherwise move it
+static void *arenaResize(void *context, void *memory, size_t oldSize, size_t size)
+{
+    Arena *arena = (Arena *)context;
+    ArenaBlock *block = arena->blocks;
+    if (size <= oldSize)
+    {
+        // Shrinking the most recent allocation gives its tail back, zero-filled for a later grow
+        if (memory != NULL && memory == arena->last)
+        {
+            size_t offset = (size_t)((char *)memory - blockBytes(block));
+            memset((char *)memory + size, 0, block->used - offset - size);
+            block->used = offset + alignSize(size > 0 ? size : 1);
+        }
+        return memory;
+    }
+    if (memory != NULL && memory == arena->last)
+    {
+        size_t offset = (size_t)((char *)memory - blockBytes(block));
+        if (alignSize(size) <= block->size - offset)
+        {
+            block->used = offset + alignSize(size);
+            return memory;
+        }
+    }
+    void *moved = arenaAllocate(context, size);
+    if (moved != NULL && memory != NULL)
+    {
+        memcpy(moved, memory, oldSize);
+    }
+    return moved;
+}
+
+// Give back the most recent allocation; any other block stays in use until the arena is freed
+static void arenaRelease(void *context, void *memory, size_t size)
+{
+    Arena *arena = (Arena *)context;
+    if (memory == NULL || memory != arena->last)
+    {
+        return;
+    }
+    // Memory handed out again must be zero-filled
+    ArenaBlock *block = arena->blocks;
+    size_t offset = (size_t)((char *)memory - blockBytes(block));
+    (void)size;
+    memset(memory, 0, block->used - offset);
+    block->used = offset;
+    arena->last = NULL;
+}
+
+/*
+This function creates an arena allocator that takes memory from malloc in blocks of
+blockSize bytes, or ARENA_BLOCK_SIZE if blockSize is 0, and hands it out by bumping a
+pointer. Memory handed out is only returned by freeArenaAllocator, so an arena suits
+datasets sized up front and freed together. It returns NULL if memory runs out.
+*/
+Allocator *createArenaAllocator(size_t blockSize)
+{
+    Arena *arena = (Arena *)calloc(1, sizeof(Arena));
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+    arena->blockSize = blockSize > 0 ? alignSize(blockSize) : ARENA_BLOCK_SIZE;
+    arena->allocator.allocate = arenaAllocate;
+    arena->allocator.resize = arenaResize;
+    arena->allocator.release = arenaRelease;
+    arena->allocator.context = arena;
+    return &arena->allocator;
+}
+
+/*
+This function frees an arena allocator and every block of memory it handed out, one free
+per block regardless of how many allocations were made. Datasets taking memory from the
+arena must not be used afterwards; they need no freeDataSet.
+*/
+void freeArenaAllocator(Allocator *allocator)
+{
+    if (allocator == NULL)
+    {
+        return;
+    }
+    Arena *arena = (Arena *)allocator->context;
+    ArenaBlock *block = arena->blocks;
+    while (block != NULL)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+/*
+This function allocates size bytes of zero-filled memory from an allocator, or with calloc
+if the allocator is NULL. It returns NULL if memory runs out.
+*/
+void *allocateBlock(Allocator *allocator, size_t size)
+{
+    countStat(STAT_BLOCK_ALLOCATIONS, 1);
+    countStat(STAT_BLOCK_BYTES, size);
+    if (allocator == NULL)
+    {
+        return calloc(1, size);
+    }
+    return allocator->allocate(allocator->context, size);
+}
+
+/*
+This function resizes a block of oldSize bytes to size bytes, keeping its contents and
+zero-filling any growth. A NULL block is allocated. It returns NULL if memory runs out,
+in which case the block is unchanged.
+*/
+void *resizeBlock(Allocator *allocator, void *block, size_t oldSize, size_t size)
+{
+    countStat(STAT_BLOCK_ALLOCATIONS, 1);
+    countStat(STAT_BLOCK_BYTES, size);
+    if (allocator != NULL)
+    {
+        return allocator->resize(allocator->context, block, oldSize, size);
+    }
+    void *resized = realloc(block, size);
+    if (resized != NULL && size > oldSize)
+    {
+        memset((char *)resized + oldSize, 0, size - oldSize);
+    }
+    return resized;
+}
+
+/*
+This function releases a block of size bytes to its allocator, or with free if the
+allocator is NULL. A NULL block is ignored.
+*/
+void releaseBlock(Allocator *allocator, void *block, size_t size)
+{
+    countStat(STAT_BLOCK_RELEASES, block != NULL);
+    if (allocator == NULL)
+    {
+        free(block);
+        return;
+    }
+    if (block != NULL)
+    {
+        allocator->release(allocator->context, block, size);
+    }
+}
@@ -1,4 +1,47 @@
 #include "bitmap.h"
+#include "internal.h"
+
+// Capacity of a dataset created or grown without a capacity
+#define MIN_CAPACITY 16
+
+// Allocate the words of a bitmap of a specified size from an allocator with room for capacity bits, all bits clear
+static bool initBitmap(Bitmap *bitmap, int64_t size, int64_t capacity, Allocator *allocator)
+{
+    bitmap->size = size;
+    bitmap->words = (uint64_t *)allocateBlock(allocator, bitmapWordCount(capacity > 0 ? capacity : 1) * sizeof(uint64_t));
+    return bitmap->words != NULL;
+}
+
+// Free the words of a bitmap with room for capacity bits
+static void releaseBitmap(Bitmap *bitmap, int64_t capacity, Allocator *allocator)
+{
+    releaseBlock(allocator, bitmap->words, bitmapWordCount(capacity > 0 ? capacity : 1) * sizeof(uint64_t));
+    bitmap->words = NULL;
+    bitmap->size = 0;
+}
+
+// Count the set bits of a bitmap, one word at a time
+static int64_t countBits(const Bitmap *bitmap)
+{
+    int64_t count = 0;
+    int64_t words = bitmapWordCount(bitmap->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        count += __builtin_popcountll(bitmap->words[w]);
+    }
+    return count;
+}
+
+// Mark slot index as empty in the present bitmap and every type bitmap
+static void clearSlotBits(DataSet *dataset, int64_t index)
+{
+    noteSlotCleared(dataset, index);
+    clearBit(&dataset->present, index);
+    for (int t = 0; t < DATA_TYPE_COUNT; t++)
+    {
+        clearBit(&dataset->typeIndex[t], index);
+    }
+}
 
 /*
 This function creates a new data point with a given data type and value.
@@ -57,251 +100,1652 @@ DataPoint *createDataPoint(DataType type, void *value)
     // Set the fields of the new data point
     point->type = type;
     point->value = copy;
+    countStat(STAT_DATA_POINTS_CREATED, 1);
+    countStat(STAT_DATA_POINT_ALLOCATIONS, 2);
     return point;
 }
 
+// Allocate a dataset of a given size from an allocator with room for capacity slots, all empty
+static DataSet *allocateDataSet(int64_t size, int64_t capacity, Allocator *allocator)
+{
+    DataSet *dataset = (DataSet *)allocateBlock(allocator, sizeof(DataSet)); // allocate memory for dataset struct
+    if (dataset == NULL)
+    { // check for memory allocation failure
+        return NULL;
+    }
+
+    dataset->size = size; // set size of dataset
+    dataset->capacity = capacity;
+    dataset->allocator = allocator;
+
+    // The data point view is left to the first getDataPoint, as most datasets are never read through it
+    dataset->types = (uint8_t *)allocateBlock(allocator, capacity * sizeof(uint8_t));
+    dataset->zones = allocateZones(allocator, capacity);
+
+    // Allocate the validity bitmap and the per-type bitmaps, all bits clear
+    bool ok = dataset->types != NULL && dataset->zones != NULL;
+    ok = initBitmap(&dataset->present, size, capacity, allocator) && ok;
+    for (int t = 0; t < DATA_TYPE_COUNT; t++)
+    {
+        ok = initBitmap(&dataset->typeIndex[t], size, capacity, allocator) && ok;
+    }
+    if (!ok)
+    { // check for memory allocation failure
+        freeDataSet(dataset);
+        return NULL;
+    }
+    return dataset;
+}
+
+// Allocate the data point view of a dataset if it has none yet
+// Zero-filled memory leaves every data point NULL with the default type INT.
+static bool ensureDataPointView(DataSet *dataset)
+{
+    if (dataset->data == NULL)
+    {
+        dataset->data = (DataPoint *)allocateBlock(dataset->allocator, (size_t)dataset->capacity * sizeof(DataPoint));
+    }
+    return dataset->data != NULL;
+}
+
 /*
 This function creates a data set with a specified number of data points.
 It checks for invalid input size and returns NULL if the size is less than or equal to zero.
-It allocates memory for the dataset and the data points. It initializes the data points to NULL
-and sets the default data type to INT. Finally, it sets the data points for the dataset and returns the dataset.
+It allocates memory for the dataset, the data point view and the type tag of each slot.
+The data point view is zero-filled, which sets every data point to NULL with the default
+data type INT; since its callers may read it directly, it is allocated up front here, while
+the other ways of creating a dataset leave it to the first getDataPoint. The value columns
+are only allocated once a value of their type is added.
+It then allocates the validity bitmap and one bitmap per data type, all cleared.
+Finally, it returns the dataset.
 */
-DataSet *createDataSet(int size)
+DataSet *createDataSet(int64_t size)
 {
     if (size <= 0)
     { // check for invalid input size
         return NULL;
     }
-    DataSet *dataset = (DataSet *)malloc(sizeof(DataSet)); // allocate memory for dataset struct
-    if (dataset == NULL)
-    { // check for memory allocation failure
+    DataSet *dataset = allocateDataSet(size, size, NULL);
+    if (dataset != NULL && !ensureDataPointView(dataset))
+    {
+        freeDataSet(dataset);
         return NULL;
     }
+    return dataset;
+}
 
-    dataset->size = size; // set size of dataset
+/*
+This function creates an empty dataset, of size zero, with room for a specified number of
+data points, so that many appends run without reallocating. A capacity of zero gives a
+small default capacity. It returns NULL if the capacity is negative or memory runs out.
+*/
+DataSet *createDataSetWithCapacity(int64_t capacity)
+{
+    if (capacity < 0)
+    {
+        return NULL;
+    }
+    return allocateDataSet(0, capacity > 0 ? capacity : MIN_CAPACITY, NULL);
+}
 
-    DataPoint *data = (DataPoint *)malloc(size * sizeof(DataPoint)); // allocate memory for data points
-    if (data == NULL)
-    { // check for memory allocation failure
-        free(dataset);
+/*
+This function creates an empty dataset like createDataSetWithCapacity whose struct, columns,
+bitmaps and strings all come from an allocator, such as an arena from createArenaAllocator.
+The dataset does not own the allocator, which must outlive it.
+It returns NULL if the capacity is negative or memory runs out.
+*/
+DataSet *createDataSetWithAllocator(int64_t capacity, Allocator *allocator)
+{
+    if (capacity < 0)
+    {
         return NULL;
     }
+    return allocateDataSet(0, capacity > 0 ? capacity : MIN_CAPACITY, allocator);
+}
 
-    for (int i = 0; i < size; i++)
-    {                       // initialize data points to NULL
-        data[i].type = INT; // default data type to INT
-        data[i].value = NULL;
+// Record slot index as holding a value of a given type in the type tags and the bitmaps
+static void markSlot(DataSet *dataset, int64_t index, DataType type)
+{
+    noteSlotStored(dataset, index, type);
+    countStored(dataset, 1);
+    dataset->types[index] = (uint8_t)type;
+    setBit(&dataset->present, index);
+    setBit(&dataset->typeIndex[type], index);
+}
+
+/*
+This function allocates the column that holds values of a given type in a dataset,
+zero-filled, unless it is already allocated. STRING values need the per-slot offsets
+and lengths of the arena, which a dictionary-encoded dataset replaces by its codes.
+It returns false if the type is invalid or memory runs out.
+*/
+bool ensureColumn(DataSet *dataset, DataType type)
+{
+    switch (type)
+    {
+    case INT:
+        if (dataset->ints == NULL)
+        {
+            dataset->ints = (int32_t *)allocateBlock(dataset->allocator, dataset->capacity * sizeof(int32_t));
+        }
+        return dataset->ints != NULL;
+    case FLOAT:
+        if (dataset->floats == NULL)
+        {
+            dataset->floats = (float *)allocateBlock(dataset->allocator, dataset->capacity * sizeof(float));
+        }
+        return dataset->floats != NULL;
+    case STRING:
+        if (dataset->dictionary != NULL)
+        {
+            return true;
+        }
+        if (dataset->strings.offsets == NULL)
+        {
+            dataset->strings.offsets = (uint64_t *)allocateBlock(dataset->allocator, dataset->capacity * sizeof(uint64_t));
+        }
+        if (dataset->strings.lengths == NULL)
+        {
+            dataset->strings.lengths = (uint32_t *)allocateBlock(dataset->allocator, dataset->capacity * sizeof(uint32_t));
+        }
+        return dataset->strings.offsets != NULL && dataset->strings.lengths != NULL;
+    default:
+        return false;
     }
+}
 
-    dataset->data = data; // set data points for dataset
-    return dataset;
+// Grow the string arena of a dataset, at least doubling it, until a number of bytes more fit
+static bool reserveArena(DataSet *dataset, size_t bytes)
+{
+    StringArena *arena = &dataset->strings;
+    if (arena->length + bytes <= arena->capacity)
+    {
+        return true;
+    }
+    size_t capacity = arena->capacity == 0 ? 4096 : arena->capacity;
+    while (capacity < arena->length + bytes)
+    {
+        capacity *= 2;
+    }
+    char *resized = (char *)resizeBlock(dataset->allocator, arena->bytes, arena->capacity, capacity);
+    if (resized == NULL)
+    {
+        return false;
+    }
+    arena->bytes = resized;
+    arena->capacity = capacity;
+    return true;
 }
 
 /*
-This function adds a data point to a dataset at a specific index.
-It checks if the dataset and data point are not NULL, if the index
-is within the bounds of the dataset, and if the data point type
-matches the dataset type. It then frees the existing data point
-at the specified index, if any, sets the data point at the specified index,
-and allocates memory for the data point value and copies it from the input point.
-The memory allocation is based on the data type of the data point - integer, float or string.
+This function appends a string of a given length, followed by a NUL, to the string
+arena of a dataset and stores its offset in the arena through offset. The arena grows
+geometrically, so appending is a bump of the arena length and one memcpy in the common
+case. The string may itself live in the arena, as its position is taken before the
+arena moves. It returns false if memory runs out.
 */
-// Function to add a data point to a dataset
-void addDataPoint(DataSet *dataset, int index, DataPoint *point)
+static bool appendToArena(DataSet *dataset, const char *value, size_t length, uint64_t *offset)
 {
-    // Check if the dataset and point are not NULL
-    if (dataset == NULL || point == NULL)
+    StringArena *arena = &dataset->strings;
+    // Take the position of a string held by the arena itself before the arena can move
+    bool inArena = arena->bytes != NULL && value >= arena->bytes && value < arena->bytes + arena->length;
+    size_t source = inArena ? (size_t)(value - arena->bytes) : 0;
+    if (!reserveArena(dataset, length + 1))
     {
-        return;
+        return false;
     }
-    // Check if the index is within the bounds of the dataset
-    if (index < 0 || index >= dataset->size)
+    if (inArena)
     {
-        return;
+        value = arena->bytes + source;
     }
-    // Check if the data point type matches the dataset type
-    if (dataset->data[index].type != point->type)
+    memcpy(arena->bytes + arena->length, value, length);
+    arena->bytes[arena->length + length] = '\0';
+    *offset = arena->length;
+    arena->length += length + 1;
+    return true;
+}
+
+// FNV-1a hash of a string of a given length
+uint32_t hashString(const char *value, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
     {
-        return;
+        hash = (hash ^ (uint8_t)value[i]) * 16777619u;
     }
-    // Free the existing data point at the specified index, if any
-    if (dataset->data[index].value != NULL)
+    return hash;
+}
+
+// Write the dictionary code held by slot index
+static inline void setCode(StringDictionary *dictionary, int64_t index, uint32_t code)
+{
+    switch (dictionary->codeWidth)
     {
-        free(dataset->data[index].value);
+    case 1:
+        ((uint8_t *)dictionary->codes)[index] = (uint8_t)code;
+        break;
+    case 2:
+        ((uint16_t *)dictionary->codes)[index] = (uint16_t)code;
+        break;
+    default:
+        ((uint32_t *)dictionary->codes)[index] = code;
+        break;
     }
-    // Set the data point at the specified index
-    dataset->data[index].type = point->type;
-    // Allocate memory for the data point value and copy it from the input point
-    switch (point->type)
+}
+
+/*
+This function widens the code array of a dictionary to hold codes of width bytes.
+The array is reallocated in place and converted from the last slot to the first,
+so no entry is overwritten before it is read. It returns false if memory runs out.
+*/
+static bool widenCodes(DataSet *dataset, int64_t size, int width)
+{
+    StringDictionary *dictionary = dataset->dictionary;
+    void *codes = resizeBlock(dataset->allocator, dictionary->codes, (size_t)size * dictionary->codeWidth, (size_t)size * width);
+    if (codes == NULL)
     {
-    case INT:
-        dataset->data[index].value = malloc(sizeof(int));
-        if (dataset->data[index].value != NULL)
+        return false;
+    }
+    int oldWidth = dictionary->codeWidth;
+    for (int64_t i = size - 1; i >= 0; i--)
+    {
+        uint32_t code = oldWidth == 1 ? ((uint8_t *)codes)[i] : ((uint16_t *)codes)[i];
+        if (width == 2)
         {
-            memcpy(dataset->data[index].value, point->value, sizeof(int));
+            ((uint16_t *)codes)[i] = (uint16_t)code;
         }
-        break;
+        else
+        {
+            ((uint32_t *)codes)[i] = code;
+        }
+    }
+    dictionary->codes = codes;
+    dictionary->codeWidth = width;
+    return true;
+}
 
-    case FLOAT:
-        dataset->data[index].value = malloc(sizeof(float));
-        if (dataset->data[index].value != NULL)
+// Find the code of a string in a dictionary, or -1 if the dictionary does not hold it
+static int findCode(const StringDictionary *dictionary, const char *bytes, const char *value, size_t length, uint32_t hash)
+{
+    uint32_t mask = (uint32_t)dictionary->tableSize - 1;
+    for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        uint32_t entry = dictionary->table[slot];
+        if (entry == 0)
         {
-            memcpy(dataset->data[index].value, point->value, sizeof(float));
+            return -1;
         }
-        break;
+        uint32_t code = entry - 1;
+        if (dictionary->hashes[code] == hash && dictionary->lengths[code] == length &&
+            memcmp(bytes + dictionary->offsets[code], value, length) == 0)
+        {
+            return (int)code;
+        }
+    }
+}
 
-    case STRING:
-        // Check if the input string is NULL or empty
-        if (point->value == NULL || *(char *)point->value == '\0')
+// Double the hash table of a dictionary and reinsert every code
+static bool growTable(DataSet *dataset)
+{
+    StringDictionary *dictionary = dataset->dictionary;
+    int tableSize = dictionary->tableSize * 2;
+    uint32_t *table = (uint32_t *)allocateBlock(dataset->allocator, tableSize * sizeof(uint32_t));
+    if (table == NULL)
+    {
+        return false;
+    }
+    uint32_t mask = (uint32_t)tableSize - 1;
+    for (int code = 0; code < dictionary->count; code++)
+    {
+        uint32_t slot = dictionary->hashes[code] & mask;
+        while (table[slot] != 0)
         {
-            return;
+            slot = (slot + 1) & mask;
         }
+        table[slot] = (uint32_t)code + 1;
+    }
+    releaseBlock(dataset->allocator, dictionary->table, dictionary->tableSize * sizeof(uint32_t));
+    dictionary->table = table;
+    dictionary->tableSize = tableSize;
+    return true;
+}
 
-        size_t str_len = strlen((char *)point->value) + 1;
-        dataset->data[index].value = malloc(str_len);
-        if (dataset->data[index].value != NULL)
+/*
+This function returns the dictionary code of a string, adding the string to the
+dictionary and to the string arena if it is not held yet. The hash table is kept at
+most half full, and the code array of the dataset is widened once the number of
+distinct strings no longer fits its code width. It returns -1 if memory runs out.
+*/
+static int internString(DataSet *dataset, const char *value, size_t length)
+{
+    StringDictionary *dictionary = dataset->dictionary;
+    uint32_t hash = hashString(value, length);
+    int code = findCode(dictionary, dataset->strings.bytes, value, length, hash);
+    if (code >= 0)
+    {
+        return code;
+    }
+    // Make room for one more distinct string
+    if (dictionary->count == dictionary->capacity)
+    {
+        int capacity = dictionary->capacity * 2;
+        Allocator *allocator = dataset->allocator;
+        uint64_t *offsets = (uint64_t *)resizeBlock(allocator, dictionary->offsets, dictionary->capacity * sizeof(uint64_t),
+                                                    capacity * sizeof(uint64_t));
+        if (offsets != NULL)
         {
-            memcpy(dataset->data[index].value, point->value, str_len);
+            dictionary->offsets = offsets;
         }
-        break;
+        uint32_t *lengths = (uint32_t *)resizeBlock(allocator, dictionary->lengths, dictionary->capacity * sizeof(uint32_t),
+                                                    capacity * sizeof(uint32_t));
+        if (lengths != NULL)
+        {
+            dictionary->lengths = lengths;
+        }
+        uint32_t *hashes = (uint32_t *)resizeBlock(allocator, dictionary->hashes, dictionary->capacity * sizeof(uint32_t),
+                                                   capacity * sizeof(uint32_t));
+        if (hashes != NULL)
+        {
+            dictionary->hashes = hashes;
+        }
+        if (offsets == NULL || lengths == NULL || hashes == NULL)
+        {
+            return -1;
+        }
+        dictionary->capacity = capacity;
+    }
+    if ((dictionary->count + 1) * 2 > dictionary->tableSize && !growTable(dataset))
+    {
+        return -1;
+    }
+    // Widen the codes once the new code does not fit
+    int width = dictionary->count < 256 ? 1 : dictionary->count < 65536 ? 2 : 4;
+    if (width > dictionary->codeWidth && !widenCodes(dataset, dataset->capacity, width))
+    {
+        return -1;
+    }
+    code = dictionary->count;
+    if (!appendToArena(dataset, value, length, &dictionary->offsets[code]))
+    {
+        return -1;
+    }
+    dictionary->lengths[code] = (uint32_t)length;
+    dictionary->hashes[code] = hash;
+    uint32_t mask = (uint32_t)dictionary->tableSize - 1;
+    uint32_t slot = hash & mask;
+    while (dictionary->table[slot] != 0)
+    {
+        slot = (slot + 1) & mask;
     }
+    dictionary->table[slot] = (uint32_t)code + 1;
+    dictionary->count++;
+    return code;
 }
 
 /*
-This function retrieves a data point from a dataset by its index.
-It checks for errors such as invalid dataset or index, and returns
-NULL if any errors are encountered. If the data point exists and is
-of type INT, FLOAT, or STRING, it is returned, otherwise NULL is returned.
+This function stores a string of a given length for slot index of a dataset.
+A dictionary-encoded dataset stores the code of the string; otherwise the string is
+appended to the arena and its offset and length are recorded for the slot.
+It returns false if memory runs out.
 */
-// Function to get a data point from a dataset
-DataPoint *getDataPoint(DataSet *dataset, int index)
+static bool storeString(DataSet *dataset, int64_t index, const char *value, size_t length)
 {
-    if (dataset == NULL)
+    if (length > UINT32_MAX)
     {
-        return NULL;
+        return false;
+    }
+    if (dataset->dictionary != NULL)
+    {
+        int code = internString(dataset, value, length);
+        if (code < 0)
+        {
+            return false;
+        }
+        setCode(dataset->dictionary, index, (uint32_t)code);
+        return true;
+    }
+    StringArena *arena = &dataset->strings;
+    if (!ensureColumn(dataset, STRING))
+    {
+        return false;
     }
+    if (!appendToArena(dataset, value, length, &arena->offsets[index]))
+    {
+        return false;
+    }
+    arena->lengths[index] = (uint32_t)length;
+    return true;
+}
 
-    if (index < 0 || index >= dataset->size)
+// Free the arrays of a dictionary of a dataset with room for capacity slots, and the dictionary itself
+static void releaseDictionary(StringDictionary *dictionary, int64_t capacity, Allocator *allocator)
+{
+    if (dictionary == NULL)
     {
-        return NULL;
+        return;
     }
+    releaseBlock(allocator, dictionary->offsets, dictionary->capacity * sizeof(uint64_t));
+    releaseBlock(allocator, dictionary->lengths, dictionary->capacity * sizeof(uint32_t));
+    releaseBlock(allocator, dictionary->hashes, dictionary->capacity * sizeof(uint32_t));
+    releaseBlock(allocator, dictionary->table, dictionary->tableSize * sizeof(uint32_t));
+    releaseBlock(allocator, dictionary->codes, capacity * dictionary->codeWidth);
+    releaseBlock(allocator, dictionary, sizeof(StringDictionary));
+}
 
-    DataPoint *point = &dataset->data[index];
+/*
+This function stores a value of a given type into slot index of a dataset.
+It allocates the column for the type on first use, copies the value into the
+column (or the string arena) and updates the type tag,
+the validity bitmap and the type bitmaps. It returns false if memory runs out,
+in which case the slot is left empty.
+*/
+bool storeValue(DataSet *dataset, int64_t index, DataType type, const void *value)
+{
+    clearSlotBits(dataset, index);
 
-    if (point == NULL || point->value == NULL)
+    if (!ensureColumn(dataset, type))
     {
-        return NULL;
+        return false;
     }
-
-    switch (point->type)
+    switch (type)
     {
     case INT:
+        memcpy(&dataset->ints[index], value, sizeof(int32_t));
+        break;
     case FLOAT:
+        memcpy(&dataset->floats[index], value, sizeof(float));
+        break;
     case STRING:
-        return point;
+        if (!storeString(dataset, index, (const char *)value, strlen((const char *)value)))
+        {
+            return false;
+        }
+        break;
     default:
-        return NULL;
+        return false;
     }
+
+    markSlot(dataset, index, type);
+    return true;
 }
 
 /*
-The function frees memory allocated for a dataset structure and all its data points.
-It checks whether the dataset and its data are not NULL, and if so, it frees each
-data point based on its type (integer, float, or string) and then frees the dataset struct itself.
-If the dataset has no data, it just frees the dataset struct.
+This function stores a string of a given length into slot index of a dataset, like
+storeValue but without scanning the string for its end. It returns false if memory runs out.
 */
+bool storeStringValue(DataSet *dataset, int64_t index, const char *value, size_t length)
+{
+    clearSlotBits(dataset, index);
+    if (!ensureColumn(dataset, STRING) || !storeString(dataset, index, value, length))
+    {
+        return false;
+    }
+    markSlot(dataset, index, STRING);
+    return true;
+}
 
-void freeDataSet(DataSet *dataset)
+// Reallocate an array of count elements of a given width to capacity elements, zero-filling new elements
+static bool reallocArray(Allocator *allocator, void **array, size_t count, size_t capacity, size_t width)
 {
-    if (dataset == NULL)
+    if (*array == NULL)
     {
-        return;
+        return true;
     }
-    if (dataset->data == NULL)
+    void *resized = resizeBlock(allocator, *array, count * width, capacity * width);
+    if (resized == NULL)
     {
-        // Dataset has no data, free the dataset struct itself
-        free(dataset);
-        return;
+        return false;
     }
+    *array = resized;
+    return true;
+}
 
-    // Free each data point in the dataset
-    for (int i = 0; i < dataset->size; i++)
+/*
+This function reallocates every array of a dataset, the data point view, the type tags,
+the allocated columns, the dictionary codes, the bitmap words and the zone maps, for a new capacity of
+at least the size. New slots are empty. On failure the arrays already reallocated keep
+their new length but the capacity is unchanged, which is safe both ways as every slot
+past the size is empty. It returns false if memory runs out.
+*/
+static bool reallocDataSet(DataSet *dataset, int64_t capacity)
+{
+    size_t count = (size_t)dataset->capacity;
+    size_t words = (size_t)bitmapWordCount(dataset->capacity);
+    size_t capacityWords = (size_t)bitmapWordCount(capacity);
+    Allocator *allocator = dataset->allocator;
+    bool ok = reallocArray(allocator, (void **)&dataset->data, count, capacity, sizeof(DataPoint)) &&
+              reallocArray(allocator, (void **)&dataset->types, count, capacity, sizeof(uint8_t)) &&
+              reallocArray(allocator, (void **)&dataset->ints, count, capacity, sizeof(int32_t)) &&
+              reallocArray(allocator, (void **)&dataset->floats, count, capacity, sizeof(float)) &&
+              reallocArray(allocator, (void **)&dataset->strings.offsets, count, capacity, sizeof(uint64_t)) &&
+              reallocArray(allocator, (void **)&dataset->strings.lengths, count, capacity, sizeof(uint32_t)) &&
+              (dataset->dictionary == NULL ||
+               reallocArray(allocator, &dataset->dictionary->codes, count, capacity, dataset->dictionary->codeWidth)) &&
+              reallocArray(allocator, (void **)&dataset->present.words, words, capacityWords, sizeof(uint64_t));
+    for (int t = 0; t < DATA_TYPE_COUNT && ok; t++)
     {
-        DataPoint *point = getDataPoint(dataset, i);
-        if (point != NULL)
-        {
-            // Free the value pointed to by the data point
-            switch (point->type)
-            {
-            case INT:
-                free((int *)point->value);
-                break;
-            case FLOAT:
-                free((float *)point->value);
-                break;
-            case STRING:
-                free((char *)point->value);
-                break;
-            }
-            // Free the data point itself
-            free(point);
-        }
+        ok = reallocArray(allocator, (void **)&dataset->typeIndex[t].words, words, capacityWords, sizeof(uint64_t));
     }
-
-    // Free the dataset struct
-    free(dataset);
+    if (!ok || !resizeZones(dataset, capacity))
+    {
+        return false;
+    }
+    dataset->capacity = capacity;
+    countWrite(&dataset->stats.resizes, 1);
+    return true;
 }
 
 /*
-This function takes a dataset and a data type as input and returns a new dataset that
-contains only the data points from the original dataset that have the specified data type.
-It creates a new dataset to hold the filtered data, loops through all data points in the
-input dataset, and checks if each point is of the specified type. If it is, it creates a
-new data point with the same type and value and adds it to the filtered dataset.
-If the input dataset is NULL or the filtered dataset cannot be created, it returns NULL.
+This function makes room for at least a specified number of slots in a dataset without
+changing its size, so that many appends or resizes run without reallocating.
+It returns false if the dataset is NULL, mapped read-only or sealed, the capacity is negative,
+or memory runs out, in which case the dataset is unchanged.
 */
-DataSet *filterByType(DataSet *dataset, DataType type)
+bool reserveDataSet(DataSet *dataset, int64_t capacity)
 {
-    // Check if dataset is NULL
-    if (dataset == NULL)
+    if (dataset == NULL || readOnly(dataset) || capacity < 0)
     {
-        return NULL;
+        return false;
     }
-    // Create a new dataset to hold filtered data
-    DataSet *filteredData = createDataSet(dataset->size);
-    // Check if filteredData is NULL
-    if (filteredData == NULL)
+    if (capacity <= dataset->capacity)
     {
-        return NULL;
+        return true;
     }
-    // Loop through all data points in the dataset
-    for (int i = 0; i < dataset->size; i++)
+    return reallocDataSet(dataset, capacity);
+}
+
+// Make room for size slots, at least doubling the capacity so that appends reallocate a logarithmic number of times
+static bool growDataSet(DataSet *dataset, int64_t size)
+{
+    if (size <= dataset->capacity)
     {
-        DataPoint *point = getDataPoint(dataset, i);
-        // Check if the point pointer is NULL before accessing its members
-        if (point == NULL)
-        {
-            continue;
-        }
-        // Check if the data point is of the specified type
-        if (point->type == type)
+        return true;
+    }
+    int64_t capacity = dataset->capacity * 2 > MIN_CAPACITY ? dataset->capacity * 2 : MIN_CAPACITY;
+    return reallocDataSet(dataset, size > capacity ? size : capacity);
+}
+
+// Empty the slots [begin, end) of a dataset, clearing their type tags, views and bits
+static void clearSlots(DataSet *dataset, int64_t begin, int64_t end)
+{
+    noteRangeCleared(dataset, begin, end);
+    memset(dataset->types + begin, 0, (size_t)(end - begin) * sizeof(uint8_t));
+    if (dataset->data != NULL)
+    {
+        memset(dataset->data + begin, 0, (size_t)(end - begin) * sizeof(DataPoint));
+    }
+    for (int64_t w = begin / 64; w < bitmapWordCount(end); w++)
+    {
+        uint64_t keep = ~rangeMask(w, begin, end);
+        dataset->present.words[w] &= keep;
+        for (int t = 0; t < DATA_TYPE_COUNT; t++)
         {
-            // Create a new data point with the same type and value
-            DataPoint *newPoint = createDataPoint(type, point->value);
-            // Check if the newPoint pointer is NULL before adding it to the filtered dataset
-            if (newPoint == NULL)
-            {
-                continue;
-            }
-            // Check if the filteredData pointer is NULL before adding a new data point to it
-            if (filteredData == NULL)
-            {
-                free(newPoint);
-                continue;
-            }
-            // Add the new data point to the filtered dataset
-            addDataPoint(filteredData, filteredData->size, newPoint);
+            dataset->typeIndex[t].words[w] &= keep;
         }
     }
-    return filteredData;
+}
+
+/*
+This function changes the number of slots of a dataset. Growing past the capacity at least
+doubles it, so a sequence of one-slot resizes costs amortized constant time; new slots are
+empty. Shrinking empties the slots past the new size, although their strings stay in the
+arena, and keeps the capacity. Pointers returned by getDataPoint are invalidated.
+It returns false if the dataset is NULL, mapped read-only or sealed, the size is negative or memory
+runs out, in which case the dataset is unchanged.
+*/
+bool resizeDataSet(DataSet *dataset, int64_t size)
+{
+    if (dataset == NULL || readOnly(dataset) || size < 0)
+    {
+        return false;
+    }
+    if (!growDataSet(dataset, size))
+    {
+        return false;
+    }
+    if (size < dataset->size)
+    {
+        clearSlots(dataset, size, dataset->size);
+    }
+    dataset->size = size;
+    dataset->present.size = size;
+    for (int t = 0; t < DATA_TYPE_COUNT; t++)
+    {
+        dataset->typeIndex[t].size = size;
+    }
+    return true;
+}
+
+/*
+This function releases the room allocated past the last slot of a dataset, reallocating
+its arrays for exactly its size (one slot for an empty dataset).
+It returns false if the dataset is NULL, mapped read-only or sealed, or memory runs out.
+*/
+bool shrinkDataSet(DataSet *dataset)
+{
+    if (dataset == NULL || readOnly(dataset))
+    {
+        return false;
+    }
+    int64_t capacity = dataset->size > 0 ? dataset->size : 1;
+    if (capacity == dataset->capacity)
+    {
+        return true;
+    }
+    return reallocDataSet(dataset, capacity);
+}
+
+/*
+This function checks whether a data point can be stored into slot index of a dataset: the
+dataset must not be mapped read-only or sealed, the data point type must be valid and match the type
+of the value already held at that index (an empty slot accepts any type), and the value
+must not be NULL or an empty string.
+*/
+static bool acceptsDataPoint(const DataSet *dataset, int64_t index, const DataPoint *point)
+{
+    // Check if the dataset is writable
+    if (readOnly(dataset))
+    {
+        return false;
+    }
+    // Check if the data point type is valid
+    if (point->type != INT && point->type != FLOAT && point->type != STRING)
+    {
+        return false;
+    }
+    // Check if the data point type matches the type of the value held at the index
+    if (testBit(&dataset->present, index) && dataset->types[index] != point->type)
+    {
+        return false;
+    }
+    if (point->value == NULL)
+    {
+        return false;
+    }
+    // Check if the input string is empty
+    if (point->type == STRING && *(char *)point->value == '\0')
+    {
+        return false;
+    }
+    return true;
+}
+
+/*
+This function adds a data point to a dataset at a specific index.
+It checks if the dataset and data point are not NULL, if the index
+is within the bounds of the dataset, if the dataset is not mapped
+read-only from a file, and if the data point type
+matches the type of the value already held at that index (an empty slot
+accepts any type). It then copies the value of the data point into the
+column of its type - integer, float or string - replacing any value held
+at the specified index, and updates the type tag and the bitmaps for the slot.
+*/
+// Function to add a data point to a dataset
+void addDataPoint(DataSet *dataset, int64_t index, DataPoint *point)
+{
+    // Check if the dataset and point are not NULL
+    if (dataset == NULL || point == NULL)
+    {
+        return;
+    }
+    // Check if the index is within the bounds of the dataset
+    if (index < 0 || index >= dataset->size)
+    {
+        return;
+    }
+    if (!acceptsDataPoint(dataset, index, point))
+    {
+        return;
+    }
+    storeValue(dataset, index, point->type, point->value);
+}
+
+/*
+This function adds a data point to a dataset at a specific index like addDataPoint, and takes
+ownership of the data point: the data point and its value, both allocated with malloc as by
+createDataPoint, are freed whether or not the value could be stored, so the caller frees nothing.
+It returns false if the data point could not be stored, for the same reasons as addDataPoint,
+or memory runs out.
+*/
+bool adoptDataPoint(DataSet *dataset, int64_t index, DataPoint *point)
+{
+    if (point == NULL)
+    {
+        return false;
+    }
+    bool stored = dataset != NULL && index >= 0 && index < dataset->size && acceptsDataPoint(dataset, index, point) &&
+                  storeValue(dataset, index, point->type, point->value);
+    free(point->value);
+    free(point);
+    return stored;
+}
+
+/*
+This function constructs a STRING value of a given length in place in slot index of a dataset.
+The fill callback is given length bytes reserved at the end of the string arena and writes
+the string straight into them, so the string is never built in a buffer of its own and then
+copied; the NUL is added after it. A dictionary-encoded dataset interns the string instead,
+which takes one temporary buffer. The slot must be empty or hold a STRING value, as with
+addDataPoint. It returns false if the dataset or callback is NULL, the index is out of bounds,
+the length is 0 or too long, the dataset is read-only, the slot holds another type, or memory
+runs out, in which case the callback is not called or the slot is left empty.
+*/
+bool emplaceStringValue(DataSet *dataset, int64_t index, size_t length, void (*fill)(char *bytes, size_t length, void *context),
+                        void *context)
+{
+    if (dataset == NULL || fill == NULL || index < 0 || index >= dataset->size || length == 0 || length > UINT32_MAX ||
+        readOnly(dataset) || (testBit(&dataset->present, index) && dataset->types[index] != STRING))
+    {
+        return false;
+    }
+    if (dataset->dictionary != NULL)
+    {
+        char *bytes = (char *)malloc(length);
+        if (bytes == NULL)
+        {
+            return false;
+        }
+        fill(bytes, length, context);
+        bool stored = storeStringValue(dataset, index, bytes, length);
+        free(bytes);
+        return stored;
+    }
+    StringArena *arena = &dataset->strings;
+    clearSlotBits(dataset, index);
+    if (!ensureColumn(dataset, STRING) || !reserveArena(dataset, length + 1))
+    {
+        return false;
+    }
+    fill(arena->bytes + arena->length, length, context);
+    arena->bytes[arena->length + length] = '\0';
+    arena->offsets[index] = arena->length;
+    arena->lengths[index] = (uint32_t)length;
+    arena->length += length + 1;
+    markSlot(dataset, index, STRING);
+    return true;
+}
+
+/*
+This function appends a data point to the end of a dataset, growing the dataset by one slot.
+The capacity at least doubles whenever it runs out, so appends take amortized constant time.
+It returns the index of the new data point, or -1 if the dataset or data point is NULL or
+invalid, the dataset is mapped read-only or sealed, or memory runs out, in which case the size is unchanged.
+*/
+int64_t appendDataPoint(DataSet *dataset, DataPoint *point)
+{
+    if (dataset == NULL || point == NULL)
+    {
+        return -1;
+    }
+    int64_t index = dataset->size;
+    if (!resizeDataSet(dataset, index + 1))
+    {
+        return -1;
+    }
+    if (!acceptsDataPoint(dataset, index, point) || !storeValue(dataset, index, point->type, point->value))
+    {
+        resizeDataSet(dataset, index);
+        return -1;
+    }
+    return index;
+}
+
+/*
+This function checks that count values of a given type can be stored from slot start of a
+dataset on: the dataset must not be mapped read-only or sealed, start must be within the dataset or
+at its end, and no slot of the range may hold a value of another type. The slots are checked
+64 at a time against the validity and type bitmaps. It then grows the dataset to cover the
+range and allocates the column for the type. It returns false if a check fails or memory
+runs out, in which case the dataset is unchanged apart from its capacity.
+*/
+static bool prepareRange(DataSet *dataset, int64_t start, int64_t count, DataType type)
+{
+    if (readOnly(dataset) || start < 0 || start > dataset->size || count < 0 || count > INT64_MAX - start)
+    {
+        return false;
+    }
+    int64_t end = start + count;
+    int64_t held = end < dataset->size ? end : dataset->size;
+    for (int64_t w = start / 64; start < held && w < bitmapWordCount(held); w++)
+    {
+        uint64_t other = dataset->present.words[w] & ~dataset->typeIndex[type].words[w];
+        if ((other & rangeMask(w, start, held)) != 0)
+        {
+            return false;
+        }
+    }
+    if (end > dataset->size && !growDataSet(dataset, end))
+    {
+        return false;
+    }
+    return ensureColumn(dataset, type) && resizeDataSet(dataset, end > dataset->size ? end : dataset->size);
+}
+
+// Tag the slots [start, start + count) with a type and set their bits, one word at a time
+static void markRange(DataSet *dataset, int64_t start, int64_t count, DataType type)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    int64_t end = start + count;
+    noteRangeStored(dataset, start, end, type);
+    countStored(dataset, count);
+    memset(dataset->types + start, type, (size_t)count);
+    for (int64_t w = start / 64; w < bitmapWordCount(end); w++)
+    {
+        uint64_t mask = rangeMask(w, start, end);
+        dataset->present.words[w] |= mask;
+        dataset->typeIndex[type].words[w] |= mask;
+    }
+}
+
+/*
+This function stores an array of count INT or FLOAT values into the slots of a dataset
+starting at slot start, with one memcpy into the column, replacing the values held there.
+Slots past the end of the dataset are appended, so start may equal the size.
+*/
+template <typename T>
+static bool addFixedValues(DataSet *dataset, int64_t start, const T *values, int64_t count, DataType type)
+{
+    if (dataset == NULL || (values == NULL && count > 0) || !prepareRange(dataset, start, count, type))
+    {
+        return false;
+    }
+    T *column = type == INT ? (T *)dataset->ints : (T *)dataset->floats;
+    memcpy(column + start, values, (size_t)count * sizeof(T));
+    markRange(dataset, start, count, type);
+    return true;
+}
+
+/*
+This function stores count INT values into the slots of a dataset starting at slot start.
+The values are copied into the column with one memcpy and the type tags and bitmaps are
+updated a word at a time. Slots past the end of the dataset are appended.
+It returns false if the dataset is NULL, mapped read-only or sealed, the values are NULL, start is
+past the end of the dataset, a slot of the range holds a value of another type, or memory
+runs out, in which case no value is stored.
+*/
+bool addIntValues(DataSet *dataset, int64_t start, const int32_t *values, int64_t count)
+{
+    return addFixedValues(dataset, start, values, count, INT);
+}
+
+/*
+This function stores count FLOAT values into the slots of a dataset starting at slot start,
+in the same way as addIntValues.
+*/
+bool addFloatValues(DataSet *dataset, int64_t start, const float *values, int64_t count)
+{
+    return addFixedValues(dataset, start, values, count, FLOAT);
+}
+
+/*
+This function stores count STRING values, given as views of their bytes, into the slots of a
+dataset starting at slot start, in the same way as addIntValues. The strings need not be
+NUL-terminated. Without a dictionary the string arena is grown once for the whole batch and
+each string is one memcpy into it; with a dictionary each string is interned.
+It also returns false if a view is NULL or empty, in which case no value is stored. If memory
+runs out while interning, the strings interned so far are kept and the rest of the range is
+left empty.
+*/
+bool addStringValues(DataSet *dataset, int64_t start, const StringView *values, int64_t count)
+{
+    if (dataset == NULL || (values == NULL && count > 0))
+    {
+        return false;
+    }
+    size_t bytes = 0;
+    for (int64_t i = 0; i < count; i++)
+    {
+        if (values[i].data == NULL || values[i].length == 0)
+        {
+            return false;
+        }
+        bytes += (size_t)values[i].length + 1;
+    }
+    if (!prepareRange(dataset, start, count, STRING))
+    {
+        return false;
+    }
+    if (dataset->dictionary == NULL && !reserveArena(dataset, bytes))
+    {
+        return false;
+    }
+    for (int64_t i = 0; i < count; i++)
+    {
+        if (!storeString(dataset, start + i, values[i].data, values[i].length))
+        {
+            // Empty the slots not stored yet so every slot of the range is consistent
+            for (int64_t j = i; j < count; j++)
+            {
+                clearSlotBits(dataset, start + j);
+            }
+            markRange(dataset, start, i, STRING);
+            return false;
+        }
+    }
+    markRange(dataset, start, count, STRING);
+    return true;
+}
+
+/*
+This function retrieves a data point from a dataset by its index.
+It checks for errors such as invalid dataset or index, and returns
+NULL if any errors are encountered. If the validity bitmap shows the slot
+holds a value, the view entry for the slot is pointed at the value in its
+column and returned, otherwise NULL is returned. The view is allocated by the first
+call, which also returns NULL if memory runs out for it. The returned value pointer
+stays valid until the slot is next written; a STRING value pointer stays valid
+until the next string is added to the dataset. The INT value of a sealed dataset is
+decoded into a slot of its own in an array allocated by the first such call, so its
+pointer stays valid until the dataset is freed.
+*/
+// Function to get a data point from a dataset
+DataPoint *getDataPoint(DataSet *dataset, int64_t index)
+{
+    if (dataset == NULL)
+    {
+        return NULL;
+    }
+
+    if (index < 0 || index >= dataset->size)
+    {
+        return NULL;
+    }
+
+    if (!testBit(&dataset->present, index) || !ensureDataPointView(dataset))
+    {
+        return NULL;
+    }
+
+    DataPoint *point = &dataset->data[index];
+    point->type = (DataType)dataset->types[index];
+    switch (point->type)
+    {
+    case INT:
+        if (dataset->encodedInts != NULL)
+        {
+            // A sealed value is decoded into its own slot, so earlier points keep their values
+            EncodedInts *column = dataset->encodedInts;
+            if (column->decoded == NULL)
+            {
+                column->decoded = (int32_t *)allocateBlock(dataset->allocator, (size_t)dataset->capacity * sizeof(int32_t));
+                if (column->decoded == NULL)
+                {
+                    return NULL;
+                }
+            }
+            column->decoded[index] = encodedIntAt(column, index);
+            point->value = &column->decoded[index];
+            break;
+        }
+        point->value = &dataset->ints[index];
+        break;
+    case FLOAT:
+        point->value = &dataset->floats[index];
+        break;
+    case STRING:
+    {
+        size_t length;
+        point->value = (void *)stringAt(dataset, index, &length);
+        break;
+    }
+    default:
+        return NULL;
+    }
+    return point;
+}
+
+/*
+The function frees memory allocated for a dataset structure and all its data points.
+A dataset opened with mapDataSet is unmapped instead. Otherwise it frees the value columns, the string arena, which releases every string at once, and
+the string dictionary, then the type tags, the data point view, the zone maps, the bitmaps and finally the dataset struct itself,
+each back to the allocator of the dataset; an arena allocator takes them back for nothing.
+*/
+
+void freeDataSet(DataSet *dataset)
+{
+    if (dataset == NULL)
+    {
+        return;
+    }
+    // A mapped dataset only owns the mapping, the data point view and the dictionary struct
+    if (dataset->mapping != NULL)
+    {
+        releaseMapping(dataset);
+        free(dataset->dictionary);
+        free(dataset->data);
+        free(dataset);
+        return;
+    }
+
+    // Free the columns, the string arena and the data point view
+    Allocator *allocator = dataset->allocator;
+    size_t capacity = (size_t)dataset->capacity;
+    releaseBlock(allocator, dataset->ints, capacity * sizeof(int32_t));
+    releaseEncodedInts(dataset);
+    releaseBlock(allocator, dataset->floats, capacity * sizeof(float));
+    releaseBlock(allocator, dataset->strings.bytes, dataset->strings.capacity);
+    releaseBlock(allocator, dataset->strings.offsets, capacity * sizeof(uint64_t));
+    releaseBlock(allocator, dataset->strings.lengths, capacity * sizeof(uint32_t));
+    releaseDictionary(dataset->dictionary, dataset->capacity, allocator);
+    releaseBlock(allocator, dataset->types, capacity * sizeof(uint8_t));
+    releaseBlock(allocator, dataset->data, capacity * sizeof(DataPoint));
+    releaseZones(dataset);
+
+    // Free the bitmaps
+    releaseBitmap(&dataset->present, dataset->capacity, allocator);
+    for (int t = 0; t < DATA_TYPE_COUNT; t++)
+    {
+        releaseBitmap(&dataset->typeIndex[t], dataset->capacity, allocator);
+    }
+
+    // Free the dataset struct
+    releaseBlock(allocator, dataset, sizeof(DataSet));
+}
+
+/*
+This function copies the value held by slot index of a source dataset into the same
+slot of a destination dataset of at least the same size. Strings are copied by length,
+without scanning for their end. The INT values of a sealed source are read from decoded,
+which holds the block of the slot. It returns false if memory runs out.
+*/
+static bool copySlot(DataSet *destination, const DataSet *source, int64_t index, const int32_t *decoded)
+{
+    DataType type = (DataType)source->types[index];
+    if (type == STRING)
+    {
+        size_t length;
+        const char *value = stringAt(source, index, &length);
+        clearSlotBits(destination, index);
+        if (!storeString(destination, index, value, length))
+        {
+            return false;
+        }
+        markSlot(destination, index, STRING);
+        return true;
+    }
+    if (type == INT)
+    {
+        return storeValue(destination, index, INT, decoded != NULL ? &decoded[index % INT_BLOCK_SIZE] : &source->ints[index]);
+    }
+    return storeValue(destination, index, type, &source->floats[index]);
+}
+
+/*
+This function takes a dataset and a data type as input and returns a new dataset that
+contains only the data points from the original dataset that have the specified data type.
+It takes a view of the dataset over the bitmap of the requested type and materializes it,
+so only the matching values are copied, each into the same index of the new dataset.
+If the input dataset is NULL or the filtered dataset cannot be created, it returns NULL.
+*/
+DataSet *filterByType(DataSet *dataset, DataType type)
+{
+    ScopedStatTimer timer(STAT_TIMER_FILTER_BY_TYPE);
+    DataView *view = filterViewByType(dataset, type);
+    if (view == NULL)
+    {
+        return NULL;
+    }
+    countScan(dataset, dataset->size, 0);
+    DataSet *filteredData = materializeView(view);
+    freeDataView(view);
+    return filteredData;
+}
+
+/*
+This function creates a view of a dataset over a selection bitmap of its slots.
+The view takes ownership of the selection, which is freed with the view.
+It returns NULL if the dataset or selection is NULL, the selection size differs from
+the dataset size, or memory runs out; the selection is not freed in that case.
+*/
+DataView *createDataView(DataSet *dataset, Bitmap *selection)
+{
+    if (dataset == NULL || selection == NULL || selection->size != dataset->size)
+    {
+        return NULL;
+    }
+    DataView *view = (DataView *)malloc(sizeof(DataView));
+    if (view == NULL)
+    {
+        return NULL;
+    }
+    view->parent = dataset;
+    view->selection = selection;
+    view->ownsSelection = true;
+    return view;
+}
+
+/*
+This function creates a view of the data points of a dataset that have a specified type.
+The view borrows the type bitmap of the dataset, so nothing but the view itself is
+allocated and the view follows later changes to the dataset.
+It returns NULL if the dataset is NULL, the type is invalid or memory runs out.
+*/
+DataView *filterViewByType(DataSet *dataset, DataType type)
+{
+    if (dataset == NULL || (type != INT && type != FLOAT && type != STRING))
+    {
+        return NULL;
+    }
+    DataView *view = (DataView *)malloc(sizeof(DataView));
+    if (view == NULL)
+    {
+        return NULL;
+    }
+    view->parent = dataset;
+    view->selection = &dataset->typeIndex[type];
+    view->ownsSelection = false;
+    return view;
+}
+
+/*
+This function narrows a view to the slots that are also set in a selection bitmap,
+one word at a time, so chained filters keep a single selection per view. A view that
+borrows its selection gets its own copy first.
+It returns false if the view or selection is NULL, the sizes differ or memory runs out.
+*/
+bool intersectView(DataView *view, const Bitmap *selection)
+{
+    if (view == NULL || selection == NULL || selection->size != view->selection->size)
+    {
+        return false;
+    }
+    int64_t words = bitmapWordCount(selection->size);
+    if (!view->ownsSelection)
+    {
+        Bitmap *copy = createBitmap(selection->size);
+        if (copy == NULL)
+        {
+            return false;
+        }
+        memcpy(copy->words, view->selection->words, words * sizeof(uint64_t));
+        view->selection = copy;
+        view->ownsSelection = true;
+    }
+    for (int64_t w = 0; w < words; w++)
+    {
+        view->selection->words[w] &= selection->words[w];
+    }
+    return true;
+}
+
+// Get the number of slots a view can select, which stops at the end of the parent or the selection, whichever
+// comes first, since the parent may have been resized after the view was created
+static int64_t viewSize(const DataView *view)
+{
+    return view->parent->size < view->selection->size ? view->parent->size : view->selection->size;
+}
+
+/*
+This function counts the data points selected by a view. Only slots holding a value
+are counted. It returns 0 if the view is NULL.
+*/
+int64_t countView(DataView *view)
+{
+    if (view == NULL)
+    {
+        return 0;
+    }
+    int64_t count = 0;
+    int64_t words = bitmapWordCount(viewSize(view));
+    for (int64_t w = 0; w < words; w++)
+    {
+        count += __builtin_popcountll(view->selection->words[w] & view->parent->present.words[w]);
+    }
+    return count;
+}
+
+/*
+This function returns the index of the first data point selected by a view at or after
+a specified index, so callers can walk a view without testing every slot.
+It returns -1 if the view is NULL or no selected data point follows.
+*/
+int64_t nextViewIndex(DataView *view, int64_t index)
+{
+    if (view == NULL || index >= viewSize(view))
+    {
+        return -1;
+    }
+    if (index < 0)
+    {
+        index = 0;
+    }
+    int64_t words = bitmapWordCount(viewSize(view));
+    int64_t w = index >> 6;
+    uint64_t bits = view->selection->words[w] & view->parent->present.words[w] & (~(uint64_t)0 << (index & 63));
+    while (bits == 0)
+    {
+        if (++w >= words)
+        {
+            return -1;
+        }
+        bits = view->selection->words[w] & view->parent->present.words[w];
+    }
+    return w * 64 + __builtin_ctzll(bits);
+}
+
+/*
+This function retrieves a data point selected by a view by its index in the parent dataset.
+It returns NULL if the view is NULL, the index is out of bounds or the slot is not selected.
+*/
+DataPoint *getViewDataPoint(DataView *view, int64_t index)
+{
+    if (view == NULL || index < 0 || index >= viewSize(view) || !testBit(view->selection, index))
+    {
+        return NULL;
+    }
+    return getDataPoint(view->parent, index);
+}
+
+/*
+This function copies the data points selected by a view into a new dataset of the
+same size as the parent, each at its original index. A dictionary-encoded parent
+gives a dictionary-encoded copy.
+It returns NULL if the view is NULL or memory runs out.
+*/
+DataSet *materializeView(DataView *view)
+{
+    if (view == NULL)
+    {
+        return NULL;
+    }
+    DataSet *dataset = view->parent;
+    DataSet *copy = allocateDataSet(dataset->size, dataset->size > 0 ? dataset->size : 1, NULL);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    if (dataset->dictionary != NULL && !encodeStringDictionary(copy))
+    {
+        freeDataSet(copy);
+        return NULL;
+    }
+    // The INT values of a sealed parent are decoded a block at a time
+    int32_t values[INT_BLOCK_SIZE];
+    int64_t decoded = -1;
+    int64_t words = bitmapWordCount(viewSize(view));
+    for (int64_t w = 0; w < words; w++)
+    {
+        uint64_t bits = view->selection->words[w] & dataset->present.words[w];
+        if (dataset->encodedInts != NULL && (bits & dataset->typeIndex[INT].words[w]) != 0 && w * 64 / INT_BLOCK_SIZE != decoded)
+        {
+            decoded = w * 64 / INT_BLOCK_SIZE;
+            decodeIntBlock(dataset->encodedInts, decoded, blockLength(dataset->size, decoded), values);
+        }
+        while (bits != 0)
+        {
+            if (!copySlot(copy, dataset, w * 64 + __builtin_ctzll(bits), decoded >= 0 ? values : NULL))
+            {
+                freeDataSet(copy);
+                return NULL;
+            }
+            bits &= bits - 1;
+        }
+    }
+    return copy;
+}
+
+/*
+This function frees a view, and its selection if the view owns it. The parent dataset is not freed.
+*/
+void freeDataView(DataView *view)
+{
+    if (view == NULL)
+    {
+        return;
+    }
+    if (view->ownsSelection)
+    {
+        freeBitmap(view->selection);
+    }
+    free(view);
+}
+
+/*
+This function counts the data points of a specified type in a dataset
+by taking the population count of the type bitmap.
+It returns 0 if the dataset is NULL or the type is invalid.
+*/
+int64_t countByType(DataSet *dataset, DataType type)
+{
+    if (dataset == NULL || (type != INT && type != FLOAT && type != STRING))
+    {
+        return 0;
+    }
+    return countBits(&dataset->typeIndex[type]);
+}
+
+/*
+This function counts all data points held by a dataset
+by taking the population count of the present bitmap.
+It returns 0 if the dataset is NULL.
+*/
+int64_t countDataPoints(DataSet *dataset)
+{
+    if (dataset == NULL)
+    {
+        return 0;
+    }
+    return countBits(&dataset->present);
+}
+
+/*
+This function checks whether the slot at a specific index of a dataset holds a data point.
+It returns false if the dataset is NULL or the index is out of bounds.
+*/
+bool hasDataPoint(DataSet *dataset, int64_t index)
+{
+    if (dataset == NULL || index < 0 || index >= dataset->size)
+    {
+        return false;
+    }
+    return testBit(&dataset->present, index);
+}
+
+/*
+This function checks whether a dataset holds at least one data point of a specified type.
+It scans the type bitmap and stops at the first non-zero word.
+It returns false if the dataset is NULL or the type is invalid.
+*/
+bool containsType(DataSet *dataset, DataType type)
+{
+    if (dataset == NULL || (type != INT && type != FLOAT && type != STRING))
+    {
+        return false;
+    }
+    int64_t words = bitmapWordCount(dataset->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        if (dataset->typeIndex[type].words[w] != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+This function creates a bitmap of a specified size with all bits clear.
+It returns NULL if the size is negative or memory runs out.
+*/
+Bitmap *createBitmap(int64_t size)
+{
+    if (size < 0)
+    {
+        return NULL;
+    }
+    Bitmap *bitmap = (Bitmap *)malloc(sizeof(Bitmap));
+    if (bitmap == NULL)
+    {
+        return NULL;
+    }
+    if (!initBitmap(bitmap, size, size, NULL))
+    {
+        free(bitmap);
+        return NULL;
+    }
+    return bitmap;
+}
+
+/*
+This function frees a bitmap and its words.
+*/
+void freeBitmap(Bitmap *bitmap)
+{
+    if (bitmap == NULL)
+    {
+        return;
+    }
+    releaseBitmap(bitmap, bitmap->size, NULL);
+    free(bitmap);
+}
+
+/*
+This function counts the set bits of a bitmap. It returns 0 if the bitmap is NULL.
+*/
+int64_t countBitmap(const Bitmap *bitmap)
+{
+    if (bitmap == NULL)
+    {
+        return 0;
+    }
+    return countBits(bitmap);
+}
+
+/*
+This function checks whether the bit at a specific index of a bitmap is set.
+It returns false if the bitmap is NULL or the index is out of bounds.
+*/
+bool testBitmap(const Bitmap *bitmap, int64_t index)
+{
+    if (bitmap == NULL || index < 0 || index >= bitmap->size)
+    {
+        return false;
+    }
+    return testBit(bitmap, index);
+}
+
+/*
+This function switches the STRING values of a dataset to dictionary encoding.
+It builds a dictionary of the distinct strings held by the dataset, rewrites the
+string arena so it holds each distinct string once, and replaces the per-slot
+offsets and lengths with a code per slot. Strings added afterwards are interned
+into the dictionary. Codes start one byte wide and are widened to two and then
+four bytes as the number of distinct strings grows.
+It returns true if the dataset is dictionary-encoded when it returns, and false
+if the dataset is NULL, mapped read-only or sealed, or memory runs out, in which case the
+dataset is unchanged.
+*/
+bool encodeStringDictionary(DataSet *dataset)
+{
+    if (dataset == NULL || (readOnly(dataset) && dataset->dictionary == NULL))
+    {
+        return false;
+    }
+    if (dataset->dictionary != NULL)
+    {
+        return true;
+    }
+    Allocator *allocator = dataset->allocator;
+    StringDictionary *dictionary = (StringDictionary *)allocateBlock(allocator, sizeof(StringDictionary));
+    if (dictionary == NULL)
+    {
+        return false;
+    }
+    dictionary->capacity = 64;
+    dictionary->tableSize = 128;
+    dictionary->codeWidth = 1;
+    dictionary->offsets = (uint64_t *)allocateBlock(allocator, dictionary->capacity * sizeof(uint64_t));
+    dictionary->lengths = (uint32_t *)allocateBlock(allocator, dictionary->capacity * sizeof(uint32_t));
+    dictionary->hashes = (uint32_t *)allocateBlock(allocator, dictionary->capacity * sizeof(uint32_t));
+    dictionary->table = (uint32_t *)allocateBlock(allocator, dictionary->tableSize * sizeof(uint32_t));
+    dictionary->codes = allocateBlock(allocator, dataset->capacity);
+    if (dictionary->offsets == NULL || dictionary->lengths == NULL || dictionary->hashes == NULL ||
+        dictionary->table == NULL || dictionary->codes == NULL)
+    {
+        releaseDictionary(dictionary, dataset->capacity, allocator);
+        return false;
+    }
+
+    // Intern the strings already held into a fresh arena
+    StringArena old = dataset->strings;
+    memset(&dataset->strings, 0, sizeof(StringArena));
+    dataset->dictionary = dictionary;
+    int64_t words = bitmapWordCount(dataset->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        uint64_t bits = dataset->typeIndex[STRING].words[w];
+        while (bits != 0)
+        {
+            int64_t i = w * 64 + __builtin_ctzll(bits);
+            int code = internString(dataset, old.bytes + old.offsets[i], old.lengths[i]);
+            if (code < 0)
+            {
+                // Put the plain arena back
+                releaseBlock(allocator, dataset->strings.bytes, dataset->strings.capacity);
+                releaseDictionary(dictionary, dataset->capacity, allocator);
+                dataset->dictionary = NULL;
+                dataset->strings = old;
+                return false;
+            }
+            setCode(dictionary, i, (uint32_t)code);
+            bits &= bits - 1;
+        }
+    }
+    releaseBlock(allocator, old.bytes, old.capacity);
+    releaseBlock(allocator, old.offsets, (size_t)dataset->capacity * sizeof(uint64_t));
+    releaseBlock(allocator, old.lengths, (size_t)dataset->capacity * sizeof(uint32_t));
+    return true;
+}
+
+/*
+This function returns the dictionary code of a string in a dictionary-encoded dataset.
+It returns -1 if the dataset is NULL or not dictionary-encoded, the string is NULL,
+or the dictionary does not hold the string.
+*/
+int getStringCode(DataSet *dataset, const char *value)
+{
+    if (dataset == NULL || dataset->dictionary == NULL || value == NULL)
+    {
+        return -1;
+    }
+    size_t length = strlen(value);
+    return findCode(dataset->dictionary, dataset->strings.bytes, value, length, hashString(value, length));
+}
+
+/*
+This function returns the string numbered by a code in a dictionary-encoded dataset.
+It returns NULL if the dataset is NULL or not dictionary-encoded, or the code is out of range.
+*/
+const char *getDictionaryString(DataSet *dataset, int code)
+{
+    if (dataset == NULL || dataset->dictionary == NULL || code < 0 || code >= dataset->dictionary->count)
+    {
+        return NULL;
+    }
+    return dataset->strings.bytes + dataset->dictionary->offsets[code];
+}
+
+/*
+This function groups the STRING data points of a dictionary-encoded dataset by their
+string and counts each group. It walks the STRING bitmap and the code array only,
+never the strings themselves. It returns an array indexed by code, which the caller
+frees, and stores the number of codes through codeCount.
+It returns NULL if the dataset is NULL or not dictionary-encoded, or memory runs out.
+*/
+int64_t *countByStringCode(DataSet *dataset, int *codeCount)
+{
+    if (dataset == NULL || dataset->dictionary == NULL || codeCount == NULL)
+    {
+        return NULL;
+    }
+    const StringDictionary *dictionary = dataset->dictionary;
+    int64_t *counts = (int64_t *)calloc(dictionary->count > 0 ? dictionary->count : 1, sizeof(int64_t));
+    if (counts == NULL)
+    {
+        return NULL;
+    }
+    int64_t words = bitmapWordCount(dataset->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        uint64_t bits = dataset->typeIndex[STRING].words[w];
+        while (bits != 0)
+        {
+            counts[codeAt(dictionary, w * 64 + __builtin_ctzll(bits))]++;
+            bits &= bits - 1;
+        }
+    }
+    *codeCount = dictionary->count;
+    return counts;
+}
+
+// Set in out the bit of every STRING slot whose code equals code, 64 slots at a time
+template <typename Code>
+static void matchCodes(const DataSet *dataset, const Code *codes, Code code, Bitmap *out)
+{
+    int64_t words = bitmapWordCount(dataset->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        uint64_t strings = dataset->typeIndex[STRING].words[w];
+        if (strings == 0)
+        {
+            continue;
+        }
+        const Code *block = codes + (size_t)w * 64;
+        int count = wordLength(dataset->size, w);
+        uint64_t bits = 0;
+        for (int j = 0; j < count; j++)
+        {
+            bits |= (uint64_t)(block[j] == code) << j;
+        }
+        out->words[w] = bits & strings;
+    }
+}
+
+/*
+This function selects the data points of a dataset that hold a specified string.
+On a dictionary-encoded dataset the string is looked up once and the selection is an
+integer compare of every code; otherwise each STRING data point is compared by length
+and then by content, skipping the zones whose bloom filter rules the string out. It returns a bitmap with one bit per slot of the dataset, which
+the caller frees with freeBitmap, or NULL if the dataset or string is NULL or memory runs out.
+*/
+Bitmap *filterStringEquals(DataSet *dataset, const char *value)
+{
+    if (dataset == NULL || value == NULL)
+    {
+        return NULL;
+    }
+    Bitmap *selection = createBitmap(dataset->size);
+    if (selection == NULL)
+    {
+        return NULL;
+    }
+    const StringDictionary *dictionary = dataset->dictionary;
+    if (dictionary != NULL)
+    {
+        int code = getStringCode(dataset, value);
+        if (code < 0)
+        {
+            return selection;
+        }
+        switch (dictionary->codeWidth)
+        {
+        case 1:
+            matchCodes(dataset, (const uint8_t *)dictionary->codes, (uint8_t)code, selection);
+            break;
+        case 2:
+            matchCodes(dataset, (const uint16_t *)dictionary->codes, (uint16_t)code, selection);
+            break;
+        default:
+            matchCodes(dataset, (const uint32_t *)dictionary->codes, (uint32_t)code, selection);
+            break;
+        }
+        return selection;
+    }
+    size_t length = strlen(value);
+    uint32_t hash = hashString(value, length);
+    int64_t words = bitmapWordCount(dataset->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        // Skip a zone whose bloom filter rules the string out
+        if (dataset->zones != NULL && w % (ZONE_SIZE / 64) == 0 && !bloomMayContain(&dataset->zones[w * 64 / ZONE_SIZE], hash))
+        {
+            w += ZONE_SIZE / 64 - 1;
+            continue;
+        }
+        uint64_t bits = dataset->typeIndex[STRING].words[w];
+        while (bits != 0)
+        {
+            int64_t i = w * 64 + __builtin_ctzll(bits);
+            if (dataset->strings.lengths[i] == length &&
+                memcmp(dataset->strings.bytes + dataset->strings.offsets[i], value, length) == 0)
+            {
+                setBit(selection, i);
+            }
+            bits &= bits - 1;
+        }
+    }
+    return selection;
 }
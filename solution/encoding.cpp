@@ -0,0 +1,395 @@
+#include "encoding.h"
+#include "internal.h"
+
+/*
+INT encodings. A block of INT_BLOCK_SIZE values is stored as one of:
+  PLAIN  the 32-bit values;
+  RLE    runs as pairs of a 32-bit value and the 32-bit end of the run within the block;
+  FOR    each value minus the smallest value of the block, packed in bitWidth bits;
+  DELTA  the first value, then each difference to the value before minus the smallest
+         difference, packed in bitWidth bits.
+Packed values are written into a little-endian bit stream. A packed value of at most 32
+bits starting at bit p is read with one unaligned 64-bit load at byte p / 8 and a shift
+by p % 8, so unpacking a block is a branch-free loop the compiler vectorizes; the byte
+array is padded so the last load stays inside it.
+*/
+
+#define PACK_PADDING 8
+
+// Number of bits needed to hold a value
+static inline int bitsFor(uint64_t value)
+{
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+// Read the packed value i of width bits from a bit stream
+static inline uint32_t unpackValue(const uint8_t *bytes, int64_t i, int width)
+{
+    uint64_t bit = (uint64_t)i * width;
+    uint64_t word;
+    memcpy(&word, bytes + bit / 8, sizeof(word));
+    return (uint32_t)((word >> (bit % 8)) & (((uint64_t)1 << width) - 1));
+}
+
+// Write count values of width bits into a zero-filled bit stream
+static void packValues(uint8_t *bytes, const uint32_t *values, int count, int width)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t bit = (uint64_t)i * width;
+        uint64_t word;
+        memcpy(&word, bytes + bit / 8, sizeof(word));
+        word |= (uint64_t)values[i] << (bit % 8);
+        memcpy(bytes + bit / 8, &word, sizeof(word));
+    }
+}
+
+// Bytes of a bit stream of count values of width bits
+static inline size_t packedBytes(int count, int width)
+{
+    return ((size_t)count * width + 7) / 8;
+}
+
+/*
+This function decodes block b of a sealed INT column, of length values, into values.
+*/
+void decodeIntBlock(const EncodedInts *column, int64_t b, int length, int32_t *values)
+{
+    const IntBlock *block = &column->blocks[b];
+    const uint8_t *bytes = column->bytes + block->offset;
+    switch (block->encoding)
+    {
+    case ENCODING_PLAIN:
+        memcpy(values, bytes, (size_t)length * sizeof(int32_t));
+        break;
+    case ENCODING_RLE:
+    {
+        int begin = 0;
+        for (int r = 0; r < block->runs; r++)
+        {
+            int32_t value;
+            uint32_t end;
+            runAt(column, block, r, &value, &end);
+            for (int i = begin; i < (int)end; i++)
+            {
+                values[i] = value;
+            }
+            begin = (int)end;
+        }
+        break;
+    }
+    case ENCODING_FOR:
+        for (int i = 0; i < length; i++)
+        {
+            values[i] = (int32_t)((uint32_t)block->base + unpackValue(bytes, i, block->bitWidth));
+        }
+        break;
+    default:
+    {
+        uint32_t value = (uint32_t)block->base;
+        values[0] = block->base;
+        for (int i = 1; i < length; i++)
+        {
+            value += (uint32_t)block->delta + unpackValue(bytes, i - 1, block->bitWidth);
+            values[i] = (int32_t)value;
+        }
+        break;
+    }
+    }
+}
+
+/*
+This function decodes the value of slot index of a sealed INT column without decoding
+the rest of its block, except for a DELTA block, which is summed up to the slot.
+*/
+int32_t encodedIntAt(const EncodedInts *column, int64_t index)
+{
+    const IntBlock *block = &column->blocks[index / INT_BLOCK_SIZE];
+    const uint8_t *bytes = column->bytes + block->offset;
+    int i = (int)(index % INT_BLOCK_SIZE);
+    switch (block->encoding)
+    {
+    case ENCODING_PLAIN:
+    {
+        int32_t value;
+        memcpy(&value, bytes + (size_t)i * sizeof(int32_t), sizeof(value));
+        return value;
+    }
+    case ENCODING_RLE:
+    {
+        // Binary search for the first run ending past the slot
+        int low = 0;
+        int high = block->runs - 1;
+        while (low < high)
+        {
+            int middle = (low + high) / 2;
+            int32_t value;
+            uint32_t end;
+            runAt(column, block, middle, &value, &end);
+            if ((int)end > i)
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1;
+            }
+        }
+        int32_t value;
+        uint32_t end;
+        runAt(column, block, low, &value, &end);
+        return value;
+    }
+    case ENCODING_FOR:
+        return (int32_t)((uint32_t)block->base + unpackValue(bytes, i, block->bitWidth));
+    default:
+    {
+        uint32_t value = (uint32_t)block->base;
+        for (int k = 0; k < i; k++)
+        {
+            value += (uint32_t)block->delta + unpackValue(bytes, k, block->bitWidth);
+        }
+        return (int32_t)value;
+    }
+    }
+}
+
+/*
+This function chooses the encoding of one block of values and fills in its header: the
+bytes each encoding takes are counted from the range of the values, the range of the
+differences and the number of runs, and the smallest wins. It returns the encoded bytes.
+*/
+static size_t chooseEncoding(const int32_t *values, int length, IntBlock *block)
+{
+    int64_t min = values[0];
+    int64_t max = values[0];
+    int64_t minDelta = INT64_MAX;
+    int64_t maxDelta = INT64_MIN;
+    int runs = 1;
+    for (int i = 1; i < length; i++)
+    {
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+        int64_t delta = (int64_t)values[i] - values[i - 1];
+        minDelta = delta < minDelta ? delta : minDelta;
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+        runs += values[i] != values[i - 1];
+    }
+    block->min = (int32_t)min;
+    block->max = (int32_t)max;
+
+    size_t bytes = (size_t)length * sizeof(int32_t);
+    block->encoding = ENCODING_PLAIN;
+    size_t rleBytes = (size_t)runs * 2 * sizeof(int32_t);
+    if (rleBytes < bytes)
+    {
+        bytes = rleBytes;
+        block->encoding = ENCODING_RLE;
+        block->runs = (uint16_t)runs;
+    }
+    int forWidth = bitsFor((uint64_t)(max - min));
+    if (forWidth <= 32 && packedBytes(length, forWidth) < bytes)
+    {
+        bytes = packedBytes(length, forWidth);
+        block->encoding = ENCODING_FOR;
+        block->bitWidth = (uint8_t)forWidth;
+        block->base = (int32_t)min;
+    }
+    if (length > 1 && minDelta >= INT32_MIN && minDelta <= INT32_MAX)
+    {
+        int deltaWidth = bitsFor((uint64_t)(maxDelta - minDelta));
+        if (deltaWidth <= 32 && packedBytes(length - 1, deltaWidth) < bytes)
+        {
+            bytes = packedBytes(length - 1, deltaWidth);
+            block->encoding = ENCODING_DELTA;
+            block->bitWidth = (uint8_t)deltaWidth;
+            block->base = values[0];
+            block->delta = (int32_t)minDelta;
+        }
+    }
+    return bytes;
+}
+
+// Write one block of values in the encoding chosen for it
+static void encodeBlock(const int32_t *values, int length, const IntBlock *block, uint8_t *bytes)
+{
+    uint32_t packed[INT_BLOCK_SIZE];
+    switch (block->encoding)
+    {
+    case ENCODING_PLAIN:
+        memcpy(bytes, values, (size_t)length * sizeof(int32_t));
+        break;
+    case ENCODING_RLE:
+    {
+        int r = 0;
+        for (int i = 1; i <= length; i++)
+        {
+            if (i == length || values[i] != values[i - 1])
+            {
+                uint32_t end = (uint32_t)i;
+                memcpy(bytes + (size_t)r * 2 * sizeof(int32_t), &values[i - 1], sizeof(int32_t));
+                memcpy(bytes + ((size_t)r * 2 + 1) * sizeof(int32_t), &end, sizeof(uint32_t));
+                r++;
+            }
+        }
+        break;
+    }
+    case ENCODING_FOR:
+        for (int i = 0; i < length; i++)
+        {
+            packed[i] = (uint32_t)values[i] - (uint32_t)block->base;
+        }
+        packValues(bytes, packed, length, block->bitWidth);
+        break;
+    default:
+        for (int i = 1; i < length; i++)
+        {
+            packed[i - 1] = (uint32_t)((int64_t)values[i] - values[i - 1] - block->delta);
+        }
+        packValues(bytes, packed, length - 1, block->bitWidth);
+        break;
+    }
+}
+
+/*
+This function copies block b of the INT column of a dataset into values, giving each slot
+without an INT value the INT value before it in the block, or the first INT value of the
+block for the slots before that, and sums the INT values into the block header.
+*/
+static void fillBlock(const DataSet *dataset, int64_t b, int length, int32_t *values, IntBlock *block)
+{
+    int64_t begin = b * INT_BLOCK_SIZE;
+    const uint64_t *ints = dataset->typeIndex[INT].words + begin / 64;
+    int32_t fill = 0;
+    for (int i = 0; i < length; i++)
+    {
+        if ((ints[i / 64] >> (i % 64)) & 1)
+        {
+            fill = dataset->ints[begin + i];
+            break;
+        }
+    }
+    block->sum = 0;
+    for (int i = 0; i < length; i++)
+    {
+        if ((ints[i / 64] >> (i % 64)) & 1)
+        {
+            fill = dataset->ints[begin + i];
+            block->sum += fill;
+        }
+        values[i] = fill;
+    }
+}
+
+/*
+This function seals a dataset: its INT column is encoded block by block, each block in the
+encoding that takes the fewest bytes, and the plain column is freed. Filters and aggregates
+work on the encoded blocks, deciding a block from its range or runs where they can and
+decoding it otherwise. A sealed dataset can no longer be changed.
+It returns true if the dataset is sealed when it returns, and false if the dataset is NULL
+or mapped read-only, or memory runs out, in which case the dataset is unchanged.
+*/
+bool sealDataSet(DataSet *dataset)
+{
+    if (dataset == NULL || dataset->mapping != NULL)
+    {
+        return false;
+    }
+    if (dataset->encodedInts != NULL)
+    {
+        return true;
+    }
+    Allocator *allocator = dataset->allocator;
+    int64_t blockCount = (dataset->size + INT_BLOCK_SIZE - 1) / INT_BLOCK_SIZE;
+    EncodedInts *column = (EncodedInts *)allocateBlock(allocator, sizeof(EncodedInts));
+    IntBlock *blocks = (IntBlock *)allocateBlock(allocator, (blockCount > 0 ? blockCount : 1) * sizeof(IntBlock));
+    if (column == NULL || blocks == NULL || !ensureColumn(dataset, INT))
+    {
+        releaseBlock(allocator, blocks, (blockCount > 0 ? blockCount : 1) * sizeof(IntBlock));
+        releaseBlock(allocator, column, sizeof(EncodedInts));
+        return false;
+    }
+
+    // Choose the encoding of every block to size the encoded bytes
+    int32_t values[INT_BLOCK_SIZE];
+    size_t length = 0;
+    for (int64_t b = 0; b < blockCount; b++)
+    {
+        int count = blockLength(dataset->size, b);
+        fillBlock(dataset, b, count, values, &blocks[b]);
+        blocks[b].offset = length;
+        length += chooseEncoding(values, count, &blocks[b]);
+    }
+    uint8_t *bytes = (uint8_t *)allocateBlock(allocator, length + PACK_PADDING);
+    if (bytes == NULL)
+    {
+        releaseBlock(allocator, blocks, (blockCount > 0 ? blockCount : 1) * sizeof(IntBlock));
+        releaseBlock(allocator, column, sizeof(EncodedInts));
+        return false;
+    }
+    for (int64_t b = 0; b < blockCount; b++)
+    {
+        int count = blockLength(dataset->size, b);
+        fillBlock(dataset, b, count, values, &blocks[b]);
+        encodeBlock(values, count, &blocks[b], bytes + blocks[b].offset);
+    }
+
+    column->blocks = blocks;
+    column->blockCount = blockCount;
+    column->bytes = bytes;
+    column->length = length;
+    column->decoded = NULL;
+    releaseBlock(allocator, dataset->ints, (size_t)dataset->capacity * sizeof(int32_t));
+    dataset->ints = NULL;
+    dataset->encodedInts = column;
+    return true;
+}
+
+/*
+This function decodes block b of the INT column of a sealed dataset into an array with room
+for INT_BLOCK_SIZE values, so a caller walking the column decodes each block once. The dataset
+is only read, so several threads can decode it at once.
+It returns the number of slots in the block, or 0 if the dataset is NULL or not sealed or
+the block is out of range.
+*/
+int decodeSealedInts(const DataSet *dataset, int64_t b, int32_t *values)
+{
+    if (dataset == NULL || dataset->encodedInts == NULL || values == NULL || b < 0 || b >= dataset->encodedInts->blockCount)
+    {
+        return 0;
+    }
+    int length = blockLength(dataset->size, b);
+    decodeIntBlock(dataset->encodedInts, b, length, values);
+    return length;
+}
+
+/*
+This function reads the INT value held by slot index of a sealed dataset. Unlike getDataPoint
+it does not write to the dataset, so several threads can read it at once.
+It returns 0 if the dataset is NULL or not sealed or the index is out of bounds.
+*/
+int32_t readSealedInt(const DataSet *dataset, int64_t index)
+{
+    if (dataset == NULL || dataset->encodedInts == NULL || index < 0 || index >= dataset->size)
+    {
+        return 0;
+    }
+    return encodedIntAt(dataset->encodedInts, index);
+}
+
+/*
+This function frees the encoded INT column of a sealed dataset.
+*/
+void releaseEncodedInts(DataSet *dataset)
+{
+    EncodedInts *column = dataset->encodedInts;
+    if (column == NULL)
+    {
+        return;
+    }
+    releaseBlock(dataset->allocator, column->decoded, (size_t)dataset->capacity * sizeof(int32_t));
+    releaseBlock(dataset->allocator, column->bytes, column->length + PACK_PADDING);
+    releaseBlock(dataset->allocator, column->blocks, (column->blockCount > 0 ? column->blockCount : 1) * sizeof(IntBlock));
+    releaseBlock(dataset->allocator, column, sizeof(EncodedInts));
+    dataset->encodedInts = NULL;
+}
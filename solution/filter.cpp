@@ -0,0 +1,653 @@
+#include "filter.h"
+#include "internal.h"
+
+#include <immintrin.h>
+#include <mutex>
+
+/*
+Filter kernels. Each kernel compares the values covered by the words [wordBegin, wordEnd)
+of a column and writes one result bit per value into bits, without looking at the type
+of the slot; the caller masks the result with the type bitmap afterwards. The AVX2 and
+AVX-512 kernels compare 8 and 16 values per instruction over full words and fall back
+to the scalar kernel for the last, partial word. The kernel is chosen once from CPUID.
+*/
+
+// Compare one value against the operands of a comparison
+template <typename T>
+static inline bool compareValue(T value, CompareOp op, const T *operands, int operandCount)
+{
+    switch (op)
+    {
+    case COMPARE_EQ:
+        return value == operands[0];
+    case COMPARE_NE:
+        return !(value == operands[0]);
+    case COMPARE_LT:
+        return value < operands[0];
+    case COMPARE_LE:
+        return value <= operands[0];
+    case COMPARE_GT:
+        return value > operands[0];
+    case COMPARE_GE:
+        return value >= operands[0];
+    case COMPARE_BETWEEN:
+        return value >= operands[0] && value <= operands[1];
+    case COMPARE_IN:
+        for (int k = 0; k < operandCount; k++)
+        {
+            if (value == operands[k])
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+// Compare the count values of one word, one value at a time
+template <typename T>
+static inline uint64_t compareWordScalar(const T *values, int count, CompareOp op, const T *operands, int operandCount)
+{
+    uint64_t bits = 0;
+    for (int j = 0; j < count; j++)
+    {
+        bits |= (uint64_t)compareValue(values[j], op, operands, operandCount) << j;
+    }
+    return bits;
+}
+
+template <typename T>
+static void compareScalar(const T *values, int64_t size, int64_t wordBegin, int64_t wordEnd, CompareOp op,
+                          const T *operands, int operandCount, uint64_t *bits)
+{
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        bits[w] = compareWordScalar(values + (size_t)w * 64, wordLength(size, w), op, operands, operandCount);
+    }
+}
+
+// AVX2: compare 8 INT values, returning an all-ones lane for every match
+__attribute__((target("avx2"))) static inline __m256i compareIntsAvx2(__m256i v, CompareOp op, const int32_t *operands, int operandCount)
+{
+    __m256i a = _mm256_set1_epi32(operands[0]);
+    __m256i ones = _mm256_set1_epi32(-1);
+    switch (op)
+    {
+    case COMPARE_EQ:
+        return _mm256_cmpeq_epi32(v, a);
+    case COMPARE_NE:
+        return _mm256_xor_si256(_mm256_cmpeq_epi32(v, a), ones);
+    case COMPARE_LT:
+        return _mm256_cmpgt_epi32(a, v);
+    case COMPARE_LE:
+        return _mm256_xor_si256(_mm256_cmpgt_epi32(v, a), ones);
+    case COMPARE_GT:
+        return _mm256_cmpgt_epi32(v, a);
+    case COMPARE_GE:
+        return _mm256_xor_si256(_mm256_cmpgt_epi32(a, v), ones);
+    case COMPARE_BETWEEN:
+    {
+        __m256i b = _mm256_set1_epi32(operands[1]);
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(a, v), _mm256_cmpgt_epi32(v, b));
+        return _mm256_xor_si256(outside, ones);
+    }
+    case COMPARE_IN:
+    {
+        __m256i match = _mm256_setzero_si256();
+        for (int k = 0; k < operandCount; k++)
+        {
+            match = _mm256_or_si256(match, _mm256_cmpeq_epi32(v, _mm256_set1_epi32(operands[k])));
+        }
+        return match;
+    }
+    }
+    return _mm256_setzero_si256();
+}
+
+__attribute__((target("avx2"))) static void compareIntAvx2(const int32_t *values, int64_t size, int64_t wordBegin, int64_t wordEnd, CompareOp op,
+                                                            const int32_t *operands, int operandCount, uint64_t *bits)
+{
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        const int32_t *block = values + (size_t)w * 64;
+        if (wordLength(size, w) < 64)
+        {
+            bits[w] = compareWordScalar(block, wordLength(size, w), op, operands, operandCount);
+            continue;
+        }
+        uint64_t word = 0;
+        for (int j = 0; j < 64; j += 8)
+        {
+            __m256i match = compareIntsAvx2(_mm256_loadu_si256((const __m256i *)(block + j)), op, operands, operandCount);
+            word |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(match)) << j;
+        }
+        bits[w] = word;
+    }
+}
+
+// AVX2: compare 8 FLOAT values; NE is unordered so NaN compares not equal, as in C
+__attribute__((target("avx2"))) static inline __m256 compareFloatsAvx2(__m256 v, CompareOp op, const float *operands, int operandCount)
+{
+    __m256 a = _mm256_set1_ps(operands[0]);
+    switch (op)
+    {
+    case COMPARE_EQ:
+        return _mm256_cmp_ps(v, a, _CMP_EQ_OQ);
+    case COMPARE_NE:
+        return _mm256_cmp_ps(v, a, _CMP_NEQ_UQ);
+    case COMPARE_LT:
+        return _mm256_cmp_ps(v, a, _CMP_LT_OQ);
+    case COMPARE_LE:
+        return _mm256_cmp_ps(v, a, _CMP_LE_OQ);
+    case COMPARE_GT:
+        return _mm256_cmp_ps(v, a, _CMP_GT_OQ);
+    case COMPARE_GE:
+        return _mm256_cmp_ps(v, a, _CMP_GE_OQ);
+    case COMPARE_BETWEEN:
+        return _mm256_and_ps(_mm256_cmp_ps(v, a, _CMP_GE_OQ), _mm256_cmp_ps(v, _mm256_set1_ps(operands[1]), _CMP_LE_OQ));
+    case COMPARE_IN:
+    {
+        __m256 match = _mm256_setzero_ps();
+        for (int k = 0; k < operandCount; k++)
+        {
+            match = _mm256_or_ps(match, _mm256_cmp_ps(v, _mm256_set1_ps(operands[k]), _CMP_EQ_OQ));
+        }
+        return match;
+    }
+    }
+    return _mm256_setzero_ps();
+}
+
+__attribute__((target("avx2"))) static void compareFloatAvx2(const float *values, int64_t size, int64_t wordBegin, int64_t wordEnd, CompareOp op,
+                                                              const float *operands, int operandCount, uint64_t *bits)
+{
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        const float *block = values + (size_t)w * 64;
+        if (wordLength(size, w) < 64)
+        {
+            bits[w] = compareWordScalar(block, wordLength(size, w), op, operands, operandCount);
+            continue;
+        }
+        uint64_t word = 0;
+        for (int j = 0; j < 64; j += 8)
+        {
+            __m256 match = compareFloatsAvx2(_mm256_loadu_ps(block + j), op, operands, operandCount);
+            word |= (uint64_t)(uint32_t)_mm256_movemask_ps(match) << j;
+        }
+        bits[w] = word;
+    }
+}
+
+// AVX-512: compare 16 INT values straight into a mask
+__attribute__((target("avx512f"))) static inline __mmask16 compareIntsAvx512(__m512i v, CompareOp op, const int32_t *operands, int operandCount)
+{
+    __m512i a = _mm512_set1_epi32(operands[0]);
+    switch (op)
+    {
+    case COMPARE_EQ:
+        return _mm512_cmp_epi32_mask(v, a, _MM_CMPINT_EQ);
+    case COMPARE_NE:
+        return _mm512_cmp_epi32_mask(v, a, _MM_CMPINT_NE);
+    case COMPARE_LT:
+        return _mm512_cmp_epi32_mask(v, a, _MM_CMPINT_LT);
+    case COMPARE_LE:
+        return _mm512_cmp_epi32_mask(v, a, _MM_CMPINT_LE);
+    case COMPARE_GT:
+        return _mm512_cmp_epi32_mask(v, a, _MM_CMPINT_NLE);
+    case COMPARE_GE:
+        return _mm512_cmp_epi32_mask(v, a, _MM_CMPINT_NLT);
+    case COMPARE_BETWEEN:
+        return _mm512_mask_cmp_epi32_mask(_mm512_cmp_epi32_mask(v, a, _MM_CMPINT_NLT), v, _mm512_set1_epi32(operands[1]), _MM_CMPINT_LE);
+    case COMPARE_IN:
+    {
+        __mmask16 match = 0;
+        for (int k = 0; k < operandCount; k++)
+        {
+            match |= _mm512_cmp_epi32_mask(v, _mm512_set1_epi32(operands[k]), _MM_CMPINT_EQ);
+        }
+        return match;
+    }
+    }
+    return 0;
+}
+
+__attribute__((target("avx512f"))) static void compareIntAvx512(const int32_t *values, int64_t size, int64_t wordBegin, int64_t wordEnd, CompareOp op,
+                                                                 const int32_t *operands, int operandCount, uint64_t *bits)
+{
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        const int32_t *block = values + (size_t)w * 64;
+        if (wordLength(size, w) < 64)
+        {
+            bits[w] = compareWordScalar(block, wordLength(size, w), op, operands, operandCount);
+            continue;
+        }
+        uint64_t word = 0;
+        for (int j = 0; j < 64; j += 16)
+        {
+            word |= (uint64_t)compareIntsAvx512(_mm512_loadu_si512(block + j), op, operands, operandCount) << j;
+        }
+        bits[w] = word;
+    }
+}
+
+// AVX-512: compare 16 FLOAT values straight into a mask
+__attribute__((target("avx512f"))) static inline __mmask16 compareFloatsAvx512(__m512 v, CompareOp op, const float *operands, int operandCount)
+{
+    __m512 a = _mm512_set1_ps(operands[0]);
+    switch (op)
+    {
+    case COMPARE_EQ:
+        return _mm512_cmp_ps_mask(v, a, _CMP_EQ_OQ);
+    case COMPARE_NE:
+        return _mm512_cmp_ps_mask(v, a, _CMP_NEQ_UQ);
+    case COMPARE_LT:
+        return _mm512_cmp_ps_mask(v, a, _CMP_LT_OQ);
+    case COMPARE_LE:
+        return _mm512_cmp_ps_mask(v, a, _CMP_LE_OQ);
+    case COMPARE_GT:
+        return _mm512_cmp_ps_mask(v, a, _CMP_GT_OQ);
+    case COMPARE_GE:
+        return _mm512_cmp_ps_mask(v, a, _CMP_GE_OQ);
+    case COMPARE_BETWEEN:
+        return _mm512_mask_cmp_ps_mask(_mm512_cmp_ps_mask(v, a, _CMP_GE_OQ), v, _mm512_set1_ps(operands[1]), _CMP_LE_OQ);
+    case COMPARE_IN:
+    {
+        __mmask16 match = 0;
+        for (int k = 0; k < operandCount; k++)
+        {
+            match |= _mm512_cmp_ps_mask(v, _mm512_set1_ps(operands[k]), _CMP_EQ_OQ);
+        }
+        return match;
+    }
+    }
+    return 0;
+}
+
+__attribute__((target("avx512f"))) static void compareFloatAvx512(const float *values, int64_t size, int64_t wordBegin, int64_t wordEnd, CompareOp op,
+                                                                   const float *operands, int operandCount, uint64_t *bits)
+{
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        const float *block = values + (size_t)w * 64;
+        if (wordLength(size, w) < 64)
+        {
+            bits[w] = compareWordScalar(block, wordLength(size, w), op, operands, operandCount);
+            continue;
+        }
+        uint64_t word = 0;
+        for (int j = 0; j < 64; j += 16)
+        {
+            word |= (uint64_t)compareFloatsAvx512(_mm512_loadu_ps(block + j), op, operands, operandCount) << j;
+        }
+        bits[w] = word;
+    }
+}
+
+typedef void (*IntKernel)(const int32_t *, int64_t, int64_t, int64_t, CompareOp, const int32_t *, int, uint64_t *);
+typedef void (*FloatKernel)(const float *, int64_t, int64_t, int64_t, CompareOp, const float *, int, uint64_t *);
+
+// Define a struct for the compare functions of one kernel
+typedef struct
+{
+    FilterKernel kind;
+    IntKernel intKernel;
+    FloatKernel floatKernel;
+} KernelTable;
+
+static const KernelTable kernelTables[] = {
+    {KERNEL_SCALAR, compareScalar<int32_t>, compareScalar<float>},
+    {KERNEL_AVX2, compareIntAvx2, compareFloatAvx2},
+    {KERNEL_AVX512, compareIntAvx512, compareFloatAvx512},
+};
+
+// The kernel in use, published as one pointer so a thread never sees half of a choice
+static std::atomic<const KernelTable *> activeKernel(NULL);
+static std::once_flag autoKernel;
+
+// Check whether the CPU supports the instruction set of a kernel
+static bool kernelSupported(FilterKernel kernel)
+{
+    switch (kernel)
+    {
+    case KERNEL_SCALAR:
+        return true;
+    case KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case KERNEL_AVX512:
+        return __builtin_cpu_supports("avx512f");
+    default:
+        return false;
+    }
+}
+
+// Get the table of a kernel, the best one the CPU supports for KERNEL_AUTO
+static const KernelTable *kernelTable(FilterKernel kernel)
+{
+    if (kernel == KERNEL_AUTO)
+    {
+        kernel = kernelSupported(KERNEL_AVX512) ? KERNEL_AVX512 : kernelSupported(KERNEL_AVX2) ? KERNEL_AVX2 : KERNEL_SCALAR;
+    }
+    for (size_t k = 0; k < sizeof(kernelTables) / sizeof(kernelTables[0]); k++)
+    {
+        if (kernelTables[k].kind == kernel)
+        {
+            return &kernelTables[k];
+        }
+    }
+    return NULL;
+}
+
+// Get the table of the kernel in use, choosing it from CPUID once on first use
+// A kernel set by setFilterKernel in the meantime is kept.
+static const KernelTable *currentKernel()
+{
+    const KernelTable *table = activeKernel.load(std::memory_order_acquire);
+    if (table == NULL)
+    {
+        std::call_once(autoKernel, []() {
+            const KernelTable *none = NULL;
+            activeKernel.compare_exchange_strong(none, kernelTable(KERNEL_AUTO), std::memory_order_acq_rel);
+        });
+        table = activeKernel.load(std::memory_order_acquire);
+    }
+    return table;
+}
+
+/*
+This function chooses the kernel used by the filters. KERNEL_AUTO picks AVX-512,
+then AVX2, then the scalar kernel, whichever the CPU supports first. The choice is
+published at once, so it may be changed while other threads filter; a filter that
+is running finishes with the kernel it started with.
+It returns false, leaving the current kernel in place, if the CPU does not support
+the requested kernel.
+*/
+bool setFilterKernel(FilterKernel kernel)
+{
+    const KernelTable *table = kernelTable(kernel);
+    if (table == NULL || !kernelSupported(table->kind))
+    {
+        return false;
+    }
+    activeKernel.store(table, std::memory_order_release);
+    return true;
+}
+
+/*
+This function returns the kernel used by the filters, choosing it from CPUID on first use.
+*/
+FilterKernel getFilterKernel(void)
+{
+    return currentKernel()->kind;
+}
+
+// Check the operand count of a comparison
+bool validOperands(CompareOp op, const void *operands, int operandCount)
+{
+    if (operands == NULL)
+    {
+        return false;
+    }
+    switch (op)
+    {
+    case COMPARE_BETWEEN:
+        return operandCount >= 2;
+    case COMPARE_EQ:
+    case COMPARE_NE:
+    case COMPARE_LT:
+    case COMPARE_LE:
+    case COMPARE_GT:
+    case COMPARE_GE:
+    case COMPARE_IN:
+        return operandCount >= 1;
+    }
+    return false;
+}
+
+/*
+This function decides a comparison for every value of a block from the smallest and largest
+value of the block, none of which may be NaN. It returns 1 if every value satisfies it, 0 if none does and -1 if the
+values must be compared one by one.
+*/
+template <typename T>
+static int decideBlock(T min, T max, CompareOp op, const T *operands, int operandCount)
+{
+    if (min == max)
+    {
+        return compareValue(min, op, operands, operandCount);
+    }
+    switch (op)
+    {
+    case COMPARE_EQ:
+        return operands[0] < min || operands[0] > max ? 0 : -1;
+    case COMPARE_NE:
+        return operands[0] < min || operands[0] > max ? 1 : -1;
+    case COMPARE_LT:
+        return max < operands[0] ? 1 : min >= operands[0] ? 0 : -1;
+    case COMPARE_LE:
+        return max <= operands[0] ? 1 : min > operands[0] ? 0 : -1;
+    case COMPARE_GT:
+        return min > operands[0] ? 1 : max <= operands[0] ? 0 : -1;
+    case COMPARE_GE:
+        return min >= operands[0] ? 1 : max < operands[0] ? 0 : -1;
+    case COMPARE_BETWEEN:
+        if (max < operands[0] || min > operands[1])
+        {
+            return 0;
+        }
+        return min >= operands[0] && max <= operands[1] ? 1 : -1;
+    case COMPARE_IN:
+        for (int k = 0; k < operandCount; k++)
+        {
+            if (operands[k] >= min && operands[k] <= max)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    return -1;
+}
+
+/*
+This function compares the INT values of the words [wordBegin, wordEnd) of a sealed dataset
+block by block. A block the comparison is decided for by its smallest and largest value has
+its words set or cleared whole; an RLE block compares each run once and sets the bits of
+the runs that satisfy it; any other block is decoded and compared with the kernel.
+*/
+static void filterEncodedRange(const DataSet *dataset, IntKernel compare, CompareOp op, const int32_t *operands,
+                               int operandCount, uint64_t *bits, int64_t wordBegin, int64_t wordEnd)
+{
+    const EncodedInts *column = dataset->encodedInts;
+    const int64_t blockWords = INT_BLOCK_SIZE / 64;
+    int32_t values[INT_BLOCK_SIZE];
+    for (int64_t b = wordBegin / blockWords; b * blockWords < wordEnd; b++)
+    {
+        const IntBlock *block = &column->blocks[b];
+        int64_t first = b * blockWords > wordBegin ? b * blockWords : wordBegin;
+        int64_t last = (b + 1) * blockWords < wordEnd ? (b + 1) * blockWords : wordEnd;
+        int decision = decideBlock(block->min, block->max, op, operands, operandCount);
+        if (decision >= 0)
+        {
+            memset(bits + (first - wordBegin), decision ? 0xFF : 0, (size_t)(last - first) * sizeof(uint64_t));
+        }
+        else if (block->encoding == ENCODING_RLE)
+        {
+            memset(bits + (first - wordBegin), 0, (size_t)(last - first) * sizeof(uint64_t));
+            int64_t begin = 0;
+            for (int r = 0; r < block->runs; r++)
+            {
+                int32_t value;
+                uint32_t end;
+                runAt(column, block, r, &value, &end);
+                if (compareValue(value, op, operands, operandCount))
+                {
+                    // Words of the block are numbered from the start of the block
+                    for (int64_t w = begin / 64; w < bitmapWordCount(end); w++)
+                    {
+                        if (b * blockWords + w >= first && b * blockWords + w < last)
+                        {
+                            bits[b * blockWords + w - wordBegin] |= rangeMask(w, begin, end);
+                        }
+                    }
+                }
+                begin = end;
+            }
+        }
+        else
+        {
+            int64_t skip = (first - b * blockWords) * 64;
+            decodeIntBlock(column, b, blockLength(dataset->size, b), values);
+            compare(values + skip, blockLength(dataset->size, b) - skip, 0, last - first, op, operands, operandCount,
+                    bits + (first - wordBegin));
+        }
+    }
+}
+
+// Decide a comparison for the INT or FLOAT values of a zone from its zone map
+static int decideZone(const Zone *zone, CompareOp op, const int32_t *operands, int operandCount)
+{
+    if (zone->counts[INT] == 0)
+    {
+        return 0;
+    }
+    return decideBlock(zone->intMin, zone->intMax, op, operands, operandCount);
+}
+
+static int decideZone(const Zone *zone, CompareOp op, const float *operands, int operandCount)
+{
+    if (zone->counts[FLOAT] == 0)
+    {
+        return 0;
+    }
+    // A NaN value satisfies NE only, so only its absence lets the bounds decide
+    if (zone->floatNaN)
+    {
+        return -1;
+    }
+    return decideBlock(zone->floatMin, zone->floatMax, op, operands, operandCount);
+}
+
+/*
+This function compares the values of a column over the words [wordBegin, wordEnd) zone by
+zone, into bits holding those words. A zone without a value of the type, or whose bounds
+decide the comparison, has its words cleared or set without reading a value; the kernel
+compares the values of the other zones. The caller keeps only the slots of the type.
+*/
+template <typename T, typename Kernel>
+static void filterZones(const DataSet *dataset, const T *values, Kernel kernel, CompareOp op, const T *operands,
+                        int operandCount, uint64_t *bits, int64_t wordBegin, int64_t wordEnd)
+{
+    const int64_t zoneWords = ZONE_SIZE / 64;
+    int64_t skipped = 0;
+    for (int64_t first = wordBegin; first < wordEnd;)
+    {
+        int64_t last = (first / zoneWords + 1) * zoneWords < wordEnd ? (first / zoneWords + 1) * zoneWords : wordEnd;
+        int decision = -1;
+        if (dataset->zones != NULL)
+        {
+            decision = decideZone(&dataset->zones[first / zoneWords], op, operands, operandCount);
+        }
+        if (decision >= 0)
+        {
+            memset(bits + (first - wordBegin), decision ? 0xFF : 0, (size_t)(last - first) * sizeof(uint64_t));
+            skipped += wordSlots(dataset->size, first, last);
+        }
+        else
+        {
+            kernel(values + first * 64, dataset->size - first * 64, 0, last - first, op, operands, operandCount,
+                   bits + (first - wordBegin));
+        }
+        first = last;
+    }
+    countScan(dataset, wordSlots(dataset->size, wordBegin, wordEnd) - skipped, skipped);
+}
+
+// Compare the INT values of the words [wordBegin, wordEnd) and keep only INT slots
+void filterIntRange(const DataSet *dataset, CompareOp op, const int32_t *operands, int operandCount,
+                    uint64_t *bits, int64_t wordBegin, int64_t wordEnd)
+{
+    if (dataset->encodedInts != NULL)
+    {
+        filterEncodedRange(dataset, currentKernel()->intKernel, op, operands, operandCount, bits, wordBegin, wordEnd);
+        countScan(dataset, wordSlots(dataset->size, wordBegin, wordEnd), 0);
+    }
+    else if (dataset->ints == NULL)
+    {
+        memset(bits, 0, (size_t)(wordEnd - wordBegin) * sizeof(uint64_t));
+        countScan(dataset, 0, wordSlots(dataset->size, wordBegin, wordEnd));
+        return;
+    }
+    else
+    {
+        filterZones(dataset, dataset->ints, currentKernel()->intKernel, op, operands, operandCount, bits, wordBegin, wordEnd);
+    }
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        bits[w - wordBegin] &= dataset->typeIndex[INT].words[w];
+    }
+}
+
+// Compare the FLOAT values of the words [wordBegin, wordEnd) and keep only FLOAT slots
+void filterFloatRange(const DataSet *dataset, CompareOp op, const float *operands, int operandCount,
+                      uint64_t *bits, int64_t wordBegin, int64_t wordEnd)
+{
+    if (dataset->floats == NULL)
+    {
+        memset(bits, 0, (size_t)(wordEnd - wordBegin) * sizeof(uint64_t));
+        countScan(dataset, 0, wordSlots(dataset->size, wordBegin, wordEnd));
+        return;
+    }
+    filterZones(dataset, dataset->floats, currentKernel()->floatKernel, op, operands, operandCount, bits, wordBegin, wordEnd);
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        bits[w - wordBegin] &= dataset->typeIndex[FLOAT].words[w];
+    }
+}
+
+/*
+This function selects the INT data points of a dataset whose value satisfies a comparison.
+It runs the filter kernel over the INT column, skipping the zones whose zone map rules
+out or guarantees a match, and then keeps only the slots set in the INT bitmap, so empty slots and slots of other types are never selected.
+It returns a bitmap with one bit per slot of the dataset, which the caller frees with
+freeBitmap, or NULL if the dataset is NULL, the operands do not suit the comparison,
+or memory runs out.
+*/
+Bitmap *filterIntValues(DataSet *dataset, CompareOp op, const int32_t *operands, int operandCount)
+{
+    ScopedStatTimer timer(STAT_TIMER_FILTER_VALUES);
+    if (dataset == NULL || !validOperands(op, operands, operandCount))
+    {
+        return NULL;
+    }
+    Bitmap *selection = createBitmap(dataset->size);
+    if (selection == NULL)
+    {
+        return NULL;
+    }
+    filterIntRange(dataset, op, operands, operandCount, selection->words, 0, bitmapWordCount(dataset->size));
+    return selection;
+}
+
+/*
+This function selects the FLOAT data points of a dataset whose value satisfies a comparison.
+It works like filterIntValues over the FLOAT column and the FLOAT bitmap. Comparisons follow
+C semantics, so a NaN value only satisfies COMPARE_NE.
+*/
+Bitmap *filterFloatValues(DataSet *dataset, CompareOp op, const float *operands, int operandCount)
+{
+    ScopedStatTimer timer(STAT_TIMER_FILTER_VALUES);
+    if (dataset == NULL || !validOperands(op, operands, operandCount))
+    {
+        return NULL;
+    }
+    Bitmap *selection = createBitmap(dataset->size);
+    if (selection == NULL)
+    {
+        return NULL;
+    }
+    filterFloatRange(dataset, op, operands, operandCount, selection->words, 0, bitmapWordCount(dataset->size));
+    return selection;
+}
@@ -0,0 +1,414 @@
+#include "groupby.h"
+#include "internal.h"
+
+#include <immintrin.h>
+
+/*
+Group-by. The slots holding a key of the key type in one dataset and a value of the value
+type in the other are grouped by key, and each group keeps running aggregates of its
+values. Groups live in an array in the order they are found and a hash table maps keys to
+groups. The table is probed a bucket of GROUP_BUCKET_SIZE entries at a time: one SSE2
+comparison matches the tag of a key against the tags of the whole bucket, so a probe
+rarely reads a group it does not want, and buckets are probed linearly so a probe that
+moves on stays in the next cache line. A word of slots is hashed before any is probed and
+the buckets it needs are prefetched, so the cache misses of its probes overlap.
+*/
+
+#define GROUP_BUCKET_SIZE 16
+#define GROUP_TAG_FREE 0x80
+#define GROUP_MIN_CAPACITY 64
+
+// Check the arguments shared by the group-by functions
+bool validGroupBy(const DataSet *keys, DataType keyType, const DataSet *values, DataType valueType, const Bitmap *selection)
+{
+    return keys != NULL && values != NULL && keys->size == values->size && (keyType == INT || keyType == FLOAT || keyType == STRING) &&
+           (valueType == INT || valueType == FLOAT) && (selection == NULL || selection->size == keys->size);
+}
+
+// Tag of a hash, taken from the bits above those that choose its bucket
+static inline uint8_t hashTag(uint64_t hash)
+{
+    return (uint8_t)(hash >> 57);
+}
+
+// Key of slot index of the key dataset: the INT value, the FLOAT bits with -0 as 0 and every
+// NaN alike, the dictionary code, or 0 for a string compared by its bytes
+static inline uint64_t slotKey(const GroupTable *table, IntReader *reader, int64_t index)
+{
+    switch (table->keyType)
+    {
+    case INT:
+        return (uint32_t)readInt(reader, index);
+    case FLOAT:
+    {
+        float value = table->keys->floats[index];
+        uint32_t bits;
+        if (value != value)
+        {
+            return 0x7fc00000u;
+        }
+        value = value == 0.0f ? 0.0f : value;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    default:
+        return table->keys->dictionary != NULL ? codeAt(table->keys->dictionary, index) : 0;
+    }
+}
+
+// Hash of the key of slot index
+static inline uint64_t keyHash(const GroupTable *table, uint64_t key, int64_t index)
+{
+    if (table->keyType == STRING && table->keys->dictionary == NULL)
+    {
+        size_t length;
+        const char *value = stringAt(table->keys, index, &length);
+        return mixHash(hashString(value, length));
+    }
+    return mixHash(key);
+}
+
+// Check whether a group has the key of slot index
+static inline bool sameKey(const GroupTable *table, const Group *group, uint64_t hash, uint64_t key, int64_t index)
+{
+    if (group->hash != hash || group->key != key)
+    {
+        return false;
+    }
+    if (table->keyType != STRING || table->keys->dictionary != NULL)
+    {
+        return true;
+    }
+    size_t groupLength, length;
+    const char *groupValue = stringAt(table->keys, group->first, &groupLength);
+    const char *value = stringAt(table->keys, index, &length);
+    return groupLength == length && memcmp(groupValue, value, length) == 0;
+}
+
+// Allocate the entries of a table, all free
+static bool allocateEntries(GroupTable *table, int64_t capacity)
+{
+    table->tags = (uint8_t *)malloc(capacity);
+    table->entries = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    if (table->tags == NULL || table->entries == NULL)
+    {
+        free(table->tags);
+        free(table->entries);
+        return false;
+    }
+    memset(table->tags, GROUP_TAG_FREE, capacity);
+    table->capacity = capacity;
+    return true;
+}
+
+// Put group g in the first free entry of the buckets its hash probes
+static void placeGroup(GroupTable *table, uint32_t g)
+{
+    uint64_t hash = table->groups[g].hash;
+    int64_t bucketMask = table->capacity / GROUP_BUCKET_SIZE - 1;
+    __m128i freeTags = _mm_set1_epi8((char)GROUP_TAG_FREE);
+    for (int64_t b = (int64_t)hash & bucketMask;; b = (b + 1) & bucketMask)
+    {
+        uint8_t *tags = table->tags + b * GROUP_BUCKET_SIZE;
+        uint32_t empty = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)tags), freeTags));
+        if (empty != 0)
+        {
+            int entry = __builtin_ctz(empty);
+            tags[entry] = hashTag(hash);
+            table->entries[b * GROUP_BUCKET_SIZE + entry] = g;
+            return;
+        }
+    }
+}
+
+// Double the entries of a table and place every group again
+static bool growEntries(GroupTable *table)
+{
+    uint8_t *tags = table->tags;
+    uint32_t *entries = table->entries;
+    if (!allocateEntries(table, table->capacity * 2))
+    {
+        table->tags = tags;
+        table->entries = entries;
+        return false;
+    }
+    free(tags);
+    free(entries);
+    for (int64_t g = 0; g < table->count; g++)
+    {
+        placeGroup(table, (uint32_t)g);
+    }
+    return true;
+}
+
+/*
+This function finds the group with the key of slot index, creating an empty group for it
+if there is none. The table is grown before it is more than 7/8 full, so a probe always
+reaches a free entry. It returns NULL if memory runs out.
+*/
+static Group *findGroup(GroupTable *table, uint64_t hash, uint64_t key, int64_t index)
+{
+    int64_t bucketMask = table->capacity / GROUP_BUCKET_SIZE - 1;
+    __m128i tag = _mm_set1_epi8((char)hashTag(hash));
+    __m128i freeTags = _mm_set1_epi8((char)GROUP_TAG_FREE);
+    for (int64_t b = (int64_t)hash & bucketMask;; b = (b + 1) & bucketMask)
+    {
+        __m128i tags = _mm_loadu_si128((const __m128i *)(table->tags + b * GROUP_BUCKET_SIZE));
+        for (uint32_t matches = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(tags, tag)); matches != 0; matches &= matches - 1)
+        {
+            Group *group = &table->groups[table->entries[b * GROUP_BUCKET_SIZE + __builtin_ctz(matches)]];
+            if (sameKey(table, group, hash, key, index))
+            {
+                return group;
+            }
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(tags, freeTags)) != 0)
+        {
+            break;
+        }
+    }
+    if (table->count == UINT32_MAX)
+    {
+        return NULL;
+    }
+    if (table->count == table->groupCapacity)
+    {
+        Group *groups = (Group *)realloc(table->groups, table->groupCapacity * 2 * sizeof(Group));
+        if (groups == NULL)
+        {
+            return NULL;
+        }
+        table->groups = groups;
+        table->groupCapacity *= 2;
+    }
+    if ((table->count + 1) * 8 > table->capacity * 7 && !growEntries(table))
+    {
+        return NULL;
+    }
+    Group *group = &table->groups[table->count];
+    group->key = key;
+    group->hash = hash;
+    group->first = index;
+    initPartial(&group->partial);
+    placeGroup(table, (uint32_t)table->count++);
+    return group;
+}
+
+/*
+This function sets up an empty group table for grouping the values of a type held by one
+dataset by the keys of a type held by another. It returns false if memory runs out.
+*/
+bool initGroupTable(GroupTable *table, const DataSet *keys, DataType keyType, const DataSet *values, DataType valueType)
+{
+    table->keys = keys;
+    table->keyType = keyType;
+    table->values = values;
+    table->valueType = valueType;
+    table->count = 0;
+    table->groupCapacity = GROUP_MIN_CAPACITY;
+    table->groups = (Group *)malloc(GROUP_MIN_CAPACITY * sizeof(Group));
+    if (table->groups == NULL)
+    {
+        return false;
+    }
+    if (!allocateEntries(table, GROUP_MIN_CAPACITY))
+    {
+        free(table->groups);
+        table->groups = NULL;
+        return false;
+    }
+    return true;
+}
+
+// Free the memory of a group table
+void releaseGroupTable(GroupTable *table)
+{
+    free(table->tags);
+    free(table->entries);
+    free(table->groups);
+    table->tags = NULL;
+    table->entries = NULL;
+    table->groups = NULL;
+}
+
+/*
+This function adds to the groups of a table the slots in the words [wordBegin, wordEnd)
+that hold a key and a value, restricted to a selection if it is not NULL. A zone of
+either dataset without a data point of its type is skipped.
+It returns false if memory runs out.
+*/
+bool groupRange(GroupTable *table, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd)
+{
+    const DataSet *keys = table->keys;
+    const DataSet *values = table->values;
+    const int64_t zoneWords = ZONE_SIZE / 64;
+    IntReader keyReader = {keys, -1, {}};
+    IntReader valueReader = {values, -1, {}};
+    int64_t slots[64];
+    uint64_t slotKeys[64];
+    uint64_t hashes[64];
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        if (w == wordBegin || w % zoneWords == 0)
+        {
+            int64_t zone = w / zoneWords;
+            if ((keys->zones != NULL && keys->zones[zone].counts[table->keyType] == 0) ||
+                (values->zones != NULL && values->zones[zone].counts[table->valueType] == 0))
+            {
+                w = (zone + 1) * zoneWords - 1;
+                continue;
+            }
+        }
+        uint64_t bits = keys->typeIndex[table->keyType].words[w] & values->typeIndex[table->valueType].words[w];
+        if (selection != NULL)
+        {
+            bits &= selection->words[w];
+        }
+        // Hash the word's slots and prefetch their buckets, then probe
+        int count = 0;
+        int64_t bucketMask = table->capacity / GROUP_BUCKET_SIZE - 1;
+        for (; bits != 0; bits &= bits - 1)
+        {
+            int64_t i = w * 64 + __builtin_ctzll(bits);
+            slots[count] = i;
+            slotKeys[count] = slotKey(table, &keyReader, i);
+            hashes[count] = keyHash(table, slotKeys[count], i);
+            __builtin_prefetch(table->tags + ((int64_t)hashes[count] & bucketMask) * GROUP_BUCKET_SIZE);
+            count++;
+        }
+        for (int k = 0; k < count; k++)
+        {
+            Group *group = findGroup(table, hashes[k], slotKeys[k], slots[k]);
+            if (group == NULL)
+            {
+                return false;
+            }
+            Partial *partial = &group->partial;
+            double value;
+            if (table->valueType == INT)
+            {
+                int32_t number = readInt(&valueReader, slots[k]);
+                partial->intSum += number;
+                value = number;
+            }
+            else
+            {
+                value = values->floats[slots[k]];
+                partial->sum += value;
+            }
+            partial->count++;
+            partial->min = value < partial->min ? value : partial->min;
+            partial->max = value > partial->max ? value : partial->max;
+        }
+    }
+    return true;
+}
+
+/*
+This function merges the groups of one table into another over the same datasets,
+adding the groups it lacks in the order the other table found them.
+It returns false if memory runs out.
+*/
+bool mergeGroupTable(GroupTable *into, const GroupTable *from)
+{
+    for (int64_t g = 0; g < from->count; g++)
+    {
+        const Group *source = &from->groups[g];
+        Group *group = findGroup(into, source->hash, source->key, source->first);
+        if (group == NULL)
+        {
+            return false;
+        }
+        mergePartial(&group->partial, &source->partial);
+    }
+    return true;
+}
+
+/*
+This function builds the result of a group-by from its table: a dataset holding the key
+of each group and the aggregates of its values. It returns NULL if memory runs out.
+*/
+GroupByResult *finishGroupBy(const GroupTable *table)
+{
+    GroupByResult *result = (GroupByResult *)malloc(sizeof(GroupByResult));
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    result->count = table->count;
+    result->keys = createDataSetWithCapacity(table->count);
+    result->results = (AggregateResult *)malloc((table->count > 0 ? table->count : 1) * sizeof(AggregateResult));
+    bool ok = result->keys != NULL && result->results != NULL && resizeDataSet(result->keys, table->count);
+    IntReader reader = {table->keys, -1, {}};
+    for (int64_t g = 0; ok && g < table->count; g++)
+    {
+        const Group *group = &table->groups[g];
+        if (table->keyType == STRING)
+        {
+            size_t length;
+            const char *value = stringAt(table->keys, group->first, &length);
+            ok = storeStringValue(result->keys, g, value, length);
+        }
+        else if (table->keyType == INT)
+        {
+            int32_t value = readInt(&reader, group->first);
+            ok = storeValue(result->keys, g, INT, &value);
+        }
+        else
+        {
+            float value = table->keys->floats[group->first];
+            ok = storeValue(result->keys, g, FLOAT, &value);
+        }
+        finishAggregate(&group->partial, table->valueType, &result->results[g]);
+    }
+    if (!ok)
+    {
+        freeGroupByResult(result);
+        return NULL;
+    }
+    return result;
+}
+
+/*
+This function groups the slots holding a key of type keyType in the keys dataset and a
+value of type valueType in the values dataset, restricted to a selection if it is not NULL,
+by key, and computes COUNT, SUM, MIN, MAX and AVG over the values of each group as
+aggregateValues does. FLOAT keys -0 and 0 fall in one group, and so do NaN keys.
+The result is freed with freeGroupByResult.
+It returns NULL if a dataset is NULL, the datasets differ in size, the key type is invalid,
+the value type is not INT or FLOAT, the selection does not match or memory runs out.
+*/
+GroupByResult *groupByValues(DataSet *keys, DataType keyType, DataSet *values, DataType valueType, const Bitmap *selection)
+{
+    ScopedStatTimer timer(STAT_TIMER_GROUP_BY);
+    if (!validGroupBy(keys, keyType, values, valueType, selection))
+    {
+        return NULL;
+    }
+    GroupTable table;
+    if (!initGroupTable(&table, keys, keyType, values, valueType))
+    {
+        return NULL;
+    }
+    GroupByResult *result = NULL;
+    if (groupRange(&table, selection, 0, bitmapWordCount(keys->size)))
+    {
+        result = finishGroupBy(&table);
+    }
+    releaseGroupTable(&table);
+    return result;
+}
+
+/*
+This function frees the result of a group-by, its keys and its aggregates.
+*/
+void freeGroupByResult(GroupByResult *result)
+{
+    if (result == NULL)
+    {
+        return;
+    }
+    freeDataSet(result->keys);
+    free(result->results);
+    free(result);
+}
@@ -0,0 +1,388 @@
+#ifndef BITMAP_INTERNAL_H
+#define BITMAP_INTERNAL_H
+
+#include "bitmap.h"
+#include "filter.h"
+#include "aggregate.h"
+#include "sort.h"
+#include "groupby.h"
+#include "stats.h"
+
+#include <atomic>
+#include <chrono>
+
+/*
+Bitmap helpers shared by the solution files. A bitmap holds one bit per data point
+packed into 64-bit words, so a scan over n data points touches n / 64 words instead
+of n DataPoint structs. Bits past the bitmap size in the last word are always kept
+clear, which lets counts and scans work on whole words without masking.
+*/
+static inline int64_t bitmapWordCount(int64_t size)
+{
+    return (size + 63) / 64;
+}
+
+// Number of data points covered by word w of a bitmap of a given size
+static inline int wordLength(int64_t size, int64_t w)
+{
+    return size - w * 64 < 64 ? (int)(size - w * 64) : 64;
+}
+
+// Mask of the bits of word w that fall in the range [begin, end), which must overlap word w
+static inline uint64_t rangeMask(int64_t w, int64_t begin, int64_t end)
+{
+    uint64_t mask = ~(uint64_t)0;
+    if (w == begin / 64)
+    {
+        mask &= ~(uint64_t)0 << (begin & 63);
+    }
+    if (w == (end - 1) / 64)
+    {
+        mask &= ~(uint64_t)0 >> (63 - ((end - 1) & 63));
+    }
+    return mask;
+}
+
+static inline void setBit(Bitmap *bitmap, int64_t index)
+{
+    bitmap->words[index >> 6] |= (uint64_t)1 << (index & 63);
+}
+
+static inline void clearBit(Bitmap *bitmap, int64_t index)
+{
+    bitmap->words[index >> 6] &= ~((uint64_t)1 << (index & 63));
+}
+
+static inline bool testBit(const Bitmap *bitmap, int64_t index)
+{
+    return (bitmap->words[index >> 6] >> (index & 63)) & 1;
+}
+
+// Read the dictionary code held by slot index
+static inline uint32_t codeAt(const StringDictionary *dictionary, int64_t index)
+{
+    switch (dictionary->codeWidth)
+    {
+    case 1:
+        return ((const uint8_t *)dictionary->codes)[index];
+    case 2:
+        return ((const uint16_t *)dictionary->codes)[index];
+    default:
+        return ((const uint32_t *)dictionary->codes)[index];
+    }
+}
+
+// Get the string held by STRING slot index and its length
+static inline const char *stringAt(const DataSet *dataset, int64_t index, size_t *length)
+{
+    if (dataset->dictionary != NULL)
+    {
+        uint32_t code = codeAt(dataset->dictionary, index);
+        *length = dataset->dictionary->lengths[code];
+        return dataset->strings.bytes + dataset->dictionary->offsets[code];
+    }
+    *length = dataset->strings.lengths[index];
+    return dataset->strings.bytes + dataset->strings.offsets[index];
+}
+
+// Whether a dataset can no longer be changed, being mapped from a file or sealed
+static inline bool readOnly(const DataSet *dataset)
+{
+    return dataset->mapping != NULL || dataset->encodedInts != NULL;
+}
+
+// Number of slots in block b of a sealed INT column of a given size
+static inline int blockLength(int64_t size, int64_t b)
+{
+    return size - b * INT_BLOCK_SIZE < INT_BLOCK_SIZE ? (int)(size - b * INT_BLOCK_SIZE) : INT_BLOCK_SIZE;
+}
+
+// Read run r of an RLE block: its value and the end of the run within the block
+static inline void runAt(const EncodedInts *column, const IntBlock *block, int r, int32_t *value, uint32_t *end)
+{
+    const uint8_t *run = column->bytes + block->offset + (size_t)r * 2 * sizeof(int32_t);
+    memcpy(value, run, sizeof(int32_t));
+    memcpy(end, run + sizeof(int32_t), sizeof(uint32_t));
+}
+
+// Decode a block, or a single slot, of a sealed INT column; free the column (encoding.cpp)
+void decodeIntBlock(const EncodedInts *column, int64_t b, int length, int32_t *values);
+int32_t encodedIntAt(const EncodedInts *column, int64_t index);
+void releaseEncodedInts(DataSet *dataset);
+
+// Read the INT value held by slot index, plain or sealed
+static inline int32_t intAt(const DataSet *dataset, int64_t index)
+{
+    if (dataset->encodedInts != NULL)
+    {
+        return encodedIntAt(dataset->encodedInts, index);
+    }
+    return dataset->ints[index];
+}
+
+// Define a struct for the INT values of a dataset, decoded a block at a time if it is sealed
+typedef struct
+{
+    const DataSet *dataset;
+    int64_t decoded; // block held by values, -1 for none
+    int32_t values[INT_BLOCK_SIZE];
+} IntReader;
+
+static inline int32_t readInt(IntReader *reader, int64_t index)
+{
+    if (reader->dataset->encodedInts == NULL)
+    {
+        return reader->dataset->ints[index];
+    }
+    int64_t block = index / INT_BLOCK_SIZE;
+    if (block != reader->decoded)
+    {
+        reader->decoded = block;
+        decodeIntBlock(reader->dataset->encodedInts, block, blockLength(reader->dataset->size, block), reader->values);
+    }
+    return reader->values[index % INT_BLOCK_SIZE];
+}
+
+// Allocate, resize and release a block of memory from an allocator, or malloc if NULL (allocator.cpp)
+void *allocateBlock(Allocator *allocator, size_t size);
+void *resizeBlock(Allocator *allocator, void *block, size_t oldSize, size_t size);
+void releaseBlock(Allocator *allocator, void *block, size_t size);
+
+// Set the two bloom filter bits of a string hash in a zone
+static inline void addToBloom(Zone *zone, uint32_t hash)
+{
+    zone->bloom[(hash >> 6) % ZONE_BLOOM_WORDS] |= (uint64_t)1 << (hash & 63);
+    zone->bloom[(hash >> 22) % ZONE_BLOOM_WORDS] |= (uint64_t)1 << ((hash >> 16) & 63);
+}
+
+// Check whether a zone may hold a string of a given hash
+static inline bool bloomMayContain(const Zone *zone, uint32_t hash)
+{
+    return ((zone->bloom[(hash >> 6) % ZONE_BLOOM_WORDS] >> (hash & 63)) & 1) &&
+           ((zone->bloom[(hash >> 22) % ZONE_BLOOM_WORDS] >> ((hash >> 16) & 63)) & 1);
+}
+
+// Allocate, resize and free the zone maps of a dataset (zonemap.cpp)
+Zone *allocateZones(Allocator *allocator, int64_t capacity);
+bool resizeZones(DataSet *dataset, int64_t capacity);
+void releaseZones(DataSet *dataset);
+
+// Keep the zone maps up to date as slots are stored and emptied, before their bits change (zonemap.cpp)
+void noteSlotStored(DataSet *dataset, int64_t index, DataType type);
+void noteSlotCleared(DataSet *dataset, int64_t index);
+void noteRangeStored(DataSet *dataset, int64_t begin, int64_t end, DataType type);
+void noteRangeCleared(DataSet *dataset, int64_t begin, int64_t end);
+
+// FNV-1a hash of a string of a given length (bitmap.cpp)
+uint32_t hashString(const char *value, size_t length);
+
+// Mix the bits of a key so that every bit of the hash depends on every bit of the key
+static inline uint64_t mixHash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb93fe53ce4b9ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+// Allocate the column that holds values of a type, if not allocated yet (bitmap.cpp)
+bool ensureColumn(DataSet *dataset, DataType type);
+
+// Store a value of a type into a slot, replacing the slot's value whatever its type (bitmap.cpp)
+bool storeValue(DataSet *dataset, int64_t index, DataType type, const void *value);
+bool storeStringValue(DataSet *dataset, int64_t index, const char *value, size_t length);
+
+// Unmap the file a dataset opened with mapDataSet is read from (storage.cpp)
+void releaseMapping(DataSet *dataset);
+
+// Check the operand count of a comparison (filter.cpp)
+bool validOperands(CompareOp op, const void *operands, int operandCount);
+
+// Set in bits, which holds the words [wordBegin, wordEnd), the INT or FLOAT slots that satisfy a comparison (filter.cpp)
+void filterIntRange(const DataSet *dataset, CompareOp op, const int32_t *operands, int operandCount,
+                    uint64_t *bits, int64_t wordBegin, int64_t wordEnd);
+void filterFloatRange(const DataSet *dataset, CompareOp op, const float *operands, int operandCount,
+                      uint64_t *bits, int64_t wordBegin, int64_t wordEnd);
+
+// Running aggregates of a range of words (aggregate.cpp)
+typedef struct
+{
+    int64_t count;
+    int64_t intSum;
+    double sum;
+    double compensation; // Kahan compensation of sum
+    double min;
+    double max;
+} Partial;
+
+bool validAggregate(const DataSet *dataset, DataType type, const Bitmap *selection);
+void initPartial(Partial *partial);
+void aggregateRange(const DataSet *dataset, DataType type, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd, Partial *partial);
+void mergePartial(Partial *into, const Partial *from);
+void finishAggregate(const Partial *partial, DataType type, AggregateResult *result);
+
+
+// Define a struct for a slot being sorted and the key it sorts by (sort.cpp)
+// INT and FLOAT values and the ranks of dictionary codes map to keys that order like the
+// values, inverted for a descending sort. Other STRING values key on their first four
+// bytes, and slots with equal keys are told apart by their strings.
+typedef struct
+{
+    uint32_t key;
+    int64_t slot;
+} SortEntry;
+
+typedef struct
+{
+    const DataSet *dataset;
+    DataType type;
+    SortOrder order;
+    uint32_t *ranks;     // sort rank of each dictionary code, NULL unless the strings are dictionary-encoded
+    bool compareStrings; // keys are string prefixes
+} SortKeys;
+
+bool validSort(const DataSet *dataset, DataType type, const Bitmap *selection, SortOrder order);
+bool prepareSortKeys(SortKeys *keys, const DataSet *dataset, DataType type, SortOrder order);
+void releaseSortKeys(SortKeys *keys);
+int64_t countSortSlots(const SortKeys *keys, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd);
+int64_t collectSortEntries(const SortKeys *keys, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd, SortEntry *entries);
+void sortEntries(const SortKeys *keys, SortEntry *entries, SortEntry *buffer, int64_t count);
+void mergeEntries(const SortKeys *keys, const SortEntry *left, int64_t leftCount, const SortEntry *right, int64_t rightCount,
+                  SortEntry *out, int64_t outBegin, int64_t outEnd);
+
+
+// Define a struct for a group of a group-by and the running aggregates of its values (groupby.cpp)
+typedef struct
+{
+    uint64_t key;    // INT value, FLOAT bits or dictionary code of the key, 0 for other strings
+    uint64_t hash;   // hash of the key
+    int64_t first;   // slot of the first data point of the group, whose key stands for the group
+    Partial partial; // aggregates of the values of the group
+} Group;
+
+// Define a struct for the hash table of the groups of a group-by (groupby.cpp)
+// Open addressing with linear probing over buckets of GROUP_BUCKET_SIZE entries. Each
+// entry has a one-byte tag, GROUP_TAG_FREE when the entry is free and otherwise seven bits
+// of the hash of its key, so a probe matches the tags of a whole bucket at once and only
+// compares the keys of the entries whose tag matches.
+typedef struct
+{
+    const DataSet *keys;
+    DataType keyType;
+    const DataSet *values;
+    DataType valueType;
+    uint8_t *tags;          // tag of each entry
+    uint32_t *entries;      // group held by each entry
+    int64_t capacity;       // entries, a power of two
+    Group *groups;          // groups in the order they were found
+    int64_t count;          // groups found
+    int64_t groupCapacity;  // groups allocated
+} GroupTable;
+
+bool validGroupBy(const DataSet *keys, DataType keyType, const DataSet *values, DataType valueType, const Bitmap *selection);
+bool initGroupTable(GroupTable *table, const DataSet *keys, DataType keyType, const DataSet *values, DataType valueType);
+bool groupRange(GroupTable *table, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd);
+bool mergeGroupTable(GroupTable *into, const GroupTable *from);
+GroupByResult *finishGroupBy(const GroupTable *table);
+void releaseGroupTable(GroupTable *table);
+
+/*
+Statistics. Global counters are relaxed atomics, so updating one never orders memory or
+waits on another thread. The counters of a dataset live in the dataset: those only its
+writer changes are updated without a locked instruction, and those a scan changes, which
+may run on several threads at once, with a relaxed atomic add. Built with BITMAP_NO_STATS,
+every update below compiles to nothing.
+*/
+#ifndef BITMAP_NO_STATS
+
+// Global counters and timers (stats.cpp)
+extern std::atomic<uint64_t> statCounters[STAT_COUNTER_COUNT];
+extern std::atomic<uint64_t> statTimerCalls[STAT_TIMER_COUNT];
+extern std::atomic<uint64_t> statTimerNanoseconds[STAT_TIMER_COUNT];
+extern std::atomic<bool> statTimersEnabled;
+extern thread_local int statTimerDepth;
+
+static inline void countStat(StatCounter counter, uint64_t amount)
+{
+    statCounters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+// Add to a counter of a dataset that only the writer of the dataset changes
+static inline void countWrite(uint64_t *counter, uint64_t amount)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+// Count values written into the slots of a dataset
+static inline void countStored(DataSet *dataset, int64_t count)
+{
+    countWrite(&dataset->stats.valuesStored, (uint64_t)count);
+    countStat(STAT_VALUES_STORED, (uint64_t)count);
+}
+
+// Count the slots a scan of a dataset read and passed over
+static inline void countScan(const DataSet *dataset, int64_t scanned, int64_t skipped)
+{
+    DataSetStats *stats = (DataSetStats *)&dataset->stats;
+    __atomic_fetch_add(&stats->rowsScanned, (uint64_t)scanned, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->rowsSkipped, (uint64_t)skipped, __ATOMIC_RELAXED);
+    countStat(STAT_ROWS_SCANNED, (uint64_t)scanned);
+    countStat(STAT_ROWS_SKIPPED, (uint64_t)skipped);
+}
+
+// Time the rest of a scope into a timer, if timing is turned on when the scope starts. An
+// operation that hands its work to another timed operation is timed once, by the outer timer.
+class ScopedStatTimer
+{
+public:
+    explicit ScopedStatTimer(StatTimer timer)
+        : timer(timer), running(statTimerDepth++ == 0 && statTimersEnabled.load(std::memory_order_relaxed))
+    {
+        if (running)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedStatTimer()
+    {
+        statTimerDepth--;
+        if (running)
+        {
+            std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+            statTimerCalls[timer].fetch_add(1, std::memory_order_relaxed);
+            statTimerNanoseconds[timer].fetch_add((uint64_t)elapsed.count(), std::memory_order_relaxed);
+        }
+    }
+
+private:
+    StatTimer timer;
+    bool running;
+    std::chrono::steady_clock::time_point start;
+};
+
+#else
+
+static inline void countStat(StatCounter, uint64_t) {}
+static inline void countWrite(uint64_t *, uint64_t) {}
+static inline void countStored(DataSet *, int64_t) {}
+static inline void countScan(const DataSet *, int64_t, int64_t) {}
+
+class ScopedStatTimer
+{
+public:
+    explicit ScopedStatTimer(StatTimer) {}
+};
+
+#endif
+
+// Number of slots of a dataset of a given size covered by the words [wordBegin, wordEnd)
+static inline int64_t wordSlots(int64_t size, int64_t wordBegin, int64_t wordEnd)
+{
+    int64_t end = wordEnd * 64 < size ? wordEnd * 64 : size;
+    return end > wordBegin * 64 ? end - wordBegin * 64 : 0;
+}
+
+#endif
@@ -0,0 +1,447 @@
+#include "join.h"
+#include "internal.h"
+
+#include <algorithm>
+#include <vector>
+
+/*
+Hash join. The slots holding a key of the key type are collected from both datasets with
+the hash of their key, and a chained hash table is built over the smaller side and probed
+with every key of the larger one. When the build side has more keys than fit in cache,
+both sides are first split radix-style into partitions by the top bits of their hashes,
+so each partition builds a table that stays in cache and probes only the keys that can
+match it. Splitting keeps slot order within a partition and each chain lists its build
+slots in slot order, so a final stable counting sort by slot gives pairs in left slot
+order whichever side was built. Dictionary-encoded strings are compared by their bytes,
+as the two datasets number their strings differently.
+*/
+
+// Build keys per partition, few enough for a partition's table to stay in cache
+#define JOIN_PARTITION_SIZE 16384
+
+// Most bits of the hash used to choose a partition
+#define JOIN_MAX_PARTITION_BITS 10
+
+// Define a struct for a slot taking part in a join and its key
+typedef struct
+{
+    uint64_t hash;
+    int64_t slot;
+    int32_t key; // INT key, 0 for a STRING key
+} JoinEntry;
+
+// Define a struct for the pairs found by a join, grown as they are added
+typedef struct
+{
+    int64_t *left;
+    int64_t *right;
+    int64_t count;
+    int64_t capacity;
+} PairList;
+
+// Define a struct for how a join runs
+typedef struct
+{
+    const DataSet *build;
+    const DataSet *probe;
+    DataType keyType;
+    JoinType type;
+    bool buildLeft; // the left dataset is the build side
+} JoinPlan;
+
+// Append a pair to a list, doubling its arrays when full; returns false if memory runs out
+static bool addPair(PairList *pairs, int64_t left, int64_t right)
+{
+    if (pairs->count == pairs->capacity)
+    {
+        int64_t capacity = pairs->capacity > 0 ? pairs->capacity * 2 : 1024;
+        int64_t *lefts = (int64_t *)realloc(pairs->left, capacity * sizeof(int64_t));
+        if (lefts == NULL)
+        {
+            return false;
+        }
+        pairs->left = lefts;
+        int64_t *rights = (int64_t *)realloc(pairs->right, capacity * sizeof(int64_t));
+        if (rights == NULL)
+        {
+            return false;
+        }
+        pairs->right = rights;
+        pairs->capacity = capacity;
+    }
+    pairs->left[pairs->count] = left;
+    pairs->right[pairs->count] = right;
+    pairs->count++;
+    return true;
+}
+
+/*
+This function sorts pairs by left slot, or by right slot if byRight, with a counting
+sort over the slots of a dataset of a given size, so pairs with equal slots keep their
+order. A right slot of -1 sorts first. It returns false if memory runs out.
+*/
+static bool sortPairs(PairList *pairs, bool byRight, int64_t size)
+{
+    const int64_t *keys = byRight ? pairs->right : pairs->left;
+    int64_t *starts = (int64_t *)calloc(size + 2, sizeof(int64_t));
+    int64_t *lefts = (int64_t *)malloc((pairs->capacity > 0 ? pairs->capacity : 1) * sizeof(int64_t));
+    int64_t *rights = (int64_t *)malloc((pairs->capacity > 0 ? pairs->capacity : 1) * sizeof(int64_t));
+    if (starts == NULL || lefts == NULL || rights == NULL)
+    {
+        free(starts);
+        free(lefts);
+        free(rights);
+        return false;
+    }
+    for (int64_t i = 0; i < pairs->count; i++)
+    {
+        starts[keys[i] + 2]++;
+    }
+    for (int64_t k = 1; k < size + 2; k++)
+    {
+        starts[k] += starts[k - 1];
+    }
+    for (int64_t i = 0; i < pairs->count; i++)
+    {
+        int64_t position = starts[keys[i] + 1]++;
+        lefts[position] = pairs->left[i];
+        rights[position] = pairs->right[i];
+    }
+    free(starts);
+    free(pairs->left);
+    free(pairs->right);
+    pairs->left = lefts;
+    pairs->right = rights;
+    return true;
+}
+
+// Hash of the key of a STRING slot, the dictionary's if the dataset has one
+static inline uint64_t stringHash(const DataSet *dataset, int64_t index)
+{
+    if (dataset->dictionary != NULL)
+    {
+        return mixHash(dataset->dictionary->hashes[codeAt(dataset->dictionary, index)]);
+    }
+    size_t length;
+    const char *value = stringAt(dataset, index, &length);
+    return mixHash(hashString(value, length));
+}
+
+// Write the entry of every slot of a dataset holding a key, in slot order
+static void collectEntries(const DataSet *dataset, DataType keyType, JoinEntry *entries)
+{
+    IntReader reader = {dataset, -1, {}};
+    int64_t count = 0;
+    int64_t words = bitmapWordCount(dataset->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        for (uint64_t bits = dataset->typeIndex[keyType].words[w]; bits != 0; bits &= bits - 1)
+        {
+            int64_t i = w * 64 + __builtin_ctzll(bits);
+            JoinEntry *entry = &entries[count++];
+            entry->slot = i;
+            if (keyType == INT)
+            {
+                entry->key = readInt(&reader, i);
+                entry->hash = mixHash((uint32_t)entry->key);
+            }
+            else
+            {
+                entry->key = 0;
+                entry->hash = stringHash(dataset, i);
+            }
+        }
+    }
+}
+
+// Check whether a build entry and a probe entry have equal keys
+static inline bool sameKey(const JoinPlan *plan, const JoinEntry *build, const JoinEntry *probe)
+{
+    if (build->hash != probe->hash || build->key != probe->key)
+    {
+        return false;
+    }
+    if (plan->keyType == INT)
+    {
+        return true;
+    }
+    size_t buildLength, probeLength;
+    const char *buildValue = stringAt(plan->build, build->slot, &buildLength);
+    const char *probeValue = stringAt(plan->probe, probe->slot, &probeLength);
+    return buildLength == probeLength && memcmp(buildValue, probeValue, buildLength) == 0;
+}
+
+// Split entries into partitions by the top bits of their hashes, keeping their order, and
+// set starts[p] to the first entry of partition p
+static void partitionEntries(const JoinEntry *entries, int64_t count, int bits, JoinEntry *out, int64_t *starts)
+{
+    int64_t partitions = (int64_t)1 << bits;
+    memset(starts, 0, (partitions + 1) * sizeof(int64_t));
+    for (int64_t i = 0; i < count; i++)
+    {
+        starts[(entries[i].hash >> (64 - bits)) + 1]++;
+    }
+    for (int64_t p = 0; p < partitions; p++)
+    {
+        starts[p + 1] += starts[p];
+    }
+    std::vector<int64_t> next(starts, starts + partitions);
+    for (int64_t i = 0; i < count; i++)
+    {
+        out[next[entries[i].hash >> (64 - bits)]++] = entries[i];
+    }
+}
+
+/*
+This function joins one partition: it chains the build entries into a hash table of
+tableSize buckets, the last entry first so each chain lists its slots in slot order, and
+probes it with each probe entry. A match on a left build side is marked in matched.
+It returns false if memory runs out.
+*/
+static bool joinPartition(const JoinPlan *plan, const JoinEntry *build, int64_t buildCount, const JoinEntry *probe, int64_t probeCount,
+                          int64_t *heads, int64_t *next, int64_t tableSize, PairList *pairs, Bitmap *matched)
+{
+    uint64_t mask = (uint64_t)tableSize - 1;
+    for (int64_t b = 0; b <= (int64_t)mask; b++)
+    {
+        heads[b] = -1;
+    }
+    for (int64_t i = buildCount - 1; i >= 0; i--)
+    {
+        next[i] = heads[build[i].hash & mask];
+        heads[build[i].hash & mask] = i;
+    }
+    for (int64_t p = 0; p < probeCount; p++)
+    {
+        const JoinEntry *entry = &probe[p];
+        bool found = false;
+        for (int64_t e = heads[entry->hash & mask]; e >= 0; e = next[e])
+        {
+            if (!sameKey(plan, &build[e], entry))
+            {
+                continue;
+            }
+            found = true;
+            if (plan->buildLeft)
+            {
+                setBit(matched, build[e].slot);
+                if ((plan->type == JOIN_INNER || plan->type == JOIN_LEFT) && !addPair(pairs, build[e].slot, entry->slot))
+                {
+                    return false;
+                }
+            }
+            else if (plan->type == JOIN_SEMI)
+            {
+                break;
+            }
+            else if (plan->type != JOIN_ANTI && !addPair(pairs, entry->slot, build[e].slot))
+            {
+                return false;
+            }
+        }
+        // A left probe slot is listed on its own when a SEMI join matches it or a LEFT or ANTI join does not
+        bool alone = plan->type == JOIN_SEMI ? found : plan->type != JOIN_INNER && !found;
+        if (!plan->buildLeft && alone && !addPair(pairs, entry->slot, -1))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+This function finishes a join built on the left side: the pairs found by probing with
+the right slots are put in left slot order, and the left slots without a match are
+added for a LEFT join or listed on their own for SEMI and ANTI joins.
+It returns false if memory runs out.
+*/
+static bool finishLeftBuild(const JoinPlan *plan, const DataSet *left, const DataSet *right, const Bitmap *matched, bool partitioned, PairList *pairs)
+{
+    if (plan->type == JOIN_INNER || plan->type == JOIN_LEFT)
+    {
+        // Order by right slot, then sort by left slot keeping that order
+        if (partitioned && !sortPairs(pairs, true, right->size))
+        {
+            return false;
+        }
+        if (plan->type == JOIN_LEFT)
+        {
+            int64_t words = bitmapWordCount(left->size);
+            for (int64_t w = 0; w < words; w++)
+            {
+                for (uint64_t bits = left->typeIndex[plan->keyType].words[w] & ~matched->words[w]; bits != 0; bits &= bits - 1)
+                {
+                    if (!addPair(pairs, w * 64 + __builtin_ctzll(bits), -1))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return sortPairs(pairs, false, left->size);
+    }
+    int64_t words = bitmapWordCount(left->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        uint64_t keys = left->typeIndex[plan->keyType].words[w];
+        for (uint64_t bits = plan->type == JOIN_SEMI ? keys & matched->words[w] : keys & ~matched->words[w]; bits != 0; bits &= bits - 1)
+        {
+            if (!addPair(pairs, w * 64 + __builtin_ctzll(bits), -1))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+This function joins the slots of two datasets holding a key of type keyType, INT or
+STRING, on equal keys and returns the result as pairs of slots rather than copies of the
+data points, sorted by left slot and then by right slot. Slots holding no key of the type
+take no part, not even in a LEFT or ANTI join. The hash table is built on whichever
+dataset holds fewer keys. The result is freed with freeJoinResult.
+It returns NULL if a dataset is NULL, the key type is not INT or STRING, the join type is
+invalid or memory runs out.
+*/
+JoinResult *joinDataSets(DataSet *left, DataSet *right, DataType keyType, JoinType type)
+{
+    ScopedStatTimer timer(STAT_TIMER_JOIN);
+    if (left == NULL || right == NULL || (keyType != INT && keyType != STRING) || type < JOIN_INNER || type > JOIN_ANTI)
+    {
+        return NULL;
+    }
+    int64_t leftCount = countByType(left, keyType);
+    int64_t rightCount = countByType(right, keyType);
+    JoinPlan plan;
+    plan.buildLeft = leftCount < rightCount;
+    plan.build = plan.buildLeft ? left : right;
+    plan.probe = plan.buildLeft ? right : left;
+    plan.keyType = keyType;
+    plan.type = type;
+    int64_t buildCount = plan.buildLeft ? leftCount : rightCount;
+    int64_t probeCount = plan.buildLeft ? rightCount : leftCount;
+
+    int bits = 0;
+    while ((buildCount >> bits) > JOIN_PARTITION_SIZE && bits < JOIN_MAX_PARTITION_BITS)
+    {
+        bits++;
+    }
+    int64_t partitions = (int64_t)1 << bits;
+    JoinEntry *build = (JoinEntry *)malloc((buildCount > 0 ? buildCount : 1) * sizeof(JoinEntry));
+    JoinEntry *probe = (JoinEntry *)malloc((probeCount > 0 ? probeCount : 1) * sizeof(JoinEntry));
+    int64_t scratchCount = bits > 0 ? probeCount : 0;
+    JoinEntry *scratch = (JoinEntry *)malloc((scratchCount > 0 ? scratchCount : 1) * sizeof(JoinEntry));
+    int64_t *buildStarts = (int64_t *)malloc((partitions + 1) * sizeof(int64_t));
+    int64_t *probeStarts = (int64_t *)malloc((partitions + 1) * sizeof(int64_t));
+    Bitmap *matched = plan.buildLeft ? createBitmap(left->size) : NULL;
+    JoinResult *result = (JoinResult *)malloc(sizeof(JoinResult));
+    PairList pairs = {NULL, NULL, 0, 0};
+    int64_t *heads = NULL;
+    int64_t *next = NULL;
+    bool ok = build != NULL && probe != NULL && scratch != NULL && buildStarts != NULL && probeStarts != NULL &&
+              (matched != NULL || !plan.buildLeft) && result != NULL;
+    if (ok)
+    {
+        collectEntries(plan.build, keyType, build);
+        collectEntries(plan.probe, keyType, probe);
+        buildStarts[0] = probeStarts[0] = 0;
+        buildStarts[1] = buildCount;
+        probeStarts[1] = probeCount;
+        if (bits > 0)
+        {
+            // The probe side is the larger, so its old entries have room for the build side
+            partitionEntries(probe, probeCount, bits, scratch, probeStarts);
+            std::swap(probe, scratch);
+            partitionEntries(build, buildCount, bits, scratch, buildStarts);
+            std::swap(build, scratch);
+        }
+        // The table of the largest partition has room for the table of every partition
+        int64_t largest = 0;
+        for (int64_t p = 0; p < partitions; p++)
+        {
+            largest = std::max(largest, buildStarts[p + 1] - buildStarts[p]);
+        }
+        int64_t tableSize = 16;
+        while (tableSize < largest * 2)
+        {
+            tableSize *= 2;
+        }
+        heads = (int64_t *)malloc(tableSize * sizeof(int64_t));
+        next = (int64_t *)malloc((largest > 0 ? largest : 1) * sizeof(int64_t));
+        ok = heads != NULL && next != NULL;
+        for (int64_t p = 0; ok && p < partitions; p++)
+        {
+            int64_t count = buildStarts[p + 1] - buildStarts[p];
+            int64_t size = 16;
+            while (size < count * 2)
+            {
+                size *= 2;
+            }
+            ok = joinPartition(&plan, build + buildStarts[p], count, probe + probeStarts[p], probeStarts[p + 1] - probeStarts[p], heads,
+                               next, size, &pairs, matched);
+        }
+    }
+    if (ok)
+    {
+        if (plan.buildLeft)
+        {
+            ok = finishLeftBuild(&plan, left, right, matched, bits > 0, &pairs);
+        }
+        else if (bits > 0)
+        {
+            ok = sortPairs(&pairs, false, left->size);
+        }
+    }
+    free(build);
+    free(probe);
+    free(scratch);
+    free(buildStarts);
+    free(probeStarts);
+    free(heads);
+    free(next);
+    freeBitmap(matched);
+    if (!ok)
+    {
+        free(pairs.left);
+        free(pairs.right);
+        free(result);
+        return NULL;
+    }
+    if (pairs.left == NULL)
+    {
+        // No pair was found; the result still holds arrays the caller can free
+        ok = addPair(&pairs, -1, -1);
+        pairs.count = 0;
+    }
+    if (type == JOIN_SEMI || type == JOIN_ANTI)
+    {
+        free(pairs.right);
+        pairs.right = NULL;
+    }
+    if (!ok)
+    {
+        free(pairs.left);
+        free(pairs.right);
+        free(result);
+        return NULL;
+    }
+    result->count = pairs.count;
+    result->left = pairs.left;
+    result->right = pairs.right;
+    return result;
+}
+
+/*
+This function frees the result of a join and its slot arrays.
+*/
+void freeJoinResult(JoinResult *result)
+{
+    if (result == NULL)
+    {
+        return;
+    }
+    free(result->left);
+    free(result->right);
+    free(result);
+}
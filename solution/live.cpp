@@ -0,0 +1,473 @@
+#include "live.h"
+#include "internal.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <vector>
+
+/*
+Live datasets. A live dataset is read while it is still being written, without readers
+taking a lock. Its slots live in segments of LIVE_SEGMENT_SIZE slots that are allocated once
+and never move, so appending never reallocates what a reader may be reading; a directory of
+the segments is replaced, not grown in place, when it fills up. Each slot holds its type and
+a 64-bit value word, the bits of an INT or FLOAT value or a pointer to an immutable STRING
+record, so a value is read or replaced by one atomic load or exchange.
+
+The writer fills a slot and then publishes it by storing the new size with release order;
+a reader loads the size with acquire order and only reads slots below it. A replaced STRING
+record or directory is retired rather than freed, because a reader may still be reading it.
+Retiring stamps the block with the current epoch and advances the epoch. A reader pins the
+epoch it starts a read section in, and a block is freed once every pinned epoch is newer
+than its stamp, since a reader that pinned a newer epoch started after the block was
+replaced and cannot have seen it.
+
+Writes come from one thread, or from several if the dataset was created with sharedWriters,
+in which case they take turns on a mutex. Readers never wait on the writer or on each other.
+*/
+
+// Retired blocks collected before the writer tries to free them
+#define LIVE_RECLAIM_BATCH 64
+
+// Define a struct for a STRING value of a live dataset, never changed once published
+struct LiveString
+{
+    uint32_t length;
+    char bytes[1]; // length bytes and a NUL
+};
+
+// Define a struct for a segment of the slots of a live dataset
+struct LiveSegment
+{
+    std::atomic<uint8_t> types[LIVE_SEGMENT_SIZE];   // DataType of each published slot
+    std::atomic<uint64_t> values[LIVE_SEGMENT_SIZE]; // INT or FLOAT bits, or a LiveString pointer
+};
+
+// Define a struct for a block waiting until no reader can still see it
+struct RetiredBlock
+{
+    void *block;
+    uint64_t epoch; // epoch the block was retired in
+};
+
+// Define a struct for a reader slot, on its own cache line
+struct alignas(64) LiveReader
+{
+    std::atomic<uint64_t> epoch; // epoch pinned by the read section, 0 outside one
+    std::atomic<bool> attached;
+    LiveDataSet *live;
+};
+
+struct LiveDataSet
+{
+    LiveReader readers[LIVE_MAX_READERS];
+    alignas(64) std::atomic<int64_t> size;     // published slots
+    std::atomic<uint64_t> epoch;               // current epoch, from 1
+    std::atomic<LiveSegment **> directory;     // segments, in slot order
+    int64_t segmentCount;                      // segments allocated, by the writer
+    int64_t directoryCapacity;                 // entries of the directory
+    std::vector<RetiredBlock> retired;         // blocks retired by the writer
+    bool sharedWriters;
+    std::mutex writeMutex;
+};
+
+// Turn the value of a data point into the value word of a slot; it returns false if the data point is invalid or memory runs out
+static bool encodeLiveValue(const DataPoint *point, uint64_t *bits)
+{
+    if (point->value == NULL)
+    {
+        return false;
+    }
+    switch (point->type)
+    {
+    case INT:
+    {
+        uint32_t value;
+        memcpy(&value, point->value, sizeof(value));
+        *bits = value;
+        return true;
+    }
+    case FLOAT:
+    {
+        uint32_t value;
+        memcpy(&value, point->value, sizeof(value));
+        *bits = value;
+        return true;
+    }
+    case STRING:
+    {
+        size_t length = strlen((const char *)point->value);
+        if (length == 0 || length > UINT32_MAX)
+        {
+            return false;
+        }
+        LiveString *string = (LiveString *)malloc(offsetof(LiveString, bytes) + length + 1);
+        if (string == NULL)
+        {
+            return false;
+        }
+        string->length = (uint32_t)length;
+        memcpy(string->bytes, point->value, length + 1);
+        *bits = (uint64_t)(uintptr_t)string;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Free the record behind the value word of a STRING slot
+static void releaseLiveValue(uint8_t type, uint64_t bits)
+{
+    if (type == STRING)
+    {
+        free((void *)(uintptr_t)bits);
+    }
+}
+
+/*
+This function frees the retired blocks that no reader can still see: those retired in an
+epoch older than every epoch pinned by a read section. The pinned epochs are loaded with
+sequentially consistent order, which pairs with the order a reader pins its epoch in.
+*/
+static void reclaimRetired(LiveDataSet *live)
+{
+    uint64_t oldest = UINT64_MAX;
+    for (int r = 0; r < LIVE_MAX_READERS; r++)
+    {
+        uint64_t pinned = live->readers[r].epoch.load(std::memory_order_seq_cst);
+        if (pinned != 0 && pinned < oldest)
+        {
+            oldest = pinned;
+        }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < live->retired.size(); i++)
+    {
+        if (live->retired[i].epoch < oldest)
+        {
+            free(live->retired[i].block);
+        }
+        else
+        {
+            live->retired[kept++] = live->retired[i];
+        }
+    }
+    live->retired.resize(kept);
+}
+
+// Retire a block that has just been replaced, stamping it with the epoch and advancing the epoch
+static void retireBlock(LiveDataSet *live, void *block)
+{
+    uint64_t epoch = live->epoch.fetch_add(1, std::memory_order_seq_cst);
+    live->retired.push_back(RetiredBlock{block, epoch});
+    if (live->retired.size() >= LIVE_RECLAIM_BATCH)
+    {
+        reclaimRetired(live);
+    }
+}
+
+/*
+This function allocates the next segment of a live dataset. A full directory is copied into
+one twice its size, which is published in its place while the old one is retired, so a
+reader holding the old directory still finds every segment it can read.
+It returns false if memory runs out.
+*/
+static bool addLiveSegment(LiveDataSet *live)
+{
+    LiveSegment **directory = live->directory.load(std::memory_order_relaxed);
+    if (live->segmentCount == live->directoryCapacity)
+    {
+        int64_t capacity = live->directoryCapacity * 2;
+        LiveSegment **grown = (LiveSegment **)calloc((size_t)capacity, sizeof(LiveSegment *));
+        if (grown == NULL)
+        {
+            return false;
+        }
+        memcpy(grown, directory, (size_t)live->segmentCount * sizeof(LiveSegment *));
+        live->directory.store(grown, std::memory_order_seq_cst);
+        live->directoryCapacity = capacity;
+        retireBlock(live, directory);
+        directory = grown;
+    }
+    LiveSegment *segment = new (std::nothrow) LiveSegment();
+    if (segment == NULL)
+    {
+        return false;
+    }
+    directory[live->segmentCount++] = segment;
+    return true;
+}
+
+/*
+This function creates an empty live dataset. With sharedWriters set, appends and replacements
+may come from any number of threads at once; otherwise they must all come from one thread
+at a time. Readers may read from any thread either way.
+It returns NULL if memory runs out.
+*/
+LiveDataSet *createLiveDataSet(bool sharedWriters)
+{
+    LiveDataSet *live = new (std::nothrow) LiveDataSet();
+    if (live == NULL)
+    {
+        return NULL;
+    }
+    live->directoryCapacity = 16;
+    LiveSegment **directory = (LiveSegment **)calloc((size_t)live->directoryCapacity, sizeof(LiveSegment *));
+    if (directory == NULL)
+    {
+        delete live;
+        return NULL;
+    }
+    live->directory.store(directory, std::memory_order_relaxed);
+    live->epoch.store(1, std::memory_order_relaxed);
+    live->sharedWriters = sharedWriters;
+    for (int r = 0; r < LIVE_MAX_READERS; r++)
+    {
+        live->readers[r].live = live;
+    }
+    return live;
+}
+
+/*
+This function frees a live dataset with its segments, its STRING records and every block still
+retired. No thread may be writing to it or have a reader attached.
+*/
+void freeLiveDataSet(LiveDataSet *live)
+{
+    if (live == NULL)
+    {
+        return;
+    }
+    LiveSegment **directory = live->directory.load(std::memory_order_relaxed);
+    int64_t size = live->size.load(std::memory_order_relaxed);
+    for (int64_t s = 0; s < live->segmentCount; s++)
+    {
+        LiveSegment *segment = directory[s];
+        for (int64_t i = 0; i < LIVE_SEGMENT_SIZE && s * LIVE_SEGMENT_SIZE + i < size; i++)
+        {
+            releaseLiveValue(segment->types[i].load(std::memory_order_relaxed), segment->values[i].load(std::memory_order_relaxed));
+        }
+        delete segment;
+    }
+    free(directory);
+    for (size_t i = 0; i < live->retired.size(); i++)
+    {
+        free(live->retired[i].block);
+    }
+    delete live;
+}
+
+/*
+This function appends a data point to a live dataset. The value is copied into the next slot,
+a new segment being allocated when the last one is full, and only then is the slot published
+to readers. The same values as for addDataPoint are accepted.
+It returns the index of the new slot, or -1 if an argument is NULL, the data point is
+invalid, or memory runs out.
+*/
+int64_t appendLiveDataPoint(LiveDataSet *live, const DataPoint *point)
+{
+    if (live == NULL || point == NULL)
+    {
+        return -1;
+    }
+    std::unique_lock<std::mutex> lock(live->writeMutex, std::defer_lock);
+    if (live->sharedWriters)
+    {
+        lock.lock();
+    }
+    uint64_t bits;
+    if (!encodeLiveValue(point, &bits))
+    {
+        return -1;
+    }
+    int64_t index = live->size.load(std::memory_order_relaxed);
+    if (index / LIVE_SEGMENT_SIZE == live->segmentCount && !addLiveSegment(live))
+    {
+        releaseLiveValue(point->type, bits);
+        return -1;
+    }
+    LiveSegment *segment = live->directory.load(std::memory_order_relaxed)[index / LIVE_SEGMENT_SIZE];
+    segment->values[index % LIVE_SEGMENT_SIZE].store(bits, std::memory_order_relaxed);
+    segment->types[index % LIVE_SEGMENT_SIZE].store((uint8_t)point->type, std::memory_order_relaxed);
+    live->size.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+/*
+This function replaces the value of a published slot of a live dataset with a value of the same
+type. The new value is swapped in with one atomic exchange, so a reader sees either the old or
+the new value, never a mix; a replaced STRING record is retired until no reader can hold it.
+It returns false if an argument is NULL, the index is not published, the type differs from
+the slot's, the data point is invalid, or memory runs out.
+*/
+bool replaceLiveDataPoint(LiveDataSet *live, int64_t index, const DataPoint *point)
+{
+    if (live == NULL || point == NULL)
+    {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(live->writeMutex, std::defer_lock);
+    if (live->sharedWriters)
+    {
+        lock.lock();
+    }
+    if (index < 0 || index >= live->size.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    LiveSegment *segment = live->directory.load(std::memory_order_relaxed)[index / LIVE_SEGMENT_SIZE];
+    uint8_t type = segment->types[index % LIVE_SEGMENT_SIZE].load(std::memory_order_relaxed);
+    uint64_t bits;
+    if (type != point->type || !encodeLiveValue(point, &bits))
+    {
+        return false;
+    }
+    uint64_t old = segment->values[index % LIVE_SEGMENT_SIZE].exchange(bits, std::memory_order_seq_cst);
+    if (type == STRING)
+    {
+        retireBlock(live, (void *)(uintptr_t)old);
+    }
+    return true;
+}
+
+// Get the number of slots published to readers, 0 for a NULL live dataset
+int64_t getLiveSize(const LiveDataSet *live)
+{
+    return live != NULL ? live->size.load(std::memory_order_acquire) : 0;
+}
+
+/*
+This function attaches a reader to a live dataset by claiming one of its LIVE_MAX_READERS
+reader slots. A reader is used by one thread at a time and may be handed between threads.
+It returns NULL if the live dataset is NULL or every reader slot is taken.
+*/
+LiveReader *attachLiveReader(LiveDataSet *live)
+{
+    if (live == NULL)
+    {
+        return NULL;
+    }
+    for (int r = 0; r < LIVE_MAX_READERS; r++)
+    {
+        bool attached = false;
+        if (live->readers[r].attached.compare_exchange_strong(attached, true, std::memory_order_acquire))
+        {
+            return &live->readers[r];
+        }
+    }
+    return NULL;
+}
+
+// Detach a reader, ending its read section if one is open, and give back its reader slot
+void detachLiveReader(LiveReader *reader)
+{
+    if (reader == NULL)
+    {
+        return;
+    }
+    reader->epoch.store(0, std::memory_order_release);
+    reader->attached.store(false, std::memory_order_release);
+}
+
+/*
+This function starts a read section by pinning the current epoch for the reader. The fence
+after pinning pairs with the writer's sequentially consistent loads of the pinned epochs:
+either the writer sees the epoch and keeps every block retired since, or the reader sees
+every replacement the writer made before looking.
+*/
+void beginLiveRead(LiveReader *reader)
+{
+    if (reader == NULL)
+    {
+        return;
+    }
+    reader->epoch.store(reader->live->epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+// End a read section; the STRING values read in it may be freed from then on
+void endLiveRead(LiveReader *reader)
+{
+    if (reader != NULL)
+    {
+        reader->epoch.store(0, std::memory_order_release);
+    }
+}
+
+/*
+This function reads the value of a published slot of a live dataset into value, by value for
+INT and FLOAT values and as a view of the bytes for a STRING value, which stays valid until
+the read section ends. It returns false if an argument is NULL, the reader is not in a read
+section, or the index is not published.
+*/
+bool readLiveValue(LiveReader *reader, int64_t index, LiveValue *value)
+{
+    if (reader == NULL || value == NULL || reader->epoch.load(std::memory_order_relaxed) == 0)
+    {
+        return false;
+    }
+    LiveDataSet *live = reader->live;
+    if (index < 0 || index >= live->size.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    LiveSegment *segment = live->directory.load(std::memory_order_acquire)[index / LIVE_SEGMENT_SIZE];
+    value->type = (DataType)segment->types[index % LIVE_SEGMENT_SIZE].load(std::memory_order_relaxed);
+    uint64_t bits = segment->values[index % LIVE_SEGMENT_SIZE].load(std::memory_order_acquire);
+    uint32_t word = (uint32_t)bits;
+    switch (value->type)
+    {
+    case INT:
+        memcpy(&value->intValue, &word, sizeof(word));
+        break;
+    case FLOAT:
+        memcpy(&value->floatValue, &word, sizeof(word));
+        break;
+    default:
+    {
+        const LiveString *string = (const LiveString *)(uintptr_t)bits;
+        value->stringValue.data = string->bytes;
+        value->stringValue.length = string->length;
+        break;
+    }
+    }
+    return true;
+}
+
+/*
+This function copies the slots of a live dataset published when it starts into a new dataset,
+so the filters, aggregates and other functions of the library can query a consistent copy
+while appends go on. Slots replaced during the copy give either their old or new value.
+It returns a dataset the caller frees with freeDataSet, or NULL if the reader is NULL, not in
+a read section, or memory runs out.
+*/
+DataSet *snapshotLiveDataSet(LiveReader *reader)
+{
+    if (reader == NULL || reader->epoch.load(std::memory_order_relaxed) == 0)
+    {
+        return NULL;
+    }
+    int64_t size = getLiveSize(reader->live);
+    DataSet *dataset = createDataSetWithCapacity(size);
+    if (dataset == NULL || !resizeDataSet(dataset, size))
+    {
+        freeDataSet(dataset);
+        return NULL;
+    }
+    for (int64_t i = 0; i < size; i++)
+    {
+        LiveValue value;
+        readLiveValue(reader, i, &value);
+        bool stored = value.type == STRING
+                          ? storeStringValue(dataset, i, value.stringValue.data, value.stringValue.length)
+                          : storeValue(dataset, i, value.type, &value.intValue);
+        if (!stored)
+        {
+            freeDataSet(dataset);
+            return NULL;
+        }
+    }
+    return dataset;
+}
@@ -0,0 +1,439 @@
+#include "loader.h"
+#include "internal.h"
+
+#include <immintrin.h>
+
+/*
+Bulk loader. The file is read in chunks of bufferSize bytes and each chunk is split into
+records at the newlines outside quotes; a record cut off by the end of a chunk is moved to
+the front of the buffer and completed by the next read. Fields are located by scanning for
+the delimiter, newline and quote characters, 32 bytes at a time with AVX2, and are parsed
+straight into the column datasets, so no DataPoint is built or copied for a value.
+*/
+
+// Define a struct for the span of one field of a record
+typedef struct
+{
+    const char *begin;
+    const char *end;
+    bool quoted;  // enclosed in quotes
+    bool escaped; // contains doubled quotes
+} Field;
+
+typedef const char *(*FindSpecial)(const char *, const char *, char);
+
+// Define a struct for the state of a load
+typedef struct
+{
+    char delimiter;
+    FindSpecial findSpecial;
+    DataSet **columns;
+    int maxColumns;
+    int columnCount;
+    int64_t rows; // records stored
+    Field *fields;
+    int fieldCapacity;
+    char *scratch; // unescaped text of a quoted field
+    size_t scratchCapacity;
+} Loader;
+
+// Find the first delimiter, newline or quote character in [p, end)
+static const char *findSpecialScalar(const char *p, const char *end, char delimiter)
+{
+    while (p < end && *p != delimiter && *p != '\n' && *p != '"')
+    {
+        p++;
+    }
+    return p;
+}
+
+__attribute__((target("avx2"))) static const char *findSpecialAvx2(const char *p, const char *end, char delimiter)
+{
+    const __m256i delimiters = _mm256_set1_epi8(delimiter);
+    const __m256i newlines = _mm256_set1_epi8('\n');
+    const __m256i quotes = _mm256_set1_epi8('"');
+    while (end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, delimiters), _mm256_cmpeq_epi8(v, newlines)),
+                                          _mm256_cmpeq_epi8(v, quotes));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return findSpecialScalar(p, end, delimiter);
+}
+
+// Append a field to the fields of the current record
+static bool appendField(Loader *loader, int count, const Field *field)
+{
+    if (count == loader->fieldCapacity)
+    {
+        int capacity = loader->fieldCapacity == 0 ? 16 : loader->fieldCapacity * 2;
+        Field *fields = (Field *)realloc(loader->fields, capacity * sizeof(Field));
+        if (fields == NULL)
+        {
+            return false;
+        }
+        loader->fields = fields;
+        loader->fieldCapacity = capacity;
+    }
+    loader->fields[count] = *field;
+    return true;
+}
+
+/*
+This function splits the record starting at p into fields. It returns 1 and sets next to the
+start of the following record if the record ends before end, 0 if more input is needed to tell
+where it ends and -1 if memory runs out. When last is true, end is the end of the file and
+always ends the record.
+*/
+static int splitRecord(Loader *loader, const char *p, const char *end, bool last, const char **next, int *fieldCount)
+{
+    char delimiter = loader->delimiter;
+    int count = 0;
+    for (;;)
+    {
+        Field field = {p, p, false, false};
+        if (p < end && *p == '"')
+        {
+            field.quoted = true;
+            field.begin = p + 1;
+            const char *q = p + 1;
+            for (;;)
+            {
+                const char *quote = (const char *)memchr(q, '"', end - q);
+                if (quote == NULL || (quote + 1 == end && !last))
+                {
+                    // The closing quote, or the character telling whether it is one, is not read yet
+                    if (!last)
+                    {
+                        return 0;
+                    }
+                    quote = end;
+                }
+                if (quote + 1 < end && quote[1] == '"')
+                {
+                    field.escaped = true;
+                    q = quote + 2;
+                    continue;
+                }
+                field.end = quote;
+                p = quote < end ? quote + 1 : end;
+                break;
+            }
+            // Anything between the closing quote and the end of the field is dropped
+            while (p < end && *p != delimiter && *p != '\n')
+            {
+                p++;
+            }
+        }
+        else
+        {
+            // A quote inside an unquoted field is an ordinary character
+            p = loader->findSpecial(p, end, delimiter);
+            while (p < end && *p == '"')
+            {
+                p = loader->findSpecial(p + 1, end, delimiter);
+            }
+            field.end = p;
+        }
+        if (p == end && !last)
+        {
+            return 0;
+        }
+        bool lineEnd = p == end || *p == '\n';
+        if (lineEnd && !field.quoted && field.end > field.begin && field.end[-1] == '\r')
+        {
+            field.end--;
+        }
+        if (!appendField(loader, count, &field))
+        {
+            return -1;
+        }
+        count++;
+        if (lineEnd)
+        {
+            *next = p == end ? end : p + 1;
+            *fieldCount = count;
+            return 1;
+        }
+        p++;
+    }
+}
+
+// Parse a field holding a 32-bit integer
+static bool parseInt(const char *p, const char *end, int32_t *value)
+{
+    bool negative = false;
+    if (*p == '-' || *p == '+')
+    {
+        negative = *p == '-';
+        p++;
+    }
+    if (p == end || end - p > 10)
+    {
+        return false;
+    }
+    int64_t result = 0;
+    for (; p < end; p++)
+    {
+        if (*p < '0' || *p > '9')
+        {
+            return false;
+        }
+        result = result * 10 + (*p - '0');
+    }
+    if (negative)
+    {
+        result = -result;
+    }
+    if (result < INT32_MIN || result > INT32_MAX)
+    {
+        return false;
+    }
+    *value = (int32_t)result;
+    return true;
+}
+
+// Parse a field holding a decimal floating-point number
+static bool parseFloat(const char *p, const char *end, float *value)
+{
+    char text[64];
+    size_t length = end - p;
+    if (length >= sizeof(text))
+    {
+        return false;
+    }
+    // Only digits, signs, points and exponents, so words like "nan" and hex stay strings
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = p[i];
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'))
+        {
+            return false;
+        }
+        text[i] = c;
+    }
+    text[length] = '\0';
+    char *stop;
+    *value = strtof(text, &stop);
+    return stop == text + length;
+}
+
+/*
+This function stores one field into slot row of a column. An unquoted field becomes an INT if
+it is a 32-bit integer, a FLOAT if it is a decimal number and a STRING otherwise; a quoted
+field is always a STRING. An empty field leaves the slot empty.
+*/
+static bool storeField(Loader *loader, DataSet *column, int64_t row, const Field *field)
+{
+    const char *begin = field->begin;
+    size_t length = field->end - begin;
+    if (length == 0)
+    {
+        return true;
+    }
+    if (!field->quoted)
+    {
+        int32_t intValue;
+        if (parseInt(begin, field->end, &intValue))
+        {
+            return storeValue(column, row, INT, &intValue);
+        }
+        float floatValue;
+        if (parseFloat(begin, field->end, &floatValue))
+        {
+            return storeValue(column, row, FLOAT, &floatValue);
+        }
+        return storeStringValue(column, row, begin, length);
+    }
+    if (!field->escaped)
+    {
+        return storeStringValue(column, row, begin, length);
+    }
+
+    // Unescape the doubled quotes
+    if (length > loader->scratchCapacity)
+    {
+        char *scratch = (char *)realloc(loader->scratch, length);
+        if (scratch == NULL)
+        {
+            return false;
+        }
+        loader->scratch = scratch;
+        loader->scratchCapacity = length;
+    }
+    size_t unescaped = 0;
+    for (const char *p = begin; p < field->end; p++)
+    {
+        loader->scratch[unescaped++] = *p;
+        if (*p == '"' && p + 1 < field->end && p[1] == '"')
+        {
+            p++;
+        }
+    }
+    return storeStringValue(column, row, loader->scratch, unescaped);
+}
+
+/*
+This function stores the fields of a record into a new row of the columns, creating a
+column the first time a record has that many fields. Every column grows by one slot, which
+reallocates only when its capacity runs out. It returns false if the record has more than
+maxColumns fields or memory runs out.
+*/
+static bool storeRecord(Loader *loader, int fieldCount)
+{
+    if (fieldCount > loader->maxColumns)
+    {
+        return false;
+    }
+    for (int c = loader->columnCount; c < fieldCount; c++)
+    {
+        loader->columns[c] = createDataSetWithCapacity(loader->rows + 1);
+        if (loader->columns[c] == NULL)
+        {
+            return false;
+        }
+        loader->columnCount++;
+    }
+    for (int c = 0; c < loader->columnCount; c++)
+    {
+        if (!resizeDataSet(loader->columns[c], loader->rows + 1))
+        {
+            return false;
+        }
+    }
+    for (int c = 0; c < fieldCount; c++)
+    {
+        if (!storeField(loader, loader->columns[c], loader->rows, &loader->fields[c]))
+        {
+            return false;
+        }
+    }
+    loader->rows++;
+    return true;
+}
+
+/*
+This function loads a delimited text file, such as a CSV file or a file with one value per
+line, into one dataset per column. Slot i of columns[c] holds field c of record i; a record
+with fewer fields leaves the remaining slots empty, and blank lines are skipped. Fields may be
+quoted to hold delimiters, newlines and doubled quotes, and a carriage return ending a line is
+dropped. Passing NULL options loads a comma-separated file without a header.
+It returns the number of columns, 0 for a file without records, or -1 if the file cannot be
+read, a record has more than maxColumns fields or memory runs out, in which case no dataset
+is returned.
+*/
+int loadDelimitedFile(const char *path, const LoaderOptions *options, DataSet **columns, int maxColumns)
+{
+    if (path == NULL || columns == NULL || maxColumns <= 0)
+    {
+        return -1;
+    }
+    LoaderOptions defaults = {',', false, 0};
+    if (options == NULL)
+    {
+        options = &defaults;
+    }
+    for (int c = 0; c < maxColumns; c++)
+    {
+        columns[c] = NULL;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    size_t bufferSize = options->bufferSize > 0 ? options->bufferSize : LOADER_BUFFER_SIZE;
+    char *buffer = (char *)malloc(bufferSize);
+
+    Loader loader = {};
+    // One value per line is a file whose delimiter is the newline
+    loader.delimiter = options->delimiter != '\0' ? options->delimiter : '\n';
+    loader.findSpecial = getFilterKernel() != KERNEL_SCALAR ? findSpecialAvx2 : findSpecialScalar;
+    loader.columns = columns;
+    loader.maxColumns = maxColumns;
+
+    bool ok = buffer != NULL;
+    bool skipHeader = options->header;
+    bool last = false;
+    size_t length = 0;
+    while (ok && !last)
+    {
+        if (length == bufferSize)
+        {
+            // A record longer than the buffer
+            char *grown = (char *)realloc(buffer, bufferSize * 2);
+            if (grown == NULL)
+            {
+                ok = false;
+                break;
+            }
+            buffer = grown;
+            bufferSize *= 2;
+        }
+        size_t read = fread(buffer + length, 1, bufferSize - length, file);
+        if (read < bufferSize - length)
+        {
+            if (ferror(file))
+            {
+                ok = false;
+                break;
+            }
+            last = true;
+        }
+        length += read;
+
+        const char *p = buffer;
+        const char *end = buffer + length;
+        while (p < end)
+        {
+            const char *next;
+            int fieldCount;
+            int status = splitRecord(&loader, p, end, last, &next, &fieldCount);
+            if (status <= 0)
+            {
+                ok = status == 0;
+                break;
+            }
+            bool blank = fieldCount == 1 && !loader.fields[0].quoted && loader.fields[0].begin == loader.fields[0].end;
+            if (skipHeader)
+            {
+                skipHeader = false;
+            }
+            else if (!blank && !storeRecord(&loader, fieldCount))
+            {
+                ok = false;
+                break;
+            }
+            p = next;
+        }
+        length = end - p;
+        memmove(buffer, p, length);
+    }
+    fclose(file);
+    free(buffer);
+    free(loader.fields);
+    free(loader.scratch);
+
+    // Give back the room past the last record
+    for (int c = 0; c < loader.columnCount && ok; c++)
+    {
+        ok = shrinkDataSet(columns[c]);
+    }
+    if (!ok)
+    {
+        for (int c = 0; c < loader.columnCount; c++)
+        {
+            freeDataSet(columns[c]);
+            columns[c] = NULL;
+        }
+        return -1;
+    }
+    return loader.columnCount;
+}
@@ -0,0 +1,541 @@
+#include "parallel.h"
+#include "internal.h"
+#include "zonemap.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Morsel-driven execution. A job splits a dataset into morsels of MORSEL_SIZE data points,
+which is a whole number of bitmap words, so two threads never write the same word of a
+result bitmap. The morsels are dealt out to the threads in contiguous ranges; a thread
+takes morsels from the front of its own range and, once that is empty, steals from the
+front of the other ranges. Results that need merging are kept per morsel and merged in
+morsel order, so a parallel run gives the same answer as a serial one.
+The calling thread works on the job too, and the pool threads sleep between jobs.
+*/
+
+#define MORSEL_WORDS (MORSEL_SIZE / 64)
+
+// Range of morsels dealt to one thread, on its own cache line
+struct alignas(64) MorselRange
+{
+    std::atomic<int64_t> next;
+    int64_t end;
+};
+
+struct Job
+{
+    const std::function<void(int64_t)> *work;
+    MorselRange *ranges;
+    int workers;
+};
+
+static std::mutex jobMutex; // one job at a time
+static std::mutex poolMutex;
+static std::condition_variable poolWake;
+static std::condition_variable poolDone;
+static std::vector<std::thread> poolThreads;
+static Job currentJob;
+static uint64_t jobGeneration = 0;
+static int jobPending = 0;
+static bool poolStopping = false;
+static int threadCount = 0;
+
+// Run morsels of the current job, starting with the range of worker and then stealing
+static void runJob(const Job &job, int worker)
+{
+    for (int k = 0; k < job.workers; k++)
+    {
+        MorselRange &range = job.ranges[(worker + k) % job.workers];
+        for (int64_t morsel = range.next.fetch_add(1); morsel < range.end; morsel = range.next.fetch_add(1))
+        {
+            (*job.work)(morsel);
+        }
+    }
+}
+
+static void poolLoop(int worker, uint64_t seen)
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            poolWake.wait(lock, [&] { return poolStopping || jobGeneration != seen; });
+            if (poolStopping)
+            {
+                return;
+            }
+            seen = jobGeneration;
+            job = currentJob;
+        }
+        if (worker < job.workers)
+        {
+            runJob(job, worker);
+        }
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (--jobPending == 0)
+        {
+            poolDone.notify_one();
+        }
+    }
+}
+
+static void stopPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        poolStopping = true;
+    }
+    poolWake.notify_all();
+    for (std::thread &thread : poolThreads)
+    {
+        thread.join();
+    }
+    poolThreads.clear();
+    poolStopping = false;
+}
+
+// Joins the pool threads when the program exits
+static struct PoolShutdown
+{
+    ~PoolShutdown()
+    {
+        stopPool();
+    }
+} poolShutdown;
+
+/*
+This function sets the number of threads used by the parallel functions, counting the
+calling thread. 0, the default, uses one thread per hardware thread. The pool threads
+are started by the next parallel call.
+*/
+void setThreadCount(int threads)
+{
+    std::lock_guard<std::mutex> job(jobMutex);
+    stopPool();
+    threadCount = threads < 0 ? 0 : threads;
+}
+
+/*
+This function returns the number of threads used by the parallel functions.
+*/
+int getThreadCount(void)
+{
+    if (threadCount > 0)
+    {
+        return threadCount;
+    }
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? (int)hardware : 1;
+}
+
+// Run work once for every morsel in [0, morsels) on the pool
+static void runMorsels(int64_t morsels, const std::function<void(int64_t)> &work)
+{
+    int threads = getThreadCount();
+    int workers = morsels < threads ? (int)morsels : threads;
+    if (workers <= 1)
+    {
+        for (int64_t morsel = 0; morsel < morsels; morsel++)
+        {
+            work(morsel);
+        }
+        return;
+    }
+    // Choose the filter kernel before the threads read it
+    getFilterKernel();
+    std::lock_guard<std::mutex> job(jobMutex);
+    while ((int)poolThreads.size() < threads - 1)
+    {
+        // A new thread waits for the next job, not the one that ran last
+        std::lock_guard<std::mutex> lock(poolMutex);
+        poolThreads.emplace_back(poolLoop, (int)poolThreads.size() + 1, jobGeneration);
+    }
+    std::vector<MorselRange> ranges(workers);
+    for (int k = 0; k < workers; k++)
+    {
+        ranges[k].next.store(morsels * k / workers);
+        ranges[k].end = morsels * (k + 1) / workers;
+    }
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        currentJob.work = &work;
+        currentJob.ranges = ranges.data();
+        currentJob.workers = workers;
+        jobPending = (int)poolThreads.size();
+        jobGeneration++;
+    }
+    poolWake.notify_all();
+    runJob(currentJob, 0);
+    std::unique_lock<std::mutex> lock(poolMutex);
+    poolDone.wait(lock, [] { return jobPending == 0; });
+}
+
+// Number of morsels covering a dataset and the words of one morsel
+static int64_t morselCount(const DataSet *dataset)
+{
+    return (dataset->size + MORSEL_SIZE - 1) / MORSEL_SIZE;
+}
+
+static void morselWords(const DataSet *dataset, int64_t morsel, int64_t *wordBegin, int64_t *wordEnd)
+{
+    int64_t words = bitmapWordCount(dataset->size);
+    *wordBegin = morsel * MORSEL_WORDS;
+    *wordEnd = *wordBegin + MORSEL_WORDS < words ? *wordBegin + MORSEL_WORDS : words;
+}
+
+/*
+This function works like filterByType, splitting the copy across the threads by morsel.
+Each morsel copies its values and sets its words of the result bitmaps directly. STRING
+values are copied in two passes: the first sums the bytes of each morsel, so the second
+can copy every morsel to its own part of a string arena allocated once. The result is
+never dictionary-encoded.
+It returns NULL if the dataset is NULL, the type is invalid or memory runs out.
+*/
+DataSet *parallelFilterByType(DataSet *dataset, DataType type)
+{
+    ScopedStatTimer timer(STAT_TIMER_FILTER_BY_TYPE);
+    if (dataset == NULL || (type != INT && type != FLOAT && type != STRING))
+    {
+        return NULL;
+    }
+    countScan(dataset, dataset->size, 0);
+    DataSet *filteredData = createDataSetWithCapacity(dataset->size);
+    if (filteredData == NULL)
+    {
+        return NULL;
+    }
+    if (!resizeDataSet(filteredData, dataset->size) || !ensureColumn(filteredData, type))
+    {
+        freeDataSet(filteredData);
+        return NULL;
+    }
+    int64_t morsels = morselCount(dataset);
+    const uint64_t *index = dataset->typeIndex[type].words;
+
+    // Size the string arena and find where each morsel starts in it
+    std::vector<uint64_t> base;
+    if (type == STRING)
+    {
+        base.assign(morsels + 1, 0);
+        runMorsels(morsels, [&](int64_t morsel) {
+            int64_t wordBegin, wordEnd;
+            morselWords(dataset, morsel, &wordBegin, &wordEnd);
+            uint64_t bytes = 0;
+            for (int64_t w = wordBegin; w < wordEnd; w++)
+            {
+                for (uint64_t bits = index[w]; bits != 0; bits &= bits - 1)
+                {
+                    size_t length;
+                    stringAt(dataset, w * 64 + __builtin_ctzll(bits), &length);
+                    bytes += length + 1;
+                }
+            }
+            base[morsel + 1] = bytes;
+        });
+        for (int64_t morsel = 0; morsel < morsels; morsel++)
+        {
+            base[morsel + 1] += base[morsel];
+        }
+        StringArena *arena = &filteredData->strings;
+        arena->capacity = base[morsels] > 0 ? base[morsels] : 1;
+        arena->bytes = (char *)allocateBlock(filteredData->allocator, arena->capacity);
+        if (arena->bytes == NULL)
+        {
+            freeDataSet(filteredData);
+            return NULL;
+        }
+        arena->length = base[morsels];
+    }
+
+    runMorsels(morsels, [&](int64_t morsel) {
+        int64_t wordBegin, wordEnd;
+        morselWords(dataset, morsel, &wordBegin, &wordEnd);
+        uint64_t offset = type == STRING ? base[morsel] : 0;
+        // The INT values of a sealed dataset are decoded a block at a time
+        int32_t values[INT_BLOCK_SIZE];
+        int64_t decoded = -1;
+        for (int64_t w = wordBegin; w < wordEnd; w++)
+        {
+            if (type == INT && dataset->encodedInts != NULL && index[w] != 0 && w * 64 / INT_BLOCK_SIZE != decoded)
+            {
+                decoded = w * 64 / INT_BLOCK_SIZE;
+                decodeIntBlock(dataset->encodedInts, decoded, blockLength(dataset->size, decoded), values);
+            }
+            filteredData->present.words[w] = index[w];
+            filteredData->typeIndex[type].words[w] = index[w];
+            for (uint64_t bits = index[w]; bits != 0; bits &= bits - 1)
+            {
+                int64_t i = w * 64 + __builtin_ctzll(bits);
+                filteredData->types[i] = (uint8_t)type;
+                if (type == INT)
+                {
+                    filteredData->ints[i] = decoded >= 0 ? values[i % INT_BLOCK_SIZE] : dataset->ints[i];
+                }
+                else if (type == FLOAT)
+                {
+                    filteredData->floats[i] = dataset->floats[i];
+                }
+                else
+                {
+                    size_t length;
+                    const char *value = stringAt(dataset, i, &length);
+                    memcpy(filteredData->strings.bytes + offset, value, length + 1);
+                    filteredData->strings.offsets[i] = offset;
+                    filteredData->strings.lengths[i] = (uint32_t)length;
+                    offset += length + 1;
+                }
+            }
+        }
+    });
+    // The values were written past storeValue, so the zone maps are built in one pass
+    rebuildZoneMaps(filteredData);
+    return filteredData;
+}
+
+/*
+This function works like filterIntValues, running the filter kernel on each morsel
+from whichever thread takes it.
+*/
+Bitmap *parallelFilterIntValues(DataSet *dataset, CompareOp op, const int32_t *operands, int operandCount)
+{
+    ScopedStatTimer timer(STAT_TIMER_FILTER_VALUES);
+    if (dataset == NULL || !validOperands(op, operands, operandCount))
+    {
+        return NULL;
+    }
+    Bitmap *selection = createBitmap(dataset->size);
+    if (selection == NULL)
+    {
+        return NULL;
+    }
+    runMorsels(morselCount(dataset), [&](int64_t morsel) {
+        int64_t wordBegin, wordEnd;
+        morselWords(dataset, morsel, &wordBegin, &wordEnd);
+        filterIntRange(dataset, op, operands, operandCount, selection->words + wordBegin, wordBegin, wordEnd);
+    });
+    return selection;
+}
+
+/*
+This function works like filterFloatValues, running the filter kernel on each morsel
+from whichever thread takes it.
+*/
+Bitmap *parallelFilterFloatValues(DataSet *dataset, CompareOp op, const float *operands, int operandCount)
+{
+    ScopedStatTimer timer(STAT_TIMER_FILTER_VALUES);
+    if (dataset == NULL || !validOperands(op, operands, operandCount))
+    {
+        return NULL;
+    }
+    Bitmap *selection = createBitmap(dataset->size);
+    if (selection == NULL)
+    {
+        return NULL;
+    }
+    runMorsels(morselCount(dataset), [&](int64_t morsel) {
+        int64_t wordBegin, wordEnd;
+        morselWords(dataset, morsel, &wordBegin, &wordEnd);
+        filterFloatRange(dataset, op, operands, operandCount, selection->words + wordBegin, wordBegin, wordEnd);
+    });
+    return selection;
+}
+
+/*
+This function works like aggregateValues. Each morsel is aggregated into its own partial
+result and the partials are merged in morsel order once every thread is done.
+*/
+bool parallelAggregateValues(DataSet *dataset, DataType type, const Bitmap *selection, AggregateResult *result)
+{
+    ScopedStatTimer timer(STAT_TIMER_AGGREGATE);
+    if (!validAggregate(dataset, type, selection) || result == NULL)
+    {
+        return false;
+    }
+    int64_t morsels = morselCount(dataset);
+    std::vector<Partial> partials(morsels);
+    runMorsels(morsels, [&](int64_t morsel) {
+        int64_t wordBegin, wordEnd;
+        morselWords(dataset, morsel, &wordBegin, &wordEnd);
+        initPartial(&partials[morsel]);
+        aggregateRange(dataset, type, selection, wordBegin, wordEnd, &partials[morsel]);
+    });
+    Partial total;
+    initPartial(&total);
+    for (const Partial &partial : partials)
+    {
+        mergePartial(&total, &partial);
+    }
+    finishAggregate(&total, type, result);
+    return true;
+}
+
+// Piece of the merge of two adjacent sorted runs of entries, written by one thread
+struct MergePiece
+{
+    int64_t left;   // first entry of the left run
+    int64_t middle; // first entry of the right run
+    int64_t right;  // end of the right run
+    int64_t begin;  // first entry of the merge the piece writes
+    int64_t end;    // end of the entries the piece writes
+};
+
+/*
+This function works like sortValues. Each morsel collects the entries of its slots to
+its own part of one array, then each thread sorts a run of consecutive morsels. Adjacent
+runs are merged in pairs until one is left; every merge is cut into pieces of MORSEL_SIZE
+entries, each found by a binary search on the two runs, so the threads share the last
+merges too. Runs hold consecutive slots, so equal values keep slot order as in a serial
+sort. A dataset of one morsel is sorted on the calling thread.
+*/
+int64_t *parallelSortValues(DataSet *dataset, DataType type, const Bitmap *selection, SortOrder order, int64_t *count)
+{
+    ScopedStatTimer timer(STAT_TIMER_SORT);
+    if (!validSort(dataset, type, selection, order) || count == NULL)
+    {
+        return NULL;
+    }
+    int64_t morsels = morselCount(dataset);
+    int threads = getThreadCount();
+    if (morsels <= 1 || threads <= 1)
+    {
+        return sortValues(dataset, type, selection, order, count);
+    }
+    SortKeys keys;
+    if (!prepareSortKeys(&keys, dataset, type, order))
+    {
+        return NULL;
+    }
+    std::vector<int64_t> offsets(morsels + 1, 0);
+    runMorsels(morsels, [&](int64_t morsel) {
+        int64_t wordBegin, wordEnd;
+        morselWords(dataset, morsel, &wordBegin, &wordEnd);
+        offsets[morsel + 1] = countSortSlots(&keys, selection, wordBegin, wordEnd);
+    });
+    for (int64_t morsel = 0; morsel < morsels; morsel++)
+    {
+        offsets[morsel + 1] += offsets[morsel];
+    }
+    int64_t total = offsets[morsels];
+    size_t length = total > 0 ? (size_t)total : 1;
+    SortEntry *entries = (SortEntry *)malloc(length * sizeof(SortEntry));
+    SortEntry *buffer = (SortEntry *)malloc(length * sizeof(SortEntry));
+    int64_t *slots = (int64_t *)malloc(length * sizeof(int64_t));
+    if (entries == NULL || buffer == NULL || slots == NULL)
+    {
+        free(entries);
+        free(buffer);
+        free(slots);
+        releaseSortKeys(&keys);
+        return NULL;
+    }
+    runMorsels(morsels, [&](int64_t morsel) {
+        int64_t wordBegin, wordEnd;
+        morselWords(dataset, morsel, &wordBegin, &wordEnd);
+        collectSortEntries(&keys, selection, wordBegin, wordEnd, entries + offsets[morsel]);
+    });
+
+    // Sort one run of consecutive morsels per thread
+    int64_t runs = morsels < threads ? morsels : threads;
+    std::vector<int64_t> bounds(runs + 1);
+    for (int64_t r = 0; r <= runs; r++)
+    {
+        bounds[r] = offsets[morsels * r / runs];
+    }
+    runMorsels(runs, [&](int64_t r) {
+        sortEntries(&keys, entries + bounds[r], buffer + bounds[r], bounds[r + 1] - bounds[r]);
+    });
+
+    // Merge adjacent runs in pairs, a lone last run being copied as it is
+    while (bounds.size() > 2)
+    {
+        std::vector<MergePiece> pieces;
+        std::vector<int64_t> merged;
+        for (size_t r = 0; r + 1 < bounds.size(); r += 2)
+        {
+            int64_t right = r + 2 < bounds.size() ? bounds[r + 2] : bounds[r + 1];
+            for (int64_t begin = bounds[r]; begin < right; begin += MORSEL_SIZE)
+            {
+                pieces.push_back({bounds[r], bounds[r + 1], right, begin, begin + MORSEL_SIZE < right ? begin + MORSEL_SIZE : right});
+            }
+            merged.push_back(bounds[r]);
+        }
+        merged.push_back(total);
+        runMorsels((int64_t)pieces.size(), [&](int64_t p) {
+            const MergePiece &piece = pieces[p];
+            mergeEntries(&keys, entries + piece.left, piece.middle - piece.left, entries + piece.middle, piece.right - piece.middle,
+                         buffer + piece.left, piece.begin - piece.left, piece.end - piece.left);
+        });
+        std::swap(entries, buffer);
+        bounds.swap(merged);
+    }
+
+    runMorsels((total + MORSEL_SIZE - 1) / MORSEL_SIZE, [&](int64_t morsel) {
+        int64_t end = (morsel + 1) * MORSEL_SIZE < total ? (morsel + 1) * MORSEL_SIZE : total;
+        for (int64_t i = morsel * MORSEL_SIZE; i < end; i++)
+        {
+            slots[i] = entries[i].slot;
+        }
+    });
+    free(entries);
+    free(buffer);
+    releaseSortKeys(&keys);
+    *count = total;
+    return slots;
+}
+
+/*
+This function works like groupByValues. Each thread groups a run of consecutive morsels
+into its own group table, so the threads never share a table, and the tables are then
+merged into the first in run order. The runs hold consecutive slots, so the groups come
+out in the order of their first data point as in a serial group-by; FLOAT sums are added
+in another order and may differ in the last bits.
+*/
+GroupByResult *parallelGroupByValues(DataSet *keys, DataType keyType, DataSet *values, DataType valueType, const Bitmap *selection)
+{
+    ScopedStatTimer timer(STAT_TIMER_GROUP_BY);
+    if (!validGroupBy(keys, keyType, values, valueType, selection))
+    {
+        return NULL;
+    }
+    int64_t morsels = morselCount(keys);
+    int threads = getThreadCount();
+    int64_t runs = morsels < threads ? morsels : threads;
+    if (runs <= 1)
+    {
+        return groupByValues(keys, keyType, values, valueType, selection);
+    }
+    std::vector<GroupTable> tables(runs);
+    int64_t ready = 0;
+    while (ready < runs && initGroupTable(&tables[ready], keys, keyType, values, valueType))
+    {
+        ready++;
+    }
+    std::vector<uint8_t> grouped(runs, 0);
+    if (ready == runs)
+    {
+        int64_t words = bitmapWordCount(keys->size);
+        runMorsels(runs, [&](int64_t r) {
+            int64_t wordBegin = morsels * r / runs * MORSEL_WORDS;
+            int64_t wordEnd = morsels * (r + 1) / runs * MORSEL_WORDS;
+            grouped[r] = groupRange(&tables[r], selection, wordBegin, wordEnd < words ? wordEnd : words);
+        });
+    }
+    bool ok = ready == runs;
+    for (int64_t r = 0; ok && r < runs; r++)
+    {
+        ok = grouped[r] && (r == 0 || mergeGroupTable(&tables[0], &tables[r]));
+    }
+    GroupByResult *result = ok ? finishGroupBy(&tables[0]) : NULL;
+    for (int64_t r = 0; r < ready; r++)
+    {
+        releaseGroupTable(&tables[r]);
+    }
+    return result;
+}
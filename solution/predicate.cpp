@@ -0,0 +1,408 @@
+#include "predicate.h"
+#include "internal.h"
+
+/*
+Predicate trees. A tree is evaluated over the dataset one chunk of PREDICATE_CHUNK_WORDS
+words at a time: each leaf writes the bits of the chunk into a small buffer and AND, OR and
+NOT nodes combine the buffers of their children a word at a time, so the values of a chunk
+are still in cache for every leaf that reads them and a whole tree makes one pass over the
+dataset with no intermediate bitmap or dataset. An AND whose first child selects nothing in
+a chunk skips its second child there, and an OR whose first child selects every value skips
+its second. Comparisons skip the zones their zone maps rule out, and string equality the
+zones whose bloom filter lacks the string. On a dictionary-encoded dataset the strings of a
+STRING test are matched once per distinct string before the pass, leaving a table lookup
+per slot.
+*/
+
+#define PREDICATE_CHUNK_WORDS 64
+
+// Define a struct for the state of one evaluation of a predicate tree
+typedef struct
+{
+    const DataSet *dataset;
+    uint8_t **codeMatches; // per STRING leaf in tree order, whether each dictionary code matches
+    int leaf;              // STRING leaves visited in the current chunk
+} Evaluation;
+
+// Allocate a predicate node of a kind
+static Predicate *createPredicate(PredicateKind kind)
+{
+    Predicate *predicate = (Predicate *)calloc(1, sizeof(Predicate));
+    if (predicate != NULL)
+    {
+        predicate->kind = kind;
+    }
+    return predicate;
+}
+
+/*
+This function creates a predicate selecting the slots that hold a value of a type.
+It returns NULL if the type is invalid or memory runs out.
+*/
+Predicate *typePredicate(DataType type)
+{
+    if (type != INT && type != FLOAT && type != STRING)
+    {
+        return NULL;
+    }
+    Predicate *predicate = createPredicate(PREDICATE_TYPE);
+    if (predicate != NULL)
+    {
+        predicate->type = type;
+    }
+    return predicate;
+}
+
+/*
+This function creates a predicate selecting the INT values that satisfy a comparison, as
+filterIntValues does. The operands are copied.
+It returns NULL if the operands do not suit the comparison or memory runs out.
+*/
+Predicate *intPredicate(CompareOp op, const int32_t *operands, int operandCount)
+{
+    if (!validOperands(op, operands, operandCount))
+    {
+        return NULL;
+    }
+    Predicate *predicate = createPredicate(PREDICATE_INT);
+    if (predicate == NULL)
+    {
+        return NULL;
+    }
+    predicate->intOperands = (int32_t *)malloc(operandCount * sizeof(int32_t));
+    if (predicate->intOperands == NULL)
+    {
+        free(predicate);
+        return NULL;
+    }
+    memcpy(predicate->intOperands, operands, operandCount * sizeof(int32_t));
+    predicate->op = op;
+    predicate->operandCount = operandCount;
+    return predicate;
+}
+
+/*
+This function creates a predicate selecting the FLOAT values that satisfy a comparison, as
+filterFloatValues does. The operands are copied.
+It returns NULL if the operands do not suit the comparison or memory runs out.
+*/
+Predicate *floatPredicate(CompareOp op, const float *operands, int operandCount)
+{
+    if (!validOperands(op, operands, operandCount))
+    {
+        return NULL;
+    }
+    Predicate *predicate = createPredicate(PREDICATE_FLOAT);
+    if (predicate == NULL)
+    {
+        return NULL;
+    }
+    predicate->floatOperands = (float *)malloc(operandCount * sizeof(float));
+    if (predicate->floatOperands == NULL)
+    {
+        free(predicate);
+        return NULL;
+    }
+    memcpy(predicate->floatOperands, operands, operandCount * sizeof(float));
+    predicate->op = op;
+    predicate->operandCount = operandCount;
+    return predicate;
+}
+
+// Create a STRING test, copying its string
+static Predicate *stringPredicate(PredicateKind kind, const char *value)
+{
+    if (value == NULL)
+    {
+        return NULL;
+    }
+    Predicate *predicate = createPredicate(kind);
+    if (predicate == NULL)
+    {
+        return NULL;
+    }
+    predicate->length = strlen(value);
+    predicate->text = (char *)malloc(predicate->length + 1);
+    if (predicate->text == NULL)
+    {
+        free(predicate);
+        return NULL;
+    }
+    memcpy(predicate->text, value, predicate->length + 1);
+    predicate->hash = hashString(value, predicate->length);
+    return predicate;
+}
+
+/*
+This function creates a predicate selecting the STRING values equal to a string.
+It returns NULL if the string is NULL or memory runs out.
+*/
+Predicate *stringEqualsPredicate(const char *value)
+{
+    return stringPredicate(PREDICATE_STRING_EQUALS, value);
+}
+
+/*
+This function creates a predicate selecting the STRING values that start with a prefix;
+an empty prefix selects every STRING value.
+It returns NULL if the prefix is NULL or memory runs out.
+*/
+Predicate *stringPrefixPredicate(const char *prefix)
+{
+    return stringPredicate(PREDICATE_STRING_PREFIX, prefix);
+}
+
+// Create an AND, OR or NOT node over its children, freeing them if it cannot be created
+static Predicate *combinePredicates(PredicateKind kind, Predicate *left, Predicate *right)
+{
+    Predicate *predicate = NULL;
+    if (left != NULL && (right != NULL || kind == PREDICATE_NOT))
+    {
+        predicate = createPredicate(kind);
+    }
+    if (predicate == NULL)
+    {
+        freePredicate(left);
+        freePredicate(right);
+        return NULL;
+    }
+    predicate->left = left;
+    predicate->right = right;
+    return predicate;
+}
+
+/*
+These functions combine predicates into a new node that owns them: AND selects the data
+points both select, OR those either selects and NOT the data points its child does not
+select; empty slots are never selected. A NULL child, such as a failed constructor nested
+in the call, frees the other child and gives NULL, so a whole tree can be built in one
+expression and checked once.
+They return NULL if a child is NULL or memory runs out.
+*/
+Predicate *andPredicate(Predicate *left, Predicate *right)
+{
+    return combinePredicates(PREDICATE_AND, left, right);
+}
+
+Predicate *orPredicate(Predicate *left, Predicate *right)
+{
+    return combinePredicates(PREDICATE_OR, left, right);
+}
+
+Predicate *notPredicate(Predicate *child)
+{
+    return combinePredicates(PREDICATE_NOT, child, NULL);
+}
+
+/*
+This function frees a predicate tree, its children and their operands.
+*/
+void freePredicate(Predicate *predicate)
+{
+    if (predicate == NULL)
+    {
+        return;
+    }
+    freePredicate(predicate->left);
+    freePredicate(predicate->right);
+    free(predicate->intOperands);
+    free(predicate->floatOperands);
+    free(predicate->text);
+    free(predicate);
+}
+
+// Check whether a string satisfies a STRING test
+static inline bool matchString(const Predicate *predicate, const char *value, size_t length)
+{
+    if (predicate->kind == PREDICATE_STRING_EQUALS)
+    {
+        return length == predicate->length && memcmp(value, predicate->text, length) == 0;
+    }
+    return length >= predicate->length && memcmp(value, predicate->text, predicate->length) == 0;
+}
+
+// Count the STRING leaves of a tree
+static int countStringLeaves(const Predicate *predicate)
+{
+    if (predicate == NULL)
+    {
+        return 0;
+    }
+    bool leaf = predicate->kind == PREDICATE_STRING_EQUALS || predicate->kind == PREDICATE_STRING_PREFIX;
+    return leaf + countStringLeaves(predicate->left) + countStringLeaves(predicate->right);
+}
+
+/*
+This function matches the strings of the STRING leaves of a tree, in tree order, against
+every distinct string of a dictionary. It returns false if memory runs out.
+*/
+static bool matchDictionary(const DataSet *dataset, const Predicate *predicate, uint8_t **codeMatches, int *leaf)
+{
+    if (predicate == NULL)
+    {
+        return true;
+    }
+    if (predicate->kind == PREDICATE_STRING_EQUALS || predicate->kind == PREDICATE_STRING_PREFIX)
+    {
+        const StringDictionary *dictionary = dataset->dictionary;
+        uint8_t *matches = (uint8_t *)malloc(dictionary->count > 0 ? dictionary->count : 1);
+        if (matches == NULL)
+        {
+            return false;
+        }
+        for (int code = 0; code < dictionary->count; code++)
+        {
+            matches[code] = matchString(predicate, dataset->strings.bytes + dictionary->offsets[code], dictionary->lengths[code]);
+        }
+        codeMatches[(*leaf)++] = matches;
+        return true;
+    }
+    return matchDictionary(dataset, predicate->left, codeMatches, leaf) &&
+           matchDictionary(dataset, predicate->right, codeMatches, leaf);
+}
+
+// Skip the STRING leaves of a subtree that is not evaluated in the current chunk
+static void skipSubtree(Evaluation *evaluation, const Predicate *predicate)
+{
+    evaluation->leaf += countStringLeaves(predicate);
+}
+
+/*
+This function evaluates a predicate tree over the words [wordBegin, wordEnd) into bits,
+which holds those words.
+*/
+static void evaluateChunk(Evaluation *evaluation, const Predicate *predicate, uint64_t *bits, int64_t wordBegin, int64_t wordEnd)
+{
+    const DataSet *dataset = evaluation->dataset;
+    int64_t count = wordEnd - wordBegin;
+    switch (predicate->kind)
+    {
+    case PREDICATE_TYPE:
+        memcpy(bits, dataset->typeIndex[predicate->type].words + wordBegin, (size_t)count * sizeof(uint64_t));
+        break;
+    case PREDICATE_INT:
+        filterIntRange(dataset, predicate->op, predicate->intOperands, predicate->operandCount, bits, wordBegin, wordEnd);
+        break;
+    case PREDICATE_FLOAT:
+        filterFloatRange(dataset, predicate->op, predicate->floatOperands, predicate->operandCount, bits, wordBegin, wordEnd);
+        break;
+    case PREDICATE_STRING_EQUALS:
+    case PREDICATE_STRING_PREFIX:
+    {
+        const uint8_t *matches = evaluation->codeMatches != NULL ? evaluation->codeMatches[evaluation->leaf] : NULL;
+        evaluation->leaf++;
+        // A chunk lies in one zone, which an equality test skips if its bloom filter rules the string out
+        if (predicate->kind == PREDICATE_STRING_EQUALS && dataset->zones != NULL &&
+            !bloomMayContain(&dataset->zones[wordBegin * 64 / ZONE_SIZE], predicate->hash))
+        {
+            memset(bits, 0, (size_t)count * sizeof(uint64_t));
+            break;
+        }
+        for (int64_t w = wordBegin; w < wordEnd; w++)
+        {
+            uint64_t result = 0;
+            for (uint64_t strings = dataset->typeIndex[STRING].words[w]; strings != 0; strings &= strings - 1)
+            {
+                int64_t i = w * 64 + __builtin_ctzll(strings);
+                bool match;
+                if (matches != NULL)
+                {
+                    match = matches[codeAt(dataset->dictionary, i)];
+                }
+                else
+                {
+                    size_t length;
+                    const char *value = stringAt(dataset, i, &length);
+                    match = matchString(predicate, value, length);
+                }
+                result |= (uint64_t)match << (i & 63);
+            }
+            bits[w - wordBegin] = result;
+        }
+        break;
+    }
+    case PREDICATE_AND:
+    case PREDICATE_OR:
+    {
+        evaluateChunk(evaluation, predicate->left, bits, wordBegin, wordEnd);
+        // AND needs the second child only where the first selects something, OR only where it leaves a value out
+        bool needed = false;
+        for (int64_t w = wordBegin; w < wordEnd && !needed; w++)
+        {
+            needed = predicate->kind == PREDICATE_AND ? bits[w - wordBegin] != 0
+                                                      : bits[w - wordBegin] != dataset->present.words[w];
+        }
+        if (!needed)
+        {
+            skipSubtree(evaluation, predicate->right);
+            break;
+        }
+        uint64_t other[PREDICATE_CHUNK_WORDS];
+        evaluateChunk(evaluation, predicate->right, other, wordBegin, wordEnd);
+        for (int64_t w = 0; w < count; w++)
+        {
+            bits[w] = predicate->kind == PREDICATE_AND ? bits[w] & other[w] : bits[w] | other[w];
+        }
+        break;
+    }
+    case PREDICATE_NOT:
+        evaluateChunk(evaluation, predicate->left, bits, wordBegin, wordEnd);
+        for (int64_t w = wordBegin; w < wordEnd; w++)
+        {
+            bits[w - wordBegin] = dataset->present.words[w] & ~bits[w - wordBegin];
+        }
+        break;
+    }
+}
+
+/*
+This function selects the data points of a dataset that satisfy a predicate tree, making
+one pass over the dataset whatever the number of terms: each chunk of slots is evaluated
+by every node of the tree before the pass moves on, writing straight into the selection.
+It returns a bitmap with one bit per slot of the dataset, which the caller frees with
+freeBitmap, or NULL if the dataset or predicate is NULL or memory runs out.
+*/
+Bitmap *filterPredicate(DataSet *dataset, const Predicate *predicate)
+{
+    if (dataset == NULL || predicate == NULL)
+    {
+        return NULL;
+    }
+    Bitmap *selection = createBitmap(dataset->size);
+    if (selection == NULL)
+    {
+        return NULL;
+    }
+    Evaluation evaluation = {dataset, NULL, 0};
+    int leaves = countStringLeaves(predicate);
+    if (dataset->dictionary != NULL && leaves > 0)
+    {
+        evaluation.codeMatches = (uint8_t **)calloc(leaves, sizeof(uint8_t *));
+        int leaf = 0;
+        if (evaluation.codeMatches == NULL || !matchDictionary(dataset, predicate, evaluation.codeMatches, &leaf))
+        {
+            for (int l = 0; evaluation.codeMatches != NULL && l < leaves; l++)
+            {
+                free(evaluation.codeMatches[l]);
+            }
+            free(evaluation.codeMatches);
+            freeBitmap(selection);
+            return NULL;
+        }
+    }
+
+    int64_t words = bitmapWordCount(dataset->size);
+    for (int64_t wordBegin = 0; wordBegin < words; wordBegin += PREDICATE_CHUNK_WORDS)
+    {
+        int64_t wordEnd = wordBegin + PREDICATE_CHUNK_WORDS < words ? wordBegin + PREDICATE_CHUNK_WORDS : words;
+        evaluation.leaf = 0;
+        evaluateChunk(&evaluation, predicate, selection->words + wordBegin, wordBegin, wordEnd);
+    }
+
+    for (int l = 0; evaluation.codeMatches != NULL && l < leaves; l++)
+    {
+        free(evaluation.codeMatches[l]);
+    }
+    free(evaluation.codeMatches);
+    return selection;
+}
@@ -0,0 +1,852 @@
+#include "roaring.h"
+#include "internal.h"
+
+/*
+Compressed bitmaps. The bits are split into chunks of ROARING_CHUNK_SIZE and only the chunks
+with a set bit get a container, kept sorted by chunk number. A container holds its bits in
+whichever form takes the least memory: an array of the set bits for a sparse chunk, a run
+list for a chunk of long stretches and a plain bitset otherwise. A bitmap of a rare type or
+a selective filter therefore takes memory in proportion to its set bits, not to the slots
+of the dataset. Two arrays are combined by merging them; any other pair of containers is
+expanded into words, combined a word at a time and compressed again.
+*/
+
+#define CHUNK_WORDS (ROARING_CHUNK_SIZE / 64)
+
+// Define enums for the operations combining two compressed bitmaps
+typedef enum
+{
+    OP_AND,
+    OP_OR,
+    OP_ANDNOT,
+    OP_XOR
+} RoaringOp;
+
+// Free the memory of a container
+static void releaseContainer(Container *container)
+{
+    free(container->values);
+    free(container->words);
+    container->values = NULL;
+    container->words = NULL;
+}
+
+// Expand a container into the words of its chunk
+static void containerToWords(const Container *container, uint64_t *words)
+{
+    if (container->type == CONTAINER_BITSET)
+    {
+        memcpy(words, container->words, CHUNK_WORDS * sizeof(uint64_t));
+        return;
+    }
+    memset(words, 0, CHUNK_WORDS * sizeof(uint64_t));
+    if (container->type == CONTAINER_ARRAY)
+    {
+        for (int i = 0; i < container->length; i++)
+        {
+            uint16_t value = container->values[i];
+            words[value >> 6] |= (uint64_t)1 << (value & 63);
+        }
+        return;
+    }
+    for (int r = 0; r < container->length; r++)
+    {
+        int64_t begin = container->values[2 * r];
+        int64_t end = begin + container->values[2 * r + 1] + 1;
+        for (int64_t w = begin / 64; w < bitmapWordCount(end); w++)
+        {
+            words[w] |= rangeMask(w, begin, end);
+        }
+    }
+}
+
+// Find the first array value, or the first run, not below value
+static int lowerBound(const uint16_t *values, int length, int stride, uint16_t value)
+{
+    int low = 0;
+    int high = length;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (values[middle * stride] < value)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Check whether a container holds a value
+static bool containerContains(const Container *container, uint16_t value)
+{
+    switch (container->type)
+    {
+    case CONTAINER_BITSET:
+        return (container->words[value >> 6] >> (value & 63)) & 1;
+    case CONTAINER_ARRAY:
+    {
+        int i = lowerBound(container->values, container->length, 1, value);
+        return i < container->length && container->values[i] == value;
+    }
+    default:
+    {
+        // The run holding value, if any, is the last run starting at or before it
+        int r = lowerBound(container->values, container->length, 2, value);
+        if (r < container->length && container->values[2 * r] == value)
+        {
+            return true;
+        }
+        return r > 0 && value - container->values[2 * (r - 1)] <= container->values[2 * (r - 1) + 1];
+    }
+    }
+}
+
+// Get the first value of a container not below value, or -1 if there is none
+static int64_t containerNext(const Container *container, int64_t value)
+{
+    switch (container->type)
+    {
+    case CONTAINER_BITSET:
+        for (int64_t w = value / 64; w < CHUNK_WORDS; w++)
+        {
+            uint64_t bits = container->words[w];
+            if (w == value / 64)
+            {
+                bits &= ~(uint64_t)0 << (value & 63);
+            }
+            if (bits != 0)
+            {
+                return w * 64 + __builtin_ctzll(bits);
+            }
+        }
+        return -1;
+    case CONTAINER_ARRAY:
+    {
+        int i = lowerBound(container->values, container->length, 1, (uint16_t)value);
+        return i < container->length ? container->values[i] : -1;
+    }
+    default:
+        for (int r = 0; r < container->length; r++)
+        {
+            int64_t begin = container->values[2 * r];
+            if (begin + container->values[2 * r + 1] >= value)
+            {
+                return begin > value ? begin : value;
+            }
+        }
+        return -1;
+    }
+}
+
+// Find the first set bit of words at or after position, or CHUNK_WORDS * 64 if there is none
+static int64_t nextInWords(const uint64_t *words, int64_t position, bool set)
+{
+    for (int64_t w = position / 64; w < CHUNK_WORDS; w++)
+    {
+        uint64_t bits = set ? words[w] : ~words[w];
+        if (w == position / 64)
+        {
+            bits &= ~(uint64_t)0 << (position & 63);
+        }
+        if (bits != 0)
+        {
+            return w * 64 + __builtin_ctzll(bits);
+        }
+    }
+    return CHUNK_WORDS * 64;
+}
+
+/*
+This function fills a container from the words of its chunk, in the form that takes the
+least memory: runs if they take fewer bytes than both an array and a bitset, an array if
+it holds no more than ROARING_ARRAY_LIMIT values and a bitset otherwise. A chunk without a
+set bit gives a container of cardinality 0 that owns no memory.
+It returns false if memory runs out.
+*/
+static bool containerFromWords(Container *container, const uint64_t *words)
+{
+    int64_t cardinality = 0;
+    int64_t runs = 0;
+    uint64_t carry = 0;
+    for (int w = 0; w < CHUNK_WORDS; w++)
+    {
+        cardinality += __builtin_popcountll(words[w]);
+        // A run starts at each set bit whose lower neighbour is clear
+        runs += __builtin_popcountll(words[w] & ~((words[w] << 1) | carry));
+        carry = words[w] >> 63;
+    }
+    container->cardinality = (int32_t)cardinality;
+    container->length = 0;
+    container->values = NULL;
+    container->words = NULL;
+    if (cardinality == 0)
+    {
+        return true;
+    }
+
+    size_t runBytes = (size_t)runs * 2 * sizeof(uint16_t);
+    if (runBytes < (size_t)cardinality * sizeof(uint16_t) && runBytes < CHUNK_WORDS * sizeof(uint64_t))
+    {
+        container->type = CONTAINER_RUN;
+        container->values = (uint16_t *)malloc(runBytes);
+        if (container->values == NULL)
+        {
+            return false;
+        }
+        int64_t position = 0;
+        for (int r = 0; r < runs; r++)
+        {
+            int64_t begin = nextInWords(words, position, true);
+            position = nextInWords(words, begin, false);
+            container->values[2 * r] = (uint16_t)begin;
+            container->values[2 * r + 1] = (uint16_t)(position - begin - 1);
+        }
+        container->length = (int32_t)runs;
+    }
+    else if (cardinality <= ROARING_ARRAY_LIMIT)
+    {
+        container->type = CONTAINER_ARRAY;
+        container->values = (uint16_t *)malloc(cardinality * sizeof(uint16_t));
+        if (container->values == NULL)
+        {
+            return false;
+        }
+        for (int w = 0; w < CHUNK_WORDS; w++)
+        {
+            for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1)
+            {
+                container->values[container->length++] = (uint16_t)(w * 64 + __builtin_ctzll(bits));
+            }
+        }
+    }
+    else
+    {
+        container->type = CONTAINER_BITSET;
+        container->words = (uint64_t *)malloc(CHUNK_WORDS * sizeof(uint64_t));
+        if (container->words == NULL)
+        {
+            return false;
+        }
+        memcpy(container->words, words, CHUNK_WORDS * sizeof(uint64_t));
+    }
+    return true;
+}
+
+// Copy a container with its own memory
+static bool copyContainer(Container *to, const Container *from)
+{
+    *to = *from;
+    to->values = NULL;
+    to->words = NULL;
+    if (from->type == CONTAINER_BITSET)
+    {
+        to->words = (uint64_t *)malloc(CHUNK_WORDS * sizeof(uint64_t));
+        if (to->words == NULL)
+        {
+            return false;
+        }
+        memcpy(to->words, from->words, CHUNK_WORDS * sizeof(uint64_t));
+        return true;
+    }
+    size_t bytes = (size_t)from->length * (from->type == CONTAINER_RUN ? 2 : 1) * sizeof(uint16_t);
+    to->values = (uint16_t *)malloc(bytes);
+    if (to->values == NULL)
+    {
+        return false;
+    }
+    memcpy(to->values, from->values, bytes);
+    return true;
+}
+
+// Merge two sorted arrays under an operation into out, returning the number of values written
+static int mergeArrays(const uint16_t *a, int aLength, const uint16_t *b, int bLength, RoaringOp op, uint16_t *out)
+{
+    int i = 0;
+    int j = 0;
+    int n = 0;
+    while (i < aLength && j < bLength)
+    {
+        if (a[i] < b[j])
+        {
+            if (op != OP_AND)
+            {
+                out[n++] = a[i];
+            }
+            i++;
+        }
+        else if (a[i] > b[j])
+        {
+            if (op == OP_OR || op == OP_XOR)
+            {
+                out[n++] = b[j];
+            }
+            j++;
+        }
+        else
+        {
+            if (op == OP_AND || op == OP_OR)
+            {
+                out[n++] = a[i];
+            }
+            i++;
+            j++;
+        }
+    }
+    while (op != OP_AND && i < aLength)
+    {
+        out[n++] = a[i++];
+    }
+    while ((op == OP_OR || op == OP_XOR) && j < bLength)
+    {
+        out[n++] = b[j++];
+    }
+    return n;
+}
+
+// Keep the values of an array that another container holds, or does not hold
+static bool probeArray(const Container *array, const Container *other, bool keep, Container *result)
+{
+    result->type = CONTAINER_ARRAY;
+    result->words = NULL;
+    result->values = (uint16_t *)malloc(array->length * sizeof(uint16_t));
+    if (result->values == NULL)
+    {
+        return false;
+    }
+    int n = 0;
+    for (int i = 0; i < array->length; i++)
+    {
+        if (containerContains(other, array->values[i]) == keep)
+        {
+            result->values[n++] = array->values[i];
+        }
+    }
+    result->length = n;
+    result->cardinality = n;
+    return true;
+}
+
+/*
+This function combines two containers of the same chunk under an operation. Two arrays are
+merged, and an array intersected with, or subtracted by, another container is probed value
+by value, so sparse chunks never touch a bitset; the other pairs are expanded into words.
+It returns false if memory runs out.
+*/
+static bool combineContainers(const Container *a, const Container *b, RoaringOp op, Container *result)
+{
+    result->key = a->key;
+    if (a->type == CONTAINER_ARRAY && b->type == CONTAINER_ARRAY)
+    {
+        uint16_t *values = (uint16_t *)malloc((size_t)(a->length + b->length) * sizeof(uint16_t));
+        if (values == NULL)
+        {
+            return false;
+        }
+        int n = mergeArrays(a->values, a->length, b->values, b->length, op, values);
+        if (n <= ROARING_ARRAY_LIMIT)
+        {
+            result->type = CONTAINER_ARRAY;
+            result->values = values;
+            result->words = NULL;
+            result->length = n;
+            result->cardinality = n;
+            return true;
+        }
+        free(values);
+    }
+    else if (a->type == CONTAINER_ARRAY && (op == OP_AND || op == OP_ANDNOT))
+    {
+        return probeArray(a, b, op == OP_AND, result);
+    }
+    else if (b->type == CONTAINER_ARRAY && op == OP_AND)
+    {
+        return probeArray(b, a, true, result);
+    }
+
+    uint64_t left[CHUNK_WORDS];
+    uint64_t right[CHUNK_WORDS];
+    containerToWords(a, left);
+    containerToWords(b, right);
+    for (int w = 0; w < CHUNK_WORDS; w++)
+    {
+        switch (op)
+        {
+        case OP_AND:
+            left[w] &= right[w];
+            break;
+        case OP_OR:
+            left[w] |= right[w];
+            break;
+        case OP_ANDNOT:
+            left[w] &= ~right[w];
+            break;
+        case OP_XOR:
+            left[w] ^= right[w];
+            break;
+        }
+    }
+    return containerFromWords(result, left);
+}
+
+// Find the first container whose key is not below key
+static int64_t findContainer(const RoaringBitmap *bitmap, int64_t key)
+{
+    int64_t low = 0;
+    int64_t high = bitmap->count;
+    while (low < high)
+    {
+        int64_t middle = (low + high) / 2;
+        if (bitmap->containers[middle].key < key)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Insert a container at a position, taking over its memory; on failure the container is freed
+static bool insertContainer(RoaringBitmap *bitmap, int64_t position, Container *container)
+{
+    if (bitmap->count == bitmap->capacity)
+    {
+        int64_t capacity = bitmap->capacity > 0 ? bitmap->capacity * 2 : 4;
+        Container *containers = (Container *)realloc(bitmap->containers, capacity * sizeof(Container));
+        if (containers == NULL)
+        {
+            releaseContainer(container);
+            return false;
+        }
+        bitmap->containers = containers;
+        bitmap->capacity = capacity;
+    }
+    memmove(bitmap->containers + position + 1, bitmap->containers + position,
+            (size_t)(bitmap->count - position) * sizeof(Container));
+    bitmap->containers[position] = *container;
+    bitmap->count++;
+    return true;
+}
+
+/*
+This function creates an empty compressed bitmap of a given size, which takes no memory
+for its bits until one is set.
+It returns NULL if the size is negative or memory runs out.
+*/
+RoaringBitmap *createRoaringBitmap(int64_t size)
+{
+    if (size < 0)
+    {
+        return NULL;
+    }
+    RoaringBitmap *bitmap = (RoaringBitmap *)calloc(1, sizeof(RoaringBitmap));
+    if (bitmap == NULL)
+    {
+        return NULL;
+    }
+    bitmap->size = size;
+    return bitmap;
+}
+
+/*
+This function frees a compressed bitmap and all its containers.
+*/
+void freeRoaringBitmap(RoaringBitmap *bitmap)
+{
+    if (bitmap == NULL)
+    {
+        return;
+    }
+    for (int64_t c = 0; c < bitmap->count; c++)
+    {
+        releaseContainer(&bitmap->containers[c]);
+    }
+    free(bitmap->containers);
+    free(bitmap);
+}
+
+/*
+This function sets bit index of a compressed bitmap. An array container that grows past
+ROARING_ARRAY_LIMIT values becomes a bitset, and a run container is rebuilt in whichever
+form then suits it best.
+It returns false if the bitmap is NULL, the index is out of range or memory runs out.
+*/
+bool addRoaring(RoaringBitmap *bitmap, int64_t index)
+{
+    if (bitmap == NULL || index < 0 || index >= bitmap->size)
+    {
+        return false;
+    }
+    int64_t key = index / ROARING_CHUNK_SIZE;
+    uint16_t value = (uint16_t)(index % ROARING_CHUNK_SIZE);
+    int64_t position = findContainer(bitmap, key);
+    if (position == bitmap->count || bitmap->containers[position].key != key)
+    {
+        Container container = {key, CONTAINER_ARRAY, 1, 1, (uint16_t *)malloc(sizeof(uint16_t)), NULL};
+        if (container.values == NULL)
+        {
+            return false;
+        }
+        container.values[0] = value;
+        return insertContainer(bitmap, position, &container);
+    }
+
+    Container *container = &bitmap->containers[position];
+    if (containerContains(container, value))
+    {
+        return true;
+    }
+    if (container->type == CONTAINER_BITSET)
+    {
+        container->words[value >> 6] |= (uint64_t)1 << (value & 63);
+        container->cardinality++;
+        return true;
+    }
+    if (container->type == CONTAINER_ARRAY && container->length < ROARING_ARRAY_LIMIT)
+    {
+        uint16_t *values = (uint16_t *)realloc(container->values, (container->length + 1) * sizeof(uint16_t));
+        if (values == NULL)
+        {
+            return false;
+        }
+        int i = lowerBound(values, container->length, 1, value);
+        memmove(values + i + 1, values + i, (size_t)(container->length - i) * sizeof(uint16_t));
+        values[i] = value;
+        container->values = values;
+        container->length++;
+        container->cardinality++;
+        return true;
+    }
+    uint64_t words[CHUNK_WORDS];
+    containerToWords(container, words);
+    words[value >> 6] |= (uint64_t)1 << (value & 63);
+    Container rebuilt;
+    rebuilt.key = key;
+    if (!containerFromWords(&rebuilt, words))
+    {
+        releaseContainer(&rebuilt);
+        return false;
+    }
+    releaseContainer(container);
+    *container = rebuilt;
+    return true;
+}
+
+/*
+This function tests bit index of a compressed bitmap.
+It returns false if the bitmap is NULL or the index is out of range.
+*/
+bool testRoaring(const RoaringBitmap *bitmap, int64_t index)
+{
+    if (bitmap == NULL || index < 0 || index >= bitmap->size)
+    {
+        return false;
+    }
+    int64_t key = index / ROARING_CHUNK_SIZE;
+    int64_t position = findContainer(bitmap, key);
+    return position < bitmap->count && bitmap->containers[position].key == key &&
+           containerContains(&bitmap->containers[position], (uint16_t)(index % ROARING_CHUNK_SIZE));
+}
+
+/*
+This function counts the set bits of a compressed bitmap from the cardinalities of its
+containers, without looking at the bits. It returns 0 for a NULL bitmap.
+*/
+int64_t countRoaring(const RoaringBitmap *bitmap)
+{
+    if (bitmap == NULL)
+    {
+        return 0;
+    }
+    int64_t count = 0;
+    for (int64_t c = 0; c < bitmap->count; c++)
+    {
+        count += bitmap->containers[c].cardinality;
+    }
+    return count;
+}
+
+/*
+This function finds the first set bit of a compressed bitmap at or after index, skipping
+the chunks without a container, so the set bits are visited with
+for (i = nextRoaringIndex(bitmap, 0); i >= 0; i = nextRoaringIndex(bitmap, i + 1)).
+It returns -1 if there is no such bit or the bitmap is NULL.
+*/
+int64_t nextRoaringIndex(const RoaringBitmap *bitmap, int64_t index)
+{
+    if (bitmap == NULL)
+    {
+        return -1;
+    }
+    if (index < 0)
+    {
+        index = 0;
+    }
+    int64_t key = index / ROARING_CHUNK_SIZE;
+    for (int64_t c = findContainer(bitmap, key); c < bitmap->count; c++)
+    {
+        const Container *container = &bitmap->containers[c];
+        int64_t next = containerNext(container, container->key == key ? index % ROARING_CHUNK_SIZE : 0);
+        if (next >= 0)
+        {
+            return container->key * ROARING_CHUNK_SIZE + next;
+        }
+    }
+    return -1;
+}
+
+/*
+This function gets the bytes of memory a compressed bitmap takes: the bitmap itself, its
+container table and the values or words of each container.
+*/
+size_t roaringBytes(const RoaringBitmap *bitmap)
+{
+    if (bitmap == NULL)
+    {
+        return 0;
+    }
+    size_t bytes = sizeof(RoaringBitmap) + (size_t)bitmap->capacity * sizeof(Container);
+    for (int64_t c = 0; c < bitmap->count; c++)
+    {
+        const Container *container = &bitmap->containers[c];
+        switch (container->type)
+        {
+        case CONTAINER_BITSET:
+            bytes += CHUNK_WORDS * sizeof(uint64_t);
+            break;
+        case CONTAINER_ARRAY:
+            bytes += (size_t)container->length * sizeof(uint16_t);
+            break;
+        default:
+            bytes += (size_t)container->length * 2 * sizeof(uint16_t);
+            break;
+        }
+    }
+    return bytes;
+}
+
+/*
+This function builds a compressed bitmap of a given size chunk by chunk: fill writes the
+words [wordBegin, wordEnd) of a chunk into a buffer, which is then compressed into a
+container, so no more than one chunk is ever held uncompressed.
+It returns NULL if memory runs out.
+*/
+template <typename Fill>
+static RoaringBitmap *compressChunks(int64_t size, Fill fill)
+{
+    RoaringBitmap *bitmap = createRoaringBitmap(size);
+    if (bitmap == NULL)
+    {
+        return NULL;
+    }
+    uint64_t words[CHUNK_WORDS];
+    int64_t wordCount = bitmapWordCount(size);
+    for (int64_t wordBegin = 0; wordBegin < wordCount; wordBegin += CHUNK_WORDS)
+    {
+        int64_t wordEnd = wordBegin + CHUNK_WORDS < wordCount ? wordBegin + CHUNK_WORDS : wordCount;
+        fill(words, wordBegin, wordEnd);
+        memset(words + (wordEnd - wordBegin), 0, (size_t)(CHUNK_WORDS - (wordEnd - wordBegin)) * sizeof(uint64_t));
+        Container container;
+        container.key = wordBegin / CHUNK_WORDS;
+        if (!containerFromWords(&container, words))
+        {
+            releaseContainer(&container);
+            freeRoaringBitmap(bitmap);
+            return NULL;
+        }
+        if (container.cardinality > 0 && !insertContainer(bitmap, bitmap->count, &container))
+        {
+            freeRoaringBitmap(bitmap);
+            return NULL;
+        }
+    }
+    return bitmap;
+}
+
+/*
+This function compresses a bitmap into a compressed bitmap of the same size.
+It returns NULL if the bitmap is NULL or memory runs out.
+*/
+RoaringBitmap *compressBitmap(const Bitmap *bitmap)
+{
+    if (bitmap == NULL)
+    {
+        return NULL;
+    }
+    return compressChunks(bitmap->size, [&](uint64_t *words, int64_t wordBegin, int64_t wordEnd) {
+        memcpy(words, bitmap->words + wordBegin, (size_t)(wordEnd - wordBegin) * sizeof(uint64_t));
+    });
+}
+
+/*
+This function expands a compressed bitmap into a bitmap of the same size, which the
+caller frees with freeBitmap.
+It returns NULL if the compressed bitmap is NULL or memory runs out.
+*/
+Bitmap *decompressRoaring(const RoaringBitmap *bitmap)
+{
+    if (bitmap == NULL)
+    {
+        return NULL;
+    }
+    Bitmap *result = createBitmap(bitmap->size);
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    uint64_t words[CHUNK_WORDS];
+    int64_t wordCount = bitmapWordCount(bitmap->size);
+    for (int64_t c = 0; c < bitmap->count; c++)
+    {
+        const Container *container = &bitmap->containers[c];
+        int64_t wordBegin = container->key * CHUNK_WORDS;
+        int64_t length = wordCount - wordBegin < CHUNK_WORDS ? wordCount - wordBegin : CHUNK_WORDS;
+        containerToWords(container, words);
+        memcpy(result->words + wordBegin, words, (size_t)length * sizeof(uint64_t));
+    }
+    return result;
+}
+
+/*
+This function combines two compressed bitmaps of the same size under an operation,
+walking their containers in key order. A chunk held by one bitmap only is copied or
+dropped as the operation decides, without looking at its bits.
+It returns NULL if either bitmap is NULL, their sizes differ or memory runs out.
+*/
+static RoaringBitmap *combineRoaring(const RoaringBitmap *a, const RoaringBitmap *b, RoaringOp op)
+{
+    if (a == NULL || b == NULL || a->size != b->size)
+    {
+        return NULL;
+    }
+    RoaringBitmap *result = createRoaringBitmap(a->size);
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    int64_t i = 0;
+    int64_t j = 0;
+    while (i < a->count || j < b->count)
+    {
+        const Container *left = i < a->count ? &a->containers[i] : NULL;
+        const Container *right = j < b->count ? &b->containers[j] : NULL;
+        Container container = {};
+        bool ok = true;
+        if (right == NULL || (left != NULL && left->key < right->key))
+        {
+            i++;
+            if (op == OP_AND)
+            {
+                continue;
+            }
+            ok = copyContainer(&container, left);
+        }
+        else if (left == NULL || right->key < left->key)
+        {
+            j++;
+            if (op == OP_AND || op == OP_ANDNOT)
+            {
+                continue;
+            }
+            ok = copyContainer(&container, right);
+        }
+        else
+        {
+            i++;
+            j++;
+            ok = combineContainers(left, right, op, &container);
+        }
+        if (ok && container.cardinality == 0)
+        {
+            releaseContainer(&container);
+            continue;
+        }
+        if (!ok)
+        {
+            releaseContainer(&container);
+        }
+        if (!ok || !insertContainer(result, result->count, &container))
+        {
+            freeRoaringBitmap(result);
+            return NULL;
+        }
+    }
+    return result;
+}
+
+/*
+These functions combine two compressed bitmaps of the same size into a new compressed
+bitmap holding the bits set in both, in either, in the first but not the second, and in
+exactly one of them. The caller frees the result with freeRoaringBitmap.
+They return NULL if either bitmap is NULL, their sizes differ or memory runs out.
+*/
+RoaringBitmap *andRoaring(const RoaringBitmap *a, const RoaringBitmap *b)
+{
+    return combineRoaring(a, b, OP_AND);
+}
+
+RoaringBitmap *orRoaring(const RoaringBitmap *a, const RoaringBitmap *b)
+{
+    return combineRoaring(a, b, OP_OR);
+}
+
+RoaringBitmap *andNotRoaring(const RoaringBitmap *a, const RoaringBitmap *b)
+{
+    return combineRoaring(a, b, OP_ANDNOT);
+}
+
+RoaringBitmap *xorRoaring(const RoaringBitmap *a, const RoaringBitmap *b)
+{
+    return combineRoaring(a, b, OP_XOR);
+}
+
+/*
+This function compresses the type bitmap of a dataset, giving the slots that hold a
+value of a type. A type held by few slots takes little memory.
+It returns NULL if the dataset is NULL, the type is invalid or memory runs out.
+*/
+RoaringBitmap *compressTypeIndex(DataSet *dataset, DataType type)
+{
+    if (dataset == NULL || (type != INT && type != FLOAT && type != STRING))
+    {
+        return NULL;
+    }
+    return compressBitmap(&dataset->typeIndex[type]);
+}
+
+/*
+This function works like filterIntValues but returns a compressed bitmap. The filter runs
+one chunk of ROARING_CHUNK_SIZE slots at a time into a buffer that is compressed before the
+next chunk, so a selective filter takes memory in proportion to its matches.
+*/
+RoaringBitmap *filterIntValuesCompressed(DataSet *dataset, CompareOp op, const int32_t *operands, int operandCount)
+{
+    if (dataset == NULL || !validOperands(op, operands, operandCount))
+    {
+        return NULL;
+    }
+    return compressChunks(dataset->size, [&](uint64_t *words, int64_t wordBegin, int64_t wordEnd) {
+        filterIntRange(dataset, op, operands, operandCount, words, wordBegin, wordEnd);
+    });
+}
+
+/*
+This function works like filterFloatValues but returns a compressed bitmap, filtering one
+chunk at a time as filterIntValuesCompressed does.
+*/
+RoaringBitmap *filterFloatValuesCompressed(DataSet *dataset, CompareOp op, const float *operands, int operandCount)
+{
+    if (dataset == NULL || !validOperands(op, operands, operandCount))
+    {
+        return NULL;
+    }
+    return compressChunks(dataset->size, [&](uint64_t *words, int64_t wordBegin, int64_t wordEnd) {
+        filterFloatRange(dataset, op, operands, operandCount, words, wordBegin, wordEnd);
+    });
+}
@@ -0,0 +1,468 @@
+#include "sort.h"
+#include "internal.h"
+
+#include <algorithm>
+
+/*
+Sorting. A sort never moves values: it collects the slots of the type it sorts with a
+32-bit key each and returns the slots in key order, so a report can walk the dataset in
+order through the permutation. INT and FLOAT values, and dictionary codes once ranked by
+their strings, map to keys that order exactly like the values, so they are sorted by an
+LSD radix sort of one pass per key byte, skipping a byte every key shares. Other STRING
+values key on their first four bytes and are sorted by comparison, which only reads the
+strings of slots whose prefixes are equal. Slots with equal values keep slot order.
+*/
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// Check the arguments shared by the sort functions
+bool validSort(const DataSet *dataset, DataType type, const Bitmap *selection, SortOrder order)
+{
+    return dataset != NULL && (type == INT || type == FLOAT || type == STRING) &&
+           (order == SORT_ASCENDING || order == SORT_DESCENDING) && (selection == NULL || selection->size == dataset->size);
+}
+
+// Key of an INT value, flipping the sign bit so negative values come first
+static inline uint32_t intKey(int32_t value)
+{
+    return (uint32_t)value ^ 0x80000000u;
+}
+
+// Key of a FLOAT value: negative values have every bit flipped and others the sign bit.
+// -0 is keyed as 0 so the two keep slot order, and every NaN sorts above infinity.
+static inline uint32_t floatKey(float value)
+{
+    if (value != value)
+    {
+        return UINT32_MAX;
+    }
+    if (value == 0.0f)
+    {
+        value = 0.0f;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+// Key of a string: its first four bytes, big-endian and padded with 0
+static inline uint32_t prefixKey(const char *value, size_t length)
+{
+    uint32_t key = 0;
+    for (size_t i = 0; i < 4; i++)
+    {
+        key = (key << 8) | (i < length ? (uint8_t)value[i] : 0);
+    }
+    return key;
+}
+
+// Compare two strings byte by byte, a prefix ordering before the longer string
+static inline int compareStrings(const char *a, size_t aLength, const char *b, size_t bLength)
+{
+    int result = memcmp(a, b, aLength < bLength ? aLength : bLength);
+    if (result != 0)
+    {
+        return result;
+    }
+    return aLength < bLength ? -1 : aLength > bLength ? 1 : 0;
+}
+
+// Order two entries by key, then by string when keys are prefixes, then by slot
+static inline bool entryLess(const SortKeys *keys, const SortEntry &a, const SortEntry &b)
+{
+    if (a.key != b.key)
+    {
+        return a.key < b.key;
+    }
+    if (keys->compareStrings)
+    {
+        size_t aLength, bLength;
+        const char *aValue = stringAt(keys->dataset, a.slot, &aLength);
+        const char *bValue = stringAt(keys->dataset, b.slot, &bLength);
+        int result = compareStrings(aValue, aLength, bValue, bLength);
+        if (result != 0)
+        {
+            return keys->order == SORT_ASCENDING ? result < 0 : result > 0;
+        }
+    }
+    return a.slot < b.slot;
+}
+
+/*
+This function sets up the keys of a sort of a type. For dictionary-encoded strings it
+ranks the codes of the dictionary by their strings, so slots can be keyed by the rank of
+their code. It returns false if memory runs out.
+*/
+bool prepareSortKeys(SortKeys *keys, const DataSet *dataset, DataType type, SortOrder order)
+{
+    keys->dataset = dataset;
+    keys->type = type;
+    keys->order = order;
+    keys->ranks = NULL;
+    keys->compareStrings = type == STRING && dataset->dictionary == NULL;
+    if (type != STRING || dataset->dictionary == NULL)
+    {
+        return true;
+    }
+    const StringDictionary *dictionary = dataset->dictionary;
+    int count = dictionary->count;
+    uint32_t *codes = (uint32_t *)malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    keys->ranks = (uint32_t *)malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    if (codes == NULL || keys->ranks == NULL)
+    {
+        free(codes);
+        releaseSortKeys(keys);
+        return false;
+    }
+    for (int code = 0; code < count; code++)
+    {
+        codes[code] = (uint32_t)code;
+    }
+    const char *bytes = dataset->strings.bytes;
+    std::sort(codes, codes + count, [&](uint32_t a, uint32_t b) {
+        return compareStrings(bytes + dictionary->offsets[a], dictionary->lengths[a],
+                              bytes + dictionary->offsets[b], dictionary->lengths[b]) < 0;
+    });
+    for (int rank = 0; rank < count; rank++)
+    {
+        keys->ranks[codes[rank]] = (uint32_t)rank;
+    }
+    free(codes);
+    return true;
+}
+
+// Free the code ranks of a sort
+void releaseSortKeys(SortKeys *keys)
+{
+    free(keys->ranks);
+    keys->ranks = NULL;
+}
+
+// Key of slot index, given its INT value if the column is sealed
+static inline uint32_t slotKey(const SortKeys *keys, int64_t index, int32_t decoded)
+{
+    const DataSet *dataset = keys->dataset;
+    uint32_t key;
+    switch (keys->type)
+    {
+    case INT:
+        key = intKey(dataset->encodedInts != NULL ? decoded : dataset->ints[index]);
+        break;
+    case FLOAT:
+        key = floatKey(dataset->floats[index]);
+        break;
+    default:
+        if (keys->ranks != NULL)
+        {
+            key = keys->ranks[codeAt(dataset->dictionary, index)];
+        }
+        else
+        {
+            size_t length;
+            const char *value = stringAt(dataset, index, &length);
+            key = prefixKey(value, length);
+        }
+        break;
+    }
+    return keys->order == SORT_DESCENDING ? ~key : key;
+}
+
+// Smallest key an INT or FLOAT value of a zone can have, from the bounds of the zone
+static inline uint32_t zoneBestKey(const SortKeys *keys, const Zone *zone)
+{
+    if (keys->type == INT)
+    {
+        return keys->order == SORT_ASCENDING ? intKey(zone->intMin) : ~intKey(zone->intMax);
+    }
+    if (keys->order == SORT_ASCENDING)
+    {
+        return floatKey(zone->floatMin);
+    }
+    return zone->floatNaN ? 0 : ~floatKey(zone->floatMax);
+}
+
+/*
+This function visits the entry of every slot of the sorted type in the words
+[wordBegin, wordEnd), in slot order, restricted to a selection if it is not NULL.
+A zone without a value of the type is skipped, and so is an INT or FLOAT zone whose
+smallest possible key is not below limit(), as no slot of it could sort before one
+already found.
+*/
+template <typename Limit, typename Visit>
+static void visitEntries(const SortKeys *keys, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd, Limit limit, Visit visit)
+{
+    const DataSet *dataset = keys->dataset;
+    const uint64_t *index = dataset->typeIndex[keys->type].words;
+    const int64_t zoneWords = ZONE_SIZE / 64;
+    // The INT values of a sealed dataset are decoded a block at a time
+    int32_t values[INT_BLOCK_SIZE];
+    int64_t decoded = -1;
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        if (dataset->zones != NULL && (w == wordBegin || w % zoneWords == 0))
+        {
+            const Zone *zone = &dataset->zones[w / zoneWords];
+            if (zone->counts[keys->type] == 0 || (keys->type != STRING && zoneBestKey(keys, zone) >= limit()))
+            {
+                w = (w / zoneWords + 1) * zoneWords - 1;
+                continue;
+            }
+        }
+        uint64_t bits = index[w];
+        if (selection != NULL)
+        {
+            bits &= selection->words[w];
+        }
+        if (bits == 0)
+        {
+            continue;
+        }
+        if (keys->type == INT && dataset->encodedInts != NULL && w * 64 / INT_BLOCK_SIZE != decoded)
+        {
+            decoded = w * 64 / INT_BLOCK_SIZE;
+            decodeIntBlock(dataset->encodedInts, decoded, blockLength(dataset->size, decoded), values);
+        }
+        for (; bits != 0; bits &= bits - 1)
+        {
+            int64_t i = w * 64 + __builtin_ctzll(bits);
+            SortEntry entry = {slotKey(keys, i, decoded >= 0 ? values[i % INT_BLOCK_SIZE] : 0), i};
+            visit(entry);
+        }
+    }
+}
+
+// Count the slots of the sorted type in the words [wordBegin, wordEnd), restricted to a selection if not NULL
+int64_t countSortSlots(const SortKeys *keys, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd)
+{
+    const uint64_t *index = keys->dataset->typeIndex[keys->type].words;
+    int64_t count = 0;
+    for (int64_t w = wordBegin; w < wordEnd; w++)
+    {
+        count += __builtin_popcountll(selection != NULL ? index[w] & selection->words[w] : index[w]);
+    }
+    return count;
+}
+
+// Write the entries of the slots counted by countSortSlots to entries, returning how many
+int64_t collectSortEntries(const SortKeys *keys, const Bitmap *selection, int64_t wordBegin, int64_t wordEnd, SortEntry *entries)
+{
+    int64_t count = 0;
+    visitEntries(keys, selection, wordBegin, wordEnd, [] { return (uint64_t)UINT32_MAX + 1; },
+                 [&](const SortEntry &entry) { entries[count++] = entry; });
+    return count;
+}
+
+/*
+This function sorts entries by key with an LSD radix sort, moving them between entries
+and buffer once per key byte. A byte every key shares leaves the order unchanged, so its
+pass is skipped. Each pass is stable, so entries with equal keys keep their order.
+*/
+static void radixSort(SortEntry *entries, SortEntry *buffer, int64_t count)
+{
+    int64_t histograms[4][RADIX_BUCKETS] = {};
+    for (int64_t i = 0; i < count; i++)
+    {
+        uint32_t key = entries[i].key;
+        for (int pass = 0; pass < 4; pass++)
+        {
+            histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+    SortEntry *from = entries;
+    SortEntry *to = buffer;
+    for (int pass = 0; pass < 4; pass++)
+    {
+        int64_t *histogram = histograms[pass];
+        int shift = pass * RADIX_BITS;
+        if (histogram[(from[0].key >> shift) & (RADIX_BUCKETS - 1)] == count)
+        {
+            continue;
+        }
+        int64_t offset = 0;
+        for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+        {
+            int64_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (int64_t i = 0; i < count; i++)
+        {
+            to[histogram[(from[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != entries)
+    {
+        memcpy(entries, from, count * sizeof(SortEntry));
+    }
+}
+
+/*
+This function sorts entries collected in slot order, using buffer, which holds as many
+entries, as scratch space. Keys that order like the values are radix sorted; string
+prefixes are sorted by comparison.
+*/
+void sortEntries(const SortKeys *keys, SortEntry *entries, SortEntry *buffer, int64_t count)
+{
+    if (count < 2)
+    {
+        return;
+    }
+    if (keys->compareStrings)
+    {
+        std::sort(entries, entries + count, [&](const SortEntry &a, const SortEntry &b) { return entryLess(keys, a, b); });
+        return;
+    }
+    radixSort(entries, buffer, count);
+}
+
+/*
+This function writes the entries [outBegin, outEnd) of the merge of two sorted runs to
+out[outBegin, outEnd). The entries of the runs that come before outBegin are found by a
+binary search on the two runs, so the pieces of one merge can be written by different
+threads.
+*/
+void mergeEntries(const SortKeys *keys, const SortEntry *left, int64_t leftCount, const SortEntry *right, int64_t rightCount,
+                  SortEntry *out, int64_t outBegin, int64_t outEnd)
+{
+    int64_t low = outBegin > rightCount ? outBegin - rightCount : 0;
+    int64_t high = outBegin < leftCount ? outBegin : leftCount;
+    while (low < high)
+    {
+        int64_t i = (low + high) / 2;
+        if (entryLess(keys, left[i], right[outBegin - i - 1]))
+        {
+            low = i + 1;
+        }
+        else
+        {
+            high = i;
+        }
+    }
+    int64_t i = low;
+    int64_t j = outBegin - low;
+    for (int64_t k = outBegin; k < outEnd; k++)
+    {
+        if (j >= rightCount || (i < leftCount && entryLess(keys, left[i], right[j])))
+        {
+            out[k] = left[i++];
+        }
+        else
+        {
+            out[k] = right[j++];
+        }
+    }
+}
+
+/*
+This function sorts the data points of a type in a dataset, restricted to a selection if
+it is not NULL, and returns their slots in sort order, setting count to their number.
+Data points with equal values keep slot order. The caller frees the slots with free.
+It returns NULL if the dataset is NULL, the type or order is invalid, the selection does
+not match the dataset or memory runs out.
+*/
+int64_t *sortValues(DataSet *dataset, DataType type, const Bitmap *selection, SortOrder order, int64_t *count)
+{
+    ScopedStatTimer timer(STAT_TIMER_SORT);
+    if (!validSort(dataset, type, selection, order) || count == NULL)
+    {
+        return NULL;
+    }
+    SortKeys keys;
+    if (!prepareSortKeys(&keys, dataset, type, order))
+    {
+        return NULL;
+    }
+    int64_t words = bitmapWordCount(dataset->size);
+    int64_t total = countSortSlots(&keys, selection, 0, words);
+    size_t length = total > 0 ? (size_t)total : 1;
+    SortEntry *entries = (SortEntry *)malloc(length * sizeof(SortEntry));
+    SortEntry *buffer = (SortEntry *)malloc(length * sizeof(SortEntry));
+    int64_t *slots = (int64_t *)malloc(length * sizeof(int64_t));
+    if (entries == NULL || buffer == NULL || slots == NULL)
+    {
+        free(entries);
+        free(buffer);
+        free(slots);
+        releaseSortKeys(&keys);
+        return NULL;
+    }
+    collectSortEntries(&keys, selection, 0, words, entries);
+    sortEntries(&keys, entries, buffer, total);
+    for (int64_t i = 0; i < total; i++)
+    {
+        slots[i] = entries[i].slot;
+    }
+    free(entries);
+    free(buffer);
+    releaseSortKeys(&keys);
+    *count = total;
+    return slots;
+}
+
+/*
+This function returns the slots of the first k data points of a type in sort order,
+setting count to their number, which is less than k if fewer data points are selected:
+the k largest values for SORT_DESCENDING and the k smallest for SORT_ASCENDING. It keeps
+the best k entries found so far in a heap, and once the heap is full skips every zone
+whose bounds show it holds no better value. The caller frees the slots with free.
+It returns NULL if the arguments are invalid as for sortValues, k is negative or memory
+runs out.
+*/
+int64_t *topValues(DataSet *dataset, DataType type, const Bitmap *selection, SortOrder order, int64_t k, int64_t *count)
+{
+    ScopedStatTimer timer(STAT_TIMER_SORT);
+    if (!validSort(dataset, type, selection, order) || k < 0 || count == NULL)
+    {
+        return NULL;
+    }
+    SortKeys keys;
+    if (!prepareSortKeys(&keys, dataset, type, order))
+    {
+        return NULL;
+    }
+    int64_t words = bitmapWordCount(dataset->size);
+    if (k >= countSortSlots(&keys, selection, 0, words))
+    {
+        releaseSortKeys(&keys);
+        return sortValues(dataset, type, selection, order, count);
+    }
+    SortEntry *heap = (SortEntry *)malloc((k > 0 ? k : 1) * sizeof(SortEntry));
+    int64_t *slots = (int64_t *)malloc((k > 0 ? k : 1) * sizeof(int64_t));
+    if (heap == NULL || slots == NULL)
+    {
+        free(heap);
+        free(slots);
+        releaseSortKeys(&keys);
+        return NULL;
+    }
+    // A max-heap of the best entries, so its top is the one the next better entry replaces
+    auto less = [&](const SortEntry &a, const SortEntry &b) { return entryLess(&keys, a, b); };
+    int64_t size = 0;
+    visitEntries(
+        &keys, selection, 0, words,
+        [&] { return size == k && k > 0 ? (uint64_t)heap[0].key : (uint64_t)UINT32_MAX + 1; },
+        [&](const SortEntry &entry) {
+            if (size < k)
+            {
+                heap[size++] = entry;
+                std::push_heap(heap, heap + size, less);
+            }
+            else if (k > 0 && less(entry, heap[0]))
+            {
+                std::pop_heap(heap, heap + size, less);
+                heap[size - 1] = entry;
+                std::push_heap(heap, heap + size, less);
+            }
+        });
+    std::sort_heap(heap, heap + size, less);
+    for (int64_t i = 0; i < size; i++)
+    {
+        slots[i] = heap[i].slot;
+    }
+    free(heap);
+    releaseSortKeys(&keys);
+    *count = size;
+    return slots;
+}
@@ -0,0 +1,232 @@
+#include "stats.h"
+#include "internal.h"
+
+#include <stdarg.h>
+
+/*
+Statistics. The library counts what datasets cost as it runs: the blocks they allocate,
+the values written into them and the slots filters and aggregates read or skip through the
+zone maps, both across all datasets and per dataset. Operations can also be timed, which
+costs two clock reads per call and is turned off until setStatTimers turns it on. The
+memory a dataset holds is not counted as it changes but worked out from its capacities
+when asked for. Built with BITMAP_NO_STATS, nothing is counted or timed.
+*/
+
+#ifndef BITMAP_NO_STATS
+std::atomic<uint64_t> statCounters[STAT_COUNTER_COUNT];
+std::atomic<uint64_t> statTimerCalls[STAT_TIMER_COUNT];
+std::atomic<uint64_t> statTimerNanoseconds[STAT_TIMER_COUNT];
+std::atomic<bool> statTimersEnabled(false);
+thread_local int statTimerDepth = 0; // timers running on the thread
+#endif
+
+// Names of the counters and timers in JSON, in enum order
+static const char *const COUNTER_NAMES[STAT_COUNTER_COUNT] = {
+    "data_points_created", "data_point_allocations", "block_allocations", "block_bytes",
+    "block_releases", "values_stored", "rows_scanned", "rows_skipped",
+};
+static const char *const TIMER_NAMES[STAT_TIMER_COUNT] = {
+    "filter_by_type", "filter_values", "aggregate", "sort", "group_by", "join",
+};
+
+// Room for the JSON of every counter and timer and a dataset, whose names are fixed
+#define STATS_JSON_SIZE 4096
+
+// Get a global counter; it returns 0 for an invalid counter
+uint64_t getStatCounter(StatCounter counter)
+{
+#ifndef BITMAP_NO_STATS
+    if (counter >= 0 && counter < STAT_COUNTER_COUNT)
+    {
+        return statCounters[counter].load(std::memory_order_relaxed);
+    }
+#else
+    (void)counter;
+#endif
+    return 0;
+}
+
+/*
+This function reads the number of timed calls of an operation and the nanoseconds they took,
+counting only the calls made while timing was turned on.
+It returns false if the timer is invalid or either output is NULL.
+*/
+bool getStatTimer(StatTimer timer, uint64_t *calls, uint64_t *nanoseconds)
+{
+    if (timer < 0 || timer >= STAT_TIMER_COUNT || calls == NULL || nanoseconds == NULL)
+    {
+        return false;
+    }
+#ifndef BITMAP_NO_STATS
+    *calls = statTimerCalls[timer].load(std::memory_order_relaxed);
+    *nanoseconds = statTimerNanoseconds[timer].load(std::memory_order_relaxed);
+#else
+    *calls = 0;
+    *nanoseconds = 0;
+#endif
+    return true;
+}
+
+// Turn the timing of operations on or off; calls already running keep their setting
+void setStatTimers(bool enabled)
+{
+#ifndef BITMAP_NO_STATS
+    statTimersEnabled.store(enabled, std::memory_order_relaxed);
+#else
+    (void)enabled;
+#endif
+}
+
+// Set the global counters and timers back to 0; the counters of datasets are kept
+void resetStats(void)
+{
+#ifndef BITMAP_NO_STATS
+    for (int c = 0; c < STAT_COUNTER_COUNT; c++)
+    {
+        statCounters[c].store(0, std::memory_order_relaxed);
+    }
+    for (int t = 0; t < STAT_TIMER_COUNT; t++)
+    {
+        statTimerCalls[t].store(0, std::memory_order_relaxed);
+        statTimerNanoseconds[t].store(0, std::memory_order_relaxed);
+    }
+#endif
+}
+
+/*
+This function copies the counters of a dataset. Each counter is read atomically, so it can
+be called while other threads scan the dataset. It returns false if either argument is NULL.
+*/
+bool getDataSetStats(const DataSet *dataset, DataSetStats *stats)
+{
+    if (dataset == NULL || stats == NULL)
+    {
+        return false;
+    }
+    stats->valuesStored = __atomic_load_n(&dataset->stats.valuesStored, __ATOMIC_RELAXED);
+    stats->resizes = __atomic_load_n(&dataset->stats.resizes, __ATOMIC_RELAXED);
+    stats->rowsScanned = __atomic_load_n(&dataset->stats.rowsScanned, __ATOMIC_RELAXED);
+    stats->rowsSkipped = __atomic_load_n(&dataset->stats.rowsSkipped, __ATOMIC_RELAXED);
+    return true;
+}
+
+// Bytes of a block of count elements of a given width, or 0 if the block is not allocated
+static inline size_t blockBytes(const void *block, size_t count, size_t width)
+{
+    return block != NULL ? count * width : 0;
+}
+
+/*
+This function counts the bytes allocated for a dataset, split into the bytes that hold its
+values and the metadata around them. Arrays are counted at their capacity, as allocated,
+so the difference from the size shows the room kept for growth. A mapped dataset counts its
+whole file mapping as values. It returns false if either argument is NULL.
+*/
+bool getDataSetMemory(const DataSet *dataset, DataSetMemory *memory)
+{
+    if (dataset == NULL || memory == NULL)
+    {
+        return false;
+    }
+    size_t capacity = (size_t)dataset->capacity;
+    size_t metadata = sizeof(DataSet) + blockBytes(dataset->data, capacity, sizeof(DataPoint));
+    if (dataset->mapping != NULL)
+    {
+        memory->valueBytes = dataset->mappingLength;
+        memory->metadataBytes = metadata + blockBytes(dataset->dictionary, 1, sizeof(StringDictionary));
+        return true;
+    }
+
+    size_t values = blockBytes(dataset->ints, capacity, sizeof(int32_t)) +
+                    blockBytes(dataset->floats, capacity, sizeof(float)) + dataset->strings.capacity;
+    metadata += blockBytes(dataset->types, capacity, sizeof(uint8_t)) +
+                blockBytes(dataset->strings.offsets, capacity, sizeof(uint64_t)) +
+                blockBytes(dataset->strings.lengths, capacity, sizeof(uint32_t));
+    const EncodedInts *column = dataset->encodedInts;
+    if (column != NULL)
+    {
+        values += column->length;
+        metadata += sizeof(EncodedInts) + (size_t)column->blockCount * sizeof(IntBlock) +
+                    blockBytes(column->decoded, capacity, sizeof(int32_t));
+    }
+    const StringDictionary *dictionary = dataset->dictionary;
+    if (dictionary != NULL)
+    {
+        values += blockBytes(dictionary->codes, capacity, (size_t)dictionary->codeWidth);
+        metadata += sizeof(StringDictionary) +
+                    (size_t)dictionary->capacity * (sizeof(uint64_t) + 2 * sizeof(uint32_t)) +
+                    (size_t)dictionary->tableSize * sizeof(uint32_t);
+    }
+
+    // The bitmaps and zone maps have at least one word and one zone
+    size_t words = (size_t)bitmapWordCount(dataset->capacity > 0 ? dataset->capacity : 1);
+    metadata += blockBytes(dataset->present.words, words, sizeof(uint64_t));
+    for (int t = 0; t < DATA_TYPE_COUNT; t++)
+    {
+        metadata += blockBytes(dataset->typeIndex[t].words, words, sizeof(uint64_t));
+    }
+    size_t zones = (capacity + ZONE_SIZE - 1) / ZONE_SIZE;
+    metadata += blockBytes(dataset->zones, zones > 0 ? zones : 1, sizeof(Zone));
+
+    memory->valueBytes = values;
+    memory->metadataBytes = metadata;
+    return true;
+}
+
+// Append formatted text to a JSON buffer, keeping track of the length written
+static void appendJson(char *json, size_t *length, const char *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    int written = vsnprintf(json + *length, STATS_JSON_SIZE - *length, format, arguments);
+    va_end(arguments);
+    if (written > 0)
+    {
+        *length += (size_t)written < STATS_JSON_SIZE - *length ? (size_t)written : STATS_JSON_SIZE - *length - 1;
+    }
+}
+
+/*
+This function writes the global counters and timers as one JSON object, with a "counters"
+object of every counter and a "timers" object of the calls and nanoseconds of every timer.
+Unless the dataset is NULL, a "dataset" object adds its size, capacity, memory and counters.
+It returns a NUL-terminated string, which the caller frees with free, or NULL if memory runs out.
+*/
+char *statsToJson(const DataSet *dataset)
+{
+    char *json = (char *)malloc(STATS_JSON_SIZE);
+    if (json == NULL)
+    {
+        return NULL;
+    }
+    size_t length = 0;
+    appendJson(json, &length, "{\"counters\":{");
+    for (int c = 0; c < STAT_COUNTER_COUNT; c++)
+    {
+        appendJson(json, &length, "%s\"%s\":%llu", c > 0 ? "," : "", COUNTER_NAMES[c],
+                   (unsigned long long)getStatCounter((StatCounter)c));
+    }
+    appendJson(json, &length, "},\"timers\":{");
+    for (int t = 0; t < STAT_TIMER_COUNT; t++)
+    {
+        uint64_t calls, nanoseconds;
+        getStatTimer((StatTimer)t, &calls, &nanoseconds);
+        appendJson(json, &length, "%s\"%s\":{\"calls\":%llu,\"ns\":%llu}", t > 0 ? "," : "", TIMER_NAMES[t],
+                   (unsigned long long)calls, (unsigned long long)nanoseconds);
+    }
+    appendJson(json, &length, "}");
+    DataSetStats stats;
+    DataSetMemory memory;
+    if (getDataSetStats(dataset, &stats) && getDataSetMemory(dataset, &memory))
+    {
+        appendJson(json, &length,
+                   ",\"dataset\":{\"size\":%lld,\"capacity\":%lld,\"value_bytes\":%llu,\"metadata_bytes\":%llu,"
+                   "\"values_stored\":%llu,\"resizes\":%llu,\"rows_scanned\":%llu,\"rows_skipped\":%llu}",
+                   (long long)dataset->size, (long long)dataset->capacity, (unsigned long long)memory.valueBytes,
+                   (unsigned long long)memory.metadataBytes, (unsigned long long)stats.valuesStored,
+                   (unsigned long long)stats.resizes, (unsigned long long)stats.rowsScanned,
+                   (unsigned long long)stats.rowsSkipped);
+    }
+    appendJson(json, &length, "}");
+    return json;
+}
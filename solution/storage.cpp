@@ -0,0 +1,410 @@
+#include "storage.h"
+#include "internal.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+Dataset file format. A file starts with a fixed header followed by one section per array
+of the dataset, each starting on a 64-byte boundary so it can be used in place once the
+file is mapped. The header records the format version, the byte order the file was written
+in, the dataset size and the offset and length of every section; a column the dataset never
+allocated is an empty section. Opening a file maps it read-only and points the columns and
+bitmaps of a new dataset straight into the mapping, so no data is read or copied up front
+and every process mapping the same file shares its pages through the page cache.
+*/
+
+#define FILE_ALIGNMENT 64
+#define FILE_BYTE_ORDER 0x01020304u
+#define FILE_DICTIONARY 1u
+
+static const char fileMagic[8] = {'B', 'D', 'A', 'M', 'S', 'E', 'T', '\0'};
+
+// Define enums for the sections of a dataset file
+typedef enum
+{
+    SECTION_TYPES,
+    SECTION_PRESENT,
+    SECTION_INT_INDEX,
+    SECTION_FLOAT_INDEX,
+    SECTION_STRING_INDEX,
+    SECTION_INTS,
+    SECTION_FLOATS,
+    SECTION_STRING_OFFSETS,
+    SECTION_STRING_LENGTHS,
+    SECTION_ARENA,
+    SECTION_DICTIONARY_OFFSETS,
+    SECTION_DICTIONARY_LENGTHS,
+    SECTION_DICTIONARY_HASHES,
+    SECTION_DICTIONARY_TABLE,
+    SECTION_DICTIONARY_CODES,
+    SECTION_COUNT,
+} Section;
+
+// Define a struct for the header of a dataset file
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t flags;
+    int32_t codeWidth;       // dictionary code width
+    int64_t size;            // number of slots
+    int64_t dictionaryCount; // number of distinct strings
+    int64_t tableSize;       // entries in the dictionary hash table
+    uint64_t sections[SECTION_COUNT][2]; // offset and length of each section
+} FileHeader;
+
+// Round an offset up to the next section boundary
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + FILE_ALIGNMENT - 1) / FILE_ALIGNMENT * FILE_ALIGNMENT;
+}
+
+/*
+This function writes a dataset to a file, replacing the file if it exists. It lays out
+every section in the header first and then writes the header and the sections in one
+sequential pass, padding each section to its boundary.
+It returns false if the dataset or path is NULL, the dataset is sealed, whose INT column
+the file format has no section for, or the file cannot be written.
+*/
+bool writeDataSet(DataSet *dataset, const char *path)
+{
+    if (dataset == NULL || path == NULL || dataset->encodedInts != NULL)
+    {
+        return false;
+    }
+    const StringDictionary *dictionary = dataset->dictionary;
+    size_t size = (size_t)dataset->size;
+    size_t bitmapBytes = (size_t)bitmapWordCount(dataset->size) * sizeof(uint64_t);
+    const void *data[SECTION_COUNT] = {
+        dataset->types,
+        dataset->present.words,
+        dataset->typeIndex[INT].words,
+        dataset->typeIndex[FLOAT].words,
+        dataset->typeIndex[STRING].words,
+        dataset->ints,
+        dataset->floats,
+        dataset->strings.offsets,
+        dataset->strings.lengths,
+        dataset->strings.bytes,
+        dictionary != NULL ? dictionary->offsets : NULL,
+        dictionary != NULL ? dictionary->lengths : NULL,
+        dictionary != NULL ? dictionary->hashes : NULL,
+        dictionary != NULL ? dictionary->table : NULL,
+        dictionary != NULL ? dictionary->codes : NULL,
+    };
+    size_t count = dictionary != NULL ? (size_t)dictionary->count : 0;
+    size_t lengths[SECTION_COUNT] = {
+        size,
+        bitmapBytes,
+        bitmapBytes,
+        bitmapBytes,
+        bitmapBytes,
+        size * sizeof(int32_t),
+        size * sizeof(float),
+        size * sizeof(uint64_t),
+        size * sizeof(uint32_t),
+        dataset->strings.length,
+        count * sizeof(uint64_t),
+        count * sizeof(uint32_t),
+        count * sizeof(uint32_t),
+        dictionary != NULL ? (size_t)dictionary->tableSize * sizeof(uint32_t) : 0,
+        dictionary != NULL ? size * dictionary->codeWidth : 0,
+    };
+
+    // Lay out the sections
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = DATASET_FILE_VERSION;
+    header.byteOrder = FILE_BYTE_ORDER;
+    header.flags = dictionary != NULL ? FILE_DICTIONARY : 0;
+    header.codeWidth = dictionary != NULL ? dictionary->codeWidth : 0;
+    header.size = dataset->size;
+    header.dictionaryCount = (int64_t)count;
+    header.tableSize = dictionary != NULL ? dictionary->tableSize : 0;
+    uint64_t offset = alignOffset(sizeof(header));
+    for (int s = 0; s < SECTION_COUNT; s++)
+    {
+        uint64_t length = data[s] != NULL ? lengths[s] : 0;
+        header.sections[s][0] = offset;
+        header.sections[s][1] = length;
+        offset = alignOffset(offset + length);
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    static const char padding[FILE_ALIGNMENT] = {0};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    uint64_t written = sizeof(header);
+    for (int s = 0; s < SECTION_COUNT && ok; s++)
+    {
+        uint64_t pad = header.sections[s][0] - written;
+        ok = fwrite(padding, 1, pad, file) == pad;
+        if (ok && header.sections[s][1] > 0)
+        {
+            ok = fwrite(data[s], 1, header.sections[s][1], file) == header.sections[s][1];
+        }
+        written = header.sections[s][0] + header.sections[s][1];
+    }
+    if (fclose(file) != 0)
+    {
+        ok = false;
+    }
+    if (!ok)
+    {
+        remove(path);
+    }
+    return ok;
+}
+
+// Check that a section fits in the file and holds either nothing or exactly length bytes
+static bool validSection(const FileHeader *header, size_t fileLength, int s, uint64_t length, bool optional)
+{
+    uint64_t offset = header->sections[s][0];
+    uint64_t actual = header->sections[s][1];
+    if (offset % FILE_ALIGNMENT != 0 || offset > fileLength || actual > fileLength - offset)
+    {
+        return false;
+    }
+    return actual == length || (optional && actual == 0);
+}
+
+// Get a pointer to a section of the mapping, or NULL if the section is empty
+static void *sectionData(const DataSet *dataset, const FileHeader *header, int s)
+{
+    return header->sections[s][1] > 0 ? (char *)dataset->mapping + header->sections[s][0] : NULL;
+}
+
+// Check that the bitmaps, type tags, string offsets and dictionary of a mapped dataset agree,
+// so that no read through the dataset can leave the mapping
+static bool validContents(const DataSet *dataset)
+{
+    const StringDictionary *dictionary = dataset->dictionary;
+    int64_t words = bitmapWordCount(dataset->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        uint64_t ints = dataset->typeIndex[INT].words[w];
+        uint64_t floats = dataset->typeIndex[FLOAT].words[w];
+        uint64_t strings = dataset->typeIndex[STRING].words[w];
+        uint64_t present = dataset->present.words[w];
+        if ((ints & floats) != 0 || (ints & strings) != 0 || (floats & strings) != 0 ||
+            (ints | floats | strings) != present || (present & ~rangeMask(w, 0, dataset->size)) != 0)
+        {
+            return false;
+        }
+        // A type with a value needs its column
+        if ((ints != 0 && dataset->ints == NULL) || (floats != 0 && dataset->floats == NULL) ||
+            (strings != 0 && dictionary == NULL && (dataset->strings.offsets == NULL || dataset->strings.lengths == NULL)))
+        {
+            return false;
+        }
+    }
+    size_t arenaLength = dataset->strings.length;
+    for (int64_t i = 0; i < dataset->size; i++)
+    {
+        if (!testBit(&dataset->present, i))
+        {
+            continue;
+        }
+        uint8_t type = dataset->types[i];
+        if (type >= DATA_TYPE_COUNT || !testBit(&dataset->typeIndex[type], i))
+        {
+            return false;
+        }
+        if (type == STRING && dictionary != NULL && codeAt(dictionary, i) >= (uint32_t)dictionary->count)
+        {
+            return false;
+        }
+        if (type == STRING && dictionary == NULL)
+        {
+            uint64_t offset = dataset->strings.offsets[i];
+            uint32_t length = dataset->strings.lengths[i];
+            if (offset >= arenaLength || length >= arenaLength - offset || dataset->strings.bytes[offset + length] != '\0')
+            {
+                return false;
+            }
+        }
+    }
+    if (dictionary == NULL)
+    {
+        return true;
+    }
+
+    // Every string of the dictionary is in the arena, and its hash table has an empty entry to stop lookups
+    if (dictionary->count > 0 && (dictionary->offsets == NULL || dictionary->lengths == NULL || dictionary->hashes == NULL))
+    {
+        return false;
+    }
+    for (int c = 0; c < dictionary->count; c++)
+    {
+        uint64_t offset = dictionary->offsets[c];
+        uint32_t length = dictionary->lengths[c];
+        if (offset >= arenaLength || length >= arenaLength - offset || dataset->strings.bytes[offset + length] != '\0')
+        {
+            return false;
+        }
+    }
+    int entries = 0;
+    for (int slot = 0; slot < dictionary->tableSize; slot++)
+    {
+        uint32_t entry = dictionary->table[slot];
+        if (entry > (uint32_t)dictionary->count)
+        {
+            return false;
+        }
+        entries += entry != 0;
+    }
+    return entries <= dictionary->count;
+}
+
+/*
+This function opens a dataset file written by writeDataSet. It maps the file read-only
+and checks the header and the bounds and lengths of every section, then points the
+columns, bitmaps and dictionary of a new dataset into the mapping. Only the dataset
+struct and its dictionary struct are allocated; the data point view is left to the first
+getDataPoint, like that of any other dataset.
+Before the dataset is returned its contents are checked once: the bitmaps must agree with
+the type tags, every value must have its column, and every string offset and dictionary
+code must stay within the file. This reads the bitmaps, tags and string columns, but not
+the INT and FLOAT values.
+The dataset cannot be changed; addDataPoint ignores it. freeDataSet unmaps the file.
+It returns NULL if the path is NULL, the file cannot be mapped, it is not a valid dataset
+file of this version and byte order, or memory runs out.
+*/
+DataSet *mapDataSet(const char *path)
+{
+    if (path == NULL)
+    {
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(FileHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t fileLength = (size_t)status.st_size;
+    void *mapping = mmap(NULL, fileLength, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    // Check the header and the sections
+    const FileHeader *header = (const FileHeader *)mapping;
+    bool ok = memcmp(header->magic, fileMagic, sizeof(fileMagic)) == 0 && header->version == DATASET_FILE_VERSION &&
+              header->byteOrder == FILE_BYTE_ORDER && header->size >= 0 && header->size <= INT64_MAX / 8;
+    bool dictionary = ok && (header->flags & FILE_DICTIONARY) != 0;
+    if (ok)
+    {
+        uint64_t size = (uint64_t)header->size;
+        uint64_t bitmapBytes = (uint64_t)bitmapWordCount((int64_t)size) * sizeof(uint64_t);
+        uint64_t count = (uint64_t)header->dictionaryCount;
+        uint64_t tableSize = (uint64_t)header->tableSize;
+        ok = validSection(header, fileLength, SECTION_TYPES, size, false) &&
+             validSection(header, fileLength, SECTION_PRESENT, bitmapBytes, false) &&
+             validSection(header, fileLength, SECTION_INT_INDEX, bitmapBytes, false) &&
+             validSection(header, fileLength, SECTION_FLOAT_INDEX, bitmapBytes, false) &&
+             validSection(header, fileLength, SECTION_STRING_INDEX, bitmapBytes, false) &&
+             validSection(header, fileLength, SECTION_INTS, size * sizeof(int32_t), true) &&
+             validSection(header, fileLength, SECTION_FLOATS, size * sizeof(float), true) &&
+             validSection(header, fileLength, SECTION_STRING_OFFSETS, size * sizeof(uint64_t), true) &&
+             validSection(header, fileLength, SECTION_STRING_LENGTHS, size * sizeof(uint32_t), true) &&
+             validSection(header, fileLength, SECTION_ARENA, header->sections[SECTION_ARENA][1], true);
+        if (ok && dictionary)
+        {
+            ok = (header->codeWidth == 1 || header->codeWidth == 2 || header->codeWidth == 4) &&
+                 tableSize > count && (tableSize & (tableSize - 1)) == 0 && tableSize <= INT32_MAX &&
+                 validSection(header, fileLength, SECTION_DICTIONARY_OFFSETS, count * sizeof(uint64_t), true) &&
+                 validSection(header, fileLength, SECTION_DICTIONARY_LENGTHS, count * sizeof(uint32_t), true) &&
+                 validSection(header, fileLength, SECTION_DICTIONARY_HASHES, count * sizeof(uint32_t), true) &&
+                 validSection(header, fileLength, SECTION_DICTIONARY_TABLE, tableSize * sizeof(uint32_t), false) &&
+                 validSection(header, fileLength, SECTION_DICTIONARY_CODES, size * header->codeWidth, false);
+        }
+    }
+    if (!ok)
+    {
+        munmap(mapping, fileLength);
+        return NULL;
+    }
+
+    DataSet *dataset = (DataSet *)calloc(1, sizeof(DataSet));
+    if (dataset == NULL)
+    {
+        munmap(mapping, fileLength);
+        return NULL;
+    }
+    dataset->mapping = mapping;
+    dataset->mappingLength = fileLength;
+    dataset->size = header->size;
+    dataset->capacity = header->size;
+    if (dictionary)
+    {
+        dataset->dictionary = (StringDictionary *)calloc(1, sizeof(StringDictionary));
+    }
+    if (dictionary && dataset->dictionary == NULL)
+    {
+        freeDataSet(dataset);
+        return NULL;
+    }
+
+    // Point the columns and bitmaps into the mapping
+    dataset->types = (uint8_t *)sectionData(dataset, header, SECTION_TYPES);
+    dataset->present.words = (uint64_t *)sectionData(dataset, header, SECTION_PRESENT);
+    dataset->typeIndex[INT].words = (uint64_t *)sectionData(dataset, header, SECTION_INT_INDEX);
+    dataset->typeIndex[FLOAT].words = (uint64_t *)sectionData(dataset, header, SECTION_FLOAT_INDEX);
+    dataset->typeIndex[STRING].words = (uint64_t *)sectionData(dataset, header, SECTION_STRING_INDEX);
+    dataset->present.size = dataset->size;
+    for (int t = 0; t < DATA_TYPE_COUNT; t++)
+    {
+        dataset->typeIndex[t].size = dataset->size;
+    }
+    dataset->ints = (int32_t *)sectionData(dataset, header, SECTION_INTS);
+    dataset->floats = (float *)sectionData(dataset, header, SECTION_FLOATS);
+    dataset->strings.offsets = (uint64_t *)sectionData(dataset, header, SECTION_STRING_OFFSETS);
+    dataset->strings.lengths = (uint32_t *)sectionData(dataset, header, SECTION_STRING_LENGTHS);
+    dataset->strings.bytes = (char *)sectionData(dataset, header, SECTION_ARENA);
+    dataset->strings.length = header->sections[SECTION_ARENA][1];
+    dataset->strings.capacity = dataset->strings.length;
+    if (dictionary)
+    {
+        StringDictionary *strings = dataset->dictionary;
+        strings->offsets = (uint64_t *)sectionData(dataset, header, SECTION_DICTIONARY_OFFSETS);
+        strings->lengths = (uint32_t *)sectionData(dataset, header, SECTION_DICTIONARY_LENGTHS);
+        strings->hashes = (uint32_t *)sectionData(dataset, header, SECTION_DICTIONARY_HASHES);
+        strings->table = (uint32_t *)sectionData(dataset, header, SECTION_DICTIONARY_TABLE);
+        strings->codes = sectionData(dataset, header, SECTION_DICTIONARY_CODES);
+        strings->count = (int)header->dictionaryCount;
+        strings->capacity = strings->count;
+        strings->tableSize = (int)header->tableSize;
+        strings->codeWidth = header->codeWidth;
+    }
+    if (!validContents(dataset))
+    {
+        freeDataSet(dataset);
+        return NULL;
+    }
+    return dataset;
+}
+
+/*
+This function unmaps the file a dataset opened with mapDataSet is read from.
+*/
+void releaseMapping(DataSet *dataset)
+{
+    munmap(dataset->mapping, dataset->mappingLength);
+    dataset->mapping = NULL;
+}
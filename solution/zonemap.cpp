@@ -0,0 +1,303 @@
+#include "zonemap.h"
+#include "internal.h"
+
+#include <math.h>
+
+/*
+Zone maps. The slots of a dataset are split into zones of ZONE_SIZE slots, and each zone
+keeps the number of values of each type, the bounds of its INT and FLOAT values and a bloom
+filter of its STRING values. Every write updates the zone of the slot it writes, so the
+maps never need a separate pass; emptying a slot only lowers the counts, and the bounds of
+a type are reset once its count drops to 0. Filters and aggregates consult the zone of a
+range before its words and skip a zone that cannot hold a match.
+*/
+
+// Number of zones covering a number of slots
+static inline int64_t zonesFor(int64_t slots)
+{
+    return (slots + ZONE_SIZE - 1) / ZONE_SIZE;
+}
+
+// Reset the bounds of a type in a zone, or its bloom filter for STRING
+static void resetBounds(Zone *zone, DataType type)
+{
+    switch (type)
+    {
+    case INT:
+        zone->intMin = INT32_MAX;
+        zone->intMax = INT32_MIN;
+        break;
+    case FLOAT:
+        zone->floatMin = INFINITY;
+        zone->floatMax = -INFINITY;
+        zone->floatNaN = false;
+        break;
+    default:
+        memset(zone->bloom, 0, sizeof(zone->bloom));
+        break;
+    }
+}
+
+// Empty the zones [begin, end)
+static void resetZones(Zone *zones, int64_t begin, int64_t end)
+{
+    for (int64_t z = begin; z < end; z++)
+    {
+        memset(zones[z].counts, 0, sizeof(zones[z].counts));
+        for (int t = 0; t < DATA_TYPE_COUNT; t++)
+        {
+            resetBounds(&zones[z], (DataType)t);
+        }
+    }
+}
+
+/*
+This function allocates the zone maps of a dataset with room for capacity slots, all empty.
+It returns NULL if memory runs out.
+*/
+Zone *allocateZones(Allocator *allocator, int64_t capacity)
+{
+    int64_t count = zonesFor(capacity) > 0 ? zonesFor(capacity) : 1;
+    Zone *zones = (Zone *)allocateBlock(allocator, (size_t)count * sizeof(Zone));
+    if (zones != NULL)
+    {
+        resetZones(zones, 0, count);
+    }
+    return zones;
+}
+
+/*
+This function resizes the zone maps of a dataset from its capacity to a new capacity,
+emptying any zone added. It returns false if memory runs out, leaving the maps unchanged.
+*/
+bool resizeZones(DataSet *dataset, int64_t capacity)
+{
+    if (dataset->zones == NULL)
+    {
+        return true;
+    }
+    int64_t count = zonesFor(dataset->capacity) > 0 ? zonesFor(dataset->capacity) : 1;
+    int64_t resized = zonesFor(capacity) > 0 ? zonesFor(capacity) : 1;
+    if (resized == count)
+    {
+        return true;
+    }
+    Zone *zones = (Zone *)resizeBlock(dataset->allocator, dataset->zones, (size_t)count * sizeof(Zone), (size_t)resized * sizeof(Zone));
+    if (zones == NULL)
+    {
+        return false;
+    }
+    if (resized > count)
+    {
+        resetZones(zones, count, resized);
+    }
+    dataset->zones = zones;
+    return true;
+}
+
+// Free the zone maps of a dataset
+void releaseZones(DataSet *dataset)
+{
+    int64_t count = zonesFor(dataset->capacity) > 0 ? zonesFor(dataset->capacity) : 1;
+    releaseBlock(dataset->allocator, dataset->zones, (size_t)count * sizeof(Zone));
+    dataset->zones = NULL;
+}
+
+// Get the hash of the STRING value of a slot, the dictionary's if the dataset has one
+static inline uint32_t slotHash(const DataSet *dataset, int64_t index)
+{
+    if (dataset->dictionary != NULL)
+    {
+        return dataset->dictionary->hashes[codeAt(dataset->dictionary, index)];
+    }
+    size_t length;
+    const char *value = stringAt(dataset, index, &length);
+    return hashString(value, length);
+}
+
+// Widen the bounds of a zone, or fill its bloom filter, with the value held by a slot
+static inline void widenZone(const DataSet *dataset, Zone *zone, int64_t index, DataType type)
+{
+    switch (type)
+    {
+    case INT:
+    {
+        int32_t value = dataset->ints[index];
+        zone->intMin = value < zone->intMin ? value : zone->intMin;
+        zone->intMax = value > zone->intMax ? value : zone->intMax;
+        break;
+    }
+    case FLOAT:
+    {
+        float value = dataset->floats[index];
+        if (value != value)
+        {
+            zone->floatNaN = true;
+            break;
+        }
+        zone->floatMin = value < zone->floatMin ? value : zone->floatMin;
+        zone->floatMax = value > zone->floatMax ? value : zone->floatMax;
+        break;
+    }
+    default:
+        addToBloom(zone, slotHash(dataset, index));
+        break;
+    }
+}
+
+/*
+This function records in its zone that slot index now holds a value of a type, which is
+already stored in its column. It is called before the slot's bits are set.
+*/
+void noteSlotStored(DataSet *dataset, int64_t index, DataType type)
+{
+    if (dataset->zones == NULL)
+    {
+        return;
+    }
+    Zone *zone = &dataset->zones[index / ZONE_SIZE];
+    zone->counts[type]++;
+    widenZone(dataset, zone, index, type);
+}
+
+/*
+This function records in its zone that slot index is being emptied. It is called before
+the slot's bits are cleared and does nothing for an empty slot.
+*/
+void noteSlotCleared(DataSet *dataset, int64_t index)
+{
+    if (dataset->zones == NULL || !testBit(&dataset->present, index))
+    {
+        return;
+    }
+    Zone *zone = &dataset->zones[index / ZONE_SIZE];
+    DataType type = (DataType)dataset->types[index];
+    if (--zone->counts[type] == 0)
+    {
+        resetBounds(zone, type);
+    }
+}
+
+/*
+This function records that the slots [begin, end), whose values of a type are already
+stored in its column, now hold that type. It is called before their bits are set; the
+slots either were empty or held the same type, so only the empty ones add to the counts.
+*/
+void noteRangeStored(DataSet *dataset, int64_t begin, int64_t end, DataType type)
+{
+    if (dataset->zones == NULL)
+    {
+        return;
+    }
+    for (int64_t z = begin / ZONE_SIZE; z * ZONE_SIZE < end; z++)
+    {
+        Zone *zone = &dataset->zones[z];
+        int64_t first = z * ZONE_SIZE > begin ? z * ZONE_SIZE : begin;
+        int64_t last = (z + 1) * ZONE_SIZE < end ? (z + 1) * ZONE_SIZE : end;
+        for (int64_t w = first / 64; w < bitmapWordCount(last); w++)
+        {
+            zone->counts[type] += __builtin_popcountll(rangeMask(w, first, last) & ~dataset->present.words[w]);
+        }
+        if (type == INT)
+        {
+            // A plain loop over the column the compiler vectorizes
+            int32_t min = zone->intMin;
+            int32_t max = zone->intMax;
+            for (int64_t i = first; i < last; i++)
+            {
+                int32_t value = dataset->ints[i];
+                min = value < min ? value : min;
+                max = value > max ? value : max;
+            }
+            zone->intMin = min;
+            zone->intMax = max;
+            continue;
+        }
+        for (int64_t i = first; i < last; i++)
+        {
+            widenZone(dataset, zone, i, type);
+        }
+    }
+}
+
+/*
+This function records that the slots [begin, end) are being emptied, lowering the counts
+of their zones by the values of each type they hold. It is called before their bits are
+cleared.
+*/
+void noteRangeCleared(DataSet *dataset, int64_t begin, int64_t end)
+{
+    if (dataset->zones == NULL)
+    {
+        return;
+    }
+    for (int64_t w = begin / 64; w < bitmapWordCount(end); w++)
+    {
+        Zone *zone = &dataset->zones[w * 64 / ZONE_SIZE];
+        uint64_t mask = rangeMask(w, begin, end);
+        for (int t = 0; t < DATA_TYPE_COUNT; t++)
+        {
+            int held = __builtin_popcountll(dataset->typeIndex[t].words[w] & mask);
+            if (held > 0 && (zone->counts[t] -= held) == 0)
+            {
+                resetBounds(zone, (DataType)t);
+            }
+        }
+    }
+}
+
+/*
+This function gets the number of zones covering the slots of a dataset; zone z covers
+the slots [z * ZONE_SIZE, (z + 1) * ZONE_SIZE). It returns 0 if the dataset is NULL or
+has no zone maps, as a mapped dataset does.
+*/
+int64_t countZones(DataSet *dataset)
+{
+    if (dataset == NULL || dataset->zones == NULL)
+    {
+        return 0;
+    }
+    return zonesFor(dataset->size);
+}
+
+/*
+This function counts the empty slots of a zone of a dataset from the counts of its zone
+map, without looking at the slots. It returns -1 if the dataset is NULL, has no zone maps
+or the zone is out of range.
+*/
+int64_t countZoneNulls(DataSet *dataset, int64_t zone)
+{
+    if (zone < 0 || zone >= countZones(dataset))
+    {
+        return -1;
+    }
+    int64_t slots = dataset->size - zone * ZONE_SIZE < ZONE_SIZE ? dataset->size - zone * ZONE_SIZE : ZONE_SIZE;
+    for (int t = 0; t < DATA_TYPE_COUNT; t++)
+    {
+        slots -= dataset->zones[zone].counts[t];
+    }
+    return slots;
+}
+
+/*
+This function recomputes the zone maps of a dataset from the values it holds, tightening
+bounds left wide by slots that were emptied or overwritten.
+It returns false if the dataset is NULL or read-only.
+*/
+bool rebuildZoneMaps(DataSet *dataset)
+{
+    if (dataset == NULL || readOnly(dataset) || dataset->zones == NULL)
+    {
+        return false;
+    }
+    resetZones(dataset->zones, 0, zonesFor(dataset->size));
+    int64_t words = bitmapWordCount(dataset->size);
+    for (int64_t w = 0; w < words; w++)
+    {
+        for (uint64_t bits = dataset->present.words[w]; bits != 0; bits &= bits - 1)
+        {
+            noteSlotStored(dataset, w * 64 + __builtin_ctzll(bits), (DataType)dataset->types[w * 64 + __builtin_ctzll(bits)]);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include "bitmap.h"
+
+// Define a struct for the aggregates of the INT or FLOAT values of a dataset
+typedef struct
+{
+    int64_t count;  // COUNT of the values aggregated
+    int64_t intSum; // exact SUM of INT values, 0 for FLOAT values
+    double sum;     // SUM of the values
+    double min;     // MIN of the values, 0 when count is 0
+    double max;     // MAX of the values, 0 when count is 0
+    double avg;     // AVG of the values, 0 when count is 0
+} AggregateResult;
+
+// Function to compute COUNT, SUM, MIN, MAX and AVG over the values of a specified type
+bool aggregateValues(DataSet *dataset, DataType type, const Bitmap *selection, AggregateResult *result);
+
+// Function to count the distinct values of a specified type
+int64_t countDistinctValues(DataSet *dataset, DataType type, const Bitmap *selection);
+
+#endif
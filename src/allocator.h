@@ -0,0 +1,15 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include "bitmap.h"
+
+// Bytes an arena allocator takes from malloc at a time unless told otherwise
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+// Function to create an arena allocator that hands out memory from large blocks
+Allocator *createArenaAllocator(size_t blockSize);
+
+// Function to free an arena allocator and all the memory it handed out
+void freeArenaAllocator(Allocator *allocator);
+
+#endif
@@ -15,43 +15,50 @@ DataPoint *createDataPoint(DataType type, void *value)
 /*
 This function creates a data set with a specified number of data points.
 It checks for invalid input size and returns NULL if the size is less than or equal to zero.
-It allocates memory for the dataset and the data points. It initializes the data points to NULL
-and sets the default data type to INT. Finally, it sets the data points for the dataset and returns the dataset.
+It allocates memory for the dataset, the data point view and the type tag of each slot.
+The data point view is zero-filled, which sets every data point to NULL with the default
+data type INT; the value columns are only allocated once a value of their type is added.
+It then allocates the validity bitmap and one bitmap per data type, all cleared.
+Finally, it returns the dataset.
 */
-DataSet *createDataSet(int size)
+DataSet *createDataSet(int64_t size)
 {
 }
 
 /*
 This function adds a data point to a dataset at a specific index.
 It checks if the dataset and data point are not NULL, if the index
-is within the bounds of the dataset, and if the data point type
-matches the dataset type. It then frees the existing data point
-at the specified index, if any, sets the data point at the specified index,
-and allocates memory for the data point value and copies it from the input point.
-The memory allocation is based on the data type of the data point - integer, float or string.
+is within the bounds of the dataset, if the dataset is not mapped
+read-only from a file, and if the data point type
+matches the type of the value already held at that index (an empty slot
+accepts any type). It then copies the value of the data point into the
+column of its type - integer, float or string - replacing any value held
+at the specified index, and updates the type tag and the bitmaps for the slot.
 */
 // Function to add a data point to a dataset
-void addDataPoint(DataSet *dataset, int index, DataPoint *point)
+void addDataPoint(DataSet *dataset, int64_t index, DataPoint *point)
 {
 }
 
 /*
 This function retrieves a data point from a dataset by its index.
 It checks for errors such as invalid dataset or index, and returns
-NULL if any errors are encountered. If the data point exists and is
-of type INT, FLOAT, or STRING, it is returned, otherwise NULL is returned.
+NULL if any errors are encountered. If the validity bitmap shows the slot
+holds a value, the view entry for the slot is pointed at the value in its
+column and returned, otherwise NULL is returned. The returned value pointer
+stays valid until the slot is next written; a STRING value pointer stays valid
+until the next string is added to the dataset.
 */
 // Function to get a data point from a dataset
-DataPoint *getDataPoint(DataSet *dataset, int index)
+DataPoint *getDataPoint(DataSet *dataset, int64_t index)
 {
 }
 
 /*
 The function frees memory allocated for a dataset structure and all its data points.
-It checks whether the dataset and its data are not NULL, and if so, it frees each
-data point based on its type (integer, float, or string) and then frees the dataset struct itself.
-If the dataset has no data, it just frees the dataset struct.
+A dataset opened with mapDataSet is unmapped instead. Otherwise it frees the value columns, the string arena, which releases every string at once, and
+the string dictionary, then the type tags, the data point view, the bitmaps and finally the dataset struct itself,
+each back to the allocator of the dataset; an arena allocator takes them back for nothing.
 */
 
 void freeDataSet(DataSet *dataset)
@@ -61,9 +68,8 @@ void freeDataSet(DataSet *dataset)
 /*
 This function takes a dataset and a data type as input and returns a new dataset that
 contains only the data points from the original dataset that have the specified data type.
-It creates a new dataset to hold the filtered data, loops through all data points in the
-input dataset, and checks if each point is of the specified type. If it is, it creates a
-new data point with the same type and value and adds it to the filtered dataset.
+It takes a view of the dataset over the bitmap of the requested type and materializes it,
+so only the matching values are copied, each into the same index of the new dataset.
 If the input dataset is NULL or the filtered dataset cannot be created, it returns NULL.
 */
 DataSet *filterByType(DataSet *dataset, DataType type)
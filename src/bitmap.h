@@ -1,7 +1,11 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Define enums for data types
 typedef enum
@@ -11,6 +15,28 @@ typedef enum
     STRING,
 } DataType;
 
+// Number of values in the DataType enum
+#define DATA_TYPE_COUNT 3
+
+// Define a struct for a packed bitmap with one bit per data point
+typedef struct
+{
+    int64_t size;    // number of bits
+    uint64_t *words; // bit i lives in words[i / 64]
+} Bitmap;
+
+// Define a struct for the allocator a dataset takes its memory from
+// allocate returns zero-filled memory and resize keeps the contents of a block, zero-filling
+// any growth. Both are given the size of the block, so release may ignore blocks altogether
+// for an allocator that frees everything at once.
+typedef struct
+{
+    void *(*allocate)(void *context, size_t size);
+    void *(*resize)(void *context, void *block, size_t oldSize, size_t size);
+    void (*release)(void *context, void *block, size_t size);
+    void *context;
+} Allocator;
+
 // Define a struct for a data point
 typedef struct
 {
@@ -18,27 +44,265 @@ typedef struct
     void *value;
 } DataPoint;
 
+// Define a struct for a view of the bytes of a string, which need not be NUL-terminated
+typedef struct
+{
+    const char *data;
+    uint32_t length;
+} StringView;
+
+// Define a struct for the STRING storage of a dataset
+// Strings are appended NUL-terminated to one growing byte arena and each slot
+// records where its string starts and how long it is. Replacing a string leaves
+// the old bytes in the arena until the dataset is freed.
+typedef struct
+{
+    char *bytes;       // arena of NUL-terminated strings
+    size_t length;     // bytes of the arena in use
+    size_t capacity;   // bytes allocated for the arena
+    uint64_t *offsets; // arena offset of the string held by each slot
+    uint32_t *lengths; // length of the string held by each slot, without the NUL
+} StringArena;
+
+// Define a struct for the dictionary of dictionary-encoded STRING values
+// Each distinct string is stored once in the string arena and numbered by a code.
+// Slots hold only their code, in 1, 2 or 4 bytes depending on how many distinct
+// strings the dictionary holds.
+typedef struct
+{
+    uint64_t *offsets; // arena offset of each distinct string, indexed by code
+    uint32_t *lengths; // length of each distinct string, indexed by code
+    uint32_t *hashes;  // hash of each distinct string, indexed by code
+    int count;         // number of distinct strings
+    int capacity;      // entries allocated for offsets, lengths and hashes
+    uint32_t *table;   // open-addressing hash table of code + 1, 0 marks a free entry
+    int tableSize;     // entries in the hash table, a power of two
+    void *codes;       // code held by each slot, codeWidth bytes per slot
+    int codeWidth;     // 1, 2 or 4
+} StringDictionary;
+
+// Number of slots in a block of a sealed INT column
+#define INT_BLOCK_SIZE 1024
+
+// Define enums for the encodings of a block of a sealed INT column
+typedef enum
+{
+    ENCODING_PLAIN, // 32-bit values
+    ENCODING_RLE,   // runs of equal values
+    ENCODING_FOR,   // bit-packed offsets from the smallest value of the block
+    ENCODING_DELTA, // bit-packed differences between consecutive values
+} IntEncoding;
+
+// Define a struct for one block of a sealed INT column
+typedef struct
+{
+    uint8_t encoding; // IntEncoding
+    uint8_t bitWidth; // bits per packed offset or difference
+    uint16_t runs;    // number of runs of an RLE block
+    int32_t base;     // FOR: smallest value; DELTA: first value
+    int32_t delta;    // DELTA: smallest difference
+    int32_t min;      // smallest value of the block
+    int32_t max;      // largest value of the block
+    int64_t sum;      // sum of the INT values of the block
+    uint64_t offset;  // offset of the encoded block in bytes
+} IntBlock;
+
+// Define a struct for a sealed INT column
+// The column is cut into blocks of INT_BLOCK_SIZE slots and each block is encoded in
+// whichever encoding takes the fewest bytes. A slot without an INT value is encoded as
+// the INT value before it in the block, or the first one after it, so it does not break
+// runs or widen the range of the block; the type bitmap tells it apart.
+typedef struct
+{
+    IntBlock *blocks;
+    int64_t blockCount;
+    uint8_t *bytes; // encoded blocks
+    size_t length;  // bytes of the encoded blocks
+    int32_t *decoded; // values decoded by getDataPoint, one per slot, NULL until its first call
+} EncodedInts;
+
+// Number of slots in a zone, the block of a dataset a zone map keeps statistics for
+#define ZONE_SIZE 65536
+
+// Words of the bloom filter of the STRING values of a zone
+#define ZONE_BLOOM_WORDS 4
+
+// Define a struct for the zone map of one zone of a dataset
+// The counts are exact. The bounds cover every value stored since the count of its type
+// was last 0, so emptying slots can leave them wider than the values held; a filter or
+// aggregate that finds a zone cannot hold a match skips the zone.
+typedef struct
+{
+    int32_t intMin;
+    int32_t intMax;
+    float floatMin;                   // NaN values are left out of the FLOAT bounds
+    float floatMax;
+    bool floatNaN;                    // a NaN FLOAT value was stored
+    int32_t counts[DATA_TYPE_COUNT];  // values of each type held in the zone
+    uint64_t bloom[ZONE_BLOOM_WORDS]; // two bits set for each STRING value stored
+} Zone;
+
+// Define a struct for the counters a dataset keeps about itself, read with getDataSetStats
+typedef struct
+{
+    uint64_t valuesStored; // values written into slots
+    uint64_t resizes;      // reallocations of the arrays of the dataset
+    uint64_t rowsScanned;  // slots read by filters and aggregates
+    uint64_t rowsSkipped;  // slots of zones the zone maps let filters and aggregates pass over
+} DataSetStats;
+
 // Define a struct for a dataset
+// Values are stored column by column: slot i of an INT value lives in ints[i],
+// of a FLOAT value in floats[i] and of a STRING value in the string arena. A column is
+// only allocated once the first value of its type is added. The data array is a
+// compatibility view that getDataPoint fills in for the slot it returns; it is allocated
+// by the first getDataPoint, except for a dataset made by createDataSet. A sealed dataset
+// holds its INT values encoded in encodedInts and can no longer be changed. Arrays are
+// allocated for capacity slots so appends grow them geometrically; slots past size are
+// always empty. Every write keeps the zone map of its zone up to date. A dataset opened
+// with mapDataSet reads its columns and bitmaps from a read-only file mapping.
 typedef struct
 {
-    int size;
-    DataPoint *data;
+    int64_t size;                      // number of slots
+    int64_t capacity;                  // number of slots allocated
+    DataPoint *data;                   // data point view, NULL until getDataPoint first needs it
+    uint8_t *types;                    // type tag of each slot
+    int32_t *ints;                     // INT values, NULL once sealed
+    EncodedInts *encodedInts;          // encoded INT values of a sealed dataset, NULL unless sealed
+    float *floats;                     // FLOAT values
+    StringArena strings;               // STRING values
+    StringDictionary *dictionary;      // NULL unless STRING values are dictionary-encoded
+    Bitmap present;                    // validity bitmap, bit i is set when slot i holds a value
+    Bitmap typeIndex[DATA_TYPE_COUNT]; // bit i is set when slot i holds a value of that type
+    Zone *zones;                       // zone map of each ZONE_SIZE slots, NULL for a mapped dataset
+    Allocator *allocator;              // allocator of the arrays of the dataset, NULL for malloc
+    void *mapping;                     // file mapping the dataset is read from, NULL if in memory
+    size_t mappingLength;              // length of the file mapping
+    DataSetStats stats;                // counters of the dataset, all 0 when built with BITMAP_NO_STATS
 } DataSet;
 
+// Define a struct for a filtered view of a dataset
+// A view refers to its parent dataset and a selection bitmap of its slots; no value is copied
+typedef struct
+{
+    DataSet *parent;
+    Bitmap *selection;
+    bool ownsSelection; // false when the selection is a type bitmap of the parent
+} DataView;
+
 // Function to create a data point
 DataPoint *createDataPoint(DataType type, void *value);
 
 // Function to create a dataset
-DataSet *createDataSet(int size);
+DataSet *createDataSet(int64_t size);
+
+// Function to create an empty dataset with room for a number of data points
+DataSet *createDataSetWithCapacity(int64_t capacity);
 
 // Function to add a data point to a dataset
-void addDataPoint(DataSet *dataset, int index, DataPoint *point);
+void addDataPoint(DataSet *dataset, int64_t index, DataPoint *point);
+
+// Function to add a data point created by createDataPoint to a dataset, freeing the data point
+bool adoptDataPoint(DataSet *dataset, int64_t index, DataPoint *point);
+
+// Function to construct a STRING value in place in a slot of a dataset through a callback
+bool emplaceStringValue(DataSet *dataset, int64_t index, size_t length, void (*fill)(char *bytes, size_t length, void *context),
+                        void *context);
+
+// Function to create an empty dataset that takes its memory from an allocator
+DataSet *createDataSetWithAllocator(int64_t capacity, Allocator *allocator);
+
+// Function to append a data point to the end of a dataset, returning its index
+int64_t appendDataPoint(DataSet *dataset, DataPoint *point);
+
+// Function to store an array of INT values into consecutive slots of a dataset
+bool addIntValues(DataSet *dataset, int64_t start, const int32_t *values, int64_t count);
+
+// Function to store an array of FLOAT values into consecutive slots of a dataset
+bool addFloatValues(DataSet *dataset, int64_t start, const float *values, int64_t count);
+
+// Function to store an array of STRING values into consecutive slots of a dataset
+bool addStringValues(DataSet *dataset, int64_t start, const StringView *values, int64_t count);
+
+// Function to make room for a number of data points without changing the size of a dataset
+bool reserveDataSet(DataSet *dataset, int64_t capacity);
+
+// Function to change the number of slots of a dataset
+bool resizeDataSet(DataSet *dataset, int64_t size);
+
+// Function to release the room allocated past the last slot of a dataset
+bool shrinkDataSet(DataSet *dataset);
 
 // Function to get a data point from a dataset
-DataPoint *getDataPoint(DataSet *dataset, int index);
+DataPoint *getDataPoint(DataSet *dataset, int64_t index);
 
 // Function to free a dataset
 void freeDataSet(DataSet *dataset);
 
 // Function to filter a dataset by a specified data type
 DataSet *filterByType(DataSet *dataset, DataType type);
+
+// Function to count the data points of a specified type in a dataset
+int64_t countByType(DataSet *dataset, DataType type);
+
+// Function to count all data points held by a dataset
+int64_t countDataPoints(DataSet *dataset);
+
+// Function to check whether a dataset slot holds a data point
+bool hasDataPoint(DataSet *dataset, int64_t index);
+
+// Function to check whether a dataset holds any data point of a specified type
+bool containsType(DataSet *dataset, DataType type);
+
+// Function to create a bitmap with all bits clear
+Bitmap *createBitmap(int64_t size);
+
+// Function to free a bitmap
+void freeBitmap(Bitmap *bitmap);
+
+// Function to count the set bits of a bitmap
+int64_t countBitmap(const Bitmap *bitmap);
+
+// Function to check whether a bit of a bitmap is set
+bool testBitmap(const Bitmap *bitmap, int64_t index);
+
+// Function to switch the STRING values of a dataset to dictionary encoding
+bool encodeStringDictionary(DataSet *dataset);
+
+// Function to get the dictionary code of a string, or -1 if the dictionary does not hold it
+int getStringCode(DataSet *dataset, const char *value);
+
+// Function to get the string numbered by a dictionary code
+const char *getDictionaryString(DataSet *dataset, int code);
+
+// Function to count the data points holding each dictionary code
+int64_t *countByStringCode(DataSet *dataset, int *codeCount);
+
+// Function to select the data points holding a specified string
+Bitmap *filterStringEquals(DataSet *dataset, const char *value);
+
+// Function to create a view of a dataset over a selection bitmap
+DataView *createDataView(DataSet *dataset, Bitmap *selection);
+
+// Function to create a view of the data points of a specified type
+DataView *filterViewByType(DataSet *dataset, DataType type);
+
+// Function to narrow a view to the slots set in a selection bitmap
+bool intersectView(DataView *view, const Bitmap *selection);
+
+// Function to count the data points selected by a view
+int64_t countView(DataView *view);
+
+// Function to find the next data point selected by a view
+int64_t nextViewIndex(DataView *view, int64_t index);
+
+// Function to get a data point selected by a view
+DataPoint *getViewDataPoint(DataView *view, int64_t index);
+
+// Function to copy the data points selected by a view into a new dataset
+DataSet *materializeView(DataView *view);
+
+// Function to free a view
+void freeDataView(DataView *view);
+
+#endif
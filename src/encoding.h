@@ -0,0 +1,15 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include "bitmap.h"
+
+// Function to seal a dataset, encoding its INT column and making it read-only
+bool sealDataSet(DataSet *dataset);
+
+// Function to decode one block of INT_BLOCK_SIZE slots of the INT column of a sealed dataset
+int decodeSealedInts(const DataSet *dataset, int64_t block, int32_t *values);
+
+// Function to read the INT value of one slot of a sealed dataset without writing to it
+int32_t readSealedInt(const DataSet *dataset, int64_t index);
+
+#endif
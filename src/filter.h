@@ -0,0 +1,40 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "bitmap.h"
+
+// Define enums for value comparisons
+typedef enum
+{
+    COMPARE_EQ,      // value == operands[0]
+    COMPARE_NE,      // value != operands[0]
+    COMPARE_LT,      // value < operands[0]
+    COMPARE_LE,      // value <= operands[0]
+    COMPARE_GT,      // value > operands[0]
+    COMPARE_GE,      // value >= operands[0]
+    COMPARE_BETWEEN, // operands[0] <= value <= operands[1]
+    COMPARE_IN,      // value equals one of operands[0..operandCount)
+} CompareOp;
+
+// Define enums for the instruction sets the filter kernels can use
+typedef enum
+{
+    KERNEL_AUTO, // best kernel the CPU supports
+    KERNEL_SCALAR,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+} FilterKernel;
+
+// Function to select the INT data points of a dataset whose value satisfies a comparison
+Bitmap *filterIntValues(DataSet *dataset, CompareOp op, const int32_t *operands, int operandCount);
+
+// Function to select the FLOAT data points of a dataset whose value satisfies a comparison
+Bitmap *filterFloatValues(DataSet *dataset, CompareOp op, const float *operands, int operandCount);
+
+// Function to choose the kernel used by the filters
+bool setFilterKernel(FilterKernel kernel);
+
+// Function to get the kernel used by the filters
+FilterKernel getFilterKernel(void);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef GROUPBY_H
+#define GROUPBY_H
+
+#include "bitmap.h"
+#include "aggregate.h"
+
+// Define a struct for the result of a group-by
+// Group g has its key in slot g of keys and the aggregates of its values in results[g].
+// Groups are numbered in the order their first data point appears in the datasets.
+typedef struct
+{
+    int64_t count;            // number of groups
+    DataSet *keys;            // key of each group
+    AggregateResult *results; // aggregates of the values of each group
+} GroupByResult;
+
+// Function to group the values held by one dataset by the keys held in the same slots of another
+GroupByResult *groupByValues(DataSet *keys, DataType keyType, DataSet *values, DataType valueType, const Bitmap *selection);
+
+// Function to free the result of a group-by
+void freeGroupByResult(GroupByResult *result);
+
+#endif
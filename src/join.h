@@ -0,0 +1,32 @@
+#ifndef JOIN_H
+#define JOIN_H
+
+#include "bitmap.h"
+
+// Define enums for the kinds of equi-join
+typedef enum
+{
+    JOIN_INNER, // every pair of a left and a right slot with equal keys
+    JOIN_LEFT,  // the pairs of an inner join and every left slot without a match, paired with -1
+    JOIN_SEMI,  // every left slot with a match, once
+    JOIN_ANTI,  // every left slot without a match
+} JoinType;
+
+// Define a struct for the result of a join
+// Pair i joins slot left[i] of the left dataset to slot right[i] of the right dataset,
+// sorted by left slot and then by right slot. A SEMI or ANTI join only gives left slots
+// and right is NULL.
+typedef struct
+{
+    int64_t count;  // number of pairs
+    int64_t *left;  // left slot of each pair
+    int64_t *right; // right slot of each pair, -1 for a LEFT join's slot without a match
+} JoinResult;
+
+// Function to join the slots of two datasets holding equal INT or STRING keys
+JoinResult *joinDataSets(DataSet *left, DataSet *right, DataType keyType, JoinType type);
+
+// Function to free the result of a join
+void freeJoinResult(JoinResult *result);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef LIVE_H
+#define LIVE_H
+
+#include "bitmap.h"
+
+// Number of slots in a segment of a live dataset, allocated at once and never moved
+#define LIVE_SEGMENT_SIZE 4096
+
+// Number of readers that can be attached to a live dataset at once
+#define LIVE_MAX_READERS 64
+
+// Define a struct for a dataset that can be read while it is being appended to
+// The struct is opaque; it is used through the functions below.
+typedef struct LiveDataSet LiveDataSet;
+
+// Define a struct for a reader attached to a live dataset, owned by one thread at a time
+typedef struct LiveReader LiveReader;
+
+// Define a struct for a value read from a live dataset
+// A STRING value is a view of bytes owned by the live dataset, which stay valid until the
+// read section it was read in ends.
+typedef struct
+{
+    DataType type;
+    union
+    {
+        int32_t intValue;
+        float floatValue;
+        StringView stringValue;
+    };
+} LiveValue;
+
+// Function to create an empty live dataset, whose writes may come from several threads if sharedWriters is set
+LiveDataSet *createLiveDataSet(bool sharedWriters);
+
+// Function to free a live dataset once no thread writes to it or has a reader attached
+void freeLiveDataSet(LiveDataSet *live);
+
+// Function to append a data point to a live dataset, returning its index
+int64_t appendLiveDataPoint(LiveDataSet *live, const DataPoint *point);
+
+// Function to replace the value of a slot of a live dataset with a value of the same type
+bool replaceLiveDataPoint(LiveDataSet *live, int64_t index, const DataPoint *point);
+
+// Function to get the number of slots published to readers
+int64_t getLiveSize(const LiveDataSet *live);
+
+// Function to attach a reader to a live dataset
+LiveReader *attachLiveReader(LiveDataSet *live);
+
+// Function to detach a reader from its live dataset
+void detachLiveReader(LiveReader *reader);
+
+// Function to start a read section, during which the values read stay valid
+void beginLiveRead(LiveReader *reader);
+
+// Function to end a read section
+void endLiveRead(LiveReader *reader);
+
+// Function to read the value of a slot of a live dataset within a read section
+bool readLiveValue(LiveReader *reader, int64_t index, LiveValue *value);
+
+// Function to copy the published slots of a live dataset into a new dataset within a read section
+DataSet *snapshotLiveDataSet(LiveReader *reader);
+
+#endif
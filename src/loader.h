@@ -0,0 +1,20 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "bitmap.h"
+
+// Number of bytes the loader reads from a file at a time unless told otherwise
+#define LOADER_BUFFER_SIZE (1 << 20)
+
+// Define a struct for the options of a load
+typedef struct
+{
+    char delimiter;    // field delimiter, '\0' for one value per line
+    bool header;       // skip the first record
+    size_t bufferSize; // bytes read at a time, 0 for LOADER_BUFFER_SIZE
+} LoaderOptions;
+
+// Function to load a delimited text file into one dataset per column, returning the number of columns
+int loadDelimitedFile(const char *path, const LoaderOptions *options, DataSet **columns, int maxColumns);
+
+#endif
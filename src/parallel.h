@@ -0,0 +1,37 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "bitmap.h"
+#include "filter.h"
+#include "aggregate.h"
+#include "sort.h"
+#include "groupby.h"
+
+// Number of data points in a morsel, the unit of work a thread takes at a time
+#define MORSEL_SIZE 16384
+
+// Function to set the number of threads used by the parallel functions, 0 for one per hardware thread
+void setThreadCount(int threads);
+
+// Function to get the number of threads used by the parallel functions
+int getThreadCount(void);
+
+// Function to filter a dataset by a specified data type on all threads
+DataSet *parallelFilterByType(DataSet *dataset, DataType type);
+
+// Function to select the INT data points satisfying a comparison on all threads
+Bitmap *parallelFilterIntValues(DataSet *dataset, CompareOp op, const int32_t *operands, int operandCount);
+
+// Function to select the FLOAT data points satisfying a comparison on all threads
+Bitmap *parallelFilterFloatValues(DataSet *dataset, CompareOp op, const float *operands, int operandCount);
+
+// Function to compute COUNT, SUM, MIN, MAX and AVG over the values of a specified type on all threads
+bool parallelAggregateValues(DataSet *dataset, DataType type, const Bitmap *selection, AggregateResult *result);
+
+// Function to sort the data points of a specified type on all threads, returning their slots in sort order
+int64_t *parallelSortValues(DataSet *dataset, DataType type, const Bitmap *selection, SortOrder order, int64_t *count);
+
+// Function to group the values held by one dataset by the keys held in the same slots of another on all threads
+GroupByResult *parallelGroupByValues(DataSet *keys, DataType keyType, DataSet *values, DataType valueType, const Bitmap *selection);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include "bitmap.h"
+#include "filter.h"
+
+// Define enums for the kinds of predicate
+typedef enum
+{
+    PREDICATE_TYPE,          // slot holds a value of a type
+    PREDICATE_INT,           // INT value satisfies a comparison
+    PREDICATE_FLOAT,         // FLOAT value satisfies a comparison
+    PREDICATE_STRING_EQUALS, // STRING value equals a string
+    PREDICATE_STRING_PREFIX, // STRING value starts with a string
+    PREDICATE_AND,
+    PREDICATE_OR,
+    PREDICATE_NOT,
+} PredicateKind;
+
+// Define a struct for a node of a predicate tree
+// Leaves test the value of a slot; AND, OR and NOT nodes own their children.
+typedef struct Predicate
+{
+    PredicateKind kind;
+    DataType type;          // type of a type test
+    CompareOp op;           // comparison of an INT or FLOAT test
+    int operandCount;       // operands of the comparison
+    int32_t *intOperands;   // operands of an INT test
+    float *floatOperands;   // operands of a FLOAT test
+    char *text;             // string of a STRING test
+    size_t length;          // length of the string
+    uint32_t hash;          // hash of the string
+    struct Predicate *left; // child of a NOT node, or first child of an AND or OR node
+    struct Predicate *right;
+} Predicate;
+
+// Functions to create the leaves of a predicate tree
+Predicate *typePredicate(DataType type);
+Predicate *intPredicate(CompareOp op, const int32_t *operands, int operandCount);
+Predicate *floatPredicate(CompareOp op, const float *operands, int operandCount);
+Predicate *stringEqualsPredicate(const char *value);
+Predicate *stringPrefixPredicate(const char *prefix);
+
+// Functions to combine predicates, taking ownership of them
+Predicate *andPredicate(Predicate *left, Predicate *right);
+Predicate *orPredicate(Predicate *left, Predicate *right);
+Predicate *notPredicate(Predicate *child);
+
+// Function to free a predicate tree
+void freePredicate(Predicate *predicate);
+
+// Function to select the data points of a dataset satisfying a predicate tree in one pass
+Bitmap *filterPredicate(DataSet *dataset, const Predicate *predicate);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef ROARING_H
+#define ROARING_H
+
+#include "bitmap.h"
+#include "filter.h"
+
+// Number of bits in a chunk of a compressed bitmap, each held by one container
+#define ROARING_CHUNK_SIZE 65536
+
+// Most values an array container holds before a bitset takes less memory
+#define ROARING_ARRAY_LIMIT 4096
+
+// Define enums for the kinds of container of a compressed bitmap
+typedef enum
+{
+    CONTAINER_ARRAY,  // sorted 16-bit values of the set bits
+    CONTAINER_BITSET, // ROARING_CHUNK_SIZE bits in 64-bit words
+    CONTAINER_RUN     // runs of set bits as pairs of a 16-bit start and length minus one
+} ContainerType;
+
+// Define a struct for the container of one chunk of a compressed bitmap
+typedef struct
+{
+    int64_t key;         // chunk number, the index of the first bit divided by ROARING_CHUNK_SIZE
+    uint8_t type;        // ContainerType
+    int32_t cardinality; // set bits, never 0
+    int32_t length;      // values of an array or runs of a run container
+    uint16_t *values;    // values of an array or run container
+    uint64_t *words;     // words of a bitset container
+} Container;
+
+// Define a struct for a compressed bitmap, holding a container for each chunk with a set bit
+typedef struct
+{
+    int64_t size;
+    int64_t count; // containers in use, sorted by key
+    int64_t capacity;
+    Container *containers;
+} RoaringBitmap;
+
+// Function to create an empty compressed bitmap of a given size
+RoaringBitmap *createRoaringBitmap(int64_t size);
+
+// Function to free a compressed bitmap
+void freeRoaringBitmap(RoaringBitmap *bitmap);
+
+// Function to set a bit of a compressed bitmap
+bool addRoaring(RoaringBitmap *bitmap, int64_t index);
+
+// Function to test a bit of a compressed bitmap
+bool testRoaring(const RoaringBitmap *bitmap, int64_t index);
+
+// Function to count the set bits of a compressed bitmap
+int64_t countRoaring(const RoaringBitmap *bitmap);
+
+// Function to get the first set bit at or after an index, or -1 if there is none
+int64_t nextRoaringIndex(const RoaringBitmap *bitmap, int64_t index);
+
+// Function to get the bytes of memory a compressed bitmap takes
+size_t roaringBytes(const RoaringBitmap *bitmap);
+
+// Function to compress a bitmap
+RoaringBitmap *compressBitmap(const Bitmap *bitmap);
+
+// Function to expand a compressed bitmap into a bitmap
+Bitmap *decompressRoaring(const RoaringBitmap *bitmap);
+
+// Functions to combine two compressed bitmaps of the same size into a new one
+RoaringBitmap *andRoaring(const RoaringBitmap *a, const RoaringBitmap *b);
+RoaringBitmap *orRoaring(const RoaringBitmap *a, const RoaringBitmap *b);
+RoaringBitmap *andNotRoaring(const RoaringBitmap *a, const RoaringBitmap *b);
+RoaringBitmap *xorRoaring(const RoaringBitmap *a, const RoaringBitmap *b);
+
+// Function to get the slots of a dataset holding a type as a compressed bitmap
+RoaringBitmap *compressTypeIndex(DataSet *dataset, DataType type);
+
+// Functions to select the INT or FLOAT data points satisfying a comparison into a compressed bitmap
+RoaringBitmap *filterIntValuesCompressed(DataSet *dataset, CompareOp op, const int32_t *operands, int operandCount);
+RoaringBitmap *filterFloatValuesCompressed(DataSet *dataset, CompareOp op, const float *operands, int operandCount);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include "bitmap.h"
+
+// Define enums for the order a sort puts values in
+typedef enum
+{
+    SORT_ASCENDING,  // smallest value first, NaN FLOAT values last
+    SORT_DESCENDING, // largest value first, NaN FLOAT values first
+} SortOrder;
+
+// Function to sort the data points of a specified type, returning their slots in sort order
+int64_t *sortValues(DataSet *dataset, DataType type, const Bitmap *selection, SortOrder order, int64_t *count);
+
+// Function to get the slots of the first k data points of a specified type in sort order
+int64_t *topValues(DataSet *dataset, DataType type, const Bitmap *selection, SortOrder order, int64_t k, int64_t *count);
+
+#endif
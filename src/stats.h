@@ -0,0 +1,66 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "bitmap.h"
+
+// Counters and timers are kept unless the library is built with BITMAP_NO_STATS, which
+// removes every update from the hot paths and leaves every counter at 0.
+
+// Define enums for the counters kept across all datasets
+typedef enum
+{
+    STAT_DATA_POINTS_CREATED,    // data points made by createDataPoint
+    STAT_DATA_POINT_ALLOCATIONS, // blocks allocated by createDataPoint, two per data point
+    STAT_BLOCK_ALLOCATIONS,      // blocks allocated or resized for datasets
+    STAT_BLOCK_BYTES,            // bytes of the blocks allocated or resized for datasets
+    STAT_BLOCK_RELEASES,         // blocks released by datasets
+    STAT_VALUES_STORED,          // values written into the slots of datasets
+    STAT_ROWS_SCANNED,           // slots read by filters and aggregates
+    STAT_ROWS_SKIPPED,           // slots of zones the zone maps let filters and aggregates pass over
+    STAT_COUNTER_COUNT,
+} StatCounter;
+
+// Define enums for the operations that can be timed
+typedef enum
+{
+    STAT_TIMER_FILTER_BY_TYPE, // filterByType
+    STAT_TIMER_FILTER_VALUES,  // filterIntValues and filterFloatValues, serial or parallel
+    STAT_TIMER_AGGREGATE,      // aggregateValues, serial or parallel
+    STAT_TIMER_SORT,           // sortValues and topValues, serial or parallel
+    STAT_TIMER_GROUP_BY,       // groupByValues, serial or parallel
+    STAT_TIMER_JOIN,           // joinDataSets
+    STAT_TIMER_COUNT,
+} StatTimer;
+
+// Define a struct for the bytes allocated for a dataset
+// Value bytes hold the INT and FLOAT columns, the encoded INT blocks, the string arena and
+// the dictionary codes of the slots, or the file mapping of a mapped dataset; metadata bytes
+// hold everything else.
+typedef struct
+{
+    size_t valueBytes;
+    size_t metadataBytes;
+} DataSetMemory;
+
+// Function to read a global counter
+uint64_t getStatCounter(StatCounter counter);
+
+// Function to read the number of calls and nanoseconds recorded for a timed operation
+bool getStatTimer(StatTimer timer, uint64_t *calls, uint64_t *nanoseconds);
+
+// Function to turn the timing of operations on or off, off by default
+void setStatTimers(bool enabled);
+
+// Function to set the global counters and timers back to 0
+void resetStats(void);
+
+// Function to read the counters of a dataset
+bool getDataSetStats(const DataSet *dataset, DataSetStats *stats);
+
+// Function to count the bytes allocated for a dataset
+bool getDataSetMemory(const DataSet *dataset, DataSetMemory *memory);
+
+// Function to write the global counters and timers, and those of a dataset, as JSON
+char *statsToJson(const DataSet *dataset);
+
+#endif
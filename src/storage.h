@@ -0,0 +1,15 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "bitmap.h"
+
+// Version of the dataset file format written by writeDataSet
+#define DATASET_FILE_VERSION 1
+
+// Function to write a dataset to a file in a single sequential pass
+bool writeDataSet(DataSet *dataset, const char *path);
+
+// Function to open a dataset file as a read-only dataset mapped into memory
+DataSet *mapDataSet(const char *path);
+
+#endif
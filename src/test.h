@@ -222,4 +222,505 @@ public:
         freeDataSet(filteredData);
     }
     
-};
\ No newline at end of file
+    ////////////////////////////////////////////////////////////////
+    void testCountByTypeUsesTypeBitmaps()
+    {
+        DataSet *dataset = createDataSet(4);
+        int value1 = 10;
+        float value2 = 2.5f;
+        const char *value3 = "hello";
+        DataPoint *point1 = createDataPoint(INT, &value1);
+        DataPoint *point2 = createDataPoint(FLOAT, &value2);
+        DataPoint *point3 = createDataPoint(STRING, (void *)value3);
+        addDataPoint(dataset, 0, point1);
+        addDataPoint(dataset, 1, point2);
+        addDataPoint(dataset, 2, point3);
+
+        TS_ASSERT_EQUALS(countByType(dataset, INT), 1);
+        TS_ASSERT_EQUALS(countByType(dataset, FLOAT), 1);
+        TS_ASSERT_EQUALS(countByType(dataset, STRING), 1);
+        TS_ASSERT_EQUALS(countDataPoints(dataset), 3);
+        TS_ASSERT(hasDataPoint(dataset, 2));
+        TS_ASSERT(!hasDataPoint(dataset, 3));
+        TS_ASSERT(containsType(dataset, STRING));
+
+        freeDataSet(dataset);
+        free(point1->value);
+        free(point1);
+        free(point2->value);
+        free(point2);
+        free(point3->value);
+        free(point3);
+    }
+
+    void testAddDataPointWithDifferentTypeKeepsExistingValue()
+    {
+        DataSet *dataset = createDataSet(1);
+        int value1 = 7;
+        float value2 = 1.5f;
+        DataPoint *point1 = createDataPoint(INT, &value1);
+        DataPoint *point2 = createDataPoint(FLOAT, &value2);
+        addDataPoint(dataset, 0, point1);
+        addDataPoint(dataset, 0, point2);
+
+        DataPoint *result = getDataPoint(dataset, 0);
+        TS_ASSERT_EQUALS(result->type, INT);
+        TS_ASSERT_EQUALS(*((int *)result->value), 7);
+        TS_ASSERT_EQUALS(countByType(dataset, INT), 1);
+        TS_ASSERT(!containsType(dataset, FLOAT));
+
+        freeDataSet(dataset);
+        free(point1->value);
+        free(point1);
+        free(point2->value);
+        free(point2);
+    }
+
+    void testFilterByTypeKeepsMatchingPoints()
+    {
+        DataSet *dataset = createDataSet(130);
+        float value = 4.25f;
+        int other = 3;
+        DataPoint *point1 = createDataPoint(FLOAT, &value);
+        DataPoint *point2 = createDataPoint(INT, &other);
+        addDataPoint(dataset, 1, point1);
+        addDataPoint(dataset, 129, point1);
+        addDataPoint(dataset, 64, point2);
+
+        DataSet *filteredData = filterByType(dataset, FLOAT);
+        TS_ASSERT(filteredData != NULL);
+        TS_ASSERT_EQUALS(filteredData->size, 130);
+        TS_ASSERT_EQUALS(countDataPoints(filteredData), 2);
+        TS_ASSERT_EQUALS(*((float *)getDataPoint(filteredData, 129)->value), value);
+        TS_ASSERT(getDataPoint(filteredData, 64) == NULL);
+
+        freeDataSet(filteredData);
+        freeDataSet(dataset);
+        free(point1->value);
+        free(point1);
+        free(point2->value);
+        free(point2);
+    }
+
+    void testValuesAreStoredInTypedColumns()
+    {
+        DataSet *dataset = createDataSet(3);
+        int value1 = 11;
+        float value2 = 0.5f;
+        DataPoint *point1 = createDataPoint(INT, &value1);
+        addDataPoint(dataset, 2, point1);
+
+        // Only the INT column exists until a value of another type is added
+        TS_ASSERT(dataset->ints != NULL);
+        TS_ASSERT(dataset->floats == NULL);
+        TS_ASSERT_EQUALS(dataset->ints[2], 11);
+
+        DataPoint *point2 = createDataPoint(FLOAT, &value2);
+        addDataPoint(dataset, 0, point2);
+        TS_ASSERT_EQUALS(dataset->floats[0], 0.5f);
+        TS_ASSERT_EQUALS(dataset->types[0], FLOAT);
+
+        // The returned data point views the value held by the column
+        DataPoint *result = getDataPoint(dataset, 2);
+        TS_ASSERT_EQUALS(result->value, (void *)&dataset->ints[2]);
+
+        freeDataSet(dataset);
+        free(point1->value);
+        free(point1);
+        free(point2->value);
+        free(point2);
+    }
+
+    void testStringsShareOneArena()
+    {
+        DataSet *dataset = createDataSet(2);
+        const char *value1 = "alpha";
+        const char *value2 = "beta";
+        DataPoint *point1 = createDataPoint(STRING, (void *)value1);
+        DataPoint *point2 = createDataPoint(STRING, (void *)value2);
+        addDataPoint(dataset, 0, point1);
+        addDataPoint(dataset, 1, point2);
+
+        // Both strings are stored back to back in the arena
+        TS_ASSERT_EQUALS(dataset->strings.offsets[0], 0u);
+        TS_ASSERT_EQUALS(dataset->strings.offsets[1], 6u);
+        TS_ASSERT_EQUALS(dataset->strings.lengths[1], 4u);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 1)->value, "beta"), 0);
+
+        // Replacing a string appends the new one and keeps the slot readable
+        addDataPoint(dataset, 0, point2);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 0)->value, "beta"), 0);
+        TS_ASSERT_EQUALS(dataset->strings.length, 16u);
+
+        freeDataSet(dataset);
+        free(point1->value);
+        free(point1);
+        free(point2->value);
+        free(point2);
+    }
+    ////////////////////////////////////////////////////////////////
+    void testFilterStringEqualsWithoutDictionary()
+    {
+        DataSet *dataset = createDataSet(3);
+        const char *value1 = "de";
+        const char *value2 = "fr";
+        DataPoint *point1 = createDataPoint(STRING, (void *)value1);
+        DataPoint *point2 = createDataPoint(STRING, (void *)value2);
+        addDataPoint(dataset, 0, point1);
+        addDataPoint(dataset, 1, point2);
+        addDataPoint(dataset, 2, point1);
+
+        Bitmap *selection = filterStringEquals(dataset, "de");
+        TS_ASSERT(selection != NULL);
+        TS_ASSERT_EQUALS(countBitmap(selection), 2);
+        TS_ASSERT(testBitmap(selection, 2));
+        TS_ASSERT(!testBitmap(selection, 1));
+
+        freeBitmap(selection);
+        freeDataSet(dataset);
+        free(point1->value);
+        free(point1);
+        free(point2->value);
+        free(point2);
+    }
+
+    void testDictionaryEncodingStoresEachStringOnce()
+    {
+        DataSet *dataset = createDataSet(4);
+        const char *value1 = "ok";
+        const char *value2 = "failed";
+        DataPoint *point1 = createDataPoint(STRING, (void *)value1);
+        DataPoint *point2 = createDataPoint(STRING, (void *)value2);
+        addDataPoint(dataset, 0, point1);
+        addDataPoint(dataset, 1, point2);
+
+        // Existing strings are interned when the dataset is encoded
+        TS_ASSERT(encodeStringDictionary(dataset));
+        addDataPoint(dataset, 2, point1);
+        addDataPoint(dataset, 3, point1);
+        TS_ASSERT_EQUALS(dataset->dictionary->count, 2);
+        TS_ASSERT_EQUALS(dataset->dictionary->codeWidth, 1);
+        TS_ASSERT_EQUALS(dataset->strings.length, 10u);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 3)->value, "ok"), 0);
+
+        int code = getStringCode(dataset, "ok");
+        TS_ASSERT_EQUALS(strcmp(getDictionaryString(dataset, code), "ok"), 0);
+        TS_ASSERT_EQUALS(getStringCode(dataset, "missing"), -1);
+
+        int codeCount = 0;
+        int64_t *counts = countByStringCode(dataset, &codeCount);
+        TS_ASSERT_EQUALS(codeCount, 2);
+        TS_ASSERT_EQUALS(counts[code], 3);
+        free(counts);
+
+        Bitmap *selection = filterStringEquals(dataset, "ok");
+        TS_ASSERT_EQUALS(countBitmap(selection), 3);
+        TS_ASSERT(!testBitmap(selection, 1));
+        freeBitmap(selection);
+
+        freeDataSet(dataset);
+        free(point1->value);
+        free(point1);
+        free(point2->value);
+        free(point2);
+    }
+
+    void testDictionaryCodesWidenWithCardinality()
+    {
+        DataSet *dataset = createDataSet(300);
+        TS_ASSERT(encodeStringDictionary(dataset));
+        char value[16];
+        for (int i = 0; i < 300; i++)
+        {
+            sprintf(value, "tag%d", i);
+            DataPoint point = {STRING, value};
+            addDataPoint(dataset, i, &point);
+        }
+
+        TS_ASSERT_EQUALS(dataset->dictionary->count, 300);
+        TS_ASSERT_EQUALS(dataset->dictionary->codeWidth, 2);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 7)->value, "tag7"), 0);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 299)->value, "tag299"), 0);
+
+        Bitmap *selection = filterStringEquals(dataset, "tag260");
+        TS_ASSERT_EQUALS(countBitmap(selection), 1);
+        TS_ASSERT(testBitmap(selection, 260));
+        freeBitmap(selection);
+
+        freeDataSet(dataset);
+    }
+    ////////////////////////////////////////////////////////////////
+    void testFilterViewByTypeCopiesNothing()
+    {
+        DataSet *dataset = createDataSet(100);
+        int value = 5;
+        DataPoint point = {INT, &value};
+        addDataPoint(dataset, 10, &point);
+        addDataPoint(dataset, 70, &point);
+
+        DataView *view = filterViewByType(dataset, INT);
+        TS_ASSERT(view != NULL);
+        TS_ASSERT(!view->ownsSelection);
+        TS_ASSERT_EQUALS(countView(view), 2);
+        TS_ASSERT_EQUALS(nextViewIndex(view, 0), 10);
+        TS_ASSERT_EQUALS(nextViewIndex(view, 11), 70);
+        TS_ASSERT_EQUALS(nextViewIndex(view, 71), -1);
+        TS_ASSERT_EQUALS(*((int *)getViewDataPoint(view, 70)->value), 5);
+        TS_ASSERT(getViewDataPoint(view, 11) == NULL);
+
+        freeDataView(view);
+        freeDataSet(dataset);
+    }
+
+    void testIntersectViewAndMaterialize()
+    {
+        DataSet *dataset = createDataSet(4);
+        const char *value1 = "a";
+        const char *value2 = "b";
+        int value3 = 1;
+        DataPoint point1 = {STRING, (void *)value1};
+        DataPoint point2 = {STRING, (void *)value2};
+        DataPoint point3 = {INT, &value3};
+        addDataPoint(dataset, 0, &point1);
+        addDataPoint(dataset, 1, &point2);
+        addDataPoint(dataset, 2, &point1);
+        addDataPoint(dataset, 3, &point3);
+
+        DataView *view = filterViewByType(dataset, STRING);
+        Bitmap *selection = filterStringEquals(dataset, "a");
+        TS_ASSERT(intersectView(view, selection));
+        TS_ASSERT_EQUALS(countView(view), 2);
+        // The type bitmap borrowed by the view is left untouched
+        TS_ASSERT_EQUALS(countByType(dataset, STRING), 3);
+
+        DataSet *copy = materializeView(view);
+        TS_ASSERT_EQUALS(copy->size, 4);
+        TS_ASSERT_EQUALS(countDataPoints(copy), 2);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(copy, 2)->value, "a"), 0);
+        TS_ASSERT(getDataPoint(copy, 1) == NULL);
+
+        freeDataSet(copy);
+        freeBitmap(selection);
+        freeDataView(view);
+        freeDataSet(dataset);
+    }
+
+    void testViewStopsAtItsSelectionWhenTheParentGrows()
+    {
+        DataSet *dataset = createDataSet(10);
+        int value = 7;
+        DataPoint point = {INT, &value};
+        addDataPoint(dataset, 3, &point);
+        addDataPoint(dataset, 9, &point);
+        Bitmap *selection = createBitmap(10);
+        selection->words[0] = (1 << 3) | (1 << 9);
+        DataView *view = createDataView(dataset, selection);
+        TS_ASSERT(view != NULL);
+
+        // Slots appended after the view was created are not selected by it
+        TS_ASSERT(resizeDataSet(dataset, 1000));
+        addDataPoint(dataset, 500, &point);
+        TS_ASSERT_EQUALS(countView(view), 2);
+        TS_ASSERT_EQUALS(nextViewIndex(view, 4), 9);
+        TS_ASSERT_EQUALS(nextViewIndex(view, 10), -1);
+        TS_ASSERT(getViewDataPoint(view, 500) == NULL);
+        DataSet *copy = materializeView(view);
+        TS_ASSERT_EQUALS(countDataPoints(copy), 2);
+
+        freeDataSet(copy);
+        freeDataView(view);
+        freeDataSet(dataset);
+    }
+
+    void testAppendGrowsCapacityGeometrically()
+    {
+        DataSet *dataset = createDataSetWithCapacity(0);
+        TS_ASSERT(dataset != NULL);
+        TS_ASSERT_EQUALS(dataset->size, 0);
+        TS_ASSERT(createDataSetWithCapacity(-1) == NULL);
+
+        int reallocations = 0;
+        int64_t capacity = dataset->capacity;
+        for (int i = 0; i < 1000; i++)
+        {
+            int value = i;
+            DataPoint point = {INT, &value};
+            TS_ASSERT_EQUALS(appendDataPoint(dataset, &point), i);
+            if (dataset->capacity != capacity)
+            {
+                reallocations++;
+                capacity = dataset->capacity;
+            }
+        }
+        TS_ASSERT_EQUALS(dataset->size, 1000);
+        TS_ASSERT(reallocations <= 7);
+        TS_ASSERT_EQUALS(countByType(dataset, INT), 1000);
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(dataset, 999)->value), 999);
+
+        // A rejected data point leaves the size unchanged
+        DataPoint empty = {STRING, (void *)""};
+        TS_ASSERT_EQUALS(appendDataPoint(dataset, &empty), -1);
+        TS_ASSERT_EQUALS(dataset->size, 1000);
+
+        // addDataPoint still ignores indexes past the size
+        int value = 7;
+        DataPoint point = {INT, &value};
+        addDataPoint(dataset, 1000, &point);
+        TS_ASSERT_EQUALS(dataset->size, 1000);
+
+        freeDataSet(dataset);
+    }
+
+    void testReserveResizeAndShrink()
+    {
+        DataSet *dataset = createDataSet(3);
+        const char *value1 = "kept";
+        float value2 = 1.5f;
+        DataPoint point1 = {STRING, (void *)value1};
+        DataPoint point2 = {FLOAT, &value2};
+        addDataPoint(dataset, 0, &point1);
+        addDataPoint(dataset, 2, &point2);
+
+        TS_ASSERT(reserveDataSet(dataset, 500));
+        TS_ASSERT_EQUALS(dataset->capacity, 500);
+        TS_ASSERT_EQUALS(dataset->size, 3);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 0)->value, "kept"), 0);
+
+        TS_ASSERT(resizeDataSet(dataset, 200));
+        TS_ASSERT_EQUALS(dataset->capacity, 500);
+        TS_ASSERT(getDataPoint(dataset, 150) == NULL);
+        addDataPoint(dataset, 150, &point2);
+        TS_ASSERT_EQUALS(countByType(dataset, FLOAT), 2);
+
+        // Shrinking empties the dropped slots, so growing again shows them empty
+        TS_ASSERT(resizeDataSet(dataset, 1));
+        TS_ASSERT_EQUALS(countDataPoints(dataset), 1);
+        TS_ASSERT(resizeDataSet(dataset, 200));
+        TS_ASSERT(getDataPoint(dataset, 150) == NULL);
+        TS_ASSERT_EQUALS(countByType(dataset, FLOAT), 0);
+
+        TS_ASSERT(shrinkDataSet(dataset));
+        TS_ASSERT_EQUALS(dataset->capacity, 200);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 0)->value, "kept"), 0);
+        TS_ASSERT(!resizeDataSet(dataset, -1));
+
+        freeDataSet(dataset);
+    }
+
+    void testAddValuesInBatches()
+    {
+        DataSet *dataset = createDataSet(100);
+        int32_t ints[70];
+        for (int i = 0; i < 70; i++)
+        {
+            ints[i] = i * 3;
+        }
+        TS_ASSERT(addIntValues(dataset, 10, ints, 70));
+        TS_ASSERT_EQUALS(countByType(dataset, INT), 70);
+        TS_ASSERT(!hasDataPoint(dataset, 9));
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(dataset, 79)->value), 207);
+
+        // The batch runs past the end of the dataset and appends
+        float floats[3] = {0.5f, 1.5f, 2.5f};
+        TS_ASSERT(addFloatValues(dataset, 98, floats, 3));
+        TS_ASSERT_EQUALS(dataset->size, 101);
+        TS_ASSERT_EQUALS(*((float *)getDataPoint(dataset, 100)->value), 2.5f);
+
+        // A slot holding another type rejects the whole batch
+        TS_ASSERT(!addFloatValues(dataset, 0, floats, 11));
+        TS_ASSERT(!hasDataPoint(dataset, 0));
+        TS_ASSERT(!addIntValues(dataset, 102, ints, 1));
+
+        StringView strings[2] = {{"north", 5}, {"south-east", 5}};
+        TS_ASSERT(addStringValues(dataset, 101, strings, 2));
+        TS_ASSERT_EQUALS(dataset->size, 103);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 102)->value, "south"), 0);
+        StringView empty[1] = {{"", 0}};
+        TS_ASSERT(!addStringValues(dataset, 0, empty, 1));
+
+        encodeStringDictionary(dataset);
+        TS_ASSERT(addStringValues(dataset, 0, strings, 2));
+        TS_ASSERT_EQUALS(dataset->dictionary->count, 2);
+        TS_ASSERT_EQUALS(countByType(dataset, STRING), 4);
+
+        freeDataSet(dataset);
+    }
+
+    void testBatchAppendsGrowCapacityGeometrically()
+    {
+        // Batches of one value appended past the end reallocate a logarithmic number of times
+        DataSet *dataset = createDataSetWithCapacity(1);
+        for (int32_t i = 0; i < 100000; i++)
+        {
+            TS_ASSERT(addIntValues(dataset, dataset->size, &i, 1));
+        }
+        TS_ASSERT_EQUALS(dataset->size, 100000);
+        TS_ASSERT(dataset->capacity < 200000);
+        TS_ASSERT(dataset->stats.resizes <= 20);
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(dataset, 99999)->value), 99999);
+        freeDataSet(dataset);
+    }
+
+    // Write the characters 'a', 'b', ... into a string being constructed
+    static void fillLetters(char *bytes, size_t length, void *context)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            bytes[i] = (char)(*(char *)context + i);
+        }
+    }
+
+    void testAdoptDataPointTakesOwnership()
+    {
+        DataSet *dataset = createDataSet(3);
+        int value = 5;
+        char text[] = "owned";
+        TS_ASSERT(adoptDataPoint(dataset, 0, createDataPoint(INT, &value)));
+        TS_ASSERT(adoptDataPoint(dataset, 1, createDataPoint(STRING, text)));
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(dataset, 0)->value), 5);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 1)->value, "owned"), 0);
+
+        // A data point that cannot be stored is freed all the same
+        TS_ASSERT(!adoptDataPoint(dataset, 0, createDataPoint(STRING, text)));
+        TS_ASSERT(!adoptDataPoint(dataset, 3, createDataPoint(INT, &value)));
+        TS_ASSERT(!adoptDataPoint(NULL, 0, createDataPoint(INT, &value)));
+        TS_ASSERT(!adoptDataPoint(dataset, 2, NULL));
+        TS_ASSERT_EQUALS(countDataPoints(dataset), 2);
+        freeDataSet(dataset);
+    }
+
+    void testEmplaceStringValue()
+    {
+        DataSet *dataset = createDataSet(4);
+        char first = 'a';
+        TS_ASSERT(emplaceStringValue(dataset, 0, 5, fillLetters, &first));
+        TS_ASSERT(emplaceStringValue(dataset, 0, 3, fillLetters, &first));
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 0)->value, "abc"), 0);
+
+        // The string arena grows to fit a long string
+        char *expected = (char *)malloc(10001);
+        fillLetters(expected, 10000, &first);
+        expected[10000] = '\0';
+        TS_ASSERT(emplaceStringValue(dataset, 1, 10000, fillLetters, &first));
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 1)->value, expected), 0);
+        free(expected);
+
+        int value = 1;
+        DataPoint point = {INT, &value};
+        addDataPoint(dataset, 2, &point);
+        TS_ASSERT(!emplaceStringValue(dataset, 2, 3, fillLetters, &first));
+        TS_ASSERT(!emplaceStringValue(dataset, 3, 0, fillLetters, &first));
+        TS_ASSERT(!emplaceStringValue(dataset, 4, 3, fillLetters, &first));
+        TS_ASSERT(!emplaceStringValue(dataset, 3, 3, NULL, &first));
+
+        // A dictionary-encoded dataset interns the string
+        TS_ASSERT(encodeStringDictionary(dataset));
+        TS_ASSERT(emplaceStringValue(dataset, 3, 3, fillLetters, &first));
+        TS_ASSERT_EQUALS(dataset->dictionary->count, 2);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 3)->value, "abc"), 0);
+        Bitmap *matches = filterStringEquals(dataset, "abc");
+        TS_ASSERT_EQUALS(matches->words[0], 9u);
+        freeBitmap(matches);
+        freeDataSet(dataset);
+    }
+};
@@ -0,0 +1,103 @@
+#include <cxxtest/TestSuite.h>
+#include <math.h>
+#include "../src/aggregate.h"
+#include "../src/filter.h"
+
+class AggregateTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testAggregateIntValues()
+    {
+        // 200 INT values 0..199 with a STRING in slot 5 and slot 150 left empty
+        DataSet *dataset = createDataSet(200);
+        for (int i = 0; i < 200; i++)
+        {
+            if (i == 5 || i == 150)
+            {
+                continue;
+            }
+            DataPoint point = {INT, &i};
+            addDataPoint(dataset, i, &point);
+        }
+        const char *text = "x";
+        DataPoint point = {STRING, (void *)text};
+        addDataPoint(dataset, 5, &point);
+
+        FilterKernel kernels[2] = {KERNEL_SCALAR, KERNEL_AUTO};
+        for (int k = 0; k < 2; k++)
+        {
+            setFilterKernel(kernels[k]);
+            AggregateResult result;
+            TS_ASSERT(aggregateValues(dataset, INT, NULL, &result));
+            TS_ASSERT_EQUALS(result.count, 198);
+            TS_ASSERT_EQUALS(result.intSum, 199 * 200 / 2 - 5 - 150);
+            TS_ASSERT_EQUALS(result.min, 0.0);
+            TS_ASSERT_EQUALS(result.max, 199.0);
+            TS_ASSERT_DELTA(result.avg, (199 * 200 / 2 - 155) / 198.0, 1e-9);
+        }
+        setFilterKernel(KERNEL_AUTO);
+        freeDataSet(dataset);
+    }
+
+    void testAggregateWithSelection()
+    {
+        DataSet *dataset = createDataSet(128);
+        for (int i = 0; i < 128; i++)
+        {
+            int value = i % 10;
+            DataPoint point = {INT, &value};
+            addDataPoint(dataset, i, &point);
+        }
+        int32_t operand = 7;
+        Bitmap *selection = filterIntValues(dataset, COMPARE_GE, &operand, 1);
+
+        AggregateResult result;
+        TS_ASSERT(aggregateValues(dataset, INT, selection, &result));
+        TS_ASSERT_EQUALS(result.min, 7.0);
+        TS_ASSERT_EQUALS(result.max, 9.0);
+        TS_ASSERT_EQUALS(result.count, countBitmap(selection));
+        TS_ASSERT_EQUALS(countDistinctValues(dataset, INT, selection), 3);
+        TS_ASSERT_EQUALS(countDistinctValues(dataset, INT, NULL), 10);
+
+        freeBitmap(selection);
+        freeDataSet(dataset);
+    }
+
+    void testAggregateFloatValuesCompensatesSum()
+    {
+        // One large value followed by many small ones that a float accumulator would drop
+        DataSet *dataset = createDataSet(100001);
+        float big = 1.0e8f;
+        float small = 1.0f;
+        DataPoint bigPoint = {FLOAT, &big};
+        DataPoint smallPoint = {FLOAT, &small};
+        addDataPoint(dataset, 0, &bigPoint);
+        for (int i = 1; i < 100001; i++)
+        {
+            addDataPoint(dataset, i, &smallPoint);
+        }
+
+        AggregateResult result;
+        TS_ASSERT(aggregateValues(dataset, FLOAT, NULL, &result));
+        TS_ASSERT_EQUALS(result.count, 100001);
+        TS_ASSERT_EQUALS(result.sum, 1.0e8 + 100000.0);
+        TS_ASSERT_EQUALS(result.min, 1.0);
+        TS_ASSERT_EQUALS(result.max, 1.0e8);
+        TS_ASSERT_EQUALS(countDistinctValues(dataset, FLOAT, NULL), 2);
+
+        freeDataSet(dataset);
+    }
+
+    void testAggregateWithoutValues()
+    {
+        DataSet *dataset = createDataSet(3);
+        AggregateResult result;
+        TS_ASSERT(aggregateValues(dataset, FLOAT, NULL, &result));
+        TS_ASSERT_EQUALS(result.count, 0);
+        TS_ASSERT_EQUALS(result.avg, 0.0);
+        TS_ASSERT(!aggregateValues(dataset, STRING, NULL, &result));
+        TS_ASSERT(!aggregateValues(NULL, INT, NULL, &result));
+        TS_ASSERT_EQUALS(countDistinctValues(dataset, INT, NULL), 0);
+        freeDataSet(dataset);
+    }
+};
@@ -0,0 +1,87 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/allocator.h"
+
+class AllocatorTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testDataSetInArena()
+    {
+        Allocator *arena = createArenaAllocator(4096);
+        TS_ASSERT(arena != NULL);
+        DataSet *dataset = createDataSetWithAllocator(8, arena);
+        TS_ASSERT(dataset != NULL);
+        TS_ASSERT(dataset->allocator == arena);
+
+        // Appends grow the arrays inside the arena
+        for (int i = 0; i < 3000; i++)
+        {
+            char text[16];
+            snprintf(text, sizeof(text), "s%d", i % 50);
+            int value = i;
+            DataPoint point = {INT, &value};
+            DataPoint string = {STRING, text};
+            appendDataPoint(dataset, i % 2 == 0 ? &point : &string);
+        }
+        TS_ASSERT_EQUALS(dataset->size, 3000);
+        TS_ASSERT_EQUALS(countByType(dataset, INT), 1500);
+        TS_ASSERT(encodeStringDictionary(dataset));
+        TS_ASSERT_EQUALS(dataset->dictionary->count, 25);
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(dataset, 2998)->value), 2998);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(dataset, 2999)->value, "s49"), 0);
+
+        // Copies are taken from malloc, so they outlive the arena
+        DataSet *copy = filterByType(dataset, STRING);
+        TS_ASSERT(copy->allocator == NULL);
+
+        freeDataSet(dataset);
+        freeArenaAllocator(arena);
+        TS_ASSERT_EQUALS(countDataPoints(copy), 1500);
+        freeDataSet(copy);
+    }
+
+    void testArenaFreesDataSetsAtOnce()
+    {
+        Allocator *arena = createArenaAllocator(0);
+        DataSet *datasets[4];
+        for (int d = 0; d < 4; d++)
+        {
+            datasets[d] = createDataSetWithAllocator(1000, arena);
+            float values[1000];
+            for (int i = 0; i < 1000; i++)
+            {
+                values[i] = d + i * 0.5f;
+            }
+            TS_ASSERT(addFloatValues(datasets[d], 0, values, 1000));
+        }
+        TS_ASSERT_EQUALS(*((float *)getDataPoint(datasets[3], 999)->value), 502.5f);
+        TS_ASSERT_EQUALS(countByType(datasets[0], FLOAT), 1000);
+        // Freeing the arena releases every dataset without freeDataSet
+        freeArenaAllocator(arena);
+        freeArenaAllocator(NULL);
+    }
+
+    void testArenaShrinkThenGrowIsZeroFilled()
+    {
+        Allocator *arena = createArenaAllocator(4096);
+        unsigned char *block = (unsigned char *)arena->allocate(arena->context, 64);
+        memset(block, 0xff, 64);
+        TS_ASSERT(arena->resize(arena->context, block, 64, 16) == block);
+
+        // Growing in place again hands back zeros past the shrunk size
+        unsigned char *grown = (unsigned char *)arena->resize(arena->context, block, 16, 64);
+        TS_ASSERT(grown == block);
+        int stale = 0;
+        for (int i = 16; i < 64; i++)
+        {
+            stale += grown[i] != 0;
+        }
+        TS_ASSERT_EQUALS(stale, 0);
+        TS_ASSERT_EQUALS(grown[15], 0xff);
+
+        // The tail given back by a shrink is handed out again
+        unsigned char *next = (unsigned char *)arena->allocate(arena->context, 16);
+        TS_ASSERT(arena->resize(arena->context, next, 16, 0) == next);
+        TS_ASSERT(arena->allocate(arena->context, 16) == next + 16);
+        freeArenaAllocator(arena);
+    }
+};
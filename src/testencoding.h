@@ -0,0 +1,199 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/encoding.h"
+#include "../src/filter.h"
+#include "../src/aggregate.h"
+#include "../src/parallel.h"
+
+class EncodingTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testSealChoosesEncodingPerBlock()
+    {
+        // Sorted timestamps, constant runs, a small range and a full range, one block each
+        const int size = 4 * 1024;
+        int values[size];
+        unsigned int seed = 7;
+        for (int i = 0; i < 1024; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            values[i] = 1700000000 + i * 60 + (int)(seed >> 16) % 3;
+            values[1024 + i] = i / 256;
+            values[2048 + i] = 5000 + (int)(seed >> 16) % 100;
+            values[3072 + i] = (int)(seed * 2654435761u);
+        }
+        DataSet *dataset = createDataSet(size);
+        TS_ASSERT(addIntValues(dataset, 0, values, size));
+        TS_ASSERT(sealDataSet(dataset));
+        TS_ASSERT(sealDataSet(dataset));
+        TS_ASSERT(dataset->ints == NULL);
+        EncodedInts *column = dataset->encodedInts;
+        TS_ASSERT_EQUALS(column->blockCount, 4);
+        TS_ASSERT_EQUALS(column->blocks[0].encoding, ENCODING_DELTA);
+        TS_ASSERT_EQUALS(column->blocks[1].encoding, ENCODING_RLE);
+        TS_ASSERT_EQUALS(column->blocks[1].runs, 4);
+        TS_ASSERT_EQUALS(column->blocks[2].encoding, ENCODING_FOR);
+        TS_ASSERT_EQUALS(column->blocks[2].bitWidth, 7);
+        TS_ASSERT_EQUALS(column->blocks[3].encoding, ENCODING_PLAIN);
+        TS_ASSERT(column->length < (size_t)size * sizeof(int32_t) / 2);
+
+        for (int i = 0; i < size; i++)
+        {
+            DataPoint *point = getDataPoint(dataset, i);
+            TS_ASSERT_EQUALS(point->type, INT);
+            TS_ASSERT_EQUALS(*((int *)point->value), values[i]);
+        }
+        freeDataSet(dataset);
+        TS_ASSERT(!sealDataSet(NULL));
+    }
+
+    void testSealedResultsMatchPlain()
+    {
+        // Runs, ramps and noise with FLOAT, STRING and empty slots in between, ending mid-block
+        const int size = 5000;
+        DataSet *plain = createDataSet(size);
+        DataSet *sealed = createDataSet(size);
+        unsigned int seed = 11;
+        for (int i = 0; i < size; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            int value = i < 1500 ? i / 100 : i < 3000 ? 40 + i * 3 : (int)(seed >> 16) % 64;
+            float number = i * 0.5f;
+            DataPoint point = {INT, &value};
+            if (i % 7 == 3)
+            {
+                point.type = FLOAT;
+                point.value = &number;
+            }
+            else if (i % 11 == 5)
+            {
+                point.type = STRING;
+                point.value = (void *)"text";
+            }
+            else if (i % 13 == 0)
+            {
+                continue;
+            }
+            addDataPoint(plain, i, &point);
+            addDataPoint(sealed, i, &point);
+        }
+        TS_ASSERT(sealDataSet(sealed));
+
+        Bitmap *every = createBitmap(size);
+        for (int i = 0; i < size; i += 3)
+        {
+            every->words[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+        CompareOp ops[8] = {COMPARE_EQ, COMPARE_NE, COMPARE_LT, COMPARE_LE, COMPARE_GT, COMPARE_GE, COMPARE_BETWEEN, COMPARE_IN};
+        int operands[4][3] = {{7, 20, 9000}, {-5, 5, 3}, {4000, 4100, 50}, {100000, 200000, 0}};
+        FilterKernel kernels[2] = {KERNEL_SCALAR, KERNEL_AUTO};
+        for (int k = 0; k < 2; k++)
+        {
+            setFilterKernel(kernels[k]);
+            for (int o = 0; o < 8; o++)
+            {
+                for (int v = 0; v < 4; v++)
+                {
+                    Bitmap *expected = filterIntValues(plain, ops[o], operands[v], 3);
+                    Bitmap *actual = filterIntValues(sealed, ops[o], operands[v], 3);
+                    Bitmap *parallel = parallelFilterIntValues(sealed, ops[o], operands[v], 3);
+                    TS_ASSERT_EQUALS(memcmp(expected->words, actual->words, (size + 63) / 64 * sizeof(uint64_t)), 0);
+                    TS_ASSERT_EQUALS(memcmp(expected->words, parallel->words, (size + 63) / 64 * sizeof(uint64_t)), 0);
+                    freeBitmap(expected);
+                    freeBitmap(actual);
+                    freeBitmap(parallel);
+                }
+            }
+
+            const Bitmap *selections[2] = {NULL, every};
+            for (int s = 0; s < 2; s++)
+            {
+                AggregateResult expected, actual, parallel;
+                TS_ASSERT(aggregateValues(plain, INT, selections[s], &expected));
+                TS_ASSERT(aggregateValues(sealed, INT, selections[s], &actual));
+                TS_ASSERT(parallelAggregateValues(sealed, INT, selections[s], &parallel));
+                TS_ASSERT_EQUALS(actual.count, expected.count);
+                TS_ASSERT_EQUALS(actual.intSum, expected.intSum);
+                TS_ASSERT_EQUALS(actual.min, expected.min);
+                TS_ASSERT_EQUALS(actual.max, expected.max);
+                TS_ASSERT_EQUALS(parallel.intSum, expected.intSum);
+                TS_ASSERT_EQUALS(countDistinctValues(sealed, INT, selections[s]), countDistinctValues(plain, INT, selections[s]));
+            }
+        }
+        setFilterKernel(KERNEL_AUTO);
+
+        // Copies of a sealed dataset hold plain values
+        DataSet *copies[2] = {filterByType(sealed, INT), parallelFilterByType(sealed, INT)};
+        for (int c = 0; c < 2; c++)
+        {
+            TS_ASSERT(copies[c]->encodedInts == NULL);
+            TS_ASSERT_EQUALS(countDataPoints(copies[c]), countByType(plain, INT));
+            for (int i = 0; i < size; i++)
+            {
+                DataPoint *expected = getDataPoint(plain, i);
+                DataPoint *actual = getDataPoint(copies[c], i);
+                if (expected != NULL && expected->type == INT)
+                {
+                    TS_ASSERT_EQUALS(*((int *)actual->value), *((int *)expected->value));
+                }
+            }
+            freeDataSet(copies[c]);
+        }
+        freeBitmap(every);
+        freeDataSet(plain);
+        freeDataSet(sealed);
+    }
+
+    void testSealedDataSetIsReadOnly()
+    {
+        DataSet *dataset = createDataSet(10);
+        int value = 42;
+        DataPoint point = {INT, &value};
+        addDataPoint(dataset, 2, &point);
+        addDataPoint(dataset, 6, &point);
+        TS_ASSERT(sealDataSet(dataset));
+
+        int other = 1;
+        DataPoint update = {INT, &other};
+        addDataPoint(dataset, 3, &update);
+        TS_ASSERT(getDataPoint(dataset, 3) == NULL);
+        TS_ASSERT_EQUALS(appendDataPoint(dataset, &update), -1);
+        TS_ASSERT(!addIntValues(dataset, 0, &other, 1));
+        TS_ASSERT(!resizeDataSet(dataset, 20));
+        TS_ASSERT(!reserveDataSet(dataset, 20));
+        TS_ASSERT(!encodeStringDictionary(dataset));
+        TS_ASSERT_EQUALS(dataset->size, 10);
+        TS_ASSERT_EQUALS(countByType(dataset, INT), 2);
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(dataset, 6)->value), 42);
+        freeDataSet(dataset);
+
+        // An empty dataset seals to an empty column
+        DataSet *empty = createDataSetWithCapacity(4);
+        TS_ASSERT(sealDataSet(empty));
+        TS_ASSERT_EQUALS(empty->encodedInts->blockCount, 0);
+        freeDataSet(empty);
+    }
+
+    void testSealedDataPointsKeepTheirValues()
+    {
+        DataSet *dataset = createDataSetWithCapacity(0);
+        for (int i = 0; i < 3000; i++)
+        {
+            int value = i * 5 - 7;
+            DataPoint point = {INT, &value};
+            appendDataPoint(dataset, &point);
+        }
+        TS_ASSERT(sealDataSet(dataset));
+
+        // Each point decoded from a sealed dataset points at a value of its own
+        int *values[3];
+        for (int i = 0; i < 3; i++)
+        {
+            values[i] = (int *)getDataPoint(dataset, i * 1000 + 1)->value;
+        }
+        TS_ASSERT_EQUALS(*values[0], 1 * 5 - 7);
+        TS_ASSERT_EQUALS(*values[1], 1001 * 5 - 7);
+        TS_ASSERT_EQUALS(*values[2], 2001 * 5 - 7);
+        TS_ASSERT(values[0] != values[1]);
+        freeDataSet(dataset);
+    }
+};
@@ -0,0 +1,176 @@
+#include <cxxtest/TestSuite.h>
+#include <math.h>
+#include "../src/filter.h"
+
+#include <thread>
+#include <vector>
+
+class FilterTestSuite : public CxxTest::TestSuite
+{
+public:
+    // Build a dataset of size slots: INT values at even slots, FLOAT values at slots that are 1 mod 4
+    DataSet *createMixedDataSet(int size)
+    {
+        DataSet *dataset = createDataSet(size);
+        for (int i = 0; i < size; i++)
+        {
+            if (i % 2 == 0)
+            {
+                int value = (i * 7) % 101 - 50;
+                DataPoint point = {INT, &value};
+                addDataPoint(dataset, i, &point);
+            }
+            else if (i % 4 == 1)
+            {
+                float value = (float)((i * 3) % 41) - 20.5f;
+                DataPoint point = {FLOAT, &value};
+                addDataPoint(dataset, i, &point);
+            }
+        }
+        return dataset;
+    }
+
+    void testFilterIntValuesMatchesScalarKernel()
+    {
+        DataSet *dataset = createMixedDataSet(1000);
+        int32_t operands[3] = {-10, 20, 33};
+        FilterKernel kernels[3] = {KERNEL_SCALAR, KERNEL_AVX2, KERNEL_AVX512};
+        for (int op = COMPARE_EQ; op <= COMPARE_IN; op++)
+        {
+            // Count the expected matches by hand
+            int expected = 0;
+            for (int i = 0; i < 1000; i += 2)
+            {
+                int value = *(int *)getDataPoint(dataset, i)->value;
+                bool match = op == COMPARE_EQ   ? value == -10
+                             : op == COMPARE_NE ? value != -10
+                             : op == COMPARE_LT ? value < -10
+                             : op == COMPARE_LE ? value <= -10
+                             : op == COMPARE_GT ? value > -10
+                             : op == COMPARE_GE ? value >= -10
+                             : op == COMPARE_BETWEEN ? value >= -10 && value <= 20
+                                                     : value == -10 || value == 20 || value == 33;
+                expected += match;
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                if (!setFilterKernel(kernels[k]))
+                {
+                    continue;
+                }
+                Bitmap *selection = filterIntValues(dataset, (CompareOp)op, operands, 3);
+                TS_ASSERT(selection != NULL);
+                TS_ASSERT_EQUALS(countBitmap(selection), expected);
+                // FLOAT and empty slots are never selected
+                TS_ASSERT(!testBitmap(selection, 1));
+                TS_ASSERT(!testBitmap(selection, 3));
+                freeBitmap(selection);
+            }
+        }
+        setFilterKernel(KERNEL_AUTO);
+        freeDataSet(dataset);
+    }
+
+    void testFilterFloatValuesBetween()
+    {
+        DataSet *dataset = createMixedDataSet(130);
+        float operands[2] = {-5.0f, 5.0f};
+        FilterKernel kernels[3] = {KERNEL_SCALAR, KERNEL_AVX2, KERNEL_AVX512};
+        for (int k = 0; k < 3; k++)
+        {
+            if (!setFilterKernel(kernels[k]))
+            {
+                continue;
+            }
+            Bitmap *selection = filterFloatValues(dataset, COMPARE_BETWEEN, operands, 2);
+            for (int i = 0; i < 130; i++)
+            {
+                DataPoint *point = getDataPoint(dataset, i);
+                bool expected = point != NULL && point->type == FLOAT &&
+                                *(float *)point->value >= -5.0f && *(float *)point->value <= 5.0f;
+                TS_ASSERT_EQUALS(testBitmap(selection, i), expected);
+            }
+            freeBitmap(selection);
+        }
+        setFilterKernel(KERNEL_AUTO);
+        freeDataSet(dataset);
+    }
+
+    void testFilterFloatValuesWithNaN()
+    {
+        DataSet *dataset = createDataSet(2);
+        float value1 = NAN;
+        float value2 = 1.0f;
+        DataPoint point1 = {FLOAT, &value1};
+        DataPoint point2 = {FLOAT, &value2};
+        addDataPoint(dataset, 0, &point1);
+        addDataPoint(dataset, 1, &point2);
+
+        float operand = 1.0f;
+        Bitmap *equal = filterFloatValues(dataset, COMPARE_EQ, &operand, 1);
+        Bitmap *notEqual = filterFloatValues(dataset, COMPARE_NE, &operand, 1);
+        TS_ASSERT_EQUALS(countBitmap(equal), 1);
+        TS_ASSERT(testBitmap(notEqual, 0));
+        TS_ASSERT(!testBitmap(notEqual, 1));
+
+        freeBitmap(equal);
+        freeBitmap(notEqual);
+        freeDataSet(dataset);
+    }
+
+    void testFilterWithInvalidOperands()
+    {
+        DataSet *dataset = createMixedDataSet(10);
+        int32_t operand = 3;
+        TS_ASSERT(filterIntValues(NULL, COMPARE_EQ, &operand, 1) == NULL);
+        TS_ASSERT(filterIntValues(dataset, COMPARE_EQ, NULL, 1) == NULL);
+        TS_ASSERT(filterIntValues(dataset, COMPARE_BETWEEN, &operand, 1) == NULL);
+        freeDataSet(dataset);
+    }
+
+    void testFilterWithoutValuesOfType()
+    {
+        DataSet *dataset = createDataSet(5);
+        float operand = 0.0f;
+        Bitmap *selection = filterFloatValues(dataset, COMPARE_GE, &operand, 1);
+        TS_ASSERT(selection != NULL);
+        TS_ASSERT_EQUALS(countBitmap(selection), 0);
+        freeBitmap(selection);
+        freeDataSet(dataset);
+    }
+
+    void testSetFilterKernelWhileFiltering()
+    {
+        // Threads filter while another switches kernels; every kernel gives the same selection
+        DataSet *dataset = createMixedDataSet(5000);
+        int32_t operand = 0;
+        Bitmap *expected = filterIntValues(dataset, COMPARE_LT, &operand, 1);
+        std::vector<int> mismatches(3, 0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 3; t++)
+        {
+            threads.push_back(std::thread([&, t]() {
+                for (int i = 0; i < 50; i++)
+                {
+                    Bitmap *selection = filterIntValues(dataset, COMPARE_LT, &operand, 1);
+                    mismatches[t] += memcmp(selection->words, expected->words, (5000 + 63) / 64 * sizeof(uint64_t)) != 0;
+                    freeBitmap(selection);
+                }
+            }));
+        }
+        FilterKernel kernels[3] = {KERNEL_SCALAR, KERNEL_AVX2, KERNEL_AVX512};
+        for (int i = 0; i < 300; i++)
+        {
+            setFilterKernel(kernels[i % 3]);
+        }
+        for (int t = 0; t < 3; t++)
+        {
+            threads[t].join();
+            TS_ASSERT_EQUALS(mismatches[t], 0);
+        }
+        TS_ASSERT(setFilterKernel(KERNEL_AUTO));
+        TS_ASSERT(getFilterKernel() != KERNEL_AUTO);
+        freeBitmap(expected);
+        freeDataSet(dataset);
+    }
+};
@@ -0,0 +1,182 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/groupby.h"
+#include "../src/encoding.h"
+
+#include <map>
+#include <string>
+
+class GroupByTestSuite : public CxxTest::TestSuite
+{
+public:
+    // Find the group holding a key, or -1
+    int64_t findKey(GroupByResult *result, DataPoint *key)
+    {
+        for (int64_t g = 0; g < result->count; g++)
+        {
+            DataPoint *point = getDataPoint(result->keys, g);
+            if (point->type != key->type)
+            {
+                continue;
+            }
+            if (key->type == STRING ? strcmp((char *)point->value, (char *)key->value) == 0
+                                    : memcmp(point->value, key->value, 4) == 0)
+            {
+                return g;
+            }
+        }
+        return -1;
+    }
+
+    void testStringKeysMatchMap()
+    {
+        // STRING categories in one dataset, FLOAT metrics in the other
+        const int size = 20000;
+        DataSet *keys = createDataSet(size);
+        DataSet *values = createDataSet(size);
+        std::map<std::string, double> sums;
+        std::map<std::string, int64_t> counts;
+        std::map<std::string, double> maxima;
+        for (int i = 0; i < size; i++)
+        {
+            char text[16];
+            snprintf(text, sizeof(text), "c%d", (i * 7) % 101);
+            float metric = (float)(i % 13) - 4.0f;
+            DataPoint key = {STRING, text};
+            DataPoint value = {FLOAT, &metric};
+            addDataPoint(keys, i, &key);
+            if (i % 10 != 9)
+            {
+                addDataPoint(values, i, &value);
+                sums[text] += metric;
+                counts[text]++;
+                maxima[text] = counts[text] == 1 || metric > maxima[text] ? metric : maxima[text];
+            }
+        }
+        for (int dictionary = 0; dictionary < 2; dictionary++)
+        {
+            if (dictionary)
+            {
+                TS_ASSERT(encodeStringDictionary(keys));
+            }
+            GroupByResult *result = groupByValues(keys, STRING, values, FLOAT, NULL);
+            TS_ASSERT(result != NULL);
+            TS_ASSERT_EQUALS(result->count, (int64_t)counts.size());
+            // Groups come in the order of their first data point
+            TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(result->keys, 0)->value, "c0"), 0);
+            TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(result->keys, 1)->value, "c7"), 0);
+            for (std::map<std::string, int64_t>::iterator it = counts.begin(); it != counts.end(); ++it)
+            {
+                DataPoint key = {STRING, (void *)it->first.c_str()};
+                int64_t g = findKey(result, &key);
+                TS_ASSERT(g >= 0);
+                TS_ASSERT_EQUALS(result->results[g].count, it->second);
+                TS_ASSERT_DELTA(result->results[g].sum, sums[it->first], 1e-6);
+                TS_ASSERT_EQUALS(result->results[g].max, maxima[it->first]);
+            }
+            freeGroupByResult(result);
+        }
+        freeDataSet(keys);
+        freeDataSet(values);
+    }
+
+    void testNumericKeysAndGrowth()
+    {
+        // Many distinct INT keys grow the table several times; the values are the keys' halves
+        const int size = 100000;
+        DataSet *keys = createDataSet(size);
+        DataSet *values = createDataSet(size);
+        int32_t *ints = (int32_t *)malloc(size * sizeof(int32_t));
+        for (int i = 0; i < size; i++)
+        {
+            ints[i] = (i % 30000) * 2 - 30000;
+        }
+        TS_ASSERT(addIntValues(keys, 0, ints, size));
+        for (int i = 0; i < size; i++)
+        {
+            ints[i] /= 2;
+        }
+        TS_ASSERT(addIntValues(values, 0, ints, size));
+        free(ints);
+        TS_ASSERT(sealDataSet(values));
+        GroupByResult *result = groupByValues(keys, INT, values, INT, NULL);
+        TS_ASSERT_EQUALS(result->count, 30000);
+        for (int64_t g = 0; g < result->count; g += 997)
+        {
+            int key = *(int *)getDataPoint(result->keys, g)->value;
+            TS_ASSERT_EQUALS(key, (int)g * 2 - 30000);
+            int64_t count = g < size % 30000 ? 4 : 3;
+            TS_ASSERT_EQUALS(result->results[g].count, count);
+            TS_ASSERT_EQUALS(result->results[g].intSum, count * (key / 2));
+            TS_ASSERT_EQUALS(result->results[g].min, key / 2);
+        }
+        freeGroupByResult(result);
+
+        // FLOAT keys: -0 joins 0 and every NaN joins one group
+        float floatKeys[5] = {0.0f, -0.0f, 0.0f / 0.0f, 1.5f, -(0.0f / 0.0f)};
+        DataSet *small = createDataSet(5);
+        DataSet *smallValues = createDataSet(5);
+        int32_t ones[5] = {1, 2, 3, 4, 5};
+        TS_ASSERT(addFloatValues(small, 0, floatKeys, 5));
+        TS_ASSERT(addIntValues(smallValues, 0, ones, 5));
+        result = groupByValues(small, FLOAT, smallValues, INT, NULL);
+        TS_ASSERT_EQUALS(result->count, 3);
+        TS_ASSERT_EQUALS(result->results[0].intSum, 3);
+        TS_ASSERT_EQUALS(result->results[1].intSum, 8);
+        TS_ASSERT_EQUALS(result->results[2].intSum, 4);
+        freeGroupByResult(result);
+
+        TS_ASSERT(groupByValues(small, FLOAT, smallValues, STRING, NULL) == NULL);
+        TS_ASSERT(groupByValues(keys, INT, smallValues, INT, NULL) == NULL);
+        TS_ASSERT(groupByValues(NULL, INT, smallValues, INT, NULL) == NULL);
+        freeGroupByResult(NULL);
+        freeDataSet(small);
+        freeDataSet(smallValues);
+        freeDataSet(keys);
+        freeDataSet(values);
+    }
+
+    void testSelectionAndMissingSlots()
+    {
+        // Only slots holding a key and a value, and selected, are grouped
+        DataSet *keys = createDataSet(200);
+        DataSet *values = createDataSet(200);
+        Bitmap *selection = createBitmap(200);
+        int64_t expected = 0;
+        for (int i = 0; i < 200; i++)
+        {
+            int key = i % 4;
+            float value = 1.0f;
+            DataPoint keyPoint = {INT, &key};
+            DataPoint valuePoint = {FLOAT, &value};
+            if (i % 3 != 0)
+            {
+                addDataPoint(keys, i, &keyPoint);
+            }
+            if (i % 5 != 0)
+            {
+                addDataPoint(values, i, &valuePoint);
+            }
+            if (i < 150)
+            {
+                selection->words[i / 64] |= (uint64_t)1 << (i % 64);
+            }
+            expected += i % 3 != 0 && i % 5 != 0 && i < 150;
+        }
+        GroupByResult *result = groupByValues(keys, INT, values, FLOAT, selection);
+        TS_ASSERT_EQUALS(result->count, 4);
+        int64_t total = 0;
+        for (int64_t g = 0; g < result->count; g++)
+        {
+            total += result->results[g].count;
+            TS_ASSERT_EQUALS(result->results[g].avg, 1.0);
+        }
+        TS_ASSERT_EQUALS(total, expected);
+        freeGroupByResult(result);
+        result = groupByValues(keys, STRING, values, FLOAT, NULL);
+        TS_ASSERT_EQUALS(result->count, 0);
+        freeGroupByResult(result);
+        freeBitmap(selection);
+        freeDataSet(keys);
+        freeDataSet(values);
+    }
+};
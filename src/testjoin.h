@@ -0,0 +1,185 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/join.h"
+
+#include <vector>
+
+class JoinTestSuite : public CxxTest::TestSuite
+{
+public:
+    // INT keys i * step % modulo, every fifth slot holding a FLOAT and every seventh empty
+    DataSet *createKeys(int size, int step, int modulo)
+    {
+        DataSet *dataset = createDataSet(size);
+        for (int i = 0; i < size; i++)
+        {
+            int key = i * step % modulo;
+            float other = (float)key;
+            DataPoint point = {INT, &key};
+            if (i % 5 == 4)
+            {
+                point.type = FLOAT;
+                point.value = &other;
+            }
+            if (i % 7 != 6)
+            {
+                addDataPoint(dataset, i, &point);
+            }
+        }
+        return dataset;
+    }
+
+    // Join two INT datasets with nested loops
+    void nestedLoopJoin(DataSet *left, DataSet *right, JoinType type, std::vector<int64_t> *lefts, std::vector<int64_t> *rights)
+    {
+        for (int64_t i = 0; i < left->size; i++)
+        {
+            DataPoint *point = getDataPoint(left, i);
+            if (point == NULL || point->type != INT)
+            {
+                continue;
+            }
+            int key = *(int *)point->value;
+            bool found = false;
+            for (int64_t j = 0; j < right->size; j++)
+            {
+                DataPoint *other = getDataPoint(right, j);
+                if (other != NULL && other->type == INT && *(int *)other->value == key)
+                {
+                    found = true;
+                    if (type == JOIN_INNER || type == JOIN_LEFT)
+                    {
+                        lefts->push_back(i);
+                        rights->push_back(j);
+                    }
+                }
+            }
+            if ((type == JOIN_SEMI && found) || ((type == JOIN_LEFT || type == JOIN_ANTI) && !found))
+            {
+                lefts->push_back(i);
+                rights->push_back(-1);
+            }
+        }
+    }
+
+    void testJoinTypesMatchNestedLoops()
+    {
+        // Each order of sizes builds the table on a different side
+        for (int swap = 0; swap < 2; swap++)
+        {
+            DataSet *left = createKeys(swap ? 200 : 300, 1, 50);
+            DataSet *right = createKeys(swap ? 300 : 200, 3, 70);
+            for (int type = JOIN_INNER; type <= JOIN_ANTI; type++)
+            {
+                std::vector<int64_t> lefts, rights;
+                nestedLoopJoin(left, right, (JoinType)type, &lefts, &rights);
+                JoinResult *result = joinDataSets(left, right, INT, (JoinType)type);
+                TS_ASSERT(result != NULL);
+                TS_ASSERT_EQUALS(result->count, (int64_t)lefts.size());
+                TS_ASSERT_EQUALS(result->right == NULL, type == JOIN_SEMI || type == JOIN_ANTI);
+                for (int64_t i = 0; i < result->count && i < (int64_t)lefts.size(); i++)
+                {
+                    TS_ASSERT_EQUALS(result->left[i], lefts[i]);
+                    if (result->right != NULL)
+                    {
+                        TS_ASSERT_EQUALS(result->right[i], rights[i]);
+                    }
+                }
+                freeJoinResult(result);
+            }
+            freeDataSet(left);
+            freeDataSet(right);
+        }
+    }
+
+    void testStringKeysAcrossDictionaries()
+    {
+        // The dictionaries number the strings differently, so keys match by their bytes
+        DataSet *left = createDataSet(100);
+        DataSet *right = createDataSet(40);
+        char text[16];
+        for (int i = 0; i < 100; i++)
+        {
+            snprintf(text, sizeof(text), "k%d", i % 20);
+            DataPoint point = {STRING, text};
+            addDataPoint(left, i, &point);
+        }
+        for (int i = 0; i < 40; i++)
+        {
+            snprintf(text, sizeof(text), "k%d", 39 - i);
+            DataPoint point = {STRING, text};
+            addDataPoint(right, i, &point);
+        }
+        TS_ASSERT(encodeStringDictionary(left));
+        TS_ASSERT(encodeStringDictionary(right));
+        JoinResult *result = joinDataSets(left, right, STRING, JOIN_INNER);
+        TS_ASSERT_EQUALS(result->count, 100);
+        TS_ASSERT_EQUALS(result->left[0], 0);
+        TS_ASSERT_EQUALS(result->right[0], 39);
+        freeJoinResult(result);
+        result = joinDataSets(right, left, STRING, JOIN_ANTI);
+        TS_ASSERT_EQUALS(result->count, 20);
+        TS_ASSERT_EQUALS(result->left[0], 0);
+        freeJoinResult(result);
+        result = joinDataSets(left, right, INT, JOIN_SEMI);
+        TS_ASSERT_EQUALS(result->count, 0);
+        freeJoinResult(result);
+        TS_ASSERT(joinDataSets(left, right, FLOAT, JOIN_INNER) == NULL);
+        TS_ASSERT(joinDataSets(left, NULL, STRING, JOIN_INNER) == NULL);
+        TS_ASSERT(joinDataSets(left, right, STRING, (JoinType)4) == NULL);
+        freeJoinResult(NULL);
+        freeDataSet(left);
+        freeDataSet(right);
+    }
+
+    void testPartitionedJoin()
+    {
+        // Enough keys on both sides to split the join into partitions
+        const int leftSize = 120000;
+        const int rightSize = 90000;
+        const int modulo = 60000;
+        for (int swap = 0; swap < 2; swap++)
+        {
+            DataSet *left = createDataSet(swap ? rightSize : leftSize);
+            DataSet *right = createDataSet(swap ? leftSize : rightSize);
+            std::vector<int32_t> leftKeys(left->size), rightKeys(right->size);
+            for (int64_t i = 0; i < left->size; i++)
+            {
+                leftKeys[i] = (int32_t)(i * 7 % modulo);
+            }
+            for (int64_t i = 0; i < right->size; i++)
+            {
+                rightKeys[i] = (int32_t)(i % (modulo + modulo / 2));
+            }
+            TS_ASSERT(addIntValues(left, 0, leftKeys.data(), left->size));
+            TS_ASSERT(addIntValues(right, 0, rightKeys.data(), right->size));
+
+            // Right slots of each key, in slot order
+            std::vector<std::vector<int64_t> > slots(modulo + modulo / 2);
+            for (int64_t j = 0; j < right->size; j++)
+            {
+                slots[rightKeys[j]].push_back(j);
+            }
+            JoinResult *inner = joinDataSets(left, right, INT, JOIN_INNER);
+            JoinResult *outer = joinDataSets(left, right, INT, JOIN_LEFT);
+            int64_t position = 0;
+            int64_t unmatched = 0;
+            bool same = true;
+            for (int64_t i = 0; i < left->size; i++)
+            {
+                const std::vector<int64_t> &matches = slots[leftKeys[i]];
+                unmatched += matches.empty();
+                for (size_t m = 0; m < matches.size() && position < inner->count; m++, position++)
+                {
+                    same = same && inner->left[position] == i && inner->right[position] == matches[m];
+                }
+            }
+            TS_ASSERT(same);
+            TS_ASSERT_EQUALS(inner->count, position);
+            TS_ASSERT_EQUALS(outer->count, inner->count + unmatched);
+            freeJoinResult(inner);
+            freeJoinResult(outer);
+            freeDataSet(left);
+            freeDataSet(right);
+        }
+    }
+};
@@ -0,0 +1,197 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/live.h"
+#include "../src/aggregate.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class LiveTestSuite : public CxxTest::TestSuite
+{
+public:
+    // Check that a slot holds the value it was appended with: i for an even slot, "s<i>" or "r<i>" for an odd one
+    static bool holdsExpectedValue(const LiveValue &value, int64_t index)
+    {
+        if (index % 2 == 0)
+        {
+            return value.type == INT && value.intValue == (int32_t)index;
+        }
+        char expected[32];
+        int length = snprintf(expected, sizeof(expected), "s%lld", (long long)index);
+        return value.type == STRING && value.stringValue.length == (uint32_t)length &&
+               (value.stringValue.data[0] == 's' || value.stringValue.data[0] == 'r') &&
+               memcmp(value.stringValue.data + 1, expected + 1, length - 1) == 0;
+    }
+
+    // Append slot index with the value holdsExpectedValue looks for
+    static int64_t appendExpectedValue(LiveDataSet *live, int64_t index)
+    {
+        int32_t number = (int32_t)index;
+        char text[32];
+        snprintf(text, sizeof(text), "s%lld", (long long)index);
+        DataPoint point = {INT, &number};
+        DataPoint string = {STRING, text};
+        return appendLiveDataPoint(live, index % 2 == 0 ? &point : &string);
+    }
+
+    void testAppendReplaceAndSnapshot()
+    {
+        LiveDataSet *live = createLiveDataSet(false);
+        const int64_t size = LIVE_SEGMENT_SIZE * 20;
+        for (int64_t i = 0; i < size; i++)
+        {
+            TS_ASSERT_EQUALS(appendExpectedValue(live, i), i);
+        }
+        TS_ASSERT_EQUALS(getLiveSize(live), size);
+
+        // Replacing retires the old strings, which are freed while no reader holds them
+        char text[32];
+        for (int64_t i = 1; i < 1000; i += 2)
+        {
+            snprintf(text, sizeof(text), "r%lld", (long long)i);
+            DataPoint string = {STRING, text};
+            TS_ASSERT(replaceLiveDataPoint(live, i, &string));
+        }
+        int32_t number = 3;
+        DataPoint point = {INT, &number};
+        DataPoint empty = {STRING, (void *)""};
+        TS_ASSERT(!replaceLiveDataPoint(live, 1, &point));
+        TS_ASSERT(!replaceLiveDataPoint(live, size, &point));
+        TS_ASSERT_EQUALS(appendLiveDataPoint(live, &empty), -1);
+        TS_ASSERT_EQUALS(appendLiveDataPoint(NULL, &point), -1);
+
+        LiveReader *reader = attachLiveReader(live);
+        LiveValue value;
+        TS_ASSERT(!readLiveValue(reader, 0, &value));
+        beginLiveRead(reader);
+        TS_ASSERT(readLiveValue(reader, 3, &value));
+        TS_ASSERT_EQUALS(strcmp(value.stringValue.data, "r3"), 0);
+        TS_ASSERT(readLiveValue(reader, 1001, &value));
+        TS_ASSERT_EQUALS(strcmp(value.stringValue.data, "s1001"), 0);
+        TS_ASSERT(!readLiveValue(reader, size, &value));
+
+        // The snapshot is an ordinary dataset
+        DataSet *snapshot = snapshotLiveDataSet(reader);
+        endLiveRead(reader);
+        TS_ASSERT_EQUALS(snapshot->size, size);
+        TS_ASSERT_EQUALS(countByType(snapshot, STRING), size / 2);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(snapshot, 999)->value, "r999"), 0);
+        AggregateResult result;
+        TS_ASSERT(aggregateValues(snapshot, INT, NULL, &result));
+        TS_ASSERT_EQUALS(result.intSum, (size / 2) * (size - 2) / 2);
+        TS_ASSERT(snapshotLiveDataSet(reader) == NULL);
+        freeDataSet(snapshot);
+
+        // Every reader slot can be taken once
+        std::vector<LiveReader *> readers;
+        for (LiveReader *other = attachLiveReader(live); other != NULL; other = attachLiveReader(live))
+        {
+            readers.push_back(other);
+        }
+        TS_ASSERT_EQUALS(readers.size(), (size_t)LIVE_MAX_READERS - 1);
+        for (size_t r = 0; r < readers.size(); r++)
+        {
+            detachLiveReader(readers[r]);
+        }
+        detachLiveReader(reader);
+        freeLiveDataSet(live);
+    }
+
+    void testReadersDuringAppends()
+    {
+        // One writer appends and replaces while readers check every published slot
+        LiveDataSet *live = createLiveDataSet(false);
+        const int64_t size = 40000;
+        std::atomic<bool> done(false);
+        std::atomic<int64_t> mismatches(0);
+        std::atomic<int64_t> reads(0);
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 3; r++)
+        {
+            readers.push_back(std::thread([&]() {
+                LiveReader *reader = attachLiveReader(live);
+                while (!done.load())
+                {
+                    beginLiveRead(reader);
+                    int64_t published = getLiveSize(live);
+                    for (int64_t i = published > 2000 ? published - 2000 : 0; i < published; i++)
+                    {
+                        LiveValue value;
+                        if (!readLiveValue(reader, i, &value) || !holdsExpectedValue(value, i))
+                        {
+                            mismatches++;
+                        }
+                        reads++;
+                    }
+                    endLiveRead(reader);
+                }
+                detachLiveReader(reader);
+            }));
+        }
+        char text[32];
+        for (int64_t i = 0; i < size; i++)
+        {
+            appendExpectedValue(live, i);
+            if (i % 2 == 1 && i > 100)
+            {
+                int64_t target = i - 100;
+                snprintf(text, sizeof(text), "%c%lld", i % 4 == 1 ? 'r' : 's', (long long)target);
+                DataPoint string = {STRING, text};
+                replaceLiveDataPoint(live, target, &string);
+            }
+        }
+        done.store(true);
+        for (size_t r = 0; r < readers.size(); r++)
+        {
+            readers[r].join();
+        }
+        TS_ASSERT_EQUALS(mismatches.load(), 0);
+        TS_ASSERT(reads.load() > 0);
+        TS_ASSERT_EQUALS(getLiveSize(live), size);
+        freeLiveDataSet(live);
+    }
+
+    void testSharedWriters()
+    {
+        LiveDataSet *live = createLiveDataSet(true);
+        const int writers = 4;
+        const int perWriter = 10000;
+        std::vector<std::thread> threads;
+        for (int w = 0; w < writers; w++)
+        {
+            threads.push_back(std::thread([live, w]() {
+                for (int i = 0; i < perWriter; i++)
+                {
+                    int32_t number = w * perWriter + i;
+                    DataPoint point = {INT, &number};
+                    appendLiveDataPoint(live, &point);
+                }
+            }));
+        }
+        for (int w = 0; w < writers; w++)
+        {
+            threads[w].join();
+        }
+        TS_ASSERT_EQUALS(getLiveSize(live), writers * perWriter);
+
+        // Every value was appended exactly once
+        std::vector<int> seen(writers * perWriter, 0);
+        LiveReader *reader = attachLiveReader(live);
+        beginLiveRead(reader);
+        for (int64_t i = 0; i < getLiveSize(live); i++)
+        {
+            LiveValue value;
+            TS_ASSERT(readLiveValue(reader, i, &value));
+            seen[value.intValue]++;
+        }
+        endLiveRead(reader);
+        detachLiveReader(reader);
+        int64_t once = 0;
+        for (size_t i = 0; i < seen.size(); i++)
+        {
+            once += seen[i] == 1;
+        }
+        TS_ASSERT_EQUALS(once, writers * perWriter);
+        freeLiveDataSet(live);
+    }
+};
@@ -0,0 +1,95 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/loader.h"
+
+class LoaderTestSuite : public CxxTest::TestSuite
+{
+public:
+    void writeFile(const char *text)
+    {
+        FILE *file = fopen("testloader.csv", "wb");
+        fwrite(text, 1, strlen(text), file);
+        fclose(file);
+    }
+
+    void testLoadCsvFile()
+    {
+        writeFile("id,price,name\n1,2.5,apple\n-7,3,\"pear, ripe\"\n2147483648,,\"say \"\"hi\"\"\"\r\n");
+        LoaderOptions options = {',', true, 0};
+        DataSet *columns[4];
+        TS_ASSERT_EQUALS(loadDelimitedFile("testloader.csv", &options, columns, 4), 3);
+        TS_ASSERT_EQUALS(columns[0]->size, 3);
+        TS_ASSERT(columns[3] == NULL);
+
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(columns[0], 1)->value), -7);
+        // An integer out of range for INT is a FLOAT
+        TS_ASSERT_EQUALS(getDataPoint(columns[0], 2)->type, FLOAT);
+        TS_ASSERT_EQUALS(*((float *)getDataPoint(columns[1], 0)->value), 2.5f);
+        TS_ASSERT_EQUALS(getDataPoint(columns[1], 1)->type, INT);
+        TS_ASSERT(getDataPoint(columns[1], 2) == NULL);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(columns[2], 1)->value, "pear, ripe"), 0);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(columns[2], 2)->value, "say \"hi\""), 0);
+        TS_ASSERT_EQUALS(countByType(columns[2], STRING), 3);
+
+        for (int c = 0; c < 3; c++)
+        {
+            freeDataSet(columns[c]);
+        }
+        remove("testloader.csv");
+    }
+
+    void testLoadAcrossSmallBuffers()
+    {
+        // Records and a quoted newline cut by every chunk boundary
+        writeFile("10;\"first\nline\";x\n\n20;second\n30\n");
+        LoaderOptions options = {';', false, 4};
+        DataSet *columns[3];
+        TS_ASSERT_EQUALS(loadDelimitedFile("testloader.csv", &options, columns, 3), 3);
+        TS_ASSERT_EQUALS(columns[0]->size, 3);
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(columns[0], 2)->value), 30);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(columns[1], 0)->value, "first\nline"), 0);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(columns[1], 1)->value, "second"), 0);
+        TS_ASSERT(getDataPoint(columns[1], 2) == NULL);
+        TS_ASSERT_EQUALS(countDataPoints(columns[2]), 1);
+
+        for (int c = 0; c < 3; c++)
+        {
+            freeDataSet(columns[c]);
+        }
+        remove("testloader.csv");
+    }
+
+    void testLoadLinesAndGrowColumns()
+    {
+        FILE *file = fopen("testloader.csv", "wb");
+        for (int i = 0; i < 5000; i++)
+        {
+            fprintf(file, i % 2 == 0 ? "%d\n" : "v%d\n", i);
+        }
+        fclose(file);
+        LoaderOptions options = {'\0', false, 0};
+        DataSet *columns[1];
+        TS_ASSERT_EQUALS(loadDelimitedFile("testloader.csv", &options, columns, 1), 1);
+        TS_ASSERT_EQUALS(columns[0]->size, 5000);
+        TS_ASSERT_EQUALS(countByType(columns[0], INT), 2500);
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(columns[0], 4998)->value), 4998);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(columns[0], 4999)->value, "v4999"), 0);
+        freeDataSet(columns[0]);
+        remove("testloader.csv");
+    }
+
+    void testLoadInvalidInput()
+    {
+        DataSet *columns[2];
+        TS_ASSERT_EQUALS(loadDelimitedFile("testloader.missing", NULL, columns, 2), -1);
+
+        // More fields than columns
+        writeFile("1,2,3\n");
+        TS_ASSERT_EQUALS(loadDelimitedFile("testloader.csv", NULL, columns, 2), -1);
+        TS_ASSERT(columns[0] == NULL);
+
+        writeFile("a,b\n");
+        LoaderOptions options = {',', true, 0};
+        TS_ASSERT_EQUALS(loadDelimitedFile("testloader.csv", &options, columns, 2), 0);
+        remove("testloader.csv");
+    }
+};
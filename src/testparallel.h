@@ -0,0 +1,149 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/parallel.h"
+
+class ParallelTestSuite : public CxxTest::TestSuite
+{
+public:
+    // Build a dataset cycling through INT, FLOAT, STRING and empty slots over several morsels
+    DataSet *createLargeDataSet(int size)
+    {
+        DataSet *dataset = createDataSet(size);
+        char text[16];
+        for (int i = 0; i < size; i++)
+        {
+            int value = i % 1000;
+            float real = (float)(i % 77) * 0.5f;
+            sprintf(text, "s%d", i % 13);
+            DataPoint points[3] = {{INT, &value}, {FLOAT, &real}, {STRING, text}};
+            if (i % 4 < 3)
+            {
+                addDataPoint(dataset, i, &points[i % 4]);
+            }
+        }
+        return dataset;
+    }
+
+    void testParallelFilterByTypeMatchesSerial()
+    {
+        setThreadCount(4);
+        DataSet *dataset = createLargeDataSet(3 * MORSEL_SIZE + 100);
+        for (int t = INT; t <= STRING; t++)
+        {
+            DataSet *serial = filterByType(dataset, (DataType)t);
+            DataSet *parallel = parallelFilterByType(dataset, (DataType)t);
+            TS_ASSERT_EQUALS(countDataPoints(parallel), countDataPoints(serial));
+            for (int i = 0; i < dataset->size; i += 97)
+            {
+                DataPoint *expected = getDataPoint(serial, i);
+                DataPoint *actual = getDataPoint(parallel, i);
+                TS_ASSERT_EQUALS(expected == NULL, actual == NULL);
+                if (expected != NULL && actual != NULL)
+                {
+                    size_t length = t == STRING ? strlen((char *)expected->value) + 1 : 4;
+                    TS_ASSERT_SAME_DATA(actual->value, expected->value, length);
+                }
+            }
+            freeDataSet(serial);
+            freeDataSet(parallel);
+        }
+        freeDataSet(dataset);
+        setThreadCount(0);
+    }
+
+    void testParallelFilterAndAggregateMatchSerial()
+    {
+        setThreadCount(3);
+        DataSet *dataset = createLargeDataSet(5 * MORSEL_SIZE);
+        int32_t operands[2] = {100, 400};
+        Bitmap *serial = filterIntValues(dataset, COMPARE_BETWEEN, operands, 2);
+        Bitmap *parallel = parallelFilterIntValues(dataset, COMPARE_BETWEEN, operands, 2);
+        TS_ASSERT_SAME_DATA(parallel->words, serial->words, (dataset->size + 63) / 64 * sizeof(uint64_t));
+
+        AggregateResult expected, actual;
+        TS_ASSERT(aggregateValues(dataset, INT, serial, &expected));
+        TS_ASSERT(parallelAggregateValues(dataset, INT, parallel, &actual));
+        TS_ASSERT_EQUALS(actual.count, expected.count);
+        TS_ASSERT_EQUALS(actual.intSum, expected.intSum);
+        TS_ASSERT_EQUALS(actual.min, expected.min);
+        TS_ASSERT_EQUALS(actual.max, expected.max);
+
+        float low = 10.0f;
+        Bitmap *floats = parallelFilterFloatValues(dataset, COMPARE_GT, &low, 1);
+        TS_ASSERT(parallelAggregateValues(dataset, FLOAT, floats, &actual));
+        TS_ASSERT(aggregateValues(dataset, FLOAT, floats, &expected));
+        TS_ASSERT_DELTA(actual.sum, expected.sum, 1e-6 * expected.sum);
+        TS_ASSERT_EQUALS(actual.min, 10.5);
+
+        freeBitmap(floats);
+        freeBitmap(serial);
+        freeBitmap(parallel);
+        freeDataSet(dataset);
+        setThreadCount(0);
+    }
+
+    void testParallelSortMatchesSerial()
+    {
+        // Five runs for five threads, so one run is left over in the first merge
+        setThreadCount(5);
+        DataSet *dataset = createLargeDataSet(9 * MORSEL_SIZE + 10);
+        for (int t = INT; t <= STRING; t++)
+        {
+            for (int o = SORT_ASCENDING; o <= SORT_DESCENDING; o++)
+            {
+                int64_t serialCount, parallelCount;
+                int64_t *serial = sortValues(dataset, (DataType)t, NULL, (SortOrder)o, &serialCount);
+                int64_t *parallel = parallelSortValues(dataset, (DataType)t, NULL, (SortOrder)o, &parallelCount);
+                TS_ASSERT_EQUALS(parallelCount, serialCount);
+                TS_ASSERT_SAME_DATA(parallel, serial, serialCount * sizeof(int64_t));
+                free(serial);
+                free(parallel);
+            }
+        }
+        freeDataSet(dataset);
+        setThreadCount(0);
+    }
+
+    void testParallelGroupByMatchesSerial()
+    {
+        setThreadCount(4);
+        DataSet *dataset = createLargeDataSet(6 * MORSEL_SIZE + 3);
+        DataSet *values = createDataSet(dataset->size);
+        for (int64_t i = 0; i < values->size; i++)
+        {
+            float metric = (float)(i % 41);
+            DataPoint point = {FLOAT, &metric};
+            addDataPoint(values, i, &point);
+        }
+        for (int t = INT; t <= STRING; t++)
+        {
+            GroupByResult *serial = groupByValues(dataset, (DataType)t, values, FLOAT, NULL);
+            GroupByResult *parallel = parallelGroupByValues(dataset, (DataType)t, values, FLOAT, NULL);
+            TS_ASSERT_EQUALS(parallel->count, serial->count);
+            for (int64_t g = 0; g < serial->count && g < parallel->count; g++)
+            {
+                size_t length = t == STRING ? strlen((char *)getDataPoint(serial->keys, g)->value) + 1 : 4;
+                TS_ASSERT_SAME_DATA(getDataPoint(parallel->keys, g)->value, getDataPoint(serial->keys, g)->value, length);
+                TS_ASSERT_EQUALS(parallel->results[g].count, serial->results[g].count);
+                TS_ASSERT_DELTA(parallel->results[g].sum, serial->results[g].sum, 1e-9 * serial->results[g].sum);
+                TS_ASSERT_EQUALS(parallel->results[g].min, serial->results[g].min);
+            }
+            freeGroupByResult(serial);
+            freeGroupByResult(parallel);
+        }
+        freeDataSet(values);
+        freeDataSet(dataset);
+        setThreadCount(0);
+    }
+
+    void testParallelWithNullDataset()
+    {
+        int32_t operand = 1;
+        AggregateResult result;
+        TS_ASSERT(parallelFilterByType(NULL, INT) == NULL);
+        TS_ASSERT(parallelFilterIntValues(NULL, COMPARE_EQ, &operand, 1) == NULL);
+        TS_ASSERT(!parallelAggregateValues(NULL, INT, NULL, &result));
+        int64_t count;
+        TS_ASSERT(parallelSortValues(NULL, INT, NULL, SORT_ASCENDING, &count) == NULL);
+        TS_ASSERT(parallelGroupByValues(NULL, INT, NULL, INT, NULL) == NULL);
+    }
+};
@@ -0,0 +1,126 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/predicate.h"
+
+class PredicateTestSuite : public CxxTest::TestSuite
+{
+public:
+    // INT values 0..99 repeating, FLOAT halves, strings "key<n>" and empty slots
+    DataSet *createMixedDataSet(int size)
+    {
+        DataSet *dataset = createDataSet(size);
+        for (int i = 0; i < size; i++)
+        {
+            int value = i % 100;
+            float number = i * 0.5f;
+            char text[16];
+            snprintf(text, sizeof(text), "key%d", i % 37);
+            DataPoint point = {INT, &value};
+            if (i % 5 == 1)
+            {
+                point.type = FLOAT;
+                point.value = &number;
+            }
+            else if (i % 5 == 2)
+            {
+                point.type = STRING;
+                point.value = text;
+            }
+            else if (i % 5 == 3 && i % 2 == 0)
+            {
+                continue;
+            }
+            addDataPoint(dataset, i, &point);
+        }
+        return dataset;
+    }
+
+    // Evaluate the tree used by testFusedTreeMatchesDataPoints on a single data point
+    bool expected(DataPoint *point)
+    {
+        if (point == NULL)
+        {
+            return false;
+        }
+        bool intRange = point->type == INT && *((int *)point->value) >= 10 && *((int *)point->value) <= 40;
+        bool bigFloat = point->type == FLOAT && *((float *)point->value) > 1000.0f;
+        bool prefix = point->type == STRING && strncmp((char *)point->value, "key1", 4) == 0;
+        bool equals = point->type == STRING && strcmp((char *)point->value, "key12") == 0;
+        return (intRange || bigFloat || prefix) && !equals;
+    }
+
+    void testFusedTreeMatchesDataPoints()
+    {
+        const int size = 10000;
+        for (int dictionary = 0; dictionary < 2; dictionary++)
+        {
+            DataSet *dataset = createMixedDataSet(size);
+            if (dictionary)
+            {
+                TS_ASSERT(encodeStringDictionary(dataset));
+            }
+            int range[2] = {10, 40};
+            float threshold = 1000.0f;
+            Predicate *predicate = andPredicate(
+                orPredicate(orPredicate(intPredicate(COMPARE_BETWEEN, range, 2), floatPredicate(COMPARE_GT, &threshold, 1)),
+                            stringPrefixPredicate("key1")),
+                notPredicate(stringEqualsPredicate("key12")));
+            TS_ASSERT(predicate != NULL);
+            Bitmap *selection = filterPredicate(dataset, predicate);
+            TS_ASSERT(selection != NULL);
+            int64_t count = 0;
+            for (int i = 0; i < size; i++)
+            {
+                bool match = expected(getDataPoint(dataset, i));
+                TS_ASSERT_EQUALS(testBitmap(selection, i), match);
+                count += match;
+            }
+            TS_ASSERT_EQUALS(countBitmap(selection), count);
+            freeBitmap(selection);
+            freePredicate(predicate);
+            freeDataSet(dataset);
+        }
+    }
+
+    void testTypeTestsAndNot()
+    {
+        DataSet *dataset = createMixedDataSet(1000);
+        Predicate *notInt = notPredicate(typePredicate(INT));
+        Bitmap *selection = filterPredicate(dataset, notInt);
+        // NOT never selects empty slots
+        TS_ASSERT_EQUALS(countBitmap(selection), countByType(dataset, FLOAT) + countByType(dataset, STRING));
+        freeBitmap(selection);
+
+        // A single type test agrees with filterByType
+        Predicate *strings = typePredicate(STRING);
+        selection = filterPredicate(dataset, strings);
+        DataSet *filtered = filterByType(dataset, STRING);
+        TS_ASSERT_EQUALS(countBitmap(selection), countDataPoints(filtered));
+        freeDataSet(filtered);
+        freeBitmap(selection);
+
+        // An empty prefix selects every string
+        Predicate *all = stringPrefixPredicate("");
+        selection = filterPredicate(dataset, all);
+        TS_ASSERT_EQUALS(countBitmap(selection), countByType(dataset, STRING));
+        freeBitmap(selection);
+
+        freePredicate(all);
+        freePredicate(strings);
+        freePredicate(notInt);
+        freeDataSet(dataset);
+    }
+
+    void testInvalidPredicates()
+    {
+        // A failed leaf makes the whole tree NULL and frees the rest
+        TS_ASSERT(andPredicate(typePredicate(INT), intPredicate(COMPARE_BETWEEN, NULL, 2)) == NULL);
+        TS_ASSERT(orPredicate(NULL, stringEqualsPredicate("x")) == NULL);
+        TS_ASSERT(notPredicate(NULL) == NULL);
+        TS_ASSERT(typePredicate((DataType)7) == NULL);
+        TS_ASSERT(stringPrefixPredicate(NULL) == NULL);
+        Predicate *predicate = typePredicate(INT);
+        TS_ASSERT(filterPredicate(NULL, predicate) == NULL);
+        freePredicate(predicate);
+        freePredicate(NULL);
+    }
+};
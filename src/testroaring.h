@@ -0,0 +1,149 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/roaring.h"
+
+class RoaringTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testContainersFollowDensity()
+    {
+        // A sparse chunk, a dense chunk, a chunk of long runs and an empty chunk
+        const int64_t size = 4 * ROARING_CHUNK_SIZE + 100;
+        Bitmap *bitmap = createBitmap(size);
+        for (int64_t i = 0; i < ROARING_CHUNK_SIZE; i += 1000)
+        {
+            bitmap->words[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+        for (int64_t i = ROARING_CHUNK_SIZE; i < 2 * ROARING_CHUNK_SIZE; i += 3)
+        {
+            bitmap->words[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+        for (int64_t i = 2 * ROARING_CHUNK_SIZE + 10; i < 2 * ROARING_CHUNK_SIZE + 30000; i++)
+        {
+            bitmap->words[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+        bitmap->words[(size - 1) / 64] |= (uint64_t)1 << ((size - 1) % 64);
+
+        RoaringBitmap *compressed = compressBitmap(bitmap);
+        TS_ASSERT(compressed != NULL);
+        TS_ASSERT_EQUALS(compressed->count, 4);
+        TS_ASSERT_EQUALS(compressed->containers[0].type, CONTAINER_ARRAY);
+        TS_ASSERT_EQUALS(compressed->containers[1].type, CONTAINER_BITSET);
+        TS_ASSERT_EQUALS(compressed->containers[2].type, CONTAINER_RUN);
+        TS_ASSERT_EQUALS(compressed->containers[2].length, 1);
+        TS_ASSERT_EQUALS(compressed->containers[3].key, 4);
+        TS_ASSERT_EQUALS(countRoaring(compressed), countBitmap(bitmap));
+        TS_ASSERT(testRoaring(compressed, 2 * ROARING_CHUNK_SIZE + 29999));
+        TS_ASSERT(!testRoaring(compressed, 2 * ROARING_CHUNK_SIZE + 30000));
+        TS_ASSERT(!testRoaring(compressed, size));
+        TS_ASSERT_EQUALS(nextRoaringIndex(compressed, 2001), 3000);
+        TS_ASSERT_EQUALS(nextRoaringIndex(compressed, 2 * ROARING_CHUNK_SIZE + 30000), size - 1);
+        TS_ASSERT_EQUALS(nextRoaringIndex(compressed, size), -1);
+
+        Bitmap *expanded = decompressRoaring(compressed);
+        TS_ASSERT_EQUALS(memcmp(expanded->words, bitmap->words, (size + 63) / 64 * sizeof(uint64_t)), 0);
+        freeBitmap(expanded);
+        freeBitmap(bitmap);
+        freeRoaringBitmap(compressed);
+    }
+
+    void testCombineMatchesWords()
+    {
+        // Mixed densities so every pair of container kinds meets
+        const int64_t size = 3 * ROARING_CHUNK_SIZE;
+        RoaringBitmap *a = createRoaringBitmap(size);
+        RoaringBitmap *b = createRoaringBitmap(size);
+        Bitmap *wordsA = createBitmap(size);
+        Bitmap *wordsB = createBitmap(size);
+        unsigned int seed = 3;
+        for (int64_t i = 0; i < size; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            int64_t chunk = i / ROARING_CHUNK_SIZE;
+            bool inA = chunk == 0 ? (seed >> 16) % 50 == 0 : chunk == 1 ? (seed >> 16) % 2 == 0 : (i / 5000) % 2 == 0;
+            bool inB = chunk == 0 ? (seed >> 20) % 40 == 0 : chunk == 1 ? (i / 700) % 3 == 0 : (seed >> 20) % 3 == 0;
+            if (inA)
+            {
+                TS_ASSERT(addRoaring(a, i));
+                wordsA->words[i / 64] |= (uint64_t)1 << (i % 64);
+            }
+            if (inB)
+            {
+                TS_ASSERT(addRoaring(b, i));
+                wordsB->words[i / 64] |= (uint64_t)1 << (i % 64);
+            }
+        }
+        TS_ASSERT(!addRoaring(a, size));
+        TS_ASSERT_EQUALS(countRoaring(a), countBitmap(wordsA));
+
+        RoaringBitmap *results[4] = {andRoaring(a, b), orRoaring(a, b), andNotRoaring(a, b), xorRoaring(a, b)};
+        for (int op = 0; op < 4; op++)
+        {
+            Bitmap *actual = decompressRoaring(results[op]);
+            int64_t count = 0;
+            for (int64_t w = 0; w < (size + 63) / 64; w++)
+            {
+                uint64_t x = wordsA->words[w];
+                uint64_t y = wordsB->words[w];
+                uint64_t expected = op == 0 ? x & y : op == 1 ? x | y : op == 2 ? x & ~y : x ^ y;
+                TS_ASSERT_EQUALS(actual->words[w], expected);
+                count += __builtin_popcountll(expected);
+            }
+            TS_ASSERT_EQUALS(countRoaring(results[op]), count);
+            freeBitmap(actual);
+            freeRoaringBitmap(results[op]);
+        }
+
+        RoaringBitmap *other = createRoaringBitmap(size + 1);
+        TS_ASSERT(andRoaring(a, other) == NULL);
+        TS_ASSERT(orRoaring(a, NULL) == NULL);
+        freeRoaringBitmap(other);
+        freeRoaringBitmap(a);
+        freeRoaringBitmap(b);
+        freeBitmap(wordsA);
+        freeBitmap(wordsB);
+    }
+
+    void testCompressedFilterAndTypeIndex()
+    {
+        const int size = 200000;
+        DataSet *dataset = createDataSet(size);
+        int *values = (int *)malloc(size * sizeof(int));
+        for (int i = 0; i < size; i++)
+        {
+            values[i] = i % 1000;
+        }
+        TS_ASSERT(addIntValues(dataset, 0, values, size));
+        free(values);
+        float rare = 1.5f;
+        DataPoint point = {FLOAT, &rare};
+        resizeDataSet(dataset, size + 10);
+        for (int i = size; i < size + 10; i++)
+        {
+            addDataPoint(dataset, i, &point);
+        }
+
+        int operand = 7;
+        Bitmap *expected = filterIntValues(dataset, COMPARE_EQ, &operand, 1);
+        RoaringBitmap *selection = filterIntValuesCompressed(dataset, COMPARE_EQ, &operand, 1);
+        TS_ASSERT_EQUALS(countRoaring(selection), 200);
+        TS_ASSERT_EQUALS(countRoaring(selection), countBitmap(expected));
+        TS_ASSERT(roaringBytes(selection) < (size + 63) / 64 * sizeof(uint64_t) / 10);
+        Bitmap *actual = decompressRoaring(selection);
+        TS_ASSERT_EQUALS(memcmp(actual->words, expected->words, (size + 10 + 63) / 64 * sizeof(uint64_t)), 0);
+
+        RoaringBitmap *floats = compressTypeIndex(dataset, FLOAT);
+        TS_ASSERT_EQUALS(countRoaring(floats), 10);
+        TS_ASSERT_EQUALS(floats->count, 1);
+        RoaringBitmap *floatMatches = filterFloatValuesCompressed(dataset, COMPARE_GT, &rare, 1);
+        TS_ASSERT_EQUALS(countRoaring(floatMatches), 0);
+        TS_ASSERT(compressTypeIndex(NULL, INT) == NULL);
+        TS_ASSERT(filterIntValuesCompressed(dataset, COMPARE_EQ, NULL, 1) == NULL);
+
+        freeRoaringBitmap(floatMatches);
+        freeRoaringBitmap(floats);
+        freeRoaringBitmap(selection);
+        freeBitmap(actual);
+        freeBitmap(expected);
+        freeDataSet(dataset);
+    }
+};
@@ -0,0 +1,149 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/sort.h"
+#include "../src/encoding.h"
+#include "../src/filter.h"
+
+class SortTestSuite : public CxxTest::TestSuite
+{
+public:
+    // Check that slots hold values of a type in order, equal values in slot order
+    void checkOrder(DataSet *dataset, DataType type, SortOrder order, const int64_t *slots, int64_t count)
+    {
+        for (int64_t i = 1; i < count; i++)
+        {
+            DataPoint previous = *getDataPoint(dataset, slots[i - 1]);
+            double a = 0, b = 0;
+            int compare = 0;
+            if (type == STRING)
+            {
+                char text[64];
+                snprintf(text, sizeof(text), "%s", (char *)previous.value);
+                compare = strcmp(text, (char *)getDataPoint(dataset, slots[i])->value);
+            }
+            else
+            {
+                a = type == INT ? *(int *)previous.value : *(float *)previous.value;
+                DataPoint *point = getDataPoint(dataset, slots[i]);
+                b = type == INT ? *(int *)point->value : *(float *)point->value;
+                compare = a < b ? -1 : a > b ? 1 : 0;
+            }
+            TS_ASSERT(order == SORT_ASCENDING ? compare <= 0 : compare >= 0);
+            if (compare == 0)
+            {
+                TS_ASSERT(slots[i - 1] < slots[i]);
+            }
+        }
+    }
+
+    void testSortEachType()
+    {
+        const int size = 50000;
+        DataSet *dataset = createDataSet(size);
+        unsigned int seed = 7;
+        for (int i = 0; i < size; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            int value = (int)(seed >> 8) % 2000 - 1000;
+            float number = (float)((seed >> 12) % 500) * 0.5f - 100.0f;
+            char text[16];
+            snprintf(text, sizeof(text), "w%u", (seed >> 4) % 300);
+            DataPoint points[3] = {{INT, &value}, {FLOAT, &number}, {STRING, text}};
+            if (i % 7 != 6)
+            {
+                addDataPoint(dataset, i, &points[i % 3]);
+            }
+        }
+        for (int dictionary = 0; dictionary < 2; dictionary++)
+        {
+            if (dictionary)
+            {
+                TS_ASSERT(encodeStringDictionary(dataset));
+            }
+            for (int t = INT; t <= STRING; t++)
+            {
+                for (int o = SORT_ASCENDING; o <= SORT_DESCENDING; o++)
+                {
+                    int64_t count = -1;
+                    int64_t *slots = sortValues(dataset, (DataType)t, NULL, (SortOrder)o, &count);
+                    TS_ASSERT(slots != NULL);
+                    TS_ASSERT_EQUALS(count, countByType(dataset, (DataType)t));
+                    checkOrder(dataset, (DataType)t, (SortOrder)o, slots, count);
+                    free(slots);
+                }
+            }
+        }
+
+        // A selection sorts only the slots it holds
+        int operand = 0;
+        Bitmap *negative = filterIntValues(dataset, COMPARE_LT, &operand, 1);
+        int64_t count;
+        int64_t *slots = sortValues(dataset, INT, negative, SORT_DESCENDING, &count);
+        TS_ASSERT_EQUALS(count, countBitmap(negative));
+        TS_ASSERT_LESS_THAN(*(int *)getDataPoint(dataset, slots[0])->value, 0);
+        free(slots);
+        freeBitmap(negative);
+        freeDataSet(dataset);
+    }
+
+    void testFloatSpecialValues()
+    {
+        float values[6] = {1.0f, 0.0f / 0.0f, -0.0f, -3.5f, 0.0f, 1.0f / 0.0f};
+        DataSet *dataset = createDataSet(6);
+        TS_ASSERT(addFloatValues(dataset, 0, values, 6));
+        int64_t count;
+        int64_t *slots = sortValues(dataset, FLOAT, NULL, SORT_ASCENDING, &count);
+        // -0 and 0 are equal and keep slot order; NaN sorts above infinity
+        int64_t expected[6] = {3, 2, 4, 0, 5, 1};
+        TS_ASSERT_SAME_DATA(slots, expected, sizeof(expected));
+        free(slots);
+        slots = topValues(dataset, FLOAT, NULL, SORT_DESCENDING, 2, &count);
+        TS_ASSERT_EQUALS(count, 2);
+        TS_ASSERT_EQUALS(slots[0], 1);
+        TS_ASSERT_EQUALS(slots[1], 5);
+        free(slots);
+        freeDataSet(dataset);
+    }
+
+    void testTopValuesMatchSort()
+    {
+        // Rising values over several zones, so a top-K skips every zone but the last ones
+        const int64_t size = 3 * ZONE_SIZE + 500;
+        DataSet *dataset = createDataSet(size);
+        int32_t *values = (int32_t *)malloc(size * sizeof(int32_t));
+        for (int64_t i = 0; i < size; i++)
+        {
+            values[i] = (int32_t)(i / 3);
+        }
+        TS_ASSERT(addIntValues(dataset, 0, values, size));
+        free(values);
+        for (int sealed = 0; sealed < 2; sealed++)
+        {
+            if (sealed)
+            {
+                TS_ASSERT(sealDataSet(dataset));
+            }
+            for (int o = SORT_ASCENDING; o <= SORT_DESCENDING; o++)
+            {
+                int64_t sortedCount, topCount;
+                int64_t *sorted = sortValues(dataset, INT, NULL, (SortOrder)o, &sortedCount);
+                int64_t *top = topValues(dataset, INT, NULL, (SortOrder)o, 100, &topCount);
+                TS_ASSERT_EQUALS(topCount, 100);
+                TS_ASSERT_SAME_DATA(top, sorted, 100 * sizeof(int64_t));
+                free(top);
+                free(sorted);
+            }
+        }
+        int64_t count;
+        int64_t *slots = topValues(dataset, INT, NULL, SORT_DESCENDING, 0, &count);
+        TS_ASSERT(slots != NULL);
+        TS_ASSERT_EQUALS(count, 0);
+        free(slots);
+        slots = topValues(dataset, INT, NULL, SORT_ASCENDING, size * 2, &count);
+        TS_ASSERT_EQUALS(count, size);
+        free(slots);
+        TS_ASSERT(topValues(dataset, INT, NULL, SORT_ASCENDING, -1, &count) == NULL);
+        TS_ASSERT(sortValues(dataset, INT, NULL, (SortOrder)2, &count) == NULL);
+        TS_ASSERT(sortValues(NULL, INT, NULL, SORT_ASCENDING, &count) == NULL);
+        freeDataSet(dataset);
+    }
+};
@@ -0,0 +1,113 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/stats.h"
+#include "../src/filter.h"
+#include "../src/aggregate.h"
+
+class StatsTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testCountersFollowOperations()
+    {
+        resetStats();
+        int value = 7;
+        DataPoint *point = createDataPoint(INT, &value);
+        TS_ASSERT_EQUALS(getStatCounter(STAT_DATA_POINTS_CREATED), 1u);
+        TS_ASSERT_EQUALS(getStatCounter(STAT_DATA_POINT_ALLOCATIONS), 2u);
+        free(point->value);
+        free(point);
+
+        // INT values only in the second zone, so a filter of the INT column skips the first
+        const int size = ZONE_SIZE * 2;
+        DataSet *dataset = createDataSet(size);
+        TS_ASSERT(getStatCounter(STAT_BLOCK_ALLOCATIONS) > 0);
+        int32_t *ints = (int32_t *)malloc((size / 2) * sizeof(int32_t));
+        for (int i = 0; i < size / 2; i++)
+        {
+            ints[i] = i;
+        }
+        TS_ASSERT(addIntValues(dataset, size / 2, ints, size / 2));
+        free(ints);
+        float other = 1.0f;
+        DataPoint floatPoint = {FLOAT, &other};
+        addDataPoint(dataset, 0, &floatPoint);
+        TS_ASSERT_EQUALS(getStatCounter(STAT_VALUES_STORED), (uint64_t)size / 2 + 1);
+
+        int32_t operand = 100;
+        Bitmap *selection = filterIntValues(dataset, COMPARE_LT, &operand, 1);
+        DataSetStats stats;
+        TS_ASSERT(getDataSetStats(dataset, &stats));
+        TS_ASSERT_EQUALS(stats.valuesStored, (uint64_t)size / 2 + 1);
+        TS_ASSERT_EQUALS(stats.rowsScanned, (uint64_t)size / 2);
+        TS_ASSERT_EQUALS(stats.rowsSkipped, (uint64_t)size / 2);
+        AggregateResult result;
+        TS_ASSERT(aggregateValues(dataset, FLOAT, NULL, &result));
+        TS_ASSERT(getDataSetStats(dataset, &stats));
+        TS_ASSERT_EQUALS(stats.rowsScanned, (uint64_t)size);
+        TS_ASSERT_EQUALS(stats.rowsSkipped, (uint64_t)size);
+        TS_ASSERT_EQUALS(getStatCounter(STAT_ROWS_SKIPPED), (uint64_t)size);
+
+        uint64_t releases = getStatCounter(STAT_BLOCK_RELEASES);
+        freeBitmap(selection);
+        freeDataSet(dataset);
+        TS_ASSERT(getStatCounter(STAT_BLOCK_RELEASES) > releases);
+        TS_ASSERT_EQUALS(getStatCounter((StatCounter)STAT_COUNTER_COUNT), 0u);
+        TS_ASSERT(!getDataSetStats(NULL, &stats));
+    }
+
+    void testTimersMemoryAndJson()
+    {
+        resetStats();
+        DataSet *dataset = createDataSetWithCapacity(1000);
+        char text[] = "text";
+        for (int i = 0; i < 1000; i++)
+        {
+            DataPoint point = {INT, &i};
+            DataPoint string = {STRING, text};
+            appendDataPoint(dataset, i % 2 == 0 ? &point : &string);
+        }
+
+        // Values are counted at the capacity allocated; the string arena starts at 4096 bytes
+        DataSetMemory memory;
+        TS_ASSERT(getDataSetMemory(dataset, &memory));
+        TS_ASSERT_EQUALS(memory.valueBytes, (size_t)dataset->capacity * sizeof(int32_t) + 4096);
+        TS_ASSERT(memory.metadataBytes > (size_t)dataset->capacity * sizeof(uint64_t));
+
+        // The data point view is only allocated by the first getDataPoint
+        size_t metadata = memory.metadataBytes;
+        TS_ASSERT(dataset->data == NULL);
+        TS_ASSERT_EQUALS(*(int *)getDataPoint(dataset, 998)->value, 998);
+        TS_ASSERT(getDataSetMemory(dataset, &memory));
+        TS_ASSERT_EQUALS(memory.metadataBytes, metadata + (size_t)dataset->capacity * sizeof(DataPoint));
+        TS_ASSERT(!getDataSetMemory(NULL, &memory));
+
+        // Only calls made while timing is on are timed
+        AggregateResult result;
+        uint64_t calls, nanoseconds;
+        TS_ASSERT(aggregateValues(dataset, INT, NULL, &result));
+        TS_ASSERT(getStatTimer(STAT_TIMER_AGGREGATE, &calls, &nanoseconds));
+        TS_ASSERT_EQUALS(calls, 0u);
+        setStatTimers(true);
+        TS_ASSERT(aggregateValues(dataset, INT, NULL, &result));
+        DataSet *strings = filterByType(dataset, STRING);
+        setStatTimers(false);
+        TS_ASSERT(getStatTimer(STAT_TIMER_AGGREGATE, &calls, &nanoseconds));
+        TS_ASSERT_EQUALS(calls, 1u);
+        TS_ASSERT(getStatTimer(STAT_TIMER_FILTER_BY_TYPE, &calls, &nanoseconds));
+        TS_ASSERT_EQUALS(calls, 1u);
+        TS_ASSERT(!getStatTimer(STAT_TIMER_COUNT, &calls, &nanoseconds));
+
+        char *json = statsToJson(dataset);
+        TS_ASSERT(json != NULL);
+        TS_ASSERT(strncmp(json, "{\"counters\":{\"data_points_created\":0,", 37) == 0);
+        TS_ASSERT(strstr(json, "\"aggregate\":{\"calls\":1,") != NULL);
+        TS_ASSERT(strstr(json, "\"dataset\":{\"size\":1000,") != NULL);
+        TS_ASSERT(strstr(json, "\"values_stored\":1000,") != NULL);
+        TS_ASSERT_EQUALS(json[strlen(json) - 1], '}');
+        free(json);
+        json = statsToJson(NULL);
+        TS_ASSERT(strstr(json, "\"dataset\"") == NULL);
+        free(json);
+        freeDataSet(strings);
+        freeDataSet(dataset);
+    }
+};
@@ -0,0 +1,164 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/storage.h"
+
+class StorageTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testWriteAndMapDataSet()
+    {
+        DataSet *dataset = createDataSet(200);
+        int value1 = -42;
+        float value2 = 2.75f;
+        const char *value3 = "mapped";
+        DataPoint point1 = {INT, &value1};
+        DataPoint point2 = {FLOAT, &value2};
+        DataPoint point3 = {STRING, (void *)value3};
+        addDataPoint(dataset, 0, &point1);
+        addDataPoint(dataset, 100, &point2);
+        addDataPoint(dataset, 199, &point3);
+        TS_ASSERT(writeDataSet(dataset, "teststorage.bds"));
+
+        DataSet *mapped = mapDataSet("teststorage.bds");
+        TS_ASSERT(mapped != NULL);
+        TS_ASSERT(mapped->mapping != NULL);
+        TS_ASSERT_EQUALS(mapped->size, 200);
+        TS_ASSERT_EQUALS(countDataPoints(mapped), 3);
+        TS_ASSERT_EQUALS(countByType(mapped, FLOAT), 1);
+        TS_ASSERT_EQUALS(*((int *)getDataPoint(mapped, 0)->value), -42);
+        TS_ASSERT_EQUALS(*((float *)getDataPoint(mapped, 100)->value), 2.75f);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(mapped, 199)->value, "mapped"), 0);
+        TS_ASSERT(getDataPoint(mapped, 1) == NULL);
+
+        // A mapped dataset is read-only
+        addDataPoint(mapped, 1, &point1);
+        TS_ASSERT(getDataPoint(mapped, 1) == NULL);
+
+        freeDataSet(mapped);
+        freeDataSet(dataset);
+        remove("teststorage.bds");
+    }
+
+    void testMapDictionaryEncodedDataSet()
+    {
+        DataSet *dataset = createDataSet(3);
+        encodeStringDictionary(dataset);
+        const char *value1 = "de";
+        const char *value2 = "us";
+        DataPoint point1 = {STRING, (void *)value1};
+        DataPoint point2 = {STRING, (void *)value2};
+        addDataPoint(dataset, 0, &point1);
+        addDataPoint(dataset, 1, &point2);
+        addDataPoint(dataset, 2, &point1);
+        TS_ASSERT(writeDataSet(dataset, "teststorage.bds"));
+
+        DataSet *mapped = mapDataSet("teststorage.bds");
+        TS_ASSERT(mapped != NULL);
+        TS_ASSERT_EQUALS(mapped->dictionary->count, 2);
+        TS_ASSERT_EQUALS(getStringCode(mapped, "us"), getStringCode(dataset, "us"));
+        Bitmap *selection = filterStringEquals(mapped, "de");
+        TS_ASSERT_EQUALS(countBitmap(selection), 2);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(mapped, 1)->value, "us"), 0);
+
+        freeBitmap(selection);
+        freeDataSet(mapped);
+        freeDataSet(dataset);
+        remove("teststorage.bds");
+    }
+
+    void testWriteAndMapEmptyDataSet()
+    {
+        DataSet *dataset = createDataSetWithCapacity(0);
+        TS_ASSERT(writeDataSet(dataset, "teststorage.bds"));
+        DataSet *mapped = mapDataSet("teststorage.bds");
+        TS_ASSERT(mapped != NULL);
+        TS_ASSERT_EQUALS(mapped->size, 0);
+        TS_ASSERT_EQUALS(countDataPoints(mapped), 0);
+        TS_ASSERT(getDataPoint(mapped, 0) == NULL);
+        freeDataSet(mapped);
+
+        encodeStringDictionary(dataset);
+        TS_ASSERT(writeDataSet(dataset, "teststorage.bds"));
+        mapped = mapDataSet("teststorage.bds");
+        TS_ASSERT(mapped != NULL);
+        TS_ASSERT_EQUALS(getStringCode(mapped, "none"), -1);
+        freeDataSet(mapped);
+        freeDataSet(dataset);
+        remove("teststorage.bds");
+    }
+
+    // Overwrite bytes of a dataset file, at an offset within one of its sections or, for a section of -1,
+    // within the header; the section table follows the magic, four 32-bit and three 64-bit header fields
+    static void corruptFile(int section, uint64_t at, const void *bytes, size_t length)
+    {
+        FILE *file = fopen("teststorage.bds", "r+b");
+        uint64_t offset = 0;
+        if (section >= 0)
+        {
+            fseek(file, 48 + section * 2 * sizeof(uint64_t), SEEK_SET);
+            TS_ASSERT_EQUALS(fread(&offset, sizeof(offset), 1, file), 1u);
+        }
+        fseek(file, (long)(offset + at), SEEK_SET);
+        fwrite(bytes, 1, length, file);
+        fclose(file);
+    }
+
+    void testMapRejectsInconsistentContents()
+    {
+        DataSet *dataset = createDataSet(200);
+        int value1 = 7;
+        const char *value2 = "kept";
+        DataPoint point1 = {INT, &value1};
+        DataPoint point2 = {STRING, (void *)value2};
+        addDataPoint(dataset, 0, &point1);
+        addDataPoint(dataset, 199, &point2);
+
+        // A type tag out of range
+        TS_ASSERT(writeDataSet(dataset, "teststorage.bds"));
+        uint8_t type = 9;
+        corruptFile(0, 0, &type, 1);
+        TS_ASSERT(mapDataSet("teststorage.bds") == NULL);
+
+        // A string past the end of the arena
+        TS_ASSERT(writeDataSet(dataset, "teststorage.bds"));
+        uint64_t offset = (uint64_t)1 << 40;
+        corruptFile(7, 199 * sizeof(uint64_t), &offset, sizeof(offset));
+        TS_ASSERT(mapDataSet("teststorage.bds") == NULL);
+
+        // An INT value without an INT column: the length of the INT section in the header is zeroed
+        TS_ASSERT(writeDataSet(dataset, "teststorage.bds"));
+        uint64_t empty = 0;
+        corruptFile(-1, 48 + (5 * 2 + 1) * sizeof(uint64_t), &empty, sizeof(empty));
+        TS_ASSERT(mapDataSet("teststorage.bds") == NULL);
+
+        // A dictionary code past the end of the dictionary
+        encodeStringDictionary(dataset);
+        TS_ASSERT(writeDataSet(dataset, "teststorage.bds"));
+        uint8_t code = 200;
+        corruptFile(14, 199, &code, 1);
+        TS_ASSERT(mapDataSet("teststorage.bds") == NULL);
+
+        // The untouched file still maps
+        TS_ASSERT(writeDataSet(dataset, "teststorage.bds"));
+        DataSet *mapped = mapDataSet("teststorage.bds");
+        TS_ASSERT(mapped != NULL);
+        TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(mapped, 199)->value, "kept"), 0);
+        freeDataSet(mapped);
+        freeDataSet(dataset);
+        remove("teststorage.bds");
+    }
+
+    void testMapInvalidFile()
+    {
+        TS_ASSERT(mapDataSet(NULL) == NULL);
+        TS_ASSERT(mapDataSet("teststorage.missing") == NULL);
+
+        FILE *file = fopen("teststorage.bds", "wb");
+        char junk[512] = "not a dataset";
+        fwrite(junk, 1, sizeof(junk), file);
+        fclose(file);
+        TS_ASSERT(mapDataSet("teststorage.bds") == NULL);
+        remove("teststorage.bds");
+
+        TS_ASSERT(!writeDataSet(NULL, "teststorage.bds"));
+    }
+};
@@ -0,0 +1,217 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/typed.h"
+#include "../src/filter.h"
+#include "../src/aggregate.h"
+#include "../src/encoding.h"
+#include "../src/stats.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+class TypedTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testTypedDataSetWorksWithCApi()
+    {
+        TypedDataSet<int32_t> typed(4);
+        TS_ASSERT(typed.valid());
+        for (int32_t i = 0; i < 1000; i++)
+        {
+            TS_ASSERT_EQUALS(typed.append(i * 3 - 500), i);
+        }
+        TS_ASSERT(typed.set(5, 42));
+
+        // A FLOAT stored through the C API is not seen by the INT column
+        float other = 1.5f;
+        DataPoint point = {FLOAT, &other};
+        TS_ASSERT(resizeDataSet(typed.get(), 1001));
+        addDataPoint(typed.get(), 1000, &point);
+        TS_ASSERT(!typed.set(1000, 7));
+
+        TypedColumn<int32_t> column = typed.column();
+        TS_ASSERT_EQUALS(column.size(), 1001);
+        TS_ASSERT_EQUALS(column.count(), 1000);
+        TS_ASSERT(column.has(999));
+        TS_ASSERT(!column.has(1000));
+        TS_ASSERT_EQUALS(column[5], 42);
+        TS_ASSERT_EQUALS(*(int *)getDataPoint(typed.get(), 7)->value, column[7]);
+
+        // Iteration visits the INT slots in order
+        int64_t expected = 0;
+        int64_t visited = 0;
+        for (TypedValue<int32_t> value : column)
+        {
+            TS_ASSERT_EQUALS(value.index, visited);
+            TS_ASSERT_EQUALS(value.value, column[value.index]);
+            expected += value.value;
+            visited++;
+        }
+        TS_ASSERT_EQUALS(visited, 1000);
+
+        // The kernels agree with the C API, before and after sealing
+        for (int sealed = 0; sealed < 2; sealed++)
+        {
+            TS_ASSERT_EQUALS(column.sum(), expected);
+            AggregateResult result;
+            TS_ASSERT(aggregateValues(typed.get(), INT, NULL, &result));
+            TS_ASSERT_EQUALS(column.sum(), result.intSum);
+            int32_t operand = 100;
+            Bitmap *fromC = filterIntValues(typed.get(), COMPARE_LT, &operand, 1);
+            Bitmap *typedSelection = column.select([](int32_t value) { return value < 100; });
+            TS_ASSERT_EQUALS(countBitmap(typedSelection), countBitmap(fromC));
+            TS_ASSERT_EQUALS(memcmp(typedSelection->words, fromC->words, 16 * sizeof(uint64_t)), 0);
+            freeBitmap(fromC);
+            freeBitmap(typedSelection);
+            if (!sealed)
+            {
+                TS_ASSERT(sealDataSet(typed.get()));
+                TS_ASSERT(column.values() == NULL);
+                TS_ASSERT_EQUALS(column[5], 42);
+            }
+        }
+        TS_ASSERT_EQUALS(typed.append(1), -1);
+
+        // Ownership moves with the object
+        TypedDataSet<int32_t> moved(std::move(typed));
+        TS_ASSERT(!typed.valid());
+        DataSet *released = moved.release();
+        TS_ASSERT_EQUALS(released->size, 1001);
+        TypedDataSet<int32_t> adopted = TypedDataSet<int32_t>::adopt(released);
+        TS_ASSERT_EQUALS(adopted.size(), 1001);
+    }
+
+    void testSealedColumnIsReadWithoutWriting()
+    {
+        TypedDataSet<int32_t> typed;
+        int64_t expected = 0;
+        for (int32_t i = 0; i < 5000; i++)
+        {
+            // Runs, a sorted stretch and noise, so the blocks get different encodings
+            int32_t value = i < 2000 ? 1000 + i / 100 : i < 4000 ? i * 7 : (i * 7919) % 1000 - 500;
+            typed.append(value);
+            expected += value;
+        }
+        TS_ASSERT(sealDataSet(typed.get()));
+
+        // Several threads walk the sealed column at once, each with its own block buffers
+        TypedColumn<int32_t> column = typed.column();
+        std::vector<int64_t> sums(4, 0);
+        std::vector<int64_t> mismatches(4, 0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.push_back(std::thread([&, t]() {
+                for (TypedValue<int32_t> value : column)
+                {
+                    sums[t] += value.value;
+                    mismatches[t] += value.value != column[value.index];
+                }
+                column.forEach([&](int64_t index, int32_t value) { mismatches[t] += value != column[index]; });
+                mismatches[t] += column.sum() != sums[t];
+            }));
+        }
+        for (int t = 0; t < 4; t++)
+        {
+            threads[t].join();
+            TS_ASSERT_EQUALS(sums[t], expected);
+            TS_ASSERT_EQUALS(mismatches[t], 0);
+        }
+        TS_ASSERT_EQUALS(column[4999], (4999 * 7919) % 1000 - 500);
+        Bitmap *runs = column.select([](int32_t value) { return value == 1003; });
+        TS_ASSERT_EQUALS(countBitmap(runs), 100);
+        TS_ASSERT(testBitmap(runs, 399));
+        freeBitmap(runs);
+    }
+
+    void testAppendLoopReallocatesLogarithmically()
+    {
+        TypedDataSet<float> typed(1);
+        for (int i = 0; i < 100000; i++)
+        {
+            TS_ASSERT_EQUALS(typed.append(i * 0.5f), i);
+        }
+        TS_ASSERT_EQUALS(typed.size(), 100000);
+        TS_ASSERT(typed.get()->stats.resizes <= 20);
+        TS_ASSERT_EQUALS(typed.column()[99999], 99999 * 0.5f);
+
+        // Strings appended one at a time grow the string arena geometrically as well
+        resetStats();
+        TypedDataSet<StringView> strings(1);
+        char text[16];
+        for (int i = 0; i < 20000; i++)
+        {
+            int length = snprintf(text, sizeof(text), "value-%d", i);
+            TS_ASSERT_EQUALS(strings.append(StringView{text, (uint32_t)length}), i);
+        }
+        TS_ASSERT(getStatCounter(STAT_BLOCK_ALLOCATIONS) <= 200);
+        TS_ASSERT_EQUALS(std::string(strings.column()[19999].data, strings.column()[19999].length), "value-19999");
+    }
+
+    void testFloatAndStringColumns()
+    {
+        TypedDataSet<float> floats;
+        std::vector<float> values;
+        for (int i = 0; i < 200; i++)
+        {
+            values.push_back(i * 0.5f);
+        }
+        TS_ASSERT(floats.append(values.data(), (int64_t)values.size()));
+        TS_ASSERT_DELTA(floats.column().sum(), 199 * 200 / 4.0, 1e-9);
+        Bitmap *large = floats.column().select([](float value) { return value >= 50.0f; });
+        TS_ASSERT_EQUALS(countBitmap(large), 100);
+        freeBitmap(large);
+
+        TypedDataSet<StringView> strings;
+        const char *words[3] = {"red", "green", "blue"};
+        for (int i = 0; i < 300; i++)
+        {
+            StringView view = {words[i % 3], (uint32_t)strlen(words[i % 3])};
+            TS_ASSERT_EQUALS(strings.append(view), i);
+        }
+        for (int dictionary = 0; dictionary < 2; dictionary++)
+        {
+            TypedColumn<StringView> column = strings.column();
+            TS_ASSERT_EQUALS(std::string(column[4].data, column[4].length), "green");
+            int64_t greens = 0;
+            column.forEach([&](int64_t index, StringView value) {
+                greens += value.length == 5 && memcmp(value.data, "green", 5) == 0;
+                TS_ASSERT_EQUALS(strcmp((char *)getDataPoint(strings.get(), index)->value, words[index % 3]), 0);
+            });
+            TS_ASSERT_EQUALS(greens, 100);
+            Bitmap *blues = column.select([](StringView value) { return value.length == 4; });
+            TS_ASSERT_EQUALS(countBitmap(blues), 100);
+            TS_ASSERT(testBitmap(blues, 2));
+            freeBitmap(blues);
+            TS_ASSERT(encodeStringDictionary(strings.get()));
+        }
+
+        // An empty column has nothing to visit
+        TypedColumn<float> empty(NULL);
+        TS_ASSERT_EQUALS(empty.count(), 0);
+        TS_ASSERT(empty.begin() == empty.end());
+    }
+
+    void testMoveAndEmplaceDataPoints()
+    {
+        DataSet *dataset = createDataSet(3);
+        int value = 9;
+        char text[] = "moved";
+        DataPointPtr point = makeDataPoint(STRING, text);
+        TS_ASSERT(addDataPoint(dataset, 0, std::move(point)));
+        TS_ASSERT(point == nullptr);
+        TS_ASSERT(addDataPoint(dataset, 1, makeDataPoint(INT, &value)));
+        TS_ASSERT(!addDataPoint(dataset, 1, makeDataPoint(STRING, text)));
+
+        std::string source = "built in place";
+        TS_ASSERT(emplaceString(dataset, 2, source.size(), [&](char *bytes, size_t length) {
+            memcpy(bytes, source.data(), length);
+        }));
+        TypedColumn<StringView> strings(dataset);
+        TS_ASSERT_EQUALS(strings.count(), 2);
+        TS_ASSERT_EQUALS(std::string(strings[0].data, strings[0].length), "moved");
+        TS_ASSERT_EQUALS(std::string(strings[2].data, strings[2].length), source);
+        TS_ASSERT_EQUALS(TypedColumn<int32_t>(dataset)[1], 9);
+        freeDataSet(dataset);
+    }
+};
@@ -0,0 +1,148 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/zonemap.h"
+#include "../src/filter.h"
+#include "../src/aggregate.h"
+
+class ZoneMapTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testZonesFollowWrites()
+    {
+        // Two full zones of time-ordered INT values and a partial zone of FLOAT and STRING values
+        const int64_t size = 2 * ZONE_SIZE + 1000;
+        DataSet *dataset = createDataSetWithCapacity(0);
+        int32_t *values = (int32_t *)malloc(2 * ZONE_SIZE * sizeof(int32_t));
+        for (int64_t i = 0; i < 2 * ZONE_SIZE; i++)
+        {
+            values[i] = (int32_t)(1000 + i * 2);
+        }
+        TS_ASSERT(addIntValues(dataset, 0, values, 2 * ZONE_SIZE));
+        free(values);
+        TS_ASSERT(resizeDataSet(dataset, size));
+        float numbers[3] = {2.5f, -1.0f, 0.0f / 0.0f};
+        TS_ASSERT(addFloatValues(dataset, 2 * ZONE_SIZE, numbers, 3));
+        DataPoint point = {STRING, (void *)"alpha"};
+        addDataPoint(dataset, size - 1, &point);
+
+        TS_ASSERT_EQUALS(countZones(dataset), 3);
+        const Zone *zones = dataset->zones;
+        TS_ASSERT_EQUALS(zones[0].counts[INT], ZONE_SIZE);
+        TS_ASSERT_EQUALS(zones[0].intMin, 1000);
+        TS_ASSERT_EQUALS(zones[0].intMax, 1000 + (ZONE_SIZE - 1) * 2);
+        TS_ASSERT_EQUALS(zones[1].intMin, 1000 + ZONE_SIZE * 2);
+        TS_ASSERT_EQUALS(zones[2].counts[FLOAT], 3);
+        TS_ASSERT_EQUALS(zones[2].floatMin, -1.0f);
+        TS_ASSERT_EQUALS(zones[2].floatMax, 2.5f);
+        TS_ASSERT(zones[2].floatNaN);
+        TS_ASSERT_EQUALS(zones[2].counts[STRING], 1);
+        TS_ASSERT_EQUALS(countZoneNulls(dataset, 0), 0);
+        TS_ASSERT_EQUALS(countZoneNulls(dataset, 2), 1000 - 4);
+        TS_ASSERT_EQUALS(countZoneNulls(dataset, 3), -1);
+
+        // Emptying every value of a type resets its bounds
+        TS_ASSERT(resizeDataSet(dataset, 2 * ZONE_SIZE + 1));
+        TS_ASSERT_EQUALS(dataset->zones[2].counts[FLOAT], 1);
+        TS_ASSERT(resizeDataSet(dataset, 2 * ZONE_SIZE));
+        TS_ASSERT_EQUALS(dataset->zones[2].counts[FLOAT], 0);
+        TS_ASSERT(!dataset->zones[2].floatNaN);
+        TS_ASSERT_EQUALS(dataset->zones[2].counts[STRING], 0);
+        freeDataSet(dataset);
+        TS_ASSERT_EQUALS(countZones(NULL), 0);
+    }
+
+    void testSkippingKeepsResults()
+    {
+        // Time-ordered values with a zone of strings only in the middle
+        const int64_t size = 5 * ZONE_SIZE;
+        DataSet *dataset = createDataSet(size);
+        for (int64_t i = 0; i < size; i++)
+        {
+            int value = (int)i;
+            float number = i * 0.25f;
+            char text[16];
+            snprintf(text, sizeof(text), "s%d", (int)(i % 5000));
+            DataPoint point = {INT, &value};
+            if (i / ZONE_SIZE == 2)
+            {
+                point.type = STRING;
+                point.value = text;
+            }
+            else if (i % 3 == 0)
+            {
+                point.type = FLOAT;
+                point.value = &number;
+            }
+            addDataPoint(dataset, i, &point);
+        }
+
+        int range[2] = {(int)ZONE_SIZE + 10, (int)ZONE_SIZE + 5000};
+        Bitmap *selection = filterIntValues(dataset, COMPARE_BETWEEN, range, 2);
+        int64_t expected = 0;
+        for (int64_t i = range[0]; i <= range[1]; i++)
+        {
+            expected += i % 3 != 0;
+        }
+        TS_ASSERT_EQUALS(countBitmap(selection), expected);
+        freeBitmap(selection);
+
+        // Every value of the last zones is above the operand, so they are selected whole
+        int floor = 3 * ZONE_SIZE;
+        selection = filterIntValues(dataset, COMPARE_GE, &floor, 1);
+        expected = 0;
+        for (int64_t i = floor; i < size; i++)
+        {
+            expected += i % 3 != 0;
+        }
+        TS_ASSERT_EQUALS(countBitmap(selection), expected);
+        freeBitmap(selection);
+
+        float threshold = 10.0f;
+        selection = filterFloatValues(dataset, COMPARE_LT, &threshold, 1);
+        TS_ASSERT_EQUALS(countBitmap(selection), 14);
+        freeBitmap(selection);
+
+        selection = filterStringEquals(dataset, "s42");
+        expected = 0;
+        for (int64_t i = 2 * ZONE_SIZE; i < 3 * ZONE_SIZE; i++)
+        {
+            expected += i % 5000 == 42;
+        }
+        TS_ASSERT_EQUALS(countBitmap(selection), expected);
+        freeBitmap(selection);
+        selection = filterStringEquals(dataset, "missing");
+        TS_ASSERT_EQUALS(countBitmap(selection), 0);
+        freeBitmap(selection);
+
+        AggregateResult result;
+        TS_ASSERT(aggregateValues(dataset, INT, NULL, &result));
+        TS_ASSERT_EQUALS(result.count, countByType(dataset, INT));
+        TS_ASSERT_EQUALS(result.min, 1.0);
+        TS_ASSERT_EQUALS(result.max, (double)(size - 1));
+        freeDataSet(dataset);
+    }
+
+    void testRebuildTightensBounds()
+    {
+        DataSet *dataset = createDataSet(1000);
+        int32_t values[1000];
+        for (int i = 0; i < 1000; i++)
+        {
+            values[i] = i == 500 ? 1000000 : i;
+        }
+        TS_ASSERT(addIntValues(dataset, 0, values, 1000));
+        values[500] = 500;
+        TS_ASSERT(addIntValues(dataset, 500, values + 500, 1));
+        TS_ASSERT_EQUALS(dataset->zones[0].intMax, 1000000);
+        TS_ASSERT_EQUALS(dataset->zones[0].counts[INT], 1000);
+
+        TS_ASSERT(rebuildZoneMaps(dataset));
+        TS_ASSERT_EQUALS(dataset->zones[0].intMax, 999);
+        TS_ASSERT_EQUALS(dataset->zones[0].counts[INT], 1000);
+        int operand = 5000;
+        Bitmap *selection = filterIntValues(dataset, COMPARE_GT, &operand, 1);
+        TS_ASSERT_EQUALS(countBitmap(selection), 0);
+        freeBitmap(selection);
+        TS_ASSERT(!rebuildZoneMaps(NULL));
+        freeDataSet(dataset);
+    }
+};
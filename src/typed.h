@@ -0,0 +1,543 @@
+#ifndef TYPED_H
+#define TYPED_H
+
+#include "bitmap.h"
+#include "encoding.h"
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/*
+Typed access to datasets for C++ callers. A TypedColumn<T> reads the values of one type of a
+dataset, with T being int32_t for INT, float for FLOAT and StringView for STRING, so the
+type is fixed at compile time and a loop over the column reads the column array directly
+instead of switching on the type of every data point. A TypedDataSet<T> owns a dataset that
+holds values of one type and hands out its column. Both work on the same DataSet struct as
+the C API, so a dataset can be filled through one and read through the other. A DataPointPtr
+moves a data point into a dataset, which frees it, and emplaceString builds a string straight
+in the string arena. Everything here is inline; there is nothing to link.
+*/
+
+// Define a struct for the DataType of a C++ value type, known at compile time
+template <typename T>
+struct DataTypeOf;
+
+template <>
+struct DataTypeOf<int32_t>
+{
+    static constexpr DataType value = INT;
+};
+
+template <>
+struct DataTypeOf<float>
+{
+    static constexpr DataType value = FLOAT;
+};
+
+template <>
+struct DataTypeOf<StringView>
+{
+    static constexpr DataType value = STRING;
+};
+
+// Define a struct for a value of a typed column and the slot holding it
+template <typename T>
+struct TypedValue
+{
+    int64_t index;
+    T value;
+};
+
+// Define a class for a read-only view of the values of one type of a dataset
+// The view holds no copy: it reads the columns and bitmaps of the dataset, so it follows
+// later writes and is invalidated, like a pointer returned by getDataPoint, when the
+// dataset is resized or freed. Slots that hold no value of the type are passed over.
+// Reading never writes to the dataset; a sealed INT column is decoded a block at a time
+// into a buffer of the loop or iterator walking it.
+template <typename T>
+class TypedColumn
+{
+    static_assert(std::is_same<T, int32_t>::value || std::is_same<T, float>::value ||
+                      std::is_same<T, StringView>::value,
+                  "a typed column holds int32_t, float or StringView values");
+
+    // Define a struct for the block of a sealed INT column decoded last
+    struct SealedBlock
+    {
+        int64_t index;
+        int32_t values[INT_BLOCK_SIZE];
+    };
+
+public:
+    static constexpr DataType type = DataTypeOf<T>::value;
+
+    // The sum of a column: exact for INT values, a double for FLOAT values
+    typedef typename std::conditional<std::is_same<T, int32_t>::value, int64_t, double>::type SumType;
+
+    explicit TypedColumn(const DataSet *dataset) : dataset(dataset) {}
+
+    // Number of slots of the dataset, with or without a value of the type
+    int64_t size() const
+    {
+        return dataset != NULL ? dataset->size : 0;
+    }
+
+    // Number of slots holding a value of the type
+    int64_t count() const
+    {
+        int64_t total = 0;
+        for (int64_t w = 0; w < words(); w++)
+        {
+            total += __builtin_popcountll(bits()[w]);
+        }
+        return total;
+    }
+
+    // Whether slot index holds a value of the type
+    bool has(int64_t index) const
+    {
+        return index >= 0 && index < size() && ((bits()[index >> 6] >> (index & 63)) & 1);
+    }
+
+    // Get the value held by slot index, which must hold a value of the type
+    T operator[](int64_t index) const
+    {
+        if constexpr (std::is_same<T, StringView>::value)
+        {
+            const StringDictionary *dictionary = dataset->dictionary;
+            if (dictionary != NULL)
+            {
+                uint32_t code = dictionary->codeWidth == 1   ? ((const uint8_t *)dictionary->codes)[index]
+                                : dictionary->codeWidth == 2 ? ((const uint16_t *)dictionary->codes)[index]
+                                                             : ((const uint32_t *)dictionary->codes)[index];
+                return StringView{dataset->strings.bytes + dictionary->offsets[code], dictionary->lengths[code]};
+            }
+            return StringView{dataset->strings.bytes + dataset->strings.offsets[index], dataset->strings.lengths[index]};
+        }
+        else
+        {
+            const T *column = values();
+            if constexpr (std::is_same<T, int32_t>::value)
+            {
+                if (column == NULL)
+                {
+                    // A sealed INT value is decoded on its own
+                    return readSealedInt(dataset, index);
+                }
+            }
+            return column[index];
+        }
+    }
+
+    // Get the column array of an INT or FLOAT column, NULL if none is allocated or it is sealed
+    // Slots without a value of the type hold unspecified values; the type bitmap tells them apart.
+    const T *values() const
+    {
+        if constexpr (std::is_same<T, int32_t>::value)
+        {
+            return dataset != NULL ? dataset->ints : NULL;
+        }
+        else if constexpr (std::is_same<T, float>::value)
+        {
+            return dataset != NULL ? dataset->floats : NULL;
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+
+    // Call f(index, value) for every slot holding a value of the type, in slot order
+    template <typename F>
+    void forEach(F f) const
+    {
+        std::shared_ptr<SealedBlock> block = sealedBlock();
+        for (int64_t w = 0; w < words(); w++)
+        {
+            for (uint64_t mask = bits()[w]; mask != 0; mask &= mask - 1)
+            {
+                int64_t index = w * 64 + __builtin_ctzll(mask);
+                f(index, at(index, block.get()));
+            }
+        }
+    }
+
+    /*
+    This function selects the slots holding a value of the type that satisfies a predicate.
+    An INT or FLOAT column is compared 64 slots at a time, every slot of a word whatever it
+    holds, into a mask of the word that is then cut down to the slots of the type, so the
+    comparison has no branch and the compiler can vectorize it. A sealed INT column is
+    compared the same way in its decoded blocks. It returns a bitmap the
+    caller frees with freeBitmap, or NULL if memory runs out.
+    */
+    template <typename Predicate>
+    Bitmap *select(Predicate predicate) const
+    {
+        Bitmap *selection = createBitmap(size());
+        if (selection == NULL)
+        {
+            return NULL;
+        }
+        const T *column = values();
+        std::shared_ptr<SealedBlock> block = sealedBlock();
+        for (int64_t w = 0; w < words(); w++)
+        {
+            uint64_t held = bits()[w];
+            if (held == 0)
+            {
+                continue;
+            }
+            uint64_t mask = 0;
+            if constexpr (!std::is_same<T, StringView>::value)
+            {
+                const T *chunk = wordValues(w, column, block.get());
+                if (chunk != NULL)
+                {
+                    int length = size() - w * 64 < 64 ? (int)(size() - w * 64) : 64;
+                    for (int i = 0; i < length; i++)
+                    {
+                        mask |= (uint64_t)(predicate(chunk[i]) ? 1 : 0) << i;
+                    }
+                    selection->words[w] = mask & held;
+                    continue;
+                }
+            }
+            for (uint64_t rest = held; rest != 0; rest &= rest - 1)
+            {
+                int bit = __builtin_ctzll(rest);
+                mask |= (uint64_t)(predicate((*this)[w * 64 + bit]) ? 1 : 0) << bit;
+            }
+            selection->words[w] = mask;
+        }
+        return selection;
+    }
+
+    // Sum the INT or FLOAT values of the column; a full word is summed without looking at its bits
+    SumType sum() const
+    {
+        static_assert(!std::is_same<T, StringView>::value, "STRING values have no sum");
+        SumType total = 0;
+        const T *column = values();
+        std::shared_ptr<SealedBlock> block = sealedBlock();
+        for (int64_t w = 0; w < words(); w++)
+        {
+            uint64_t held = bits()[w];
+            const T *chunk = held == ~(uint64_t)0 ? wordValues(w, column, block.get()) : NULL;
+            if (chunk != NULL)
+            {
+                SumType part = 0;
+                for (int i = 0; i < 64; i++)
+                {
+                    part += chunk[i];
+                }
+                total += part;
+                continue;
+            }
+            for (; held != 0; held &= held - 1)
+            {
+                total += at(w * 64 + __builtin_ctzll(held), block.get());
+            }
+        }
+        return total;
+    }
+
+    // Define a class for an iterator over the values of the column, in slot order
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef TypedValue<T> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const TypedValue<T> *pointer;
+        typedef TypedValue<T> reference;
+
+        iterator(const TypedColumn *column, int64_t word) : column(column), word(word), mask(0)
+        {
+            if (word < column->words())
+            {
+                mask = column->bits()[word];
+                block = column->sealedBlock();
+                skipEmptyWords();
+            }
+        }
+
+        TypedValue<T> operator*() const
+        {
+            int64_t index = word * 64 + __builtin_ctzll(mask);
+            return TypedValue<T>{index, column->at(index, block.get())};
+        }
+
+        iterator &operator++()
+        {
+            mask &= mask - 1;
+            skipEmptyWords();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const iterator &other) const
+        {
+            return word == other.word && mask == other.mask;
+        }
+
+        bool operator!=(const iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        // Move to the next word holding a value of the type, or to the end
+        void skipEmptyWords()
+        {
+            while (mask == 0 && ++word < column->words())
+            {
+                mask = column->bits()[word];
+            }
+            if (mask == 0)
+            {
+                word = column->words();
+            }
+        }
+
+        const TypedColumn *column;
+        int64_t word;
+        uint64_t mask;
+        std::shared_ptr<SealedBlock> block; // shared by the copies of the iterator
+    };
+
+    iterator begin() const
+    {
+        return iterator(this, 0);
+    }
+
+    iterator end() const
+    {
+        return iterator(this, words());
+    }
+
+private:
+    // Allocate a block buffer for walking a sealed INT column, NULL for any other column
+    std::shared_ptr<SealedBlock> sealedBlock() const
+    {
+        if constexpr (std::is_same<T, int32_t>::value)
+        {
+            if (dataset != NULL && dataset->encodedInts != NULL)
+            {
+                std::shared_ptr<SealedBlock> block(new SealedBlock);
+                block->index = -1;
+                return block;
+            }
+        }
+        return nullptr;
+    }
+
+    // Get the decoded values of a sealed INT column from slot index to the end of its block
+    const int32_t *decoded(int64_t index, SealedBlock *block) const
+    {
+        int64_t b = index / INT_BLOCK_SIZE;
+        if (block->index != b)
+        {
+            decodeSealedInts(dataset, b, block->values);
+            block->index = b;
+        }
+        return block->values + (index - b * INT_BLOCK_SIZE);
+    }
+
+    // Get the value held by slot index, through the block buffer when the column is sealed
+    T at(int64_t index, SealedBlock *block) const
+    {
+        if constexpr (std::is_same<T, int32_t>::value)
+        {
+            if (block != NULL)
+            {
+                return *decoded(index, block);
+            }
+        }
+        return (*this)[index];
+    }
+
+    // Get the values of the 64 slots of word w as an array, NULL for a STRING column
+    const T *wordValues(int64_t w, const T *column, SealedBlock *block) const
+    {
+        if (column != NULL)
+        {
+            return column + w * 64;
+        }
+        if constexpr (std::is_same<T, int32_t>::value)
+        {
+            if (block != NULL)
+            {
+                return decoded(w * 64, block);
+            }
+        }
+        return NULL;
+    }
+
+    int64_t words() const
+    {
+        return (size() + 63) / 64;
+    }
+
+    const uint64_t *bits() const
+    {
+        return dataset->typeIndex[type].words;
+    }
+
+    const DataSet *dataset;
+};
+
+// Store count values of one type from slot start on, choosing the C function at compile time
+static inline bool addTypedValues(DataSet *dataset, int64_t start, const int32_t *values, int64_t count)
+{
+    return addIntValues(dataset, start, values, count);
+}
+
+static inline bool addTypedValues(DataSet *dataset, int64_t start, const float *values, int64_t count)
+{
+    return addFloatValues(dataset, start, values, count);
+}
+
+static inline bool addTypedValues(DataSet *dataset, int64_t start, const StringView *values, int64_t count)
+{
+    return addStringValues(dataset, start, values, count);
+}
+
+// Define a class for a dataset that owns its DataSet and holds values of one type
+// The dataset can still be passed to any C function through get(); a value of another type
+// stored that way is simply not seen by the column.
+template <typename T>
+class TypedDataSet
+{
+public:
+    // Create an empty dataset with room for capacity values; valid() is false if memory runs out
+    explicit TypedDataSet(int64_t capacity = 0) : dataset(createDataSetWithCapacity(capacity)) {}
+
+    // Take ownership of a dataset created through the C API
+    static TypedDataSet adopt(DataSet *dataset)
+    {
+        return TypedDataSet(Adopted(), dataset);
+    }
+
+    TypedDataSet(TypedDataSet &&other) noexcept : dataset(other.dataset)
+    {
+        other.dataset = NULL;
+    }
+
+    TypedDataSet &operator=(TypedDataSet &&other) noexcept
+    {
+        std::swap(dataset, other.dataset);
+        return *this;
+    }
+
+    TypedDataSet(const TypedDataSet &) = delete;
+    TypedDataSet &operator=(const TypedDataSet &) = delete;
+
+    ~TypedDataSet()
+    {
+        freeDataSet(dataset);
+    }
+
+    bool valid() const
+    {
+        return dataset != NULL;
+    }
+
+    int64_t size() const
+    {
+        return dataset != NULL ? dataset->size : 0;
+    }
+
+    // Append a value, returning its index, or -1 if the dataset is read-only or memory runs out
+    int64_t append(T value)
+    {
+        int64_t index = size();
+        return addTypedValues(dataset, index, &value, 1) ? index : -1;
+    }
+
+    // Append count values at once, growing the arrays once
+    bool append(const T *values, int64_t count)
+    {
+        return addTypedValues(dataset, size(), values, count);
+    }
+
+    // Store a value into slot index, which may be at the end of the dataset
+    bool set(int64_t index, T value)
+    {
+        return addTypedValues(dataset, index, &value, 1);
+    }
+
+    TypedColumn<T> column() const
+    {
+        return TypedColumn<T>(dataset);
+    }
+
+    // Get the dataset for the C API; it stays owned by this object
+    DataSet *get() const
+    {
+        return dataset;
+    }
+
+    // Give up ownership of the dataset, which the caller then frees with freeDataSet
+    DataSet *release()
+    {
+        DataSet *released = dataset;
+        dataset = NULL;
+        return released;
+    }
+
+private:
+    struct Adopted
+    {
+    };
+
+    TypedDataSet(Adopted, DataSet *dataset) : dataset(dataset) {}
+
+    DataSet *dataset;
+};
+
+// Define a struct for freeing a data point created by createDataPoint
+struct DataPointDeleter
+{
+    void operator()(DataPoint *point) const
+    {
+        if (point != NULL)
+        {
+            free(point->value);
+            free(point);
+        }
+    }
+};
+
+// Define a type for a data point owned by the caller until it is moved into a dataset
+typedef std::unique_ptr<DataPoint, DataPointDeleter> DataPointPtr;
+
+// Create a data point owned by a DataPointPtr, empty if the arguments are invalid or memory runs out
+static inline DataPointPtr makeDataPoint(DataType type, void *value)
+{
+    return DataPointPtr(createDataPoint(type, value));
+}
+
+// Move a data point into a slot of a dataset; it is freed whether or not it could be stored
+static inline bool addDataPoint(DataSet *dataset, int64_t index, DataPointPtr &&point)
+{
+    return adoptDataPoint(dataset, index, point.release());
+}
+
+// Construct a STRING value of a given length in place in a slot, fill(bytes, length) writing its bytes
+template <typename Fill>
+bool emplaceString(DataSet *dataset, int64_t index, size_t length, Fill fill)
+{
+    return emplaceStringValue(
+        dataset, index, length, [](char *bytes, size_t length, void *context) { (*(Fill *)context)(bytes, length); }, &fill);
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+#include "bitmap.h"
+
+// Function to get the number of zones covering the slots of a dataset
+int64_t countZones(DataSet *dataset);
+
+// Function to count the empty slots of a zone of a dataset
+int64_t countZoneNulls(DataSet *dataset, int64_t zone);
+
+// Function to recompute the zone maps of a dataset from the values it holds
+bool rebuildZoneMaps(DataSet *dataset);
+
+#endif